@@ -1,69 +1,40 @@
 #include "pch.h"
 #include "CppUnitTest.h"
 
+#include <climits>
 #include <cstdio>
 #include <cstring>
 #include <string>
 
-extern "C" {
-    struct years;
-    struct months;
-    struct days;
-    struct tasks;
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "../My Calendar Project Repo/AsyncFile.h"
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/CalendarContext.h"
+#include "../My Calendar Project Repo/CalendarJobs.h"
+#include "../My Calendar Project Repo/CommandServer.h"
+#include "../My Calendar Project Repo/Commands.h"
+#include "../My Calendar Project Repo/Epoch.h"
+#include "../My Calendar Project Repo/EventRing.h"
+#include "../My Calendar Project Repo/MemStats.h"
+#include "../My Calendar Project Repo/OpStats.h"
+#include "../My Calendar Project Repo/Platform.h"
+#include "../My Calendar Project Repo/Query.h"
+#include "../My Calendar Project Repo/QueryCache.h"
+#include "../My Calendar Project Repo/Render.h"
+#include "../My Calendar Project Repo/RenderCache.h"
+#include "../My Calendar Project Repo/SharedCalendar.h"
+#include "../My Calendar Project Repo/TermIndex.h"
+#include "../My Calendar Project Repo/Trace.h"
+#include "../My Calendar Project Repo/WorkPool.h"
+#include "../My Calendar Project Repo/Workload.h"
 
-    struct years {
-        int year_number;
-        struct months* months;
-        struct years* next;
-    };
-
-    struct months {
-        int month_number;
-        const char* month_name;
-        struct days* days;
-        int num_days;
-    };
-
-    struct days {
-        int day_number;
-        const char* day_name;
-        struct tasks* tasks_head;
-    };
-
-    struct tasks {
-        int task_id;
-        char* task_description;
-        struct tasks* next;
-        struct tasks* prev;
-        struct tasks* loop;
-    };
-
-    // date helpers
-    int dayOfWeek(int year, int month, int day);
-    int isLeap(int year);
-    int daysInMonth(int year, int month);
-
-    // calendar creation
-    struct years* findOrAddYear(struct years** calendar_head, int year_number);
-
-    // task ops
-    void addTask(struct years** calendar_head, int year, int month, int day, const char* desc);
-    struct days* getDayNode(struct years* calendar_head, int year, int month, int day);
-    int listTasksForDayNode(struct days* day_node);
-    int updateTask(struct years* calendar_head, int year, int month, int day, int task_id, const char* new_desc);
-    int deleteTask(struct years* calendar_head, int year, int month, int day, int task_id);
-
-    // search helpers
-    int containsIgnoreCase(const char* text, const char* key);
-    void searchTasks(struct years* calendar_head, const char* keyword); // prints results
-
-    // file I/O
-    struct years* loadTasks(const char* filename);
-    int saveTasks(const char* filename, struct years* calendar_head);
-
-    // memory cleanup
-    void freeCalendar(struct years* calendar_head);
-}
 //Note: All of the the tests were coded cooperatively
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -96,6 +67,14 @@ namespace CalendarAppTests
         return NULL;
     }
 
+    // Counts every callback it gets
+    static int CountMatchCallback(const struct task_match* match, void* user_data)
+    {
+        (void)match;
+        (*(int*)user_data)++;
+        return 1;
+    }
+
     // Helper to count keyword matches across calendar by scanning nodes
     // (Instead of relying on searchTasks() printing)
     static int CountMatches(struct years* cal, const char* keyword)
@@ -120,6 +99,36 @@ namespace CalendarAppTests
         return matches;
     }
 
+    // Helper to count query matches (-1 if the query doesn't parse)
+    static int CountQueryMatches(struct years* cal, const char* text)
+    {
+        struct query* q = parseQuery(text, NULL, 0);
+        if (!q) return -1;
+
+        int matches = 0;
+        runQuery(cal, q, 0, CountMatchCallback, &matches);
+        freeQuery(q);
+        return matches;
+    }
+
+    // Collects range results as "YYYY-MM-DD desc" strings, in the order they were reported
+    static int CollectRangeResult(const struct task_match* match, void* user_data)
+    {
+        char line[300];
+        snprintf(line, sizeof(line), "%04d-%02d-%02d %s", match->year, match->month, match->day,
+            match->task->task_description);
+        ((std::string*)user_data)->append(line).append(";");
+        return 1;
+    }
+
+    // Stops the search after the first hit
+    static int StopAfterFirst(const struct task_match* match, void* user_data)
+    {
+        (void)match;
+        (*(int*)user_data)++;
+        return 0;
+    }
+
     TEST_CLASS(DateMathTests)
     {
     public:
@@ -178,6 +187,76 @@ namespace CalendarAppTests
 
             freeCalendar(cal);
         }
+
+        TEST_METHOD(YearsShareFourteenSkeletons)
+        {
+            // 2015 and 2026 both start on a Thursday, 1996 and 2024 are leap years starting on a Monday
+            Assert::IsTrue(yearSkeleton(2015) == yearSkeleton(2026));
+            Assert::IsTrue(yearSkeleton(1996) == yearSkeleton(2024));
+            Assert::IsFalse(yearSkeleton(2024) == yearSkeleton(2025));
+
+            const struct year_skeleton* seen[14] = {};
+            int distinct = 0;
+            for (int year = 2000; year < 2400; year++) {
+                const struct year_skeleton* skeleton = yearSkeleton(year);
+                int known = 0;
+                for (int i = 0; i < distinct; i++) known |= seen[i] == skeleton;
+                if (!known) seen[distinct++] = skeleton;
+            }
+            Assert::AreEqual(14, distinct);
+
+            struct years* cal = NULL;
+            struct years* y2026 = findOrAddYear(&cal, 2026);
+            Assert::IsTrue(y2026->skeleton == yearSkeleton(2015));
+            Assert::AreEqual(std::string("February"), std::string(y2026->months[1].month_name));
+            Assert::AreEqual(28, y2026->months[1].num_days);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(SkeletonsMatchDayOfWeek)
+        {
+            Assert::AreEqual(std::string("Monday"), std::string(dayName(2025, 12, 15)));
+            Assert::AreEqual(std::string("Thursday"), std::string(dayName(2026, 1, 1)));
+            Assert::AreEqual(std::string(""), std::string(dayName(2025, 2, 29)));
+
+            // negative years included: the weekdays have to run on from one year into the next
+            for (int year = -1200; year <= 2800; year++) {
+                const struct year_skeleton* skeleton = yearSkeleton(year);
+                for (int m = 1; m <= 12; m++) {
+                    Assert::AreEqual(dayOfWeek(year, m, 1), skeleton->months[m - 1].first_weekday);
+                }
+                Assert::AreEqual((dayOfWeek(year, 12, 31) + 1) % 7, dayOfWeek(year + 1, 1, 1));
+            }
+
+            // the extremes land on the same place in the 400-year cycle as any other year
+            Assert::AreEqual(dayOfWeek(352, 1, 1), dayOfWeek(INT_MIN, 1, 1));
+            Assert::AreEqual(dayOfWeek(47, 12, 31), dayOfWeek(INT_MAX, 12, 31));
+        }
+
+        TEST_METHOD(DayArraysComeWithTheFirstTask)
+        {
+            struct years* cal = NULL;
+            struct years* year = findOrAddYear(&cal, 2030);
+
+            // every month starts out on the same shared, empty days
+            for (int m = 1; m < 12; m++) Assert::IsTrue(year->months[m].days == year->months[0].days);
+            // and hands none of them out: they're read-only
+            Assert::IsNull(getDayNode(cal, 2030, 5, 31));
+
+            addTask(&cal, 2030, 5, 31, "first");
+            Assert::IsFalse(year->months[4].days == year->months[0].days);
+            Assert::IsTrue(year->months[3].days == year->months[0].days);
+            Assert::IsNull(getDayNode(cal, 2030, 4, 30));
+            Assert::IsNull(getDayNode(cal, 2030, 5, 30)->tasks_head);
+            Assert::AreEqual(std::string("first"), std::string(getDayNode(cal, 2030, 5, 31)->tasks_head->task_description));
+
+            // a second task in the month keeps the same array
+            struct days* may = year->months[4].days;
+            addTask(&cal, 2030, 5, 1, "second");
+            Assert::IsTrue(year->months[4].days == may);
+
+            freeCalendar(cal);
+        }
     };
 
     TEST_CLASS(TaskAddTests)
@@ -395,6 +474,86 @@ namespace CalendarAppTests
         }
     };
 
+    TEST_CLASS(BulkOpsTests)
+    {
+    public:
+        TEST_METHOD(AddTasks_GroupsByDayAndKeepsInputOrder)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 4, 1, "already there");
+
+            struct task_entry entries[] = {
+                { 2025, 4, 1, "a" },
+                { 2024, 2, 29, "leap" },
+                { 2025, 4, 1, "b" },
+                { 2025, 2, 30, "bad day" },
+                { 2025, 13, 1, "bad month" },
+                { 2025, 4, 1, "c" },
+            };
+            int statuses[6];
+
+            Assert::AreEqual(4, addTasks(&cal, entries, 6, statuses));
+            Assert::AreEqual((int)CALENDAR_OK, statuses[0]);
+            Assert::AreEqual((int)CALENDAR_INVALID_DATE, statuses[3]);
+            Assert::AreEqual((int)CALENDAR_INVALID_DATE, statuses[4]);
+
+            // appended after the existing task, in input order, with the next ids
+            Assert::AreEqual(4, CountTasksForDay(cal, 2025, 4, 1));
+            Assert::AreEqual(0, strcmp("b", GetNthTaskNode(cal, 2025, 4, 1, 3)->task_description));
+            Assert::AreEqual(4, GetNthTaskNode(cal, 2025, 4, 1, 4)->task_id);
+            Assert::AreEqual(1, CountTasksForDay(cal, 2024, 2, 29));
+
+            // range views see the new tasks (counts / occupancy kept up to date)
+            std::string got;
+            forEachTaskInRange(cal, 2024, 1, 1, 2024, 12, 31, CollectRangeResult, &got);
+            Assert::AreEqual(0, strcmp("2024-02-29 leap;", got.c_str()));
+
+            // a bad date doesn't leave an empty year behind
+            Assert::IsNull(findYear(cal, 2023));
+
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(DeleteTasks_UsesIdsFromBeforeTheBatch)
+        {
+            struct years* cal = NULL;
+            struct task_entry entries[] = {
+                { 2025, 9, 1, "one" }, { 2025, 9, 1, "two" }, { 2025, 9, 1, "three" },
+                { 2025, 9, 2, "other day" },
+            };
+            addTasks(&cal, entries, 4, NULL);
+
+            struct task_ref refs[] = {
+                { 2025, 9, 1, 3 },
+                { 2025, 9, 1, 1 },
+                { 2025, 9, 1, 1 },      // repeat
+                { 2025, 9, 1, 7 },      // no such id
+                { 1999, 9, 1, 1 },      // year not loaded
+                { 2025, 9, 2, 1 },
+            };
+            int statuses[6];
+
+            Assert::AreEqual(3, deleteTasks(cal, refs, 6, statuses));
+            Assert::AreEqual((int)CALENDAR_OK, statuses[0]);
+            Assert::AreEqual((int)CALENDAR_OK, statuses[1]);
+            Assert::AreEqual((int)CALENDAR_NOT_FOUND, statuses[2]);
+            Assert::AreEqual((int)CALENDAR_NOT_FOUND, statuses[3]);
+            Assert::AreEqual((int)CALENDAR_INVALID_DATE, statuses[4]);
+            Assert::AreEqual((int)CALENDAR_OK, statuses[5]);
+
+            // "two" is left, renumbered to 1
+            Assert::AreEqual(1, CountTasksForDay(cal, 2025, 9, 1));
+            Assert::AreEqual(0, strcmp("two", GetNthTaskNode(cal, 2025, 9, 1, 1)->task_description));
+            Assert::AreEqual(1, GetNthTaskNode(cal, 2025, 9, 1, 1)->task_id);
+
+            int matches = 0;
+            forEachTaskInRange(cal, 2025, 9, 2, 2025, 9, 2, CountMatchCallback, &matches);
+            Assert::AreEqual(0, matches);
+
+            freeCalendar(cal);
+        }
+    };
+
     TEST_CLASS(SearchHelperTests)
     {
     public:
@@ -423,40 +582,2959 @@ namespace CalendarAppTests
             freeCalendar(cal);
         }
 
+        TEST_METHOD(SearchInto_FillsDatesAndTaskPointers)
+        {
+            struct years* cal = NULL;
+
+            addTask(&cal, 2025, 11, 29, "Buy groceries");
+            addTask(&cal, 2025, 11, 29, "Call mom");
+            addTask(&cal, 2025, 11, 29, "More groceries");
+
+            struct task_match results[4];
+            int n = searchTasksInto(cal, "GROCERIES", results, 4);
+            Assert::AreEqual(2, n);
+
+            Assert::AreEqual(2025, results[0].year);
+            Assert::AreEqual(11, results[0].month);
+            Assert::AreEqual(29, results[0].day);
+            Assert::AreEqual(1, results[0].task->task_id);
+            Assert::AreEqual(3, results[1].task->task_id);
+            Assert::IsTrue(results[0].day_node == getDayNode(cal, 2025, 11, 29));
+
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(SearchEach_LimitAndEarlyStop)
+        {
+            struct years* cal = NULL;
+
+            addTask(&cal, 2025, 1, 1, "gym");
+            addTask(&cal, 2025, 1, 2, "gym");
+            addTask(&cal, 2025, 1, 3, "gym");
+
+            // result limit caps the number of hits reported
+            int seen = 0;
+            Assert::AreEqual(2, searchTasksEach(cal, "gym", 2, CountMatchCallback, &seen));
+            Assert::AreEqual(2, seen);
+
+            // callback returning 0 stops the scan right away
+            seen = 0;
+            Assert::AreEqual(1, searchTasksEach(cal, "gym", 0, StopAfterFirst, &seen));
+            Assert::AreEqual(1, seen);
+
+            // buffer smaller than the hit count is never overrun
+            struct task_match one[1];
+            Assert::AreEqual(1, searchTasksInto(cal, "gym", one, 1));
+
+            // empty keyword reports nothing
+            Assert::AreEqual(0, CountMatches(cal, ""));
+
+            freeCalendar(cal);
+        }
+
        
     };
 
-    TEST_CLASS(FileIOTests)
+    TEST_CLASS(RangeQueryTests)
     {
     public:
-        TEST_METHOD(SaveLoad_RoundTripPreservesTasks)
+        TEST_METHOD(YearsStaySortedWhateverTheInsertOrder)
         {
-            // write to a predictable test file name
-            const char* fname = "tasks_test.txt";
+            struct years* cal = NULL;
+
+            findOrAddYear(&cal, 2026);
+            findOrAddYear(&cal, 2024);
+            findOrAddYear(&cal, 2025);
+
+            Assert::AreEqual(2024, cal->year_number);
+            Assert::AreEqual(2025, cal->next->year_number);
+            Assert::AreEqual(2026, cal->next->next->year_number);
+            Assert::IsNull(findYear(cal, 2023));
+            Assert::IsTrue(findYear(cal, 2025) == cal->next);
+
+            freeCalendar(cal);
+        }
 
+        TEST_METHOD(RangeCrossesMonthAndYearInOrder)
+        {
             struct years* cal = NULL;
 
-            addTask(&cal, 2025, 12, 25, "Christmas Day");
-            addTask(&cal, 2025, 12, 25, "Dinner at 6");
-            addTask(&cal, 2026, 1, 1, "New Year's Day");
+            addTask(&cal, 2026, 1, 2, "c");
+            addTask(&cal, 2025, 12, 31, "b");
+            addTask(&cal, 2025, 11, 30, "a");
+            addTask(&cal, 2025, 12, 31, "b2");
+            addTask(&cal, 2026, 2, 1, "outside");
+            addTask(&cal, 2025, 11, 29, "outside");
 
-            int saved = saveTasks(fname, cal);
-            Assert::IsTrue(saved == 1);
+            std::string seen;
+            int n = forEachTaskInRange(cal, 2025, 11, 30, 2026, 1, 31, CollectRangeResult, &seen);
+
+            Assert::AreEqual(4, n);
+            Assert::AreEqual(std::string("2025-11-30 a;2025-12-31 b;2025-12-31 b2;2026-01-02 c;"), seen);
+
+            // backwards range is empty
+            Assert::AreEqual(0, forEachTaskInRange(cal, 2026, 1, 1, 2025, 1, 1, CollectRangeResult, &seen));
 
             freeCalendar(cal);
-            cal = NULL;
+        }
 
-            // load into fresh structure
-            cal = loadTasks(fname);
-            Assert::IsNotNull(cal);
+        TEST_METHOD(OccupancyTracksAddsAndDeletes)
+        {
+            struct years* cal = NULL;
 
-            Assert::AreEqual(2, CountTasksForDay(cal, 2025, 12, 25));
-            Assert::AreEqual(1, CountTasksForDay(cal, 2026, 1, 1));
+            addTask(&cal, 2025, 3, 19, "A");
+            addTask(&cal, 2025, 3, 19, "B");
+            addTask(&cal, 2025, 3, 1, "C");
+
+            struct years* y = findYear(cal, 2025);
+            Assert::AreEqual(3, y->task_count);
+            Assert::AreEqual(3, y->months[2].task_count);
+            Assert::IsTrue(y->months[2].occupied_days == ((1u << 18) | 1u));
+
+            deleteTask(cal, 2025, 3, 19, 1);
+            Assert::IsTrue(y->months[2].occupied_days == ((1u << 18) | 1u));
+            deleteTask(cal, 2025, 3, 19, 1);
+            Assert::IsTrue(y->months[2].occupied_days == 1u);
+            Assert::AreEqual(1, y->task_count);
 
-            // cleanup calendar
             freeCalendar(cal);
+        }
+    };
 
-            // cleanup file (best effort)
+    TEST_CLASS(QueryTests)
+    {
+    private:
+        struct years* calendar = NULL;
+
+    public:
+        TEST_METHOD_INITIALIZE(Setup)
+        {
+            addTask(&calendar, 2025, 11, 3, "deploy api to prod");
+            addTask(&calendar, 2025, 11, 4, "deploy api to staging");
+            addTask(&calendar, 2025, 12, 1, "deploy web to prod and staging");
+            addTask(&calendar, 2024, 6, 1, "code review with Sam");
+            addTask(&calendar, 2025, 1, 9, "Code Review prep");
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            freeCalendar(calendar);
+            calendar = NULL;
+        }
+
+        TEST_METHOD(AndOrNot)
+        {
+            Assert::AreEqual(3, CountQueryMatches(calendar, "deploy"));
+            Assert::AreEqual(1, CountQueryMatches(calendar, "deploy AND prod NOT staging"));
+            Assert::AreEqual(2, CountQueryMatches(calendar, "deploy prod"));          // implicit AND
+            Assert::AreEqual(4, CountQueryMatches(calendar, "staging OR review"));
+            Assert::AreEqual(2, CountQueryMatches(calendar, "(api OR web) NOT staging OR sam"));
+        }
+
+        TEST_METHOD(PhraseAndLowercaseOperators)
+        {
+            Assert::AreEqual(2, CountQueryMatches(calendar, "\"code review\""));
+            Assert::AreEqual(0, CountQueryMatches(calendar, "\"review code\""));
+            // lowercase "and" is a normal search term
+            Assert::AreEqual(1, CountQueryMatches(calendar, "and"));
+        }
+
+        TEST_METHOD(DatePredicates)
+        {
+            Assert::AreEqual(1, CountQueryMatches(calendar, "review year:2024"));
+            Assert::AreEqual(2, CountQueryMatches(calendar, "deploy month:11"));
+            Assert::AreEqual(3, CountQueryMatches(calendar, "deploy month:11..12"));
+            Assert::AreEqual(1, CountQueryMatches(calendar, "month:6 OR month:7"));
+            Assert::AreEqual(3, CountQueryMatches(calendar, "date:2025-11-01..2025-12-31"));
+            Assert::AreEqual(5, CountQueryMatches(calendar, "year:2024..2025"));
+            Assert::AreEqual(2, CountQueryMatches(calendar, "year:2024 OR date:2025-01-09"));
+
+            // tasks in years no date can name are still found, and never by a date
+            addTask(&calendar, 300000, 11, 1, "deploy far out");
+            Assert::AreEqual(4, CountQueryMatches(calendar, "deploy"));
+            Assert::AreEqual(3, CountQueryMatches(calendar, "deploy month:11"));
+            Assert::AreEqual(0, CountQueryMatches(calendar, "far date:2025..214748"));
+        }
+
+        TEST_METHOD(PlannerUsesDateRangeAndOrdersTerms)
+        {
+            struct query* q = parseQuery("staging AND year:2025", NULL, 0);
+            Assert::IsNotNull(q);
+            planQuery(q, calendar);
+
+            char plan[512];
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "access: date range 20250101..20251231") != NULL);
+            // the date compare is cheaper than the text scan, so it runs first
+            Assert::IsTrue(strstr(plan, "date") < strstr(plan, "staging"));
+            freeQuery(q);
+
+            q = parseQuery("year:2025 OR staging", NULL, 0);
+            planQuery(q, calendar);
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "access: full scan") != NULL);
+            freeQuery(q);
+        }
+
+        TEST_METHOD(PlannerPicksTheCheapestAccessPath)
+        {
+            // lots of routine tasks in 2026, one dentist visit
+            for (int i = 0; i < 300; i++) addTask(&calendar, 2026, 1 + i % 12, 1 + i % 28, "routine standup");
+            addTask(&calendar, 2026, 7, 14, "Dentist checkup");
+            struct term_index* index = buildTermIndex(calendar);
+
+            char plan[512];
+            struct query* q = parseQuery("dentist year:2026", NULL, 0);
+            planQueryWithIndex(q, calendar, index);
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "access: term index \"dentist\", 1 postings") != NULL);
+            int found = 0;
+            Assert::AreEqual(1, runQueryWithIndex(calendar, index, q, 0, CountMatchCallback, &found));
+            freeQuery(q);
+
+            // the index's real counts order the terms: the rare word runs first
+            q = parseQuery("routine AND dentist", NULL, 0);
+            planQueryWithIndex(q, calendar, index);
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "  dentist") < strstr(plan, "  routine"));
+            freeQuery(q);
+
+            // a narrow date range beats 300 postings
+            q = parseQuery("routine date:2026-03-01..2026-03-02", NULL, 0);
+            planQueryWithIndex(q, calendar, index);
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "access: date range 20260301..20260302") != NULL);
+            freeQuery(q);
+
+            // same results, in the same order, whichever path runs
+            std::string scanned, indexed;
+            q = parseQuery("deploy OR review OR dentist", NULL, 0);
+            runQuery(calendar, q, 0, CollectRangeResult, &scanned);
+            freeQuery(q);
+            q = parseQuery("staging deploy", NULL, 0);
+            runQueryWithIndex(calendar, index, q, 0, CollectRangeResult, &indexed);
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "access: term index") != NULL);
+            Assert::AreEqual(0, strcmp("2025-11-04 deploy api to staging;2025-12-01 deploy web to prod and staging;",
+                indexed.c_str()));
+            freeQuery(q);
+            Assert::AreEqual(0, strcmp("2024-06-01 code review with Sam;2025-01-09 Code Review prep;"
+                "2025-11-03 deploy api to prod;2025-11-04 deploy api to staging;"
+                "2025-12-01 deploy web to prod and staging;2026-07-14 Dentist checkup;", scanned.c_str()));
+
+            // a stale index is left alone
+            addTask(&calendar, 2026, 7, 15, "dentist again");
+            q = parseQuery("dentist", NULL, 0);
+            found = 0;
+            Assert::AreEqual(2, runQueryWithIndex(calendar, index, q, 0, CountMatchCallback, &found));
+            explainQuery(q, plan, sizeof(plan));
+            Assert::IsTrue(strstr(plan, "access: full scan") != NULL);
+            freeQuery(q);
+
+            freeTermIndex(index);
+        }
+
+        TEST_METHOD(CanonicalForm)
+        {
+            char a[128], b[128];
+            struct query* q1 = parseQuery("Prod deploy NOT (Staging OR qa)", NULL, 0);
+            struct query* q2 = parseQuery("NOT (qa OR staging) AND deploy AND prod", NULL, 0);
+
+            formatQuery(q1, a, sizeof(a));
+            formatQuery(q2, b, sizeof(b));
+            Assert::AreEqual(0, strcmp("NOT (qa OR staging) AND deploy AND prod", a));
+            Assert::AreEqual(0, strcmp(a, b));
+
+            freeQuery(q1);
+            freeQuery(q2);
+
+            q1 = parseQuery("month:06..8 gym", NULL, 0);
+            formatQuery(q1, a, sizeof(a));
+            Assert::AreEqual(0, strcmp("gym AND month:6..8", a));
+            freeQuery(q1);
+        }
+
+        TEST_METHOD(SyntaxErrors)
+        {
+            char error[128];
+            Assert::IsNull(parseQuery("", error, sizeof(error)));
+            Assert::IsNull(parseQuery("deploy AND", error, sizeof(error)));
+            Assert::IsNull(parseQuery("(deploy OR prod", error, sizeof(error)));
+            Assert::IsNull(parseQuery("\"open phrase", error, sizeof(error)));
+            Assert::IsNull(parseQuery("month:13", error, sizeof(error)));
+            Assert::IsNull(parseQuery("month:2025-11", error, sizeof(error)));
+            Assert::IsNull(parseQuery("month:12..1", error, sizeof(error)));
+            // later years would overflow the yyyymmdd keys
+            Assert::IsNull(parseQuery("year:214749", error, sizeof(error)));
+            Assert::IsNull(parseQuery("date:2025..99999999999", error, sizeof(error)));
+            Assert::AreEqual(0, CountQueryMatches(calendar, "year:214748"));
+            Assert::IsNull(parseQuery("date:2025-12-01..2025-11-01", error, sizeof(error)));
+            Assert::IsTrue(error[0] != '\0');
+        }
+    };
+
+    TEST_CLASS(QueryCacheTests)
+    {
+    public:
+        TEST_METHOD(EquivalentQueriesShareAnEntry)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 11, 3, "Deploy to prod");
+
+            struct query_cache* cache = createQueryCache(4);
+            const struct task_match* results = NULL;
+
+            Assert::AreEqual(1, cachedQuery(cache, cal, "deploy prod", &results, NULL, 0));
+            Assert::AreEqual(1, cachedQuery(cache, cal, "PROD AND Deploy", &results, NULL, 0));
+            Assert::AreEqual(0, strcmp("Deploy to prod", results[0].task->task_description));
+
+            struct query_cache_stats stats;
+            getQueryCacheStats(cache, &stats);
+            Assert::AreEqual(1ul, stats.misses);
+            Assert::AreEqual(1ul, stats.hits);
+            Assert::AreEqual(1, stats.entries);
+
+            freeQueryCache(cache);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(MutationsInvalidateOnlyAffectedYears)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2024, 5, 1, "on-call");
+            addTask(&cal, 2025, 5, 1, "on-call");
+
+            struct query_cache* cache = createQueryCache(4);
+            const struct task_match* results = NULL;
+            struct query_cache_stats stats;
+
+            Assert::AreEqual(1, cachedQuery(cache, cal, "on-call year:2024", &results, NULL, 0));
+            Assert::AreEqual(2, cachedQuery(cache, cal, "on-call", &results, NULL, 0));
+
+            // a change in 2025 leaves the 2024-only entry alone...
+            addTask(&cal, 2025, 6, 1, "on-call again");
+            Assert::AreEqual(1, cachedQuery(cache, cal, "on-call year:2024", &results, NULL, 0));
+            getQueryCacheStats(cache, &stats);
+            Assert::AreEqual(1ul, stats.hits);
+            Assert::AreEqual(0ul, stats.invalidations);
+
+            // ...but the unbounded one has to rerun
+            Assert::AreEqual(3, cachedQuery(cache, cal, "on-call", &results, NULL, 0));
+            getQueryCacheStats(cache, &stats);
+            Assert::AreEqual(1ul, stats.invalidations);
+
+            // updates and deletes bump the generation too
+            updateTask(cal, 2024, 5, 1, 1, "vacation");
+            Assert::AreEqual(0, cachedQuery(cache, cal, "on-call year:2024", &results, NULL, 0));
+            deleteTask(cal, 2025, 6, 1, 1);
+            Assert::AreEqual(1, cachedQuery(cache, cal, "on-call", &results, NULL, 0));
+
+            freeQueryCache(cache);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(EvictsLeastRecentlyUsed)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 1, 1, "alpha beta gamma");
+
+            struct query_cache* cache = createQueryCache(2);
+            const struct task_match* results = NULL;
+            struct query_cache_stats stats;
+
+            cachedQuery(cache, cal, "alpha", &results, NULL, 0);
+            cachedQuery(cache, cal, "beta", &results, NULL, 0);
+            cachedQuery(cache, cal, "alpha", &results, NULL, 0);   // alpha is now most recent
+            cachedQuery(cache, cal, "gamma", &results, NULL, 0);   // evicts beta
+            cachedQuery(cache, cal, "alpha", &results, NULL, 0);   // still cached
+
+            getQueryCacheStats(cache, &stats);
+            Assert::AreEqual(2, stats.entries);
+            Assert::AreEqual(1ul, stats.evictions);
+            Assert::AreEqual(2ul, stats.hits);
+
+            char error[64];
+            Assert::AreEqual(-1, cachedQuery(cache, cal, "alpha AND", &results, error, sizeof(error)));
+
+            freeQueryCache(cache);
+            freeCalendar(cal);
+        }
+    };
+
+    TEST_CLASS(TopKSearchTests)
+    {
+    private:
+        struct years* calendar = NULL;
+
+    public:
+        TEST_METHOD_INITIALIZE(Setup)
+        {
+            addTask(&calendar, 2025, 6, 1, "Release notes");          // prefix, 14 days before
+            addTask(&calendar, 2025, 6, 20, "prerelease checks");     // substring only, 5 days after
+            addTask(&calendar, 2025, 6, 16, "release train");         // prefix, 1 day after
+            addTask(&calendar, 2025, 6, 14, "Cut release branch");    // prefix, 1 day before
+            addTask(&calendar, 2024, 1, 1, "release retro");          // prefix, far away
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            freeCalendar(calendar);
+            calendar = NULL;
+        }
+
+        TEST_METHOD(RanksPrefixThenCloseness)
+        {
+            struct ranked_match out[3];
+            int n = topKSearch(calendar, NULL, "rel", 3, 2025, 6, 15, out);
+
+            Assert::AreEqual(3, n);
+            // same distance: the upcoming one wins
+            Assert::AreEqual(0, strcmp("release train", out[0].match.task->task_description));
+            Assert::AreEqual(0, strcmp("Cut release branch", out[1].match.task->task_description));
+            Assert::AreEqual(0, strcmp("Release notes", out[2].match.task->task_description));
+            Assert::AreEqual(1, out[0].prefix_hit);
+            Assert::AreEqual(14L, out[2].distance_days);
+        }
+
+        TEST_METHOD(SubstringHitsComeAfterPrefixHits)
+        {
+            struct ranked_match out[10];
+            int n = topKSearch(calendar, NULL, "release", 10, 2025, 6, 15, out);
+
+            Assert::AreEqual(5, n);
+            Assert::AreEqual(0, strcmp("prerelease checks", out[4].match.task->task_description));
+            Assert::AreEqual(0, out[4].prefix_hit);
+        }
+
+        TEST_METHOD(IndexAndScanAgree)
+        {
+            struct term_index* index = buildTermIndex(calendar);
+            Assert::IsNotNull(index);
+            Assert::IsTrue(isTermIndexCurrent(index, calendar) == 1);
+
+            const char* keys[] = { "rel", "release", "e", "notes", "zzz" };
+            for (int i = 0; i < 5; i++) {
+                struct ranked_match scanned[4], indexed[4];
+                int a = topKSearch(calendar, NULL, keys[i], 4, 2025, 6, 15, scanned);
+                int b = topKSearch(calendar, index, keys[i], 4, 2025, 6, 15, indexed);
+
+                Assert::AreEqual(a, b);
+                for (int j = 0; j < a; j++) {
+                    Assert::IsTrue(scanned[j].match.task == indexed[j].match.task);
+                }
+            }
+
+            // after a change the index is stale and refresh rebuilds it
+            addTask(&calendar, 2025, 6, 15, "release day");
+            Assert::IsTrue(isTermIndexCurrent(index, calendar) == 0);
+            Assert::IsTrue(refreshTermIndex(&index, calendar) == 1);
+
+            struct ranked_match best[1];
+            topKSearch(calendar, index, "rel", 1, 2025, 6, 15, best);
+            Assert::AreEqual(0, strcmp("release day", best[0].match.task->task_description));
+
+            freeTermIndex(index);
+        }
+
+        TEST_METHOD(SameDayTiesGoToTheLowerId)
+        {
+            // a past day's postings are walked backwards; the lowest id still has to win
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 6, 10, "foo one");
+            addTask(&cal, 2025, 6, 10, "fo1");
+            addTask(&cal, 2025, 6, 10, "foo three");
+            struct term_index* index = buildTermIndex(cal);
+
+            struct ranked_match scanned[1], indexed[1];
+            Assert::AreEqual(1, topKSearch(cal, NULL, "fo", 1, 2025, 6, 15, scanned));
+            Assert::AreEqual(1, topKSearch(cal, index, "fo", 1, 2025, 6, 15, indexed));
+            Assert::AreEqual(1, scanned[0].match.task->task_id);
+            Assert::AreEqual(1, indexed[0].match.task->task_id);
+
+            freeTermIndex(index);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(IndexMatchesScanOnRandomQueries)
+        {
+            const char* words[] = { "fo", "foo", "fo1", "food", "bar", "ba", "rebar", "xfoo", "a1", "Foo" };
+            const char* keys[] = { "f", "fo", "foo", "o", "ba", "bar", "a", "1", "x", "re", "zz" };
+            unsigned int seed = 12345;
+            struct years* cal = NULL;
+
+            // a few days either side of "today" so ties and both directions come up
+            for (int i = 0; i < 300; i++) {
+                char desc[64] = "";
+                int count = 1 + (seed = seed * 1103515245u + 12345u) / 65536u % 3;
+                for (int w = 0; w < count; w++) {
+                    seed = seed * 1103515245u + 12345u;
+                    if (w) strcat_s(desc, sizeof(desc), " ");
+                    strcat_s(desc, sizeof(desc), words[seed / 65536u % 10]);
+                }
+                seed = seed * 1103515245u + 12345u;
+                addTask(&cal, 2025, 6, 10 + (int)(seed / 65536u % 11), desc);
+            }
+            struct term_index* index = buildTermIndex(cal);
+
+            for (int q = 0; q < 200; q++) {
+                seed = seed * 1103515245u + 12345u;
+                const char* key = keys[seed / 65536u % 11];
+                seed = seed * 1103515245u + 12345u;
+                int k = 1 + (int)(seed / 65536u % 12);
+                seed = seed * 1103515245u + 12345u;
+                int today = 8 + (int)(seed / 65536u % 15);
+
+                struct ranked_match scanned[12], indexed[12];
+                int a = topKSearch(cal, NULL, key, k, 2025, 6, today, scanned);
+                int b = topKSearch(cal, index, key, k, 2025, 6, today, indexed);
+
+                Assert::AreEqual(a, b);
+                for (int j = 0; j < a; j++) {
+                    Assert::IsTrue(scanned[j].match.task == indexed[j].match.task);
+                    Assert::AreEqual(scanned[j].prefix_hit, indexed[j].prefix_hit);
+                }
+            }
+
+            freeTermIndex(index);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(OtherCalendarsDontMakeTheIndexStale)
+        {
+            struct term_index* index = buildTermIndex(calendar);
+
+            struct years* other = NULL;
+            addTask(&other, 2025, 6, 15, "release elsewhere");
+            Assert::IsTrue(isTermIndexCurrent(index, calendar) == 1);
+
+            // an empty year in this calendar doesn't either, a task in it does
+            findOrAddYear(&calendar, 2030);
+            Assert::IsTrue(isTermIndexCurrent(index, calendar) == 1);
+            addTask(&calendar, 2030, 1, 1, "later");
+            Assert::IsTrue(isTermIndexCurrent(index, calendar) == 0);
+
+            freeCalendar(other);
+            freeTermIndex(index);
+        }
+
+        TEST_METHOD(CompletesDictionaryTerms)
+        {
+            struct term_index* index = buildTermIndex(calendar);
+
+            struct term_completion terms[8];
+            int n = completeTerms(index, "Re", terms, 8);
+
+            Assert::AreEqual(2, n);
+            Assert::AreEqual(0, strcmp("release", terms[0].term));
+            Assert::AreEqual(4, terms[0].task_count);
+            Assert::AreEqual(0, strcmp("retro", terms[1].term));
+
+            freeTermIndex(index);
+        }
+    };
+
+    // counts frees instead of freeing (EpochTests)
+    static int g_epochFrees = 0;
+    static void CountEpochFree(void* memory)
+    {
+        (void)memory;
+        g_epochFrees++;
+    }
+
+    TEST_CLASS(EpochTests)
+    {
+    public:
+        TEST_METHOD(RetiredMemoryWaitsForReaders)
+        {
+            struct epoch_domain* domain = createEpochDomain();
+            Assert::IsNotNull(domain);
+            g_epochFrees = 0;
+
+            int reader = epochEnter(domain);
+            int dummy = 0;
+            epochRetire(domain, &dummy, CountEpochFree);
+
+            // the reader that was inside holds it back however often we try
+            for (int i = 0; i < 5; i++)
+                epochCollect(domain);
+            Assert::AreEqual(0, g_epochFrees);
+
+            epochExit(domain, reader);
+            for (int i = 0; i < 3; i++)
+                epochCollect(domain);
+            Assert::AreEqual(1, g_epochFrees);
+
+            struct epoch_stats stats;
+            getEpochStats(domain, &stats);
+            Assert::AreEqual(0L, stats.pending);
+
+            freeEpochDomain(domain);
+        }
+
+        TEST_METHOD(FreeDomainReleasesPending)
+        {
+            struct epoch_domain* domain = createEpochDomain();
+            g_epochFrees = 0;
+
+            int reader = epochEnter(domain);
+            int a = 0, b = 0;
+            epochRetire(domain, &a, CountEpochFree);
+            epochRetire(domain, &b, CountEpochFree);
+            epochExit(domain, reader);
+
+            freeEpochDomain(domain);
+            Assert::AreEqual(2, g_epochFrees);
+        }
+    };
+
+    // one writer thread for CalendarContextTests: adds "count" tasks to its own year
+    struct ContextWriter
+    {
+        struct calendar* cal;
+        int year;
+        int count;
+    };
+
+    static void AddTasksOnThread(void* arg)
+    {
+        struct ContextWriter* writer = (struct ContextWriter*)arg;
+        for (int i = 0; i < writer->count; i++)
+            calendarAddTask(writer->cal, writer->year, 1 + i % 12, 1 + i % 28, "threaded task");
+    }
+
+    TEST_CLASS(CalendarContextTests)
+    {
+    private:
+        static struct calendar* CreateQuiet(enum calendar_lock_policy locking)
+        {
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            options.locking = locking;
+            return createCalendar(&options);
+        }
+
+    public:
+        TEST_METHOD(OpsReturnStatusCodes)
+        {
+            struct calendar* cal = CreateQuiet(CALENDAR_LOCK_PER_YEAR);
+            Assert::IsNotNull(cal);
+
+            Assert::AreEqual((int)CALENDAR_OK, calendarAddTask(cal, 2025, 3, 14, "Pi day"));
+            Assert::AreEqual((int)CALENDAR_INVALID_DATE, calendarAddTask(cal, 2025, 2, 30, "Nope"));
+            Assert::AreEqual((int)CALENDAR_OK, calendarUpdateTask(cal, 2025, 3, 14, 1, "Pie day"));
+            Assert::AreEqual((int)CALENDAR_NOT_FOUND, calendarUpdateTask(cal, 2025, 3, 14, 2, "x"));
+            Assert::AreEqual((int)CALENDAR_INVALID_DATE, calendarDeleteTask(cal, 1999, 3, 14, 1));
+            Assert::AreEqual(1, calendarCountTasks(cal, 2025, 3, 14));
+
+            int found = 0;
+            Assert::AreEqual(1, calendarSearch(cal, "PIE", 0, CountMatchCallback, &found));
+
+            Assert::AreEqual((int)CALENDAR_OK, calendarDeleteTask(cal, 2025, 3, 14, 1));
+            Assert::AreEqual(0, calendarCountTasks(cal, 2025, 3, 14));
+
+            destroyCalendar(cal);
+        }
+
+        TEST_METHOD(MessagesGoToTheConfiguredSink)
+        {
+            const char* fname = "context_output_test.txt";
+            FILE* sink = NULL;
+            fopen_s(&sink, fname, "w+");
+            Assert::IsNotNull(sink);
+
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.output = sink;
+            struct calendar* cal = createCalendar(&options);
+
+            calendarAddTask(cal, 2025, 1, 1, "New year");
+            calendarDeleteTask(cal, 2025, 1, 1, 7);
+
+            char text[200] = "";
+            rewind(sink);
+            size_t n = fread(text, 1, sizeof(text) - 1, sink);
+            text[n] = '\0';
+            fclose(sink);
+            std::remove(fname);
+
+            Assert::IsTrue(strstr(text, "Task added for 2025-01-01.") != NULL);
+            Assert::IsTrue(strstr(text, "Task 7 not found") != NULL);
+
+            destroyCalendar(cal);
+        }
+
+        TEST_METHOD(RangeWalkCrossesYearLocksInOrder)
+        {
+            struct calendar* cal = CreateQuiet(CALENDAR_LOCK_PER_YEAR);
+            calendarAddTask(cal, 2026, 1, 5, "later");
+            calendarAddTask(cal, 2024, 12, 31, "eve");
+            calendarAddTask(cal, 2025, 6, 1, "middle");
+            calendarAddTask(cal, 2024, 1, 1, "outside");
+
+            std::string got;
+            int n = calendarForEachInRange(cal, 2024, 6, 1, 2026, 1, 5, CollectRangeResult, &got);
+            Assert::AreEqual(3, n);
+            Assert::AreEqual(0, strcmp("2024-12-31 eve;2025-06-01 middle;2026-01-05 later;", got.c_str()));
+
+            // stopping in the first year doesn't carry on into the next
+            int seen = 0;
+            Assert::AreEqual(1, calendarForEachInRange(cal, 2024, 1, 1, 2026, 12, 31, StopAfterFirst, &seen));
+            Assert::AreEqual(1, seen);
+
+            destroyCalendar(cal);
+        }
+
+        TEST_METHOD(SaveAndLoadThroughContext)
+        {
+            const char* fname = "context_tasks_test.txt";
+
+            struct calendar* cal = CreateQuiet(CALENDAR_LOCK_GLOBAL);
+            calendarAddTask(cal, 2025, 12, 25, "Christmas Day");
+            calendarAddTask(cal, 2026, 1, 1, "New Year's Day");
+            Assert::AreEqual(1, calendarSave(cal, fname));
+            destroyCalendar(cal);
+
+            cal = CreateQuiet(CALENDAR_LOCK_PER_YEAR);
+            Assert::AreEqual(2, calendarLoad(cal, fname));
+            Assert::AreEqual(1, calendarCountTasks(cal, 2026, 1, 1));
+
+            // loaded years are indexed like any other
+            Assert::AreEqual((int)CALENDAR_OK, calendarAddTask(cal, 2025, 12, 25, "Dinner"));
+            Assert::AreEqual(2, calendarCountTasks(cal, 2025, 12, 25));
+
+            destroyCalendar(cal);
+            std::remove(fname);
+        }
+
+        TEST_METHOD(EpochReadersSeeDeletedTaskUntilTheyLeave)
+        {
+            struct calendar* cal = CreateQuiet(CALENDAR_LOCK_EPOCH);
+            calendarAddTask(cal, 2025, 5, 1, "first");
+            calendarAddTask(cal, 2025, 5, 1, "second");
+            calendarAddTask(cal, 2025, 5, 2, "third");
+
+            // the callback deletes the task it's looking at and keeps reading it;
+            // readers hold no locks with EPOCH, so this is allowed there
+            struct DeleteWhileReading
+            {
+                static int Callback(const struct task_match* match, void* user_data)
+                {
+                    struct calendar* c = *(struct calendar**)user_data;
+                    Assert::AreEqual((int)CALENDAR_OK, calendarDeleteTask(c, match->year, match->month, match->day, 1));
+                    Assert::IsTrue(strlen(match->task->task_description) > 0);
+                    return 1;
+                }
+            };
+
+            int n = calendarForEachInRange(cal, 2025, 5, 1, 2025, 5, 31, DeleteWhileReading::Callback, &cal);
+            Assert::AreEqual(3, n);
+            Assert::AreEqual(0, calendarCountTasks(cal, 2025, 5, 1));
+            Assert::AreEqual(0, calendarCountTasks(cal, 2025, 5, 2));
+
+            destroyCalendar(cal);
+        }
+
+        TEST_METHOD(EpochReadersNeverSeeAHalfRenumberedDay)
+        {
+            struct calendar* cal = CreateQuiet(CALENDAR_LOCK_EPOCH);
+            calendarAddTask(cal, 2025, 5, 1, "a");
+            calendarAddTask(cal, 2025, 5, 1, "b");
+            calendarAddTask(cal, 2025, 5, 1, "c");
+            calendarAddTask(cal, 2025, 5, 1, "d");
+
+            // standing on b, the reader deletes a: the rest of its walk is the old
+            // list (ids 3, 4), not b's neighbours renumbered under it
+            struct DeleteBehind
+            {
+                struct calendar* cal;
+                std::string ids;
+
+                static int Callback(const struct task_match* match, void* user_data)
+                {
+                    DeleteBehind* self = (DeleteBehind*)user_data;
+                    if (self->cal && strcmp(match->task->task_description, "b") == 0)
+                        Assert::AreEqual((int)CALENDAR_OK, calendarDeleteTask(self->cal, 2025, 5, 1, 1));
+                    self->ids += std::to_string(match->task->task_id) + match->task->task_description + ";";
+                    return 1;
+                }
+            };
+
+            DeleteBehind reader;
+            reader.cal = cal;
+            Assert::AreEqual(4, calendarForEachInRange(cal, 2025, 5, 1, 2025, 5, 1, DeleteBehind::Callback, &reader));
+            Assert::AreEqual(0, strcmp("1a;2b;3c;4d;", reader.ids.c_str()));
+
+            // the next reader sees the new list, numbered from 1, and so do the writers
+            reader.ids.clear();
+            reader.cal = NULL;
+            Assert::AreEqual(3, calendarForEachInRange(cal, 2025, 5, 1, 2025, 5, 1, DeleteBehind::Callback, &reader));
+            Assert::AreEqual(0, strcmp("1b;2c;3d;", reader.ids.c_str()));
+            Assert::AreEqual((int)CALENDAR_OK, calendarUpdateTask(cal, 2025, 5, 1, 3, "D"));
+            Assert::AreEqual((int)CALENDAR_NOT_FOUND, calendarDeleteTask(cal, 2025, 5, 1, 4));
+
+            destroyCalendar(cal);
+        }
+
+        TEST_METHOD(ConcurrentWritersOnDifferentYears)
+        {
+            struct calendar* cal = CreateQuiet(CALENDAR_LOCK_PER_YEAR);
+
+            struct ContextWriter writers[4];
+            platform_thread threads[4];
+            for (int i = 0; i < 4; i++)
+            {
+                // two threads share 2030, so year creation races too
+                writers[i].cal = cal;
+                writers[i].year = 2030 + i / 2;
+                writers[i].count = 500;
+                Assert::IsTrue(threadStart(&threads[i], AddTasksOnThread, &writers[i]) == 1);
+            }
+            for (int i = 0; i < 4; i++)
+                threadJoin(threads[i]);
+
+            int total = 0;
+            calendarForEachInRange(cal, 2030, 1, 1, 2031, 12, 31, CountMatchCallback, &total);
+            Assert::AreEqual(2000, total);
+
+            destroyCalendar(cal);
+        }
+    };
+
+    // runCommandServer on its own thread, for CommandProtocolTests
+    struct ServerRun
+    {
+        struct calendar* calendar;
+        struct command_server_options options;
+        volatile long done;
+        int result;
+    };
+
+    static void RunServer(void* arg)
+    {
+        struct ServerRun* run = (struct ServerRun*)arg;
+        run->result = runCommandServer(run->calendar, &run->options);
+        atomicStoreLong(&run->done, 1);
+    }
+
+#ifdef __linux__
+    // connects to the server, retrying while it starts up; -1 if it never does
+    static int ConnectToServer(const char* path)
+    {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path, strlen(path) + 1);
+
+        for (int tries = 0; tries < 500; tries++) {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) return fd;
+            if (fd >= 0) close(fd);
+            threadSleepMillis(10);
+        }
+        return -1;
+    }
+#endif
+
+    TEST_CLASS(CommandProtocolTests)
+    {
+    private:
+        struct calendar* cal = NULL;
+        struct command_session* session = NULL;
+
+        // runs one command and returns its reply (and clears it for the next one)
+        std::string Run(const char* line)
+        {
+            Assert::AreEqual((int)COMMAND_CONTINUE, executeCommand(session, line));
+            std::string reply = commandOutput(session, NULL);
+            clearCommandOutput(session);
+            return reply;
+        }
+
+    public:
+        TEST_METHOD_INITIALIZE(Setup)
+        {
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            cal = createCalendar(&options);
+            session = createCommandSession(cal, "command_tasks_test.txt");
+        }
+
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            freeCommandSession(session);
+            destroyCalendar(cal);
+            std::remove("command_tasks_test.txt");
+        }
+
+        TEST_METHOD(AddListUpdateDelete)
+        {
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("add 2025 11 29 Buy turkey").c_str()));
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("add 2025 11 29 Call mom\r").c_str()));
+            Assert::AreEqual(0, strcmp("OK 2\n2025-11-29\t1\tBuy turkey\n2025-11-29\t2\tCall mom\n",
+                Run("day 2025 11 29").c_str()));
+
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("update 2025 11 29 2 Call dad").c_str()));
+            Assert::AreEqual(0, strcmp("OK 1\n2025-11-29\t2\tCall dad\n", Run("search DAD").c_str()));
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("delete 2025 11 29 1").c_str()));
+            Assert::AreEqual(0, strcmp("OK 1\n1\n", Run("count 2025 11 29").c_str()));
+            Assert::AreEqual(0, strcmp("OK 1\n2025-11-29\t1\tCall dad\n", Run("month 2025 11").c_str()));
+        }
+
+        TEST_METHOD(ErrorsAreOneLine)
+        {
+            Assert::AreEqual(0, strncmp("ERR invalid_date ", Run("add 2025 2 30 Nope").c_str(), 17));
+            Assert::AreEqual(0, strncmp("ERR not_found ", Run("delete 2025 1 1 1").c_str(), 14));
+            Assert::AreEqual(0, strncmp("ERR bad_args ", Run("add 2025 11").c_str(), 13));
+            Assert::AreEqual(0, strncmp("ERR bad_args ", Run("day 2025 11 x").c_str(), 13));
+            Assert::AreEqual(0, strncmp("ERR bad_command ", Run("frobnicate").c_str(), 16));
+
+            // numbers that don't fit an int, or have junk after them, aren't cut down to one
+            Assert::AreEqual(0, strncmp("ERR bad_args ", Run("day 2025 11 4294967325").c_str(), 13));
+            Assert::AreEqual(0, strncmp("ERR bad_args ", Run("day 99999999999999999999 1 1").c_str(), 13));
+            Assert::AreEqual(0, strncmp("ERR bad_args ", Run("delete 2025 11 29 1x").c_str(), 13));
+
+            // blank lines and comments get no reply at all
+            Assert::AreEqual(0, strcmp("", Run("   ").c_str()));
+            Assert::AreEqual(0, strcmp("", Run("# a comment").c_str()));
+        }
+
+        TEST_METHOD(EventsFollowChanges)
+        {
+            Assert::AreEqual(0, strncmp("ERR unavailable ", Run("events").c_str(), 16));
+
+            // the stream is the session calendar's own
+            struct event_ring* ring = createEventRing(16, EVENT_RING_OVERWRITE, 0);
+            freeCommandSession(session);
+            destroyCalendar(cal);
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            options.events = ring;
+            cal = createCalendar(&options);
+            session = createCommandSession(cal, "command_tasks_test.txt");
+
+            // the first call subscribes; changes before it aren't reported
+            Run("add 2025 1 1 before");
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("events").c_str()));
+            Run("add 2025 1 1 after");
+            Run("delete 2025 1 1 1");
+            Assert::AreEqual(0, strcmp("OK 2\n2\tadd\t2025-01-01\t2\n3\tdelete\t2025-01-01\t1\n", Run("events").c_str()));
+
+            for (int i = 0; i < 20; i++) Run("add 2025 1 2 x");
+            std::string reply = Run("events 1");
+            Assert::AreEqual(0, strcmp("OK 2\nlost\t4\n8\tadd\t2025-01-02\t5\n", reply.c_str()));
+
+            freeCommandSession(session);
+            destroyCalendar(cal);
+            options.events = NULL;
+            cal = createCalendar(&options);
+            session = createCommandSession(cal, "command_tasks_test.txt");
+            freeEventRing(ring);
+        }
+
+        TEST_METHOD(PipelinedRepliesStayInOrder)
+        {
+            executeCommand(session, "add 2025 1 1 one");
+            executeCommand(session, "ping");
+            executeCommand(session, "bogus");
+            Assert::AreEqual((int)COMMAND_QUIT, executeCommand(session, "quit"));
+
+            const char* expected = "OK 0\nOK 0\nERR bad_command Unknown command (try help).\nOK 0\n";
+            Assert::AreEqual(0, strcmp(expected, commandOutput(session, NULL)));
+        }
+
+        TEST_METHOD(FedInputCanSplitLinesAnywhere)
+        {
+            const char* pieces[] = { "add 2025 1 1 ab", "c\nday 2025", " 1 1\r\n# note\n", "count 2025 1 1" };
+            for (const char* piece : pieces) {
+                Assert::AreEqual((int)COMMAND_CONTINUE, feedCommands(session, piece, strlen(piece)));
+            }
+
+            // the last line has no newline yet, so only two replies so far
+            Assert::AreEqual(0, strcmp("OK 0\nOK 1\n2025-01-01\t1\tabc\n", commandOutput(session, NULL)));
+            clearCommandOutput(session);
+
+            Assert::AreEqual((int)COMMAND_CONTINUE, finishCommands(session));
+            Assert::AreEqual(0, strcmp("OK 1\n1\n", commandOutput(session, NULL)));
+        }
+
+        TEST_METHOD(FedLineTooLongIsReportedOnce)
+        {
+            std::string big(70000, 'x');
+            feedCommands(session, "add 2025 1 1 ", 13);
+            feedCommands(session, big.c_str(), big.size());
+            feedCommands(session, big.c_str(), big.size());
+            feedCommands(session, "\nping\n", 6);
+
+            const char* expected = "ERR line_too_long Command line too long.\nOK 0\n";
+            Assert::AreEqual(0, strcmp(expected, commandOutput(session, NULL)));
+        }
+
+        TEST_METHOD(LongLinesUpToTheLimitStillRun)
+        {
+            Run("add 2025 1 1 needle");
+            std::string search = "search " + std::string(65000, 'x');
+            Assert::AreEqual(0, strcmp("OK 0\n", Run(search.c_str()).c_str()));
+
+            // the long line's copy doesn't leak into the next one
+            Assert::AreEqual(0, strcmp("OK 1\n2025-01-01\t1\tneedle\n", Run("search needle").c_str()));
+            search = "search " + std::string(65535, 'x');
+            Assert::AreEqual(0, strncmp("ERR line_too_long ", Run(search.c_str()).c_str(), 18));
+        }
+
+        static int CountingSave(void* user_data)
+        {
+            (*(int*)user_data)++;
+            return 1;
+        }
+
+        TEST_METHOD(SaveWithoutAFileUsesTheHandler)
+        {
+            int saves = 0;
+            setCommandSaveHandler(session, CountingSave, &saves);
+
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("save").c_str()));
+            Assert::AreEqual(1, saves);
+
+            // an explicit file is still written directly
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("save command_tasks_test.txt").c_str()));
+            Assert::AreEqual(1, saves);
+        }
+
+        TEST_METHOD(SessionsCanBeKeptToTheirOwnFile)
+        {
+            int saves = 0;
+            setCommandSaveHandler(session, CountingSave, &saves);
+            disallowCommandFiles(session);
+
+            Assert::AreEqual(0, strncmp("ERR unavailable ", Run("save /tmp/elsewhere.txt").c_str(), 16));
+            Assert::AreEqual(0, strncmp("ERR unavailable ", Run("load /etc/passwd").c_str(), 16));
+            Assert::AreEqual(0, saves);
+
+            // the session's own save still goes through the handler
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("save").c_str()));
+            Assert::AreEqual(1, saves);
+        }
+
+        TEST_METHOD(SaveWritesTheSessionTasksFile)
+        {
+            Run("add 2026 1 1 New year");
+            Assert::AreEqual(0, strcmp("OK 0\n", Run("save").c_str()));
+
+            struct years* loaded = loadTasks("command_tasks_test.txt");
+            Assert::AreEqual(1, CountTasksForDay(loaded, 2026, 1, 1));
+            freeCalendar(loaded);
+        }
+
+        TEST_METHOD(ServerGetsPastAClientThatDoesntRead)
+        {
+#ifdef __linux__
+            // every "day 2025 3 1" reply is about 65 KB
+            std::string add = "add 2025 3 1 " + std::string(250, 'x');
+            for (int i = 0; i < 250; i++) Run(add.c_str());
+
+            struct ServerRun run;
+            run.calendar = cal;
+            initCommandServerOptions(&run.options);
+            run.options.socket_path = "command_server_test.sock";
+            run.options.tasks_file = "command_tasks_test.txt";
+            run.options.workers = 1;
+            run.options.persist_millis = 0;
+            run.done = 0;
+            run.result = -1;
+            platform_thread thread;
+            Assert::IsTrue(threadStart(&thread, RunServer, &run) != 0);
+
+            // one round trip so the server has it, then megabytes of replies it never reads
+            int stuck = ConnectToServer(run.options.socket_path);
+            Assert::IsTrue(stuck >= 0);
+            char reply[16] = { 0 };
+            Assert::AreEqual(5L, (long)send(stuck, "ping\n", 5, 0));
+            Assert::AreEqual(5L, (long)recv(stuck, reply, sizeof(reply) - 1, 0));
+            std::string requests;
+            for (int i = 0; i < 64; i++) requests += "day 2025 3 1\n";
+            Assert::AreEqual((long)requests.size(), (long)send(stuck, requests.data(), requests.size(), 0));
+            threadSleepMillis(200);
+
+            // the only worker must still be free to answer someone else
+            int other = ConnectToServer(run.options.socket_path);
+            Assert::IsTrue(other >= 0);
+            struct timeval timeout = { 5, 0 };
+            setsockopt(other, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            Assert::AreEqual(5L, (long)send(other, "ping\n", 5, 0));
+            memset(reply, 0, sizeof(reply));
+            Assert::AreEqual(5L, (long)recv(other, reply, sizeof(reply) - 1, 0));
+            Assert::AreEqual(0, strcmp("OK 0\n", reply));
+
+            // and shutting down doesn't wait for the stuck client either
+            Assert::AreEqual(9L, (long)send(other, "shutdown\n", 9, 0));
+            for (int i = 0; i < 500 && !atomicLoadLong(&run.done); i++) threadSleepMillis(10);
+            Assert::AreEqual(1L, (long)atomicLoadLong(&run.done));
+            threadJoin(thread);
+            Assert::AreEqual(0, run.result);
+
+            close(other);
+            close(stuck);
+#endif
+        }
+    };
+
+    // parallelFor body for WorkPoolTests: counts every index it's given
+    static void CountIndexes(int begin, int end, void* arg)
+    {
+        int* seen = (int*)arg;
+        for (int i = begin; i < end; i++) seen[i]++;
+    }
+
+    // submitted work for WorkPoolTests that submits more work and waits for it
+    struct NestedWork
+    {
+        struct work_pool* pool;
+        volatile long* done;
+        int depth;
+    };
+
+    static void RunNestedWork(void* arg)
+    {
+        struct NestedWork* work = (struct NestedWork*)arg;
+        if (work->depth > 0) {
+            struct work_group group;
+            struct work_item items[2];
+            struct NestedWork children[2];
+            initWorkGroup(&group);
+            for (int i = 0; i < 2; i++) {
+                children[i] = { work->pool, work->done, work->depth - 1 };
+                submitWork(work->pool, &group, &items[i], RunNestedWork, &children[i]);
+            }
+            waitWorkGroup(work->pool, &group);
+        }
+        atomicAddLong(work->done, 1);
+    }
+
+    // "YYYY-MM-DD #id desc;" per hit, to compare whole result lists
+    static int CollectWithIds(const struct task_match* match, void* user_data)
+    {
+        char line[300];
+        snprintf(line, sizeof(line), "%04d-%02d-%02d #%d %s;", match->year, match->month, match->day,
+            match->task->task_id, match->task->task_description);
+        ((std::string*)user_data)->append(line);
+        return 1;
+    }
+
+    static std::string ReadWholeFile(const char* fname)
+    {
+        std::string text;
+        FILE* fp = NULL;
+        fopen_s(&fp, fname, "r");
+        if (!fp) return text;
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0) text.append(buffer, n);
+        fclose(fp);
+        return text;
+    }
+
+    TEST_CLASS(WorkPoolTests)
+    {
+    public:
+        TEST_METHOD(ParallelForCoversEveryIndexOnce)
+        {
+            struct work_pool* pool = createWorkPool(4);
+            Assert::IsNotNull(pool);
+
+            static int seen[10000];
+            memset(seen, 0, sizeof(seen));
+            parallelFor(pool, 10000, 7, CountIndexes, seen);
+            for (int i = 0; i < 10000; i++) Assert::AreEqual(1, seen[i]);
+
+            // no pool: same thing, on this thread
+            memset(seen, 0, sizeof(seen));
+            parallelFor(NULL, 100, 0, CountIndexes, seen);
+            for (int i = 0; i < 100; i++) Assert::AreEqual(1, seen[i]);
+            Assert::AreEqual(1, workPoolThreads(NULL));
+
+            freeWorkPool(pool);
+        }
+
+        TEST_METHOD(WorkCanWaitForWorkItSubmitted)
+        {
+            struct work_pool* pool = createWorkPool(3);
+            Assert::IsNotNull(pool);
+
+            // a full binary tree of depth 6: every node waits for its two children
+            volatile long done = 0;
+            struct NestedWork root = { pool, &done, 6 };
+            struct work_group group;
+            struct work_item item;
+            initWorkGroup(&group);
+            submitWork(pool, &group, &item, RunNestedWork, &root);
+            waitWorkGroup(pool, &group);
+            Assert::AreEqual(127L, (long)done);
+
+            struct work_pool_stats stats;
+            getWorkPoolStats(pool, &stats);
+            Assert::AreEqual(3, stats.threads);
+
+            freeWorkPool(pool);
+        }
+
+        TEST_METHOD(PooledCalendarOpsMatchSerial)
+        {
+            const char* serial_file = "pool_serial_test.txt";
+            const char* pooled_file = "pool_parallel_test.txt";
+
+            // big enough that the load is split into several chunks, with days
+            // whose tasks end up in different chunks
+            struct years* cal = NULL;
+            static char descs[8000][40];
+            static struct task_entry entries[8000];
+            for (int i = 0; i < 8000; i++) {
+                snprintf(descs[i], sizeof(descs[i]), "Task %d review %s", i, (i % 3) ? "budget" : "Design");
+                entries[i] = { 2024 + i % 3, 1 + i % 12, 1 + i % 28, descs[i] };
+            }
+            Assert::AreEqual(8000, addTasks(&cal, entries, 8000, NULL));
+            findOrAddYear(&cal, 2030);      // an empty year still gets its header
+            Assert::AreEqual(1, saveTasks(serial_file, cal));
+
+            struct work_pool* pool = createWorkPool(4);
+            Assert::IsNotNull(pool);
+
+            // load: same tasks with the same ids, so saving gives the same file
+            struct years* loaded = loadTasksParallel(serial_file, pool);
+            Assert::IsNotNull(loaded);
+            Assert::AreEqual(1, saveTasksParallel(pooled_file, loaded, pool));
+            std::string expected = ReadWholeFile(serial_file);
+            Assert::IsTrue(expected.size() > 200000);
+            Assert::IsTrue(expected == ReadWholeFile(pooled_file));
+
+            // search: same hits, in the same order, limit included
+            std::string serial_hits, pooled_hits;
+            Assert::AreEqual(searchTasksEach(cal, "design", 0, CollectWithIds, &serial_hits),
+                searchTasksParallel(loaded, "design", 0, CollectWithIds, &pooled_hits, pool));
+            Assert::IsTrue(serial_hits == pooled_hits);
+
+            serial_hits.clear();
+            pooled_hits.clear();
+            Assert::AreEqual(5, searchTasksParallel(loaded, "budget", 5, CollectWithIds, &pooled_hits, pool));
+            searchTasksEach(cal, "budget", 5, CollectWithIds, &serial_hits);
+            Assert::IsTrue(serial_hits == pooled_hits);
+
+            // term index: same dictionary and the same top results
+            struct term_index* serial_index = buildTermIndex(cal);
+            struct term_index* pooled_index = buildTermIndexParallel(loaded, pool);
+            struct term_completion a[8], b[8];
+            int n = completeTerms(serial_index, "", a, 8);
+            Assert::AreEqual(n, completeTerms(pooled_index, "", b, 8));
+            for (int i = 0; i < n; i++) {
+                Assert::AreEqual(0, strcmp(a[i].term, b[i].term));
+                Assert::AreEqual(a[i].task_count, b[i].task_count);
+            }
+
+            struct ranked_match ra[5], rb[5];
+            Assert::AreEqual(5, topKSearch(loaded, pooled_index, "review", 5, 2025, 6, 15, rb));
+            topKSearch(cal, serial_index, "review", 5, 2025, 6, 15, ra);
+            for (int i = 0; i < 5; i++) {
+                Assert::AreEqual(0, strcmp(ra[i].match.task->task_description, rb[i].match.task->task_description));
+            }
+
+            freeTermIndex(serial_index);
+            freeTermIndex(pooled_index);
+            freeCalendar(loaded);
+            freeCalendar(cal);
+            freeWorkPool(pool);
+            std::remove(serial_file);
+            std::remove(pooled_file);
+        }
+
+        TEST_METHOD(PooledContextLoadMergesIntoLoadedYears)
+        {
+            const char* fname = "pool_context_test.txt";
+            struct years* file_cal = NULL;
+            addTask(&file_cal, 2025, 3, 1, "from file");
+            addTask(&file_cal, 2026, 1, 1, "new year");
+            Assert::AreEqual(1, saveTasks(fname, file_cal));
+            freeCalendar(file_cal);
+
+            struct work_pool* pool = createWorkPool(2);
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            options.pool = pool;
+            struct calendar* cal = createCalendar(&options);
+
+            calendarAddTask(cal, 2025, 3, 1, "already here");
+            Assert::AreEqual(2, calendarLoad(cal, fname));
+
+            // the file's task goes after the one that was there, ids carry on
+            std::string got;
+            Assert::AreEqual(3, calendarSearch(cal, "e", 0, CollectWithIds, &got));
+            Assert::AreEqual(0, strcmp("2025-03-01 #1 already here;2025-03-01 #2 from file;2026-01-01 #1 new year;", got.c_str()));
+
+            destroyCalendar(cal);
+            freeWorkPool(pool);
+            std::remove(fname);
+        }
+    };
+
+    TEST_CLASS(AsyncFileTests)
+    {
+    public:
+        TEST_METHOD(EveryBackendWritesAndReadsTheSameBytes)
+        {
+            const char* fname = "async_file_test.bin";
+
+            // several blocks' worth, in pieces that don't line up with them
+            std::string data;
+            for (int i = 0; data.size() < 3 * 1024 * 1024; i++) data += "line " + std::to_string(i) + " of the test\n";
+
+            const enum file_io_backend backends[] = { FILE_IO_STDIO, FILE_IO_PREAD, FILE_IO_URING, FILE_IO_AUTO };
+            for (enum file_io_backend backend : backends) {
+                struct async_writer* writer = openAsyncWriter(fname, backend);
+                Assert::IsNotNull(writer);
+                for (size_t at = 0; at < data.size(); at += 7777) {
+                    size_t piece = data.size() - at < 7777 ? data.size() - at : 7777;
+                    Assert::AreEqual(1, asyncWrite(writer, data.data() + at, piece));
+                }
+                Assert::AreEqual(1, closeAsyncWriter(writer));
+
+                size_t size = 0;
+                char* back = readFileWith(fname, &size, backend);
+                Assert::IsNotNull(back);
+                Assert::IsTrue(size == data.size());
+                Assert::AreEqual(0, memcmp(back, data.data(), size));
+                free(back);
+            }
+
+            // an empty file is still a file; a missing one isn't
+            struct async_writer* empty = openAsyncWriter(fname, FILE_IO_AUTO);
+            Assert::AreEqual(1, closeAsyncWriter(empty));
+            size_t size = 1;
+            char* nothing = readFileWith(fname, &size, FILE_IO_AUTO);
+            Assert::IsNotNull(nothing);
+            Assert::IsTrue(size == 0);
+            free(nothing);
+
+            std::remove(fname);
+            Assert::IsNull(readFileWith(fname, &size, FILE_IO_AUTO));
+            Assert::AreNotEqual((int)FILE_IO_AUTO, (int)resolveFileIOBackend(FILE_IO_AUTO));
+        }
+
+        TEST_METHOD(TasksRoundTripThroughEveryBackend)
+        {
+            const char* reference = "async_tasks_reference.txt";
+            const char* fname = "async_tasks_test.txt";
+
+            struct years* cal = NULL;
+            static char descs[3000][40];
+            static struct task_entry entries[3000];
+            for (int i = 0; i < 3000; i++) {
+                snprintf(descs[i], sizeof(descs[i]), "Errand %d", i);
+                entries[i] = { 2025 + i % 2, 1 + i % 12, 1 + i % 28, descs[i] };
+            }
+            addTasks(&cal, entries, 3000, NULL);
+            Assert::AreEqual(1, saveTasks(reference, cal));
+            std::string expected = ReadWholeFile(reference);
+
+            struct work_pool* pool = createWorkPool(2);
+            const enum file_io_backend backends[] = { FILE_IO_STDIO, FILE_IO_PREAD, FILE_IO_URING };
+            for (enum file_io_backend backend : backends) {
+                for (int pooled = 0; pooled < 2; pooled++) {
+                    Assert::AreEqual(1, saveTasksAsync(fname, cal, backend, pooled ? pool : NULL));
+                    Assert::IsTrue(expected == ReadWholeFile(fname));
+
+                    struct years* loaded = loadTasksAsync(reference, backend, pooled ? pool : NULL);
+                    Assert::AreEqual(3000, loaded->task_count + loaded->next->task_count);
+                    Assert::AreEqual(0, strcmp("Errand 338", GetNthTaskNode(loaded, 2025, 3, 3, 5)->task_description));
+                    freeCalendar(loaded);
+                }
+            }
+
+            freeWorkPool(pool);
+            freeCalendar(cal);
+            std::remove(reference);
+            std::remove(fname);
+        }
+    };
+
+    // Publishes one event after a short pause, for the waitEvents test
+    static void PublishLater(void* arg)
+    {
+        threadSleepMillis(20);
+        publishEvent((struct event_ring*)arg, TASK_EVENT_ADD, 2025, 1, 2, 3);
+    }
+
+    TEST_CLASS(EventRingTests)
+    {
+    private:
+        // "type:YYYY-MM-DD#id;" for every event waiting for the subscriber
+        static std::string Drain(struct event_subscriber* sub)
+        {
+            std::string out;
+            struct task_event events[16];
+            int n;
+            while ((n = pollEvents(sub, events, 16, NULL)) > 0) {
+                for (int i = 0; i < n; i++) {
+                    char line[64];
+                    snprintf(line, sizeof(line), "%s:%04d-%02d-%02d#%d;", taskEventName(events[i].type),
+                        events[i].year, events[i].month, events[i].day, events[i].task_id);
+                    out += line;
+                }
+            }
+            return out;
+        }
+
+    public:
+        TEST_METHOD(EventsArriveInOrderWithSequenceNumbers)
+        {
+            struct event_ring* ring = createEventRing(16, EVENT_RING_OVERWRITE, 0);
+            publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, 1);
+
+            // a new subscriber only sees what comes after it, unless it asks for the backlog
+            struct event_subscriber* late = subscribeEvents(ring, 0);
+            struct event_subscriber* early = subscribeEvents(ring, 1);
+            Assert::AreEqual(2ULL, publishEvent(ring, TASK_EVENT_DELETE, 2025, 1, 1, 1));
+
+            struct task_event events[8];
+            unsigned long long lost = 99;
+            Assert::AreEqual(2, pollEvents(early, events, 8, &lost));
+            Assert::AreEqual(0ULL, lost);
+            Assert::AreEqual(1ULL, events[0].sequence);
+            Assert::AreEqual((int)TASK_EVENT_ADD, events[0].type);
+            Assert::AreEqual(2ULL, events[1].sequence);
+            Assert::AreEqual((int)TASK_EVENT_DELETE, events[1].type);
+            Assert::AreEqual(0, pollEvents(early, events, 8, &lost));
+
+            Assert::AreEqual(1, pollEvents(late, events, 8, NULL));
+            Assert::AreEqual(2ULL, events[0].sequence);
+
+            struct event_ring_stats stats;
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(2ULL, stats.published);
+            Assert::AreEqual(2, stats.subscribers);
+
+            unsubscribeEvents(late);
+            unsubscribeEvents(early);
+            freeEventRing(ring);
+        }
+
+        TEST_METHOD(OverwriteModeReportsLostEvents)
+        {
+            struct event_ring* ring = createEventRing(16, EVENT_RING_OVERWRITE, 0);
+            struct event_subscriber* sub = subscribeEvents(ring, 0);
+            for (int i = 1; i <= 40; i++) publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, i);
+
+            // only the last 16 are still there
+            struct task_event events[64];
+            unsigned long long lost = 0;
+            Assert::AreEqual(16, pollEvents(sub, events, 64, &lost));
+            Assert::AreEqual(24ULL, lost);
+            Assert::AreEqual(25ULL, events[0].sequence);
+            Assert::AreEqual(40, events[15].task_id);
+
+            unsubscribeEvents(sub);
+            freeEventRing(ring);
+        }
+
+        TEST_METHOD(WaitModeHoldsTheProducerBack)
+        {
+            struct event_ring* ring = createEventRing(16, EVENT_RING_WAIT, 5);
+            struct event_subscriber* sub = subscribeEvents(ring, 0);
+            for (int i = 1; i <= 16; i++) publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, i);
+
+            struct event_ring_stats stats;
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(0ULL, stats.producer_waits);
+
+            // the ring is full: the next one waits out the deadline, then overwrites
+            publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, 17);
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(1ULL, stats.producer_waits);
+            Assert::AreEqual(1ULL, stats.forced);
+
+            struct task_event events[32];
+            unsigned long long lost = 0;
+            Assert::AreEqual(16, pollEvents(sub, events, 32, &lost));
+            Assert::AreEqual(1ULL, lost);
+
+            // with room again nothing waits
+            publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, 18);
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(1ULL, stats.producer_waits);
+
+            unsubscribeEvents(sub);
+            freeEventRing(ring);
+        }
+
+        TEST_METHOD(WaitModeDropsAStuckSubscriber)
+        {
+            struct event_ring* ring = createEventRing(16, EVENT_RING_WAIT, 5);
+            struct event_subscriber* stuck = subscribeEvents(ring, 0);
+            for (int i = 1; i <= 17; i++) publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, i);
+
+            struct event_ring_stats stats;
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(1ULL, stats.producer_waits);
+            Assert::AreEqual(1ULL, stats.dropped);
+
+            // it isn't waited for again, however far behind it gets
+            for (int i = 18; i <= 40; i++) publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, i);
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(1ULL, stats.producer_waits);
+
+            // once it has caught up it counts again
+            struct task_event events[32];
+            unsigned long long lost = 0;
+            Assert::AreEqual(16, pollEvents(stuck, events, 32, &lost));
+            Assert::AreEqual(24ULL, lost);
+            for (int i = 41; i <= 57; i++) publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, i);
+            getEventRingStats(ring, &stats);
+            Assert::AreEqual(2ULL, stats.producer_waits);
+            Assert::AreEqual(2ULL, stats.dropped);
+
+            unsubscribeEvents(stuck);
+            freeEventRing(ring);
+        }
+
+        TEST_METHOD(WaitEventsWakesOnPublish)
+        {
+            struct event_ring* ring = createEventRing(16, EVENT_RING_OVERWRITE, 0);
+            struct event_subscriber* sub = subscribeEvents(ring, 0);
+
+            struct task_event events[4];
+            Assert::AreEqual(0, waitEvents(sub, events, 4, NULL, 1));
+
+            platform_thread thread;
+            Assert::IsTrue(threadStart(&thread, PublishLater, ring) == 1);
+            Assert::AreEqual(1, waitEvents(sub, events, 4, NULL, 10000));
+            Assert::AreEqual(3, events[0].task_id);
+            threadJoin(thread);
+
+            unsubscribeEvents(sub);
+            freeEventRing(ring);
+        }
+
+        TEST_METHOD(MutationsPublishEvents)
+        {
+            struct event_ring* ring = createEventRing(64, EVENT_RING_OVERWRITE, 0);
+            struct event_subscriber* sub = subscribeEvents(ring, 0);
+            setTaskEventRing(ring);
+
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 3, 1, "a");
+            addTask(&cal, 2025, 3, 1, "b");
+            updateTask(cal, 2025, 3, 1, 2, "B");
+            Assert::IsTrue(updateTask(cal, 2025, 3, 1, 9, "nope") != CALENDAR_OK);
+            Assert::AreEqual(0, strcmp("add:2025-03-01#1;add:2025-03-01#2;update:2025-03-01#2;", Drain(sub).c_str()));
+
+            // batch ids are the ones before the batch; the events give the id at the time
+            static const struct task_entry entries[] = { { 2025, 3, 1, "c" }, { 2025, 3, 1, "d" } };
+            addTasks(&cal, entries, 2, NULL);
+            static const struct task_ref refs[] = { { 2025, 3, 1, 1 }, { 2025, 3, 1, 3 } };
+            Assert::AreEqual(2, deleteTasks(cal, refs, 2, NULL));
+            Assert::AreEqual(0, strcmp("add:2025-03-01#3;add:2025-03-01#4;delete:2025-03-01#1;delete:2025-03-01#2;",
+                Drain(sub).c_str()));
+            freeCalendar(cal);
+
+            setTaskEventRing(NULL);
+
+            // a context publishes to its own ring, not the one above
+            struct event_ring* own = createEventRing(64, EVENT_RING_OVERWRITE, 0);
+            struct event_subscriber* own_sub = subscribeEvents(own, 0);
+            setTaskEventRing(ring);
+
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            options.events = own;
+            struct calendar* context = createCalendar(&options);
+            Assert::IsTrue(calendarEventRing(context) == own);
+            calendarAddTask(context, 2026, 7, 4, "fireworks");
+            calendarDeleteTask(context, 2026, 7, 4, 1);
+            Assert::AreEqual(0, strcmp("add:2026-07-04#1;delete:2026-07-04#1;", Drain(own_sub).c_str()));
+            Assert::AreEqual(0, strcmp("", Drain(sub).c_str()));
+            destroyCalendar(context);
+
+            setTaskEventRing(NULL);
+            unsubscribeEvents(own_sub);
+            unsubscribeEvents(sub);
+            freeEventRing(own);
+            freeEventRing(ring);
+        }
+    };
+
+    // Reader side of the shared calendar test: every lookup has to see one
+    // whole published version, never a mix of two
+    struct SharedReader {
+        const char* name;
+        volatile long stop;
+        int torn;
+        int reads;
+    };
+
+    static void ReadSharedUntilStopped(void* arg)
+    {
+        struct SharedReader* reader = (struct SharedReader*)arg;
+        struct shared_calendar_view* view = openSharedCalendar(reader->name);
+        static struct shared_task tasks[64];
+
+        while (view && !atomicLoadLong(&reader->stop)) {
+            // each version has "v<n> ..." tasks, n tasks on the day
+            int count = sharedDayTasks(view, 2025, 6, 1, tasks, 64);
+            for (int i = 0; i < count && i < 64; i++) {
+                int version = atoi(tasks[i].description + 1);
+                if (version != count || tasks[i].task_id != i + 1) reader->torn++;
+            }
+            reader->reads++;
+        }
+        closeSharedCalendar(view);
+    }
+
+    // Reader side of the growing segment test: the version may only go up and
+    // the day that always has tasks must never look empty
+    struct GrowReader {
+        struct shared_calendar_view* view;
+        volatile long stop;
+        int went_back;
+        int empty;
+        int reads;
+    };
+
+    static void ReadWhileGrowing(void* arg)
+    {
+        struct GrowReader* reader = (struct GrowReader*)arg;
+        long long last = 0;
+
+        while (!atomicLoadLong(&reader->stop)) {
+            long long version = sharedCalendarVersion(reader->view);
+            if (version < last) reader->went_back++;
+            if (version > last) last = version;
+            if (sharedCountTasks(reader->view, 2025, 1, 1) < 1) reader->empty++;
+            reader->reads++;
+        }
+    }
+
+    TEST_CLASS(SharedCalendarTests)
+    {
+    public:
+        TEST_METHOD(ReadersLookUpThePublishedCalendar)
+        {
+            struct shared_calendar* shared = createSharedCalendar("/calendar_unit_test");
+#ifndef __linux__
+            Assert::IsNull(shared);
+#else
+            Assert::IsNotNull(shared);
+
+            struct years* cal = NULL;
+            static const struct task_entry entries[] = {
+                { 2025, 11, 29, "Buy turkey" }, { 2025, 11, 29, "Call mom" },
+                { 2025, 11, 3, "Dentist" }, { 2026, 1, 1, "New year" }
+            };
+            addTasks(&cal, entries, 4, NULL);
+
+            // a view opened before the first publish sees an empty calendar
+            struct shared_calendar_view* view = openSharedCalendar("/calendar_unit_test");
+            Assert::IsNotNull(view);
+            Assert::AreEqual(0LL, sharedCalendarVersion(view));
+            Assert::AreEqual(0, sharedCountTasks(view, 2025, 11, 29));
+
+            Assert::AreEqual(1, publishSharedCalendar(shared, cal));
+            Assert::AreEqual(1LL, sharedCalendarVersion(view));
+            Assert::AreEqual(2, sharedCountTasks(view, 2025, 11, 29));
+            Assert::AreEqual(0, sharedCountTasks(view, 2025, 11, 30));
+            Assert::AreEqual(0, sharedCountTasks(view, 2024, 11, 29));
+            Assert::AreEqual(0, sharedCountTasks(view, 2025, 2, 30));
+
+            struct shared_task tasks[4];
+            Assert::AreEqual(2, sharedDayTasks(view, 2025, 11, 29, tasks, 4));
+            Assert::AreEqual(0, strcmp("Buy turkey", tasks[0].description));
+            Assert::AreEqual(2, tasks[1].task_id);
+            Assert::AreEqual(0, strcmp("Call mom", tasks[1].description));
+
+            int month_tasks = 0;
+            unsigned int occupied = 0;
+            Assert::AreEqual(1, sharedMonthSummary(view, 2025, 11, &month_tasks, &occupied));
+            Assert::AreEqual(3, month_tasks);
+            Assert::IsTrue(occupied == ((1u << 2) | (1u << 28)));
+            Assert::AreEqual(0, sharedMonthSummary(view, 2030, 1, &month_tasks, &occupied));
+
+            // date order, case-insensitive
+            Assert::AreEqual(3, sharedSearchTasks(view, "E", tasks, 4));
+            Assert::AreEqual(0, strcmp("Dentist", tasks[0].description));
+            Assert::AreEqual(0, strcmp("Buy turkey", tasks[1].description));
+            Assert::AreEqual(2026, tasks[2].year);
+            Assert::AreEqual(1, sharedSearchTasks(view, "MOM", tasks, 4));
+
+            closeSharedCalendar(view);
+            destroySharedCalendar(shared);
+            freeCalendar(cal);
+#endif
+        }
+
+        TEST_METHOD(AFailedGrowKeepsTheOldSegment)
+        {
+            struct shared_calendar* shared = createSharedCalendar("/calendar_unit_test");
+#ifndef __linux__
+            Assert::IsNull(shared);
+#else
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 1, 1, "first");
+            Assert::AreEqual(1, publishSharedCalendar(shared, cal));
+
+            // a directory where the bigger segment would be built makes the grow fail
+            Assert::AreEqual(0, mkdir("/dev/shm/calendar_unit_test.next", 0700));
+            static char descs[5000][48];
+            static struct task_entry entries[5000];
+            for (int i = 0; i < 5000; i++) {
+                snprintf(descs[i], sizeof(descs[i]), "A fairly long task description number %d", i);
+                entries[i] = { 2025, 1 + i % 12, 1 + i % 28, descs[i] };
+            }
+            addTasks(&cal, entries, 5000, NULL);
+            Assert::AreEqual(0, publishSharedCalendar(shared, cal));
+
+            // new readers still find the last publish under the name
+            struct shared_calendar_view* view = openSharedCalendar("/calendar_unit_test");
+            Assert::IsNotNull(view);
+            Assert::AreEqual(1LL, sharedCalendarVersion(view));
+            Assert::AreEqual(1, sharedCountTasks(view, 2025, 1, 1));
+
+            // and the next publish that can grow carries on from there
+            Assert::AreEqual(0, rmdir("/dev/shm/calendar_unit_test.next"));
+            Assert::AreEqual(1, publishSharedCalendar(shared, cal));
+            Assert::AreEqual(2LL, sharedCalendarVersion(view));
+            Assert::AreEqual(1 + 60, sharedCountTasks(view, 2025, 1, 1));
+
+            closeSharedCalendar(view);
+            destroySharedCalendar(shared);
+            freeCalendar(cal);
+#endif
+        }
+
+        TEST_METHOD(ViewsFollowAGrowingSegment)
+        {
+            struct shared_calendar* shared = createSharedCalendar("/calendar_unit_test");
+#ifndef __linux__
+            Assert::IsNull(shared);
+#else
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 1, 1, "first");
+            publishSharedCalendar(shared, cal);
+            struct shared_calendar_view* view = openSharedCalendar("/calendar_unit_test");
+            Assert::AreEqual(1, sharedCountTasks(view, 2025, 1, 1));
+
+            // far more than the first segment holds: the writer moves to a bigger one
+            static char descs[5000][48];
+            static struct task_entry entries[5000];
+            for (int i = 0; i < 5000; i++) {
+                snprintf(descs[i], sizeof(descs[i]), "A fairly long task description number %d", i);
+                entries[i] = { 2025, 1 + i % 12, 1 + i % 28, descs[i] };
+            }
+            addTasks(&cal, entries, 5000, NULL);
+            Assert::AreEqual(1, publishSharedCalendar(shared, cal));
+            Assert::AreEqual(2LL, sharedCalendarVersion(view));
+            Assert::AreEqual(1 + 60, sharedCountTasks(view, 2025, 1, 1));
+
+            struct shared_task found[2];
+            Assert::AreEqual(1, sharedSearchTasks(view, "number 4999", found, 2));
+            Assert::AreEqual(0, strcmp(descs[4999], found[0].description));
+
+            // once the writer is gone there's nothing left to read
+            destroySharedCalendar(shared);
+            Assert::AreEqual(-1, sharedCountTasks(view, 2025, 1, 1));
+            Assert::IsNull(openSharedCalendar("/calendar_unit_test"));
+
+            closeSharedCalendar(view);
+            freeCalendar(cal);
+#endif
+        }
+
+        TEST_METHOD(ReadersFollowGrowsWithoutGoingBack)
+        {
+            struct shared_calendar* shared = createSharedCalendar("/calendar_unit_test");
+#ifndef __linux__
+            Assert::IsNull(shared);
+#else
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 1, 1, "always here");
+            publishSharedCalendar(shared, cal);
+
+            struct GrowReader reader = { openSharedCalendar("/calendar_unit_test"), 0, 0, 0, 0 };
+            Assert::IsNotNull(reader.view);
+            platform_thread thread;
+            Assert::IsTrue(threadStart(&thread, ReadWhileGrowing, &reader) == 1);
+
+            // every round outgrows the segment again (a block is 1.5x what's needed)
+            static char descs[2000][48];
+            static struct task_entry entries[2000];
+            for (int round = 0; round < 12; round++) {
+                int count = 250 << (round / 2);
+                if (count > 2000) count = 2000;
+                for (int i = 0; i < count; i++) {
+                    snprintf(descs[i], sizeof(descs[i]), "A fairly long description, round %d #%d", round, i);
+                    entries[i] = { 2025 + round, 1 + i % 12, 1 + i % 28, descs[i] };
+                }
+                addTasks(&cal, entries, count, NULL);
+                Assert::AreEqual(1, publishSharedCalendar(shared, cal));
+                threadYield();
+            }
+
+            atomicStoreLong(&reader.stop, 1);
+            threadJoin(thread);
+            Assert::AreEqual(0, reader.went_back);
+            Assert::AreEqual(0, reader.empty);
+            Assert::IsTrue(reader.reads > 0);
+
+            closeSharedCalendar(reader.view);
+            destroySharedCalendar(shared);
+            freeCalendar(cal);
+#endif
+        }
+
+        TEST_METHOD(ReadersNeverSeeHalfAPublish)
+        {
+            struct shared_calendar* shared = createSharedCalendar("/calendar_unit_test");
+#ifndef __linux__
+            Assert::IsNull(shared);
+#else
+            struct years* cal = NULL;
+            publishSharedCalendar(shared, cal);
+
+            struct SharedReader reader = { "/calendar_unit_test", 0, 0, 0 };
+            platform_thread thread;
+            Assert::IsTrue(threadStart(&thread, ReadSharedUntilStopped, &reader) == 1);
+
+            // version n has n tasks on the day, all saying "v<n>"
+            char desc[32];
+            for (int round = 0; round < 400; round++) {
+                int n = 1 + round % 40;
+                freeCalendar(cal);
+                cal = NULL;
+                snprintf(desc, sizeof(desc), "v%d", n);
+                for (int i = 0; i < n; i++) {
+                    struct task_entry entry = { 2025, 6, 1, desc };
+                    addTasks(&cal, &entry, 1, NULL);
+                }
+                Assert::AreEqual(1, publishSharedCalendar(shared, cal));
+                if (round % 8 == 0) threadYield();
+            }
+
+            atomicStoreLong(&reader.stop, 1);
+            threadJoin(thread);
+            Assert::AreEqual(0, reader.torn);
+            Assert::IsTrue(reader.reads > 0);
+
+            destroySharedCalendar(shared);
+            freeCalendar(cal);
+#endif
+        }
+    };
+
+    // Cancels the job it's given from inside the search callback
+    static int CancelFromCallback(const struct task_match* match, void* user_data)
+    {
+        (void)match;
+        cancelJob(*(struct calendar_job**)user_data);
+        return 1;
+    }
+
+    TEST_CLASS(CalendarJobTests)
+    {
+    private:
+        static struct years* BuildCalendar()
+        {
+            struct years* cal = NULL;
+            static char descs[2000][40];
+            static struct task_entry entries[2000];
+            const char* words[] = { "design", "budget", "lunch", "review" };
+            for (int i = 0; i < 2000; i++) {
+                snprintf(descs[i], sizeof(descs[i]), "%s %d", words[i % 4], i);
+                entries[i] = { 2024 + i % 3, 1 + i % 12, 1 + (i * 7) % 28, descs[i] };
+            }
+            addTasks(&cal, entries, 2000, NULL);
+            findOrAddYear(&cal, 2030);      // an empty year still gets saved
+            return cal;
+        }
+
+    public:
+        TEST_METHOD(SearchJobMatchesBlockingSearch)
+        {
+            struct years* cal = BuildCalendar();
+            std::string expected;
+            int matches = searchTasksEach(cal, "DESIGN", 0, CollectWithIds, &expected);
+
+            const int budgets[] = { 1, 7, 100000 };
+            for (int budget : budgets) {
+                std::string hits;
+                struct calendar_job* job = startSearchJob(cal, "DESIGN", 0, CollectWithIds, &hits);
+
+                // nothing happens until it's stepped
+                Assert::AreEqual(0L, jobProgress(job));
+                int steps = 0;
+                while (stepJob(job, budget) == JOB_RUNNING) steps++;
+
+                Assert::AreEqual((int)JOB_DONE, jobStatus(job));
+                Assert::IsTrue(hits == expected);
+                Assert::AreEqual((long)matches, jobResult(job));
+                Assert::AreEqual(2000L, jobProgress(job));
+                Assert::IsTrue(steps >= 2000 / budget);
+                freeJob(job);
+            }
+
+            // limit
+            std::string expected_five, five;
+            searchTasksEach(cal, "budget", 5, CollectWithIds, &expected_five);
+            struct calendar_job* job = startSearchJob(cal, "budget", 5, CollectWithIds, &five);
+            Assert::AreEqual((int)JOB_DONE, finishJob(job, 3));
+            Assert::AreEqual(5L, jobResult(job));
+            Assert::IsTrue(five == expected_five);
+            freeJob(job);
+
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(SaveJobWritesTheSameFile)
+        {
+            const char* reference = "job_save_reference.txt";
+            const char* fname = "job_save_test.txt";
+            struct years* cal = BuildCalendar();
+            Assert::AreEqual(1, saveTasks(reference, cal));
+
+            struct calendar_job* job = startSaveJob(cal, fname);
+            Assert::IsNotNull(job);
+            Assert::AreEqual((int)JOB_DONE, finishJob(job, 64));
+            Assert::AreEqual(2000L, jobResult(job));
+            freeJob(job);
+
+            Assert::IsTrue(ReadWholeFile(reference) == ReadWholeFile(fname));
+            Assert::IsTrue(ReadWholeFile("job_save_test.txt.tmp").empty());
+
+            freeCalendar(cal);
+            std::remove(reference);
+            std::remove(fname);
+        }
+
+        TEST_METHOD(CancelledOrStaleJobsStopCleanly)
+        {
+            const char* fname = "job_cancel_test.txt";
+            struct years* cal = BuildCalendar();
+            Assert::AreEqual(1, saveTasks(fname, cal));
+            std::string before = ReadWholeFile(fname);
+
+            // a cancelled save leaves the old file alone
+            struct calendar_job* job = startSaveJob(cal, fname);
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 10));
+            cancelJob(job);
+            Assert::AreEqual((int)JOB_CANCELLED, stepJob(job, 10));
+            Assert::AreEqual((int)JOB_CANCELLED, stepJob(job, 10));
+            freeJob(job);
+            Assert::IsTrue(before == ReadWholeFile(fname));
+            Assert::IsTrue(ReadWholeFile("job_cancel_test.txt.tmp").empty());
+
+            // so does one that's freed half way
+            job = startSaveJob(cal, fname);
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 10));
+            freeJob(job);
+            Assert::IsTrue(before == ReadWholeFile(fname));
+
+            // cancelling from the job's own callback stops it right there
+            struct calendar_job* holder = NULL;
+            job = holder = startSearchJob(cal, "design", 0, CancelFromCallback, &holder);
+            Assert::AreEqual((int)JOB_CANCELLED, stepJob(job, 100000));
+            Assert::AreEqual(1L, jobResult(job));
+            freeJob(job);
+
+            // the calendar changing under a job fails it instead of walking freed nodes
+            std::string hits;
+            job = startSearchJob(cal, "review", 0, CollectWithIds, &hits);
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 10));
+            static const struct task_ref ref = { 2024, 1, 1, 1 };
+            Assert::AreEqual(1, deleteTasks(cal, &ref, 1, NULL));
+            Assert::AreEqual((int)JOB_FAILED, stepJob(job, 10));
+            freeJob(job);
+
+            freeCalendar(cal);
+            std::remove(fname);
+        }
+
+        TEST_METHOD(OnlyChangesAheadOfTheWalkFailAJob)
+        {
+            struct years* cal = BuildCalendar();
+            struct years* other = BuildCalendar();
+            std::string expected;
+            searchTasksEach(cal, "lunch", 0, CollectWithIds, &expected);
+
+            // another calendar changing doesn't matter
+            std::string hits;
+            struct calendar_job* job = startSearchJob(cal, "lunch", 0, CollectWithIds, &hits);
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 10));
+            addTask(&other, 2024, 1, 1, "lunch elsewhere");
+            static const struct task_ref ref = { 2024, 1, 1, 1 };
+            Assert::AreEqual(1, deleteTasks(other, &ref, 1, NULL));
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 10));
+
+            // nor does a year the walk is done with (2024 has 667 tasks)
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 1000));
+            addTask(&cal, 2024, 1, 1, "lunch too late");
+            Assert::AreEqual((int)JOB_DONE, finishJob(job, 10));
+            Assert::IsTrue(hits == expected);
+            freeJob(job);
+
+            // a year added after the walk's position does
+            job = startSearchJob(cal, "lunch", 0, CollectWithIds, &hits);
+            Assert::AreEqual((int)JOB_RUNNING, stepJob(job, 10));
+            addTask(&cal, 2031, 1, 1, "lunch later");
+            Assert::AreEqual((int)JOB_FAILED, stepJob(job, 10));
+            freeJob(job);
+
+            freeCalendar(other);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(YearViewJobPrintsTheCompactView)
+        {
+            const char* fname = "job_view_test.txt";
+            struct years* cal = NULL;
+            static const struct task_entry entries[] = {
+                { 2025, 1, 1, "a" }, { 2025, 1, 1, "b" }, { 2025, 1, 9, "c" }, { 2025, 3, 5, "d" }, { 2026, 2, 2, "x" }
+            };
+            addTasks(&cal, entries, 5, NULL);
+            findOrAddYear(&cal, 2030);
+
+            FILE* out = NULL;
+            fopen_s(&out, fname, "w");
+            const int years[] = { 2025, 2030, 2031 };
+            for (int year : years) {
+                struct calendar_job* job = startYearViewJob(cal, year, out);
+                Assert::AreEqual((int)JOB_DONE, finishJob(job, 1));
+                freeJob(job);
+            }
+            fclose(out);
+
+            const char* expected =
+                "\n=== Tasks for 2025 ===\n\n-- January --\n1 (Wednesday): a, b\n9 (Thursday): c\n"
+                "\n-- March --\n5 (Wednesday): d\n\n"
+                "\n=== Tasks for 2030 ===\nNo tasks stored for 2030.\n\n"
+                "No data for year 2031.\n";
+            Assert::AreEqual(0, strcmp(expected, ReadWholeFile(fname).c_str()));
+
+            freeCalendar(cal);
+            std::remove(fname);
+        }
+    };
+
+    TEST_CLASS(WorkloadTests)
+    {
+    public:
+        TEST_METHOD(SameSeedSameFile)
+        {
+            struct workload_options options;
+            initWorkloadOptions(&options);
+            options.seed = 7;
+
+            const char* names[] = { "workload_a_test.txt", "workload_b_test.txt", "workload_c_test.txt" };
+            for (int i = 0; i < 3; i++) {
+                if (i == 2) options.seed = 8;
+                FILE* out = NULL;
+                fopen_s(&out, names[i], "w");
+                Assert::AreEqual(500L, writeWorkloadTasks(&options, 500, WORKLOAD_TASKS_FILE, out));
+                fclose(out);
+            }
+
+            Assert::IsTrue(ReadWholeFile(names[0]) == ReadWholeFile(names[1]));
+            Assert::IsFalse(ReadWholeFile(names[0]) == ReadWholeFile(names[2]));
+
+            // and it loads: every task in the file
+            struct years* cal = loadTasks(names[0]);
+            int total = 0;
+            for (struct years* y = cal; y != NULL; y = y->next) total += y->task_count;
+            Assert::AreEqual(500, total);
+            freeCalendar(cal);
+
+            for (const char* name : names) std::remove(name);
+        }
+
+        TEST_METHOD(SkewMakesHotDays)
+        {
+            struct workload_options options;
+            initWorkloadOptions(&options);
+            options.first_year = options.last_year = 2025;
+            options.min_length = 5;
+            options.max_length = 20;
+
+            // 20000 tasks over 365 days: about 55 a day when every day is as likely
+            const double skews[] = { 0.0, 1.2 };
+            int busiest[2];
+            for (int s = 0; s < 2; s++) {
+                options.date_skew = skews[s];
+                struct workload* workload = createWorkload(&options);
+                Assert::IsNotNull(workload);
+
+                int counts[12][31] = {};
+                struct task_entry entry;
+                for (int i = 0; i < 20000; i++) {
+                    nextWorkloadTask(workload, &entry);
+                    Assert::AreEqual(2025, entry.year);
+                    Assert::IsTrue(entry.day <= daysInMonth(2025, entry.month));
+                    int length = (int)strlen(entry.description);
+                    Assert::IsTrue(length >= 5 && length <= 20);
+                    counts[entry.month - 1][entry.day - 1]++;
+                }
+                freeWorkload(workload);
+
+                busiest[s] = 0;
+                for (int m = 0; m < 12; m++) {
+                    for (int d = 0; d < 31; d++) {
+                        if (counts[m][d] > busiest[s]) busiest[s] = counts[m][d];
+                    }
+                }
+            }
+
+            Assert::IsTrue(busiest[0] < 150);
+            Assert::IsTrue(busiest[1] > 2000);
+        }
+
+        TEST_METHOD(TraceReplaysWithoutErrors)
+        {
+            const char* tasks_name = "workload_tasks_test.txt";
+            const char* trace_name = "workload_trace_test.txt";
+
+            struct workload_options options;
+            initWorkloadOptions(&options);
+            options.first_year = 2025;
+            options.last_year = 2026;
+            options.length_distribution = WORKLOAD_LENGTH_LONG_TAIL;
+
+            // heavy on deletes, so days run empty and the trace has to notice
+            struct workload_mix mix = { 30, 20, 40, 10 };
+            FILE* out = NULL;
+            fopen_s(&out, tasks_name, "w");
+            Assert::AreEqual(300L, writeWorkloadTasks(&options, 300, WORKLOAD_TASKS_FILE, out));
+            fclose(out);
+            fopen_s(&out, trace_name, "w");
+            Assert::AreEqual(3000L, writeWorkloadTrace(&options, 300, &mix, 3000, out));
+            fclose(out);
+
+            struct calendar_options calendar_options;
+            initCalendarOptions(&calendar_options);
+            calendar_options.silent = 1;
+            struct calendar* cal = createCalendar(&calendar_options);
+            Assert::AreEqual(300, calendarLoad(cal, tasks_name));
+
+            struct command_session* session = createCommandSession(cal, tasks_name);
+            std::string trace = ReadWholeFile(trace_name);
+            size_t start = 0;
+            int lines = 0;
+            while (start < trace.size()) {
+                size_t end = trace.find('\n', start);
+                std::string line = trace.substr(start, end - start);
+                start = end + 1;
+                lines++;
+
+                executeCommand(session, line.c_str());
+                std::string reply = commandOutput(session, NULL);
+                clearCommandOutput(session);
+                if (reply.compare(0, 3, "OK ") != 0) Assert::AreEqual(std::string("OK"), line + " -> " + reply);
+            }
+            Assert::AreEqual(3000, lines);
+
+            freeCommandSession(session);
+            destroyCalendar(cal);
+            std::remove(tasks_name);
+            std::remove(trace_name);
+        }
+    };
+
+    static void RecordSearches(void* arg)
+    {
+        (void)arg;
+        for (int i = 0; i < 1000; i++) recordOp(OP_SEARCH, 500, 1);
+    }
+
+    TEST_CLASS(OpStatsTests)
+    {
+    public:
+        TEST_METHOD_INITIALIZE(Setup)
+        {
+            resetOpStats();
+        }
+
+        TEST_METHOD(OperationsCountThemselves)
+        {
+            if (!opStatsEnabled()) return;          // built with CALENDAR_NO_STATS
+            const char* fname = "op_stats_test.txt";
+            struct op_stats stats;
+
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 4, 1, "twelve chars");
+            addTask(&cal, 2025, 4, 1, "four");
+            updateTask(cal, 2025, 4, 1, 2, "seven..");
+            deleteTask(cal, 2025, 4, 1, 9);         // a failed call still counts
+            searchTasks(cal, "four");
+            Assert::AreEqual(1, saveTasks(fname, cal));
+            freeCalendar(cal);
+            cal = loadTasks(fname);
+            freeCalendar(cal);
+
+            getOpStats(OP_ADD_TASK, &stats);
+            Assert::AreEqual(2ULL, stats.calls);
+            Assert::AreEqual(16ULL, stats.bytes);
+            getOpStats(OP_UPDATE_TASK, &stats);
+            Assert::AreEqual(1ULL, stats.calls);
+            Assert::AreEqual(7ULL, stats.bytes);
+            getOpStats(OP_DELETE_TASK, &stats);
+            Assert::AreEqual(1ULL, stats.calls);
+            getOpStats(OP_SEARCH, &stats);
+            Assert::AreEqual(1ULL, stats.calls);
+
+            // "[YEAR] 2025\n4 1 twelve chars\n4 1 seven..\n", written and read back
+            unsigned long long file_bytes = 12 + 17 + 12;
+            getOpStats(OP_SAVE, &stats);
+            Assert::AreEqual(1ULL, stats.calls);
+            Assert::AreEqual(file_bytes, stats.bytes);
+            getOpStats(OP_LOAD, &stats);
+            Assert::AreEqual(1ULL, stats.calls);
+            Assert::AreEqual(file_bytes, stats.bytes);
+
+            // the calendar context's versions count under the same names
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            struct calendar* context = createCalendar(&options);
+            calendarAddTask(context, 2025, 4, 2, "abc");
+            calendarLoad(context, fname);
+            destroyCalendar(context);
+
+            getOpStats(OP_ADD_TASK, &stats);
+            Assert::AreEqual(3ULL, stats.calls);
+            Assert::AreEqual(19ULL, stats.bytes);
+            getOpStats(OP_LOAD, &stats);
+            Assert::AreEqual(2ULL, stats.calls);
+
+            std::remove(fname);
+            resetOpStats();
+            getOpStats(OP_ADD_TASK, &stats);
+            Assert::AreEqual(0ULL, stats.calls);
+        }
+
+        TEST_METHOD(HistogramPercentiles)
+        {
+            // 90 fast calls and 10 slow ones
+            for (int i = 0; i < 90; i++) recordOp(OP_SEARCH, 1000, 0);
+            for (int i = 0; i < 10; i++) recordOp(OP_SEARCH, 5000000, 0);
+
+            struct op_stats stats;
+            getOpStats(OP_SEARCH, &stats);
+            Assert::AreEqual(100ULL, stats.calls);
+            Assert::AreEqual(5000000ULL, stats.max_nanos);
+
+            // within a bucket (~6%) of the real value, never below it
+            unsigned long long p50 = opStatsPercentile(&stats, 0.5);
+            unsigned long long p90 = opStatsPercentile(&stats, 0.9);
+            unsigned long long p99 = opStatsPercentile(&stats, 0.99);
+            Assert::IsTrue(p50 >= 1000 && p50 <= 1070);
+            Assert::IsTrue(p90 >= 1000 && p90 <= 1070);
+            Assert::AreEqual(5000000ULL, p99);
+
+            // every bucket starts where the one before it ended
+            for (int b = 1; b < OP_STATS_BUCKETS; b++) Assert::IsTrue(opStatsBucketStart(b) > opStatsBucketStart(b - 1));
+            Assert::AreEqual(16ULL, opStatsBucketStart(16));
+            Assert::AreEqual(32ULL, opStatsBucketStart(32));
+        }
+
+        TEST_METHOD(ThreadsAddUp)
+        {
+            // each thread records into its own shard; the snapshot merges them
+            platform_thread threads[6];
+            for (int i = 0; i < 6; i++) Assert::IsTrue(threadStart(&threads[i], RecordSearches, NULL) == 1);
+            for (int i = 0; i < 6; i++) threadJoin(threads[i]);
+            recordOp(OP_SEARCH, 9000, 1);
+
+            struct op_stats stats;
+            getOpStats(OP_SEARCH, &stats);
+            Assert::AreEqual(6001ULL, stats.calls);
+            Assert::AreEqual(6001ULL, stats.bytes);
+            Assert::AreEqual(9000ULL, stats.max_nanos);
+            Assert::AreEqual(6000ULL * 500 + 9000, stats.total_nanos);
+
+            unsigned long long counted = 0;
+            for (int b = 0; b < OP_STATS_BUCKETS; b++) counted += stats.buckets[b];
+            Assert::AreEqual(6001ULL, counted);
+
+            resetOpStats();
+            getOpStats(OP_SEARCH, &stats);
+            Assert::AreEqual(0ULL, stats.calls);
+            Assert::AreEqual(0ULL, stats.max_nanos);
+        }
+
+        TEST_METHOD(StatsCommandFormats)
+        {
+            recordOp(OP_ADD_TASK, 2000, 10);
+            recordOp(OP_ADD_TASK, 2000000, 10);
+
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            struct calendar* cal = createCalendar(&options);
+            struct command_session* session = createCommandSession(cal, "op_stats_tasks_test.txt");
+
+            executeCommand(session, "stats");
+            std::string text = commandOutput(session, NULL);
+            clearCommandOutput(session);
+            Assert::IsTrue(text.compare(0, 5, "OK 2\n") == 0);
+            Assert::IsTrue(text.find("addTask") != std::string::npos);
+
+            executeCommand(session, "stats prometheus");
+            std::string prometheus = commandOutput(session, NULL);
+            clearCommandOutput(session);
+            Assert::IsTrue(prometheus.find("calendar_op_calls_total{op=\"addTask\"} 2\n") != std::string::npos);
+            Assert::IsTrue(prometheus.find("calendar_op_bytes_total{op=\"addTask\"} 20\n") != std::string::npos);
+            // 2 us is under 10 us, 2 ms only under 10 ms
+            Assert::IsTrue(prometheus.find("calendar_op_duration_seconds_bucket{op=\"addTask\",le=\"1e-06\"} 0\n") != std::string::npos);
+            Assert::IsTrue(prometheus.find("calendar_op_duration_seconds_bucket{op=\"addTask\",le=\"1e-05\"} 1\n") != std::string::npos);
+            Assert::IsTrue(prometheus.find("calendar_op_duration_seconds_bucket{op=\"addTask\",le=\"0.001\"} 1\n") != std::string::npos);
+            Assert::IsTrue(prometheus.find("calendar_op_duration_seconds_bucket{op=\"addTask\",le=\"0.01\"} 2\n") != std::string::npos);
+            Assert::IsTrue(prometheus.find("calendar_op_duration_seconds_count{op=\"addTask\"} 2\n") != std::string::npos);
+
+            executeCommand(session, "stats json");
+            Assert::IsTrue(std::string(commandOutput(session, NULL)).compare(0, 12, "ERR bad_args") == 0);
+
+            freeCommandSession(session);
+            destroyCalendar(cal);
+            resetOpStats();
+        }
+    };
+
+    static void AddToTwoYears(void* arg)
+    {
+        struct years** cal = (struct years**)arg;
+        for (int i = 0; i < 100; i++) addTask(cal, 2961 + i % 2, 1 + i % 12, 1, "alternating");
+    }
+
+    TEST_CLASS(MemStatsTests)
+    {
+    public:
+        TEST_METHOD(CountsEachKindPerYear)
+        {
+            if (!memStatsEnabled()) return;         // built with CALENDAR_NO_MEM_STATS
+
+            struct mem_stats before, after, totals_before, totals;
+            getYearMemStats(2931, &before);
+            getMemStats(&totals_before);
+
+            struct years* cal = NULL;
+            addTask(&cal, 2931, 5, 1, "abc");
+            updateTask(cal, 2931, 5, 1, 1, "abcdefg");
+
+            getYearMemStats(2931, &after);
+            Assert::AreEqual(2931, after.year);
+            Assert::AreEqual(1ULL, after.kinds[MEM_YEAR_NODES].count - before.kinds[MEM_YEAR_NODES].count);
+            Assert::AreEqual((unsigned long long)sizeof(struct years), after.kinds[MEM_YEAR_NODES].bytes - before.kinds[MEM_YEAR_NODES].bytes);
+            Assert::AreEqual((unsigned long long)(12 * sizeof(struct months)), after.kinds[MEM_MONTH_ARRAYS].bytes - before.kinds[MEM_MONTH_ARRAYS].bytes);
+            // only May has a task, so only May got a day array
+            Assert::AreEqual(1ULL, after.kinds[MEM_DAY_ARRAYS].count - before.kinds[MEM_DAY_ARRAYS].count);
+            Assert::AreEqual((unsigned long long)(31 * sizeof(struct days)), after.kinds[MEM_DAY_ARRAYS].bytes - before.kinds[MEM_DAY_ARRAYS].bytes);
+            Assert::AreEqual((unsigned long long)sizeof(struct tasks), after.kinds[MEM_TASK_NODES].bytes - before.kinds[MEM_TASK_NODES].bytes);
+
+            // the original text still sits in the node, the update got its own block
+            Assert::AreEqual(2ULL, after.kinds[MEM_DESCRIPTIONS].count - before.kinds[MEM_DESCRIPTIONS].count);
+            Assert::AreEqual(4ULL + 8ULL, after.kinds[MEM_DESCRIPTIONS].bytes - before.kinds[MEM_DESCRIPTIONS].bytes);
+
+            unsigned long long added = after.bytes - before.bytes;
+            getMemStats(&totals);
+            Assert::AreEqual(added, totals.bytes - totals_before.bytes);
+
+            // everything goes back on free; the peak remembers
+            freeCalendar(cal);
+            getYearMemStats(2931, &after);
+            Assert::AreEqual(before.bytes, after.bytes);
+            for (int k = 0; k < MEM_KIND_COUNT; k++) Assert::AreEqual(before.kinds[k].count, after.kinds[k].count);
+            Assert::IsTrue(after.peak_bytes >= before.bytes + added);
+
+            resetMemPeaks();
+            getYearMemStats(2931, &after);
+            Assert::AreEqual(after.bytes, after.peak_bytes);
+        }
+
+        TEST_METHOD(BlocksGoBackToTheirYearFromAnyThread)
+        {
+            if (!memStatsEnabled()) return;
+
+            struct mem_stats before[2], after[2];
+            getYearMemStats(2961, &before[0]);
+            getYearMemStats(2962, &before[1]);
+
+            // built on another thread, switching years back and forth, freed on this one
+            struct years* cal = NULL;
+            platform_thread thread;
+            Assert::IsTrue(threadStart(&thread, AddToTwoYears, &cal) == 1);
+            threadJoin(thread);
+
+            getYearMemStats(2961, &after[0]);
+            getYearMemStats(2962, &after[1]);
+            Assert::AreEqual(50ULL, after[0].kinds[MEM_TASK_NODES].count - before[0].kinds[MEM_TASK_NODES].count);
+            Assert::AreEqual(50ULL, after[1].kinds[MEM_TASK_NODES].count - before[1].kinds[MEM_TASK_NODES].count);
+
+            freeCalendar(cal);
+            for (int i = 0; i < 2; i++) {
+                getYearMemStats(2961 + i, &after[i]);
+                Assert::AreEqual(before[i].bytes, after[i].bytes);
+                for (int k = 0; k < MEM_KIND_COUNT; k++) Assert::AreEqual(before[i].kinds[k].count, after[i].kinds[k].count);
+            }
+        }
+
+        TEST_METHOD(ReportShowsYearsWithoutTasks)
+        {
+            if (!memStatsEnabled()) return;
+
+            struct years* cal = NULL;
+            addTask(&cal, 2941, 1, 1, "kept");
+            findOrAddYear(&cal, 2942);              // a skeleton and nothing else
+
+            struct mem_stats years[64];
+            int count = listYearMemStats(years, 64);
+            Assert::IsTrue(count >= 2);
+            for (int i = 1; i < count && i < 64; i++) Assert::IsTrue(years[i - 1].year < years[i].year);
+
+            std::string report;
+            formatMemStats([](const char* line, void* user_data) {
+                *(std::string*)user_data += std::string(line) + "\n";
+            }, &report);
+
+            size_t kept = report.find("\n2941 ");
+            size_t empty = report.find("\n2942 ");
+            Assert::IsTrue(kept != std::string::npos && empty != std::string::npos);
+            Assert::IsTrue(report.find("no tasks", kept) > report.find('\n', kept + 1));
+            Assert::IsTrue(report.find("no tasks", empty) < report.find('\n', empty + 1));
+            Assert::IsTrue(report.find("\nall ") != std::string::npos);
+
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(MemoryCommand)
+        {
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            struct calendar* cal = createCalendar(&options);
+            struct command_session* session = createCommandSession(cal, "mem_stats_tasks_test.txt");
+
+            executeCommand(session, "add 2951 3 3 hello");
+            clearCommandOutput(session);
+            executeCommand(session, "memory");
+            std::string reply = commandOutput(session, NULL);
+            clearCommandOutput(session);
+            Assert::IsTrue(reply.compare(0, 3, "OK ") == 0);
+            Assert::IsTrue(reply.find("\nall ") != std::string::npos);
+            if (memStatsEnabled()) Assert::IsTrue(reply.find("\n2951 ") != std::string::npos);
+
+            executeCommand(session, "memory 2951");
+            Assert::IsTrue(std::string(commandOutput(session, NULL)).compare(0, 12, "ERR bad_args") == 0);
+
+            freeCommandSession(session);
+            destroyCalendar(cal);
+        }
+    };
+
+    TEST_CLASS(TraceTests)
+    {
+    public:
+        TEST_METHOD_CLEANUP(Cleanup)
+        {
+            traceClear();
+        }
+
+        TEST_METHOD(LoadSaveSearchSpans)
+        {
+            const char* tasks_file = "trace_tasks_test.txt";
+            const char* trace_file = "trace_test.json";
+
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 1, 1, "alpha");
+            addTask(&cal, 2026, 2, 2, "beta");
+            Assert::AreEqual(1, saveTasks(tasks_file, cal));
+            freeCalendar(cal);
+
+            if (!traceStart(0)) return;             // built with CALENDAR_NO_STATS
+            traceThreadName("test \"main\"");
+            cal = loadTasks(tasks_file);
+            saveTasks(tasks_file, cal);
+            searchTasks(cal, "beta");
+            traceStop();
+
+            // stopped: nothing more is recorded
+            int count = traceEventCount();
+            searchTasks(cal, "alpha");
+            Assert::AreEqual(count, traceEventCount());
+            freeCalendar(cal);
+
+            Assert::AreEqual(1, saveTrace(trace_file));
+            std::string json = ReadWholeFile(trace_file);
+            Assert::IsTrue(json.compare(0, 15, "{\"displayTimeUn") == 0);
+            Assert::IsTrue(json.find("\"args\":{\"name\":\"test \\\"main\\\"\"}") != std::string::npos);
+            Assert::IsTrue(json.find("{\"name\":\"loadTasks\",\"cat\":\"load\",\"ph\":\"X\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"args\":{\"tasks\":2}") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"read + parse year\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"args\":{\"year\":2026}") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"build year skeleton\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"saveTasks\"") != std::string::npos);
+            Assert::IsTrue(json.find("{\"name\":\"search\",\"cat\":\"search\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"args\":{\"hits\":1}") != std::string::npos);
+            Assert::IsTrue(json.compare(json.size() - 4, 4, "\n]}\n") == 0);
+
+            std::remove(tasks_file);
+            std::remove(trace_file);
+        }
+
+        TEST_METHOD(PooledLoadSpans)
+        {
+            const char* tasks_file = "trace_pool_test.txt";
+
+            struct years* cal = NULL;
+            static char descs[4000][32];
+            static struct task_entry entries[4000];
+            for (int i = 0; i < 4000; i++) {
+                snprintf(descs[i], sizeof(descs[i]), "Task %d of the trace", i);
+                entries[i] = { 2024 + i % 2, 1 + i % 12, 1 + i % 28, descs[i] };
+            }
+            addTasks(&cal, entries, 4000, NULL);
+            Assert::AreEqual(1, saveTasks(tasks_file, cal));
+            freeCalendar(cal);
+
+            if (!traceStart(0)) return;
+            struct work_pool* pool = createWorkPool(2);
+            cal = loadTasksParallel(tasks_file, pool);
+            freeWorkPool(pool);
+            traceStop();
+
+            std::string json;
+            Assert::IsTrue(traceEventCount() > 3);
+            FILE* out = tmpfile();
+            Assert::IsNotNull(out);
+            Assert::AreEqual(1, writeTrace(out));
+            long size = ftell(out);
+            rewind(out);
+            json.resize((size_t)size);
+            Assert::AreEqual((size_t)size, fread(&json[0], 1, (size_t)size, out));
+            fclose(out);
+
+            Assert::IsTrue(json.find("\"name\":\"read file\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"split into chunks\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"parse chunk\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"merge chunks\"") != std::string::npos);
+            Assert::IsTrue(json.find("\"name\":\"loadTasksAsync\"") != std::string::npos);
+
+            freeCalendar(cal);
+            std::remove(tasks_file);
+        }
+
+        TEST_METHOD(FullBufferDropsSpans)
+        {
+            Assert::AreEqual(0LL, traceBegin());    // not tracing yet
+
+            if (!traceStart(2)) return;
+            for (int i = 0; i < 5; i++) {
+                long long span = traceBegin();
+                Assert::IsTrue(span != 0);
+                traceEnd(span, "step", "test", NULL, 0);
+            }
+            Assert::AreEqual(2, traceEventCount());
+            Assert::AreEqual(3, traceDroppedCount());
+
+            // starting again empties it
+            Assert::AreEqual(1, traceStart(2));
+            Assert::AreEqual(0, traceEventCount());
+            Assert::AreEqual(0, traceDroppedCount());
+
+            traceClear();
+            Assert::AreEqual(0, traceActive());
+            Assert::AreEqual(0LL, traceBegin());
+        }
+    };
+
+    TEST_CLASS(RenderTests)
+    {
+    private:
+        static int CountWrite(const char* data, size_t length, void* user_data)
+        {
+            int* writes = (int*)user_data;
+            (*writes)++;
+            return 1;
+        }
+
+    public:
+        TEST_METHOD(MonthGridLayout)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2026, 2, 3, "dentist");
+            addTask(&cal, 2026, 2, 14, "dinner");
+
+            struct render_memory memory = {};
+            struct render_buffer buffer;
+            initRenderBuffer(&buffer, memorySink(&memory));
+            Assert::AreEqual(1, renderMonthCalendar(&buffer, cal, 2026, 2));
+            Assert::AreEqual(1, flushRender(&buffer));
+
+            // February 2026 starts on a Sunday and fills exactly four weeks
+            const char* expected =
+                "\n"
+                "         February 2026\n"
+                "_____________________________\n"
+                "|Su |Mo |Tu |We |Th |Fr |Sa |\n"
+                "|___|___|___|___|___|___|___|\n"
+                "|1  |2  |3* |4  |5  |6  |7  |\n"
+                "|___|___|___|___|___|___|___|\n"
+                "|8  |9  |10 |11 |12 |13 |14*|\n"
+                "|___|___|___|___|___|___|___|\n"
+                "|15 |16 |17 |18 |19 |20 |21 |\n"
+                "|___|___|___|___|___|___|___|\n"
+                "|22 |23 |24 |25 |26 |27 |28 |\n"
+                "|___|___|___|___|___|___|___|\n"
+                "\n* = day has one or more tasks.\n";
+            Assert::AreEqual(std::string(expected), std::string(memory.data));
+
+            // partial first and last weeks keep their empty cells
+            memory.length = 0;
+            renderMonthCalendar(&buffer, cal, 2025, 11);
+            flushRender(&buffer);
+            Assert::IsTrue(strstr(memory.data, "|   |   |   |   |   |   |1  |\n") != NULL);
+            Assert::IsTrue(strstr(memory.data, "|30 |   |   |   |   |   |   |\n") != NULL);
+
+            memory.length = 0;
+            Assert::AreEqual(0, renderMonthCalendar(&buffer, cal, 2026, 13));
+            flushRender(&buffer);
+            Assert::AreEqual(std::string("Invalid month.\n"), std::string(memory.data));
+
+            freeRenderBuffer(&buffer);
+            freeRenderMemory(&memory);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(YearGoesOutInOneWrite)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 7, 4, "fireworks");
+
+            int writes = 0;
+            struct render_sink counter = { CountWrite, &writes };
+            struct render_buffer buffer;
+            initRenderBuffer(&buffer, counter);
+            renderYearCalendar(&buffer, cal, 2025);
+            size_t length = buffer.length;
+            Assert::AreEqual(1, flushRender(&buffer));
+            Assert::AreEqual(1, writes);
+            Assert::AreEqual((size_t)0, buffer.length);
+
+            // every sink gets the same text
+            struct render_memory memory = {};
+            buffer.sink = memorySink(&memory);
+            renderYearCalendar(&buffer, cal, 2025);
+            flushRender(&buffer);
+            Assert::AreEqual(length, memory.length);
+            Assert::IsTrue(strstr(memory.data, "===Calendar of 2025===\n") != NULL);
+            Assert::IsTrue(strstr(memory.data, "|4* |") != NULL);
+
+            FILE* out = tmpfile();
+            Assert::IsNotNull(out);
+            buffer.sink = fdSink(_fileno(out));
+            renderYearCalendar(&buffer, cal, 2025);
+            Assert::AreEqual(1, flushRender(&buffer));
+
+            std::string written(length, '\0');
+            rewind(out);
+            Assert::AreEqual(length, fread(&written[0], 1, length, out));
+            Assert::AreEqual(std::string(memory.data), written);
+            fclose(out);
+
+            freeRenderBuffer(&buffer);
+            freeRenderMemory(&memory);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(UnloadedYearIsNotCreated)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2030, 1, 1, "first");
+
+            struct render_memory memory = {};
+            struct render_buffer buffer;
+            initRenderBuffer(&buffer, memorySink(&memory));
+            renderYearCalendar(&buffer, cal, 2029);
+            renderMonthCalendar(&buffer, cal, 2031, 5);
+            flushRender(&buffer);
+            Assert::IsNull(strstr(memory.data, "*|"));     // no day is marked
+            Assert::IsNull(strstr(memory.data, "* |"));
+            Assert::IsNull(findYear(cal, 2029));
+            Assert::IsNull(findYear(cal, 2031));
+
+            // the context version reads under the calendar's locks
+            struct calendar_options options;
+            initCalendarOptions(&options);
+            options.silent = 1;
+            struct calendar* context = createCalendar(&options);
+            calendarAddTask(context, 2030, 1, 2, "second");
+            memory.length = 0;
+            Assert::AreEqual(1, calendarRenderMonth(context, &buffer, 2030, 1));
+            Assert::AreEqual(1, calendarRenderYear(context, &buffer, 2030));
+            flushRender(&buffer);
+            Assert::IsTrue(strstr(memory.data, "|2* |") != NULL);
+            destroyCalendar(context);
+
+            freeRenderBuffer(&buffer);
+            freeRenderMemory(&memory);
+            freeCalendar(cal);
+        }
+        TEST_METHOD(YearInColumns)
+        {
+            struct years* cal = NULL;
+            addTask(&cal, 2025, 7, 4, "fireworks");
+            addTask(&cal, 2025, 12, 25, "dinner");
+
+            struct render_memory memory = {};
+            struct render_buffer buffer;
+            initRenderBuffer(&buffer, memorySink(&memory));
+            Assert::AreEqual(1, renderYearColumns(&buffer, cal, 2025, 4));
+            flushRender(&buffer);
+            std::string four = memory.data;
+
+            // three rows of four months, each line holding a week of all four
+            Assert::IsTrue(four.find("===Calendar of 2025===\n") != std::string::npos);
+            Assert::IsTrue(four.find("January 2025") < four.find("April 2025"));
+            Assert::IsTrue(four.find("April 2025") < four.find("May 2025"));
+            Assert::IsTrue(four.find("|   |   |   |1  |2  |3  |4  |  |   |   |   |   |   |   |1  |  "
+                "|   |   |   |   |   |   |1  |  |   |   |1  |2  |3  |4  |5  |\n") != std::string::npos);
+            Assert::IsTrue(four.find("|4* |") != std::string::npos);
+            Assert::IsTrue(four.find("|25*|") != std::string::npos);
+            Assert::IsTrue(four.find(" \n") == std::string::npos);       // no trailing blanks
+
+            // four rows of three
+            memory.length = 0;
+            renderYearColumns(&buffer, cal, 2025, 3);
+            flushRender(&buffer);
+            std::string three = memory.data;
+            Assert::IsTrue(three.find("March 2025") < three.find("April 2025"));
+            Assert::IsTrue(three.find("|4* |") != std::string::npos);
+            size_t week = three.find("|   |   |   |1  |2  |3  |4  |  |   |   |   |   |   |   |1  |  "
+                "|   |   |   |   |   |   |1  |\n");
+            Assert::IsTrue(week != std::string::npos);
+
+            // a year with no tasks isn't created
+            memory.length = 0;
+            renderYearColumns(&buffer, cal, 2031, 3);
+            flushRender(&buffer);
+            Assert::IsNull(findYear(cal, 2031));
+            Assert::IsNull(strstr(memory.data, "*|"));
+            Assert::IsNull(strstr(memory.data, "* |"));
+
+            memory.length = 0;
+            Assert::AreEqual(0, renderYearColumns(&buffer, cal, 2025, 0));
+            flushRender(&buffer);
+            Assert::AreEqual(std::string("Invalid number of columns.\n"), std::string(memory.data));
+
+            freeRenderBuffer(&buffer);
+            freeRenderMemory(&memory);
+            freeCalendar(cal);
+        }
+    };
+
+    TEST_CLASS(RenderCacheTests)
+    {
+    private:
+        // one view through the cache, and the same view rendered directly
+        static void RenderBoth(struct render_cache* cache, struct years* cal, int year, int month,
+            std::string& cached, std::string& direct)
+        {
+            struct render_memory memory = {};
+            struct render_buffer buffer;
+            initRenderBuffer(&buffer, memorySink(&memory));
+
+            if (month) renderCachedMonth(cache, &buffer, cal, year, month);
+            else renderCachedYear(cache, &buffer, cal, year);
+            flushRender(&buffer);
+            cached = memory.data;
+
+            memory.length = 0;
+            if (month) renderMonthCalendar(&buffer, cal, year, month);
+            else renderYearCalendar(&buffer, cal, year);
+            flushRender(&buffer);
+            direct = memory.data;
+
+            freeRenderBuffer(&buffer);
+            freeRenderMemory(&memory);
+        }
+
+    public:
+        TEST_METHOD(OnlyOccupancyChangesRerender)
+        {
+            struct render_cache* cache = createRenderCache(16);
+            struct render_cache_stats stats;
+            std::string cached, direct;
+
+            struct years* cal = NULL;
+            addTask(&cal, 2027, 5, 10, "lunch");
+
+            RenderBoth(cache, cal, 2027, 5, cached, direct);
+            Assert::AreEqual(direct, cached);
+            RenderBoth(cache, cal, 2027, 5, cached, direct);
+            Assert::AreEqual(direct, cached);
+            getRenderCacheStats(cache, &stats);
+            Assert::AreEqual(1ul, stats.misses);
+            Assert::AreEqual(1ul, stats.hits);
+
+            // same days with tasks: an edit, another month, another day with tasks already
+            updateTask(cal, 2027, 5, 10, 1, "late lunch");
+            addTask(&cal, 2027, 6, 1, "june");
+            addTask(&cal, 2027, 5, 10, "second");
+            RenderBoth(cache, cal, 2027, 5, cached, direct);
+            Assert::AreEqual(direct, cached);
+            getRenderCacheStats(cache, &stats);
+            Assert::AreEqual(2ul, stats.hits);
+            Assert::AreEqual(0ul, stats.invalidations);
+
+            // a new day with tasks only redraws this month
+            RenderBoth(cache, cal, 2027, 6, cached, direct);
+            addTask(&cal, 2027, 5, 20, "dentist");
+            RenderBoth(cache, cal, 2027, 5, cached, direct);
+            Assert::AreEqual(direct, cached);
+            Assert::IsTrue(cached.find("|20*|") != std::string::npos);
+            RenderBoth(cache, cal, 2027, 6, cached, direct);
+            Assert::AreEqual(direct, cached);
+            getRenderCacheStats(cache, &stats);
+            Assert::AreEqual(1ul, stats.invalidations);
+            Assert::AreEqual(3ul, stats.hits);
+
+            // emptied again
+            deleteTask(cal, 2027, 5, 20, 1);
+            RenderBoth(cache, cal, 2027, 5, cached, direct);
+            Assert::AreEqual(direct, cached);
+            Assert::IsTrue(cached.find("|20 |") != std::string::npos);
+
+            // a freed and rebuilt calendar isn't mistaken for the old one
+            freeCalendar(cal);
+            cal = NULL;
+            addTask(&cal, 2027, 5, 3, "new");
+            RenderBoth(cache, cal, 2027, 5, cached, direct);
+            Assert::AreEqual(direct, cached);
+            Assert::IsTrue(cached.find("|10 |") != std::string::npos);
+
+            freeRenderCache(cache);
+            freeCalendar(cal);
+        }
+
+        TEST_METHOD(YearViewsAndEviction)
+        {
+            struct render_cache* cache = createRenderCache(12);
+            struct render_cache_stats stats;
+            std::string cached, direct;
+
+            struct years* cal = NULL;
+            addTask(&cal, 2028, 2, 29, "leap day");
+
+            RenderBoth(cache, cal, 2028, 0, cached, direct);
+            Assert::AreEqual(direct, cached);
+            RenderBoth(cache, cal, 2028, 0, cached, direct);
+            Assert::AreEqual(direct, cached);
+            getRenderCacheStats(cache, &stats);
+            Assert::AreEqual(12ul, stats.misses);
+            Assert::AreEqual(12ul, stats.hits);
+            Assert::AreEqual(12, stats.entries);
+
+            // a year that isn't loaded pushes the other one out (and isn't created)
+            RenderBoth(cache, cal, 2029, 0, cached, direct);
+            Assert::AreEqual(direct, cached);
+            Assert::IsNull(findYear(cal, 2029));
+            getRenderCacheStats(cache, &stats);
+            Assert::AreEqual(12ul, stats.evictions);
+            Assert::AreEqual(12, stats.entries);
+            Assert::AreEqual(12, stats.capacity);
+
+            clearRenderCache(cache);
+            getRenderCacheStats(cache, &stats);
+            Assert::AreEqual(0, stats.entries);
+
+            freeRenderCache(cache);
+            freeCalendar(cal);
+        }
+    };
+
+    TEST_CLASS(FileIOTests)
+    {
+    public:
+        TEST_METHOD(SaveLoad_RoundTripPreservesTasks)
+        {
+            // write to a predictable test file name
+            const char* fname = "tasks_test.txt";
+
+            struct years* cal = NULL;
+
+            addTask(&cal, 2025, 12, 25, "Christmas Day");
+            addTask(&cal, 2025, 12, 25, "Dinner at 6");
+            addTask(&cal, 2026, 1, 1, "New Year's Day");
+
+            int saved = saveTasks(fname, cal);
+            Assert::IsTrue(saved == 1);
+
+            freeCalendar(cal);
+            cal = NULL;
+
+            // load into fresh structure
+            cal = loadTasks(fname);
+            Assert::IsNotNull(cal);
+
+            Assert::AreEqual(2, CountTasksForDay(cal, 2025, 12, 25));
+            Assert::AreEqual(1, CountTasksForDay(cal, 2026, 1, 1));
+
+            // cleanup calendar
+            freeCalendar(cal);
+
+            // cleanup file (best effort)
+            std::remove(fname);
+        }
+
+        TEST_METHOD(Save_WritesYearsInAscendingOrder)
+        {
+            const char* fname = "tasks_order_test.txt";
+
+            // older versions wrote the newest-added year first; either order loads
+            FILE* fp = NULL;
+            fopen_s(&fp, fname, "w");
+            Assert::IsNotNull(fp);
+            fprintf(fp, "[YEAR] 2026\n1 1 b\n[YEAR] 2024\n2 2 a\n[YEAR] 2025\n");
+            fclose(fp);
+
+            struct years* cal = loadTasks(fname);
+            Assert::IsNotNull(cal);
+            Assert::AreEqual(1, saveTasks(fname, cal));
+            freeCalendar(cal);
+
+            Assert::IsTrue(ReadWholeFile(fname) == "[YEAR] 2024\n2 2 a\n[YEAR] 2025\n[YEAR] 2026\n1 1 b\n");
+            std::remove(fname);
+        }
+
+        TEST_METHOD(Load_LongDescriptionIsCutToFit)
+        {
+            const char* fname = "tasks_long_test.txt";
+
+            std::string long_desc(400, 'x');
+            FILE* fp = NULL;
+            fopen_s(&fp, fname, "w");
+            Assert::IsNotNull(fp);
+            fprintf(fp, "[YEAR] 2025\n3 4   %s\n3 5\n", long_desc.c_str());
+            fclose(fp);
+
+            struct years* cal = loadTasks(fname);
+            Assert::IsNotNull(cal);
+
+            // leading blanks skipped, cut to DESC_LEN - 1
+            struct days* day = getDayNode(cal, 2025, 3, 4);
+            Assert::IsNotNull(day->tasks_head);
+            Assert::AreEqual((size_t)(DESC_LEN - 1), strlen(day->tasks_head->task_description));
+            Assert::AreEqual(std::string(DESC_LEN - 1, 'x'), std::string(day->tasks_head->task_description));
+
+            // a line with no description still adds an (empty) task, as before
+            Assert::AreEqual(1, CountTasksForDay(cal, 2025, 3, 5));
+
+            freeCalendar(cal);
             std::remove(fname);
         }
     };
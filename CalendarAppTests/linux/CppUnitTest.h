@@ -0,0 +1,132 @@
+#pragma once
+
+// Stand-in for the Visual Studio CppUnitTest framework, so CalendarAppTests.cpp
+// builds and runs on Linux (see CMakeLists.txt). Only what the tests use:
+// TEST_CLASS / TEST_METHOD / TEST_METHOD_INITIALIZE / TEST_METHOD_CLEANUP and
+// the Assert calls. Each TEST_METHOD registers itself; TestRunner.cpp runs them.
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace CppUnitTestShim
+{
+    struct TestCase {
+        const char* class_name;
+        const char* method_name;
+        std::function<void()> run;
+    };
+
+    inline std::vector<TestCase>& testCases()
+    {
+        static std::vector<TestCase> cases;
+        return cases;
+    }
+
+    struct AssertFailed {
+        std::string message;
+    };
+
+    struct TestClassBase {
+        virtual ~TestClassBase() {}
+        virtual void initializeMethod() {}
+        virtual void cleanupMethod() {}
+    };
+
+    // a new object per test, like the Visual Studio runner
+    template <class T>
+    void runTest(void (T::*method)())
+    {
+        T test;
+        test.initializeMethod();
+        try {
+            (test.*method)();
+        }
+        catch (...) {
+            test.cleanupMethod();
+            throw;
+        }
+        test.cleanupMethod();
+    }
+
+}
+
+namespace Microsoft { namespace VisualStudio { namespace CppUnitTestFramework
+{
+    struct Assert
+    {
+        template <class E, class A>
+        static void AreEqual(const E& expected, const A& actual, const wchar_t* = nullptr)
+        {
+            if (expected == actual) return;
+            std::ostringstream text;
+            text << "AreEqual failed: expected <" << expected << "> got <" << actual << ">";
+            throw CppUnitTestShim::AssertFailed{ text.str() };
+        }
+
+        template <class E, class A>
+        static void AreNotEqual(const E& not_expected, const A& actual, const wchar_t* = nullptr)
+        {
+            if (!(not_expected == actual)) return;
+            std::ostringstream text;
+            text << "AreNotEqual failed: both <" << actual << ">";
+            throw CppUnitTestShim::AssertFailed{ text.str() };
+        }
+
+        static void IsTrue(bool condition, const wchar_t* = nullptr)
+        {
+            if (!condition) throw CppUnitTestShim::AssertFailed{ "IsTrue failed" };
+        }
+
+        static void IsFalse(bool condition, const wchar_t* = nullptr)
+        {
+            if (condition) throw CppUnitTestShim::AssertFailed{ "IsFalse failed" };
+        }
+
+        template <class T>
+        static void IsNull(const T* pointer, const wchar_t* = nullptr)
+        {
+            if (pointer) throw CppUnitTestShim::AssertFailed{ "IsNull failed" };
+        }
+
+        template <class T>
+        static void IsNotNull(const T* pointer, const wchar_t* = nullptr)
+        {
+            if (!pointer) throw CppUnitTestShim::AssertFailed{ "IsNotNull failed" };
+        }
+
+        static void Fail(const wchar_t* = nullptr)
+        {
+            throw CppUnitTestShim::AssertFailed{ "Fail" };
+        }
+    };
+}}}
+
+#define TEST_CLASS(className) \
+    struct className; \
+    struct className##_ShimInfo { \
+        typedef className Self; \
+        static const char* testClassName() { return #className; } \
+    }; \
+    struct className : CppUnitTestShim::TestClassBase, className##_ShimInfo
+
+// (the registration's constructor body sees the whole class, so it can name
+// the method declared after it)
+#define TEST_METHOD(methodName) \
+    struct methodName##_Registration { \
+        methodName##_Registration() { \
+            CppUnitTestShim::testCases().push_back({ testClassName(), #methodName, \
+                [] { CppUnitTestShim::runTest(&Self::methodName); } }); \
+        } \
+    }; \
+    inline static methodName##_Registration methodName##_registration{}; \
+    void methodName()
+
+#define TEST_METHOD_INITIALIZE(methodName) \
+    void initializeMethod() override { methodName(); } \
+    void methodName()
+
+#define TEST_METHOD_CLEANUP(methodName) \
+    void cleanupMethod() override { methodName(); } \
+    void methodName()
@@ -0,0 +1,34 @@
+// Runs the tests registered by CppUnitTest.h (the Linux stand-in).
+//
+// usage: calendar_tests [TestClass]   (no argument runs every class)
+
+#include <cstdio>
+#include <cstring>
+
+#include "CppUnitTest.h"
+
+int main(int argc, char** argv)
+{
+    const char* only_class = argc > 1 ? argv[1] : nullptr;
+    int run = 0, failed = 0;
+
+    for (const CppUnitTestShim::TestCase& test : CppUnitTestShim::testCases()) {
+        if (only_class && strcmp(only_class, test.class_name) != 0) continue;
+        run++;
+        try {
+            test.run();
+            printf("PASS %s::%s\n", test.class_name, test.method_name);
+        }
+        catch (const CppUnitTestShim::AssertFailed& failure) {
+            failed++;
+            printf("FAIL %s::%s: %s\n", test.class_name, test.method_name, failure.message.c_str());
+        }
+    }
+
+    printf("%d tests, %d failed\n", run, failed);
+    if (run == 0) {
+        printf("no tests%s%s\n", only_class ? " in " : "", only_class ? only_class : "");
+        return 1;
+    }
+    return failed != 0;
+}
@@ -0,0 +1,216 @@
+// Multi-threaded stress + throughput test for the calendar context (CalendarContext.h).
+//
+// Readers run month range queries on random years while writers add/update/delete
+// tasks in the years they own. Every policy that can be shared between threads is
+// run with the same mix, then the calendar is checked: the task count has to match
+// what the writers did, and every task a reader saw has to be in the range it asked for.
+//
+// usage: ContextStress [threads] [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../My Calendar Project Repo/CalendarContext.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2000
+#define YEAR_COUNT 20
+
+struct stress_run {
+    struct calendar* calendar;
+    volatile long stop;
+    int writers;
+};
+
+struct worker {
+    struct stress_run* run;
+    int index;                  // writers: which slice of the years it owns
+    unsigned int seed;
+
+    long long ops;
+    long long net_tasks;        // writers: adds - deletes
+    long long bad_results;      // readers: tasks outside the range they asked for
+};
+
+// xorshift, one per thread
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// checks what a reader gets back
+struct range_check {
+    int year;
+    int month;
+    long long bad;
+};
+
+static int checkMatch(const struct task_match* match, void* user_data) {
+    struct range_check* check = (struct range_check*)user_data;
+    if (match->year != check->year || match->month != check->month
+        || !match->task->task_description || match->task->task_description[0] == '\0') {
+        check->bad++;
+    }
+    return 1;
+}
+
+static void readerLoop(void* arg) {
+    struct worker* worker = (struct worker*)arg;
+    struct calendar* calendar = worker->run->calendar;
+
+    while (!atomicLoadLong(&worker->run->stop)) {
+        struct range_check check;
+        check.year = FIRST_YEAR + (int)(nextRandom(&worker->seed) % YEAR_COUNT);
+        check.month = 1 + (int)(nextRandom(&worker->seed) % 12);
+        check.bad = 0;
+
+        calendarForEachInRange(calendar, check.year, check.month, 1, check.year, check.month, 31, checkMatch, &check);
+        worker->bad_results += check.bad;
+        worker->ops++;
+    }
+}
+
+static void writerLoop(void* arg) {
+    struct worker* worker = (struct worker*)arg;
+    struct calendar* calendar = worker->run->calendar;
+    int writers = worker->run->writers;
+
+    while (!atomicLoadLong(&worker->run->stop)) {
+
+        // only years this writer owns, so it knows the task ids on them
+        int slice = (int)(nextRandom(&worker->seed) % ((YEAR_COUNT + writers - 1 - worker->index) / writers));
+        int year = FIRST_YEAR + worker->index + slice * writers;
+        int month = 1 + (int)(nextRandom(&worker->seed) % 12);
+        int day = 1 + (int)(nextRandom(&worker->seed) % 28);
+
+        if (calendarAddTask(calendar, year, month, day, "stress task") == CALENDAR_OK) worker->net_tasks++;
+
+        int last_id = calendarCountTasks(calendar, year, month, day);
+        calendarUpdateTask(calendar, year, month, day, last_id, "stress task (edited)");
+
+        // delete about as often as we add so the calendar doesn't just keep growing
+        if (nextRandom(&worker->seed) % 2 == 0
+            && calendarDeleteTask(calendar, year, month, day, last_id) == CALENDAR_OK) {
+            worker->net_tasks--;
+        }
+        worker->ops += 3;
+    }
+}
+
+static int countAll(const struct task_match* match, void* user_data) {
+    (void)match;
+    (*(long long*)user_data)++;
+    return 1;
+}
+
+static const char* policyName(enum calendar_lock_policy policy) {
+    switch (policy) {
+    case CALENDAR_LOCK_GLOBAL: return "global";
+    case CALENDAR_LOCK_PER_YEAR: return "per-year";
+    case CALENDAR_LOCK_EPOCH: return "epoch";
+    default: return "none";
+    }
+}
+
+// returns 1 if the calendar was consistent afterwards
+static int runPolicy(enum calendar_lock_policy policy, int threads, double seconds) {
+
+    struct calendar_options options;
+    initCalendarOptions(&options);
+    options.silent = 1;
+    options.locking = policy;
+
+    struct stress_run run;
+    run.calendar = createCalendar(&options);
+    run.stop = 0;
+    run.writers = threads / 2 > 0 ? threads / 2 : 1;
+    if (run.writers > YEAR_COUNT) run.writers = YEAR_COUNT;
+    if (!run.calendar) return 0;
+
+    // one task on every day to start with
+    long long preloaded = 0;
+    for (int y = FIRST_YEAR; y < FIRST_YEAR + YEAR_COUNT; y++) {
+        for (int m = 1; m <= 12; m++) {
+            for (int d = 1; d <= 28; d++) {
+                if (calendarAddTask(run.calendar, y, m, d, "preloaded task") == CALENDAR_OK) preloaded++;
+            }
+        }
+    }
+
+    int readers = threads - run.writers > 0 ? threads - run.writers : 1;
+    int total = run.writers + readers;
+    struct worker* workers = (struct worker*)calloc(total, sizeof(struct worker));
+    platform_thread* handles = (platform_thread*)calloc(total, sizeof(platform_thread));
+    if (!workers || !handles) {
+        free(workers);
+        free(handles);
+        destroyCalendar(run.calendar);
+        return 0;
+    }
+
+    int started = 0;
+    for (int i = 0; i < total; i++) {
+        workers[i].run = &run;
+        workers[i].index = i < run.writers ? i : i - run.writers;
+        workers[i].seed = 2463534242u + 7919u * (unsigned int)i;
+        if (threadStart(&handles[i], i < run.writers ? writerLoop : readerLoop, &workers[i])) started++;
+        else break;
+    }
+
+    long long start = platformNowNanos();
+    while ((platformNowNanos() - start) / 1e9 < seconds) threadSleepMillis(10);
+    atomicStoreLong(&run.stop, 1);
+
+    for (int i = 0; i < started; i++) threadJoin(handles[i]);
+    double elapsed = (platformNowNanos() - start) / 1e9;
+
+    long long write_ops = 0, read_ops = 0, net = 0, bad = 0;
+    for (int i = 0; i < total; i++) {
+        if (i < run.writers) {
+            write_ops += workers[i].ops;
+            net += workers[i].net_tasks;
+        }
+        else {
+            read_ops += workers[i].ops;
+            bad += workers[i].bad_results;
+        }
+    }
+
+    long long counted = 0;
+    calendarForEachInRange(run.calendar, FIRST_YEAR, 1, 1, FIRST_YEAR + YEAR_COUNT, 12, 31, countAll, &counted);
+    int consistent = (started == total) && bad == 0 && counted == preloaded + net;
+
+    printf("%-9s %3d writers %3d readers  %12.0f writes/s %12.0f reads/s   %s\n",
+        policyName(policy), run.writers, readers,
+        write_ops / elapsed, read_ops / elapsed,
+        consistent ? "ok" : "INCONSISTENT");
+    if (!consistent) {
+        printf("          expected %lld tasks, found %lld, %lld bad reads\n", preloaded + net, counted, bad);
+    }
+
+    free(workers);
+    free(handles);
+    destroyCalendar(run.calendar);
+    return consistent;
+}
+
+int main(int argc, char** argv) {
+
+    int threads = argc > 1 ? atoi(argv[1]) : platformCpuCount();
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    if (threads < 2) threads = 2;
+    if (seconds <= 0) seconds = 2.0;
+
+    printf("context stress: %d threads, %.1f s per policy\n", threads, seconds);
+
+    int ok = runPolicy(CALENDAR_LOCK_GLOBAL, threads, seconds);
+    ok &= runPolicy(CALENDAR_LOCK_PER_YEAR, threads, seconds);
+    ok &= runPolicy(CALENDAR_LOCK_EPOCH, threads, seconds);
+
+    return ok ? 0 : 1;
+}
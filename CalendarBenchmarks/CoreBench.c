@@ -0,0 +1,239 @@
+// The core calendar API on its own: addTask, getDayNode, updateTask,
+// deleteTask, searchTasks, saveTasks, loadTasks and freeCalendar, at a few
+// calendar sizes (1K, 1M and 10M tasks unless told otherwise).
+//
+// The years scale with the size (TASKS_PER_DAY tasks on every day), so the day
+// lists stay short and what grows is the year list. addTask fills the years
+// from the last one back, so each call finds its year at the head of the list;
+// the lookups / updates / deletes pick random dates, so their times include the
+// walk down the year list. The functions that print (addTask, searchTasks, ...)
+// print to the null device while they're timed.
+//
+// Writes the results as JSON, to stdout or to --out file.
+//
+// usage: CoreBench [--sizes 1000,1000000,10000000] [--out results.json]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#define dupFile _dup
+#define openFileDescriptor _fdopen
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#define dupFile dup
+#define openFileDescriptor fdopen
+#endif
+
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2000
+#define TASKS_PER_DAY 16
+#define DAYS_PER_YEAR (12 * 28)         // only days 1-28, so every month is the same
+#define RANDOM_OPS 200000               // lookups / updates / deletes per size (at most the size)
+#define SEARCHES 4
+#define TASKS_FILE "core_bench_tasks.txt"
+#define MAX_SIZES 8
+
+static const char* g_words[] = {
+    "meeting", "review", "dentist", "budget", "release", "lunch", "gym", "call",
+    "invoice", "design", "standup", "trip", "school", "doctor", "report", "party"
+};
+
+// xorshift
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+struct op_result {
+    const char* name;
+    long calls;
+    long long nanos;
+};
+
+struct size_result {
+    long tasks;
+    int years;
+    int ops;
+    struct op_result results[10];
+};
+
+static void record(struct size_result* size, const char* name, long calls, long long nanos) {
+    struct op_result* op = &size->results[size->ops++];
+    op->name = name;
+    op->calls = calls;
+    op->nanos = nanos;
+}
+
+struct random_date {
+    int year;
+    int month;
+    int day;
+};
+
+static struct random_date randomDate(unsigned int* seed, int years) {
+    struct random_date date;
+    date.year = FIRST_YEAR + (int)(nextRandom(seed) % (unsigned int)years);
+    date.month = 1 + (int)(nextRandom(seed) % 12);
+    date.day = 1 + (int)(nextRandom(seed) % 28);
+    return date;
+}
+
+static void runSize(long tasks, struct size_result* size) {
+
+    int years = (int)((tasks + (long)TASKS_PER_DAY * DAYS_PER_YEAR - 1) / ((long)TASKS_PER_DAY * DAYS_PER_YEAR));
+    long random_ops = tasks < RANDOM_OPS ? tasks : RANDOM_OPS;
+    char desc[64];
+
+    memset(size, 0, sizeof(*size));
+    size->tasks = tasks;
+    size->years = years;
+
+    // addTask: last year first, TASKS_PER_DAY tasks on each day
+    struct years* calendar = NULL;
+    long long start = platformNowNanos();
+    for (long i = 0; i < tasks; i++) {
+        long slot = i / TASKS_PER_DAY;
+        int year = FIRST_YEAR + years - 1 - (int)(slot / DAYS_PER_YEAR);
+        int month = 1 + (int)(slot % DAYS_PER_YEAR) / 28;
+        int day = 1 + (int)(slot % DAYS_PER_YEAR) % 28;
+        snprintf(desc, sizeof(desc), "%s %s #%ld", g_words[i % 16], g_words[(i / 16 + i) % 16], i);
+        addTask(&calendar, year, month, day, desc);
+    }
+    record(size, "addTask", tasks, platformNowNanos() - start);
+
+    unsigned int seed = 2024;
+    long found = 0;
+    start = platformNowNanos();
+    for (long i = 0; i < random_ops; i++) {
+        struct random_date date = randomDate(&seed, years);
+        if (getDayNode(calendar, date.year, date.month, date.day)) found++;
+    }
+    record(size, "getDayNode", random_ops, platformNowNanos() - start);
+
+    start = platformNowNanos();
+    for (long i = 0; i < random_ops; i++) {
+        struct random_date date = randomDate(&seed, years);
+        updateTask(calendar, date.year, date.month, date.day, 1 + (int)(nextRandom(&seed) % TASKS_PER_DAY), "updated");
+    }
+    record(size, "updateTask", random_ops, platformNowNanos() - start);
+
+    // one common word (1 in 16 tasks) and one that matches a single task
+    start = platformNowNanos();
+    for (int i = 0; i < SEARCHES; i++) {
+        if (i % 2 == 0) searchTasks(calendar, g_words[i]);
+        else {
+            snprintf(desc, sizeof(desc), "#%ld", tasks / 2 + i);
+            searchTasks(calendar, desc);
+        }
+    }
+    record(size, "searchTasks", SEARCHES, platformNowNanos() - start);
+
+    start = platformNowNanos();
+    saveTasks(TASKS_FILE, calendar);
+    record(size, "saveTasks", 1, platformNowNanos() - start);
+
+    start = platformNowNanos();
+    freeCalendar(calendar);
+    record(size, "freeCalendar", 1, platformNowNanos() - start);
+
+    start = platformNowNanos();
+    calendar = loadTasks(TASKS_FILE);
+    record(size, "loadTasks", 1, platformNowNanos() - start);
+
+    // always the first task of the day, so the rest get renumbered
+    start = platformNowNanos();
+    for (long i = 0; i < random_ops; i++) {
+        struct random_date date = randomDate(&seed, years);
+        deleteTask(calendar, date.year, date.month, date.day, 1);
+    }
+    record(size, "deleteTask", random_ops, platformNowNanos() - start);
+
+    freeCalendar(calendar);
+    remove(TASKS_FILE);
+
+    if (found != random_ops) fprintf(stderr, "CoreBench: only %ld of %ld days found at %ld tasks\n", found, random_ops, tasks);
+}
+
+static void writeJson(FILE* out, const struct size_result* sizes, int count) {
+
+    fprintf(out, "{\n  \"benchmark\": \"CoreBench\",\n  \"tasks_per_day\": %d,\n  \"sizes\": [\n", TASKS_PER_DAY);
+    for (int s = 0; s < count; s++) {
+        const struct size_result* size = &sizes[s];
+        fprintf(out, "    {\n      \"tasks\": %ld,\n      \"years\": %d,\n      \"operations\": [\n", size->tasks, size->years);
+        for (int i = 0; i < size->ops; i++) {
+            const struct op_result* op = &size->results[i];
+            fprintf(out, "        { \"name\": \"%s\", \"calls\": %ld, \"total_ms\": %.3f, \"ns_per_call\": %.1f }%s\n",
+                op->name, op->calls, op->nanos / 1e6, op->calls ? (double)op->nanos / op->calls : 0.0,
+                i + 1 < size->ops ? "," : "");
+        }
+        fprintf(out, "      ]\n    }%s\n", s + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+
+    long sizes[MAX_SIZES] = { 1000, 1000000, 10000000 };
+    int size_count = 3;
+    const char* out_file = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            size_count = 0;
+            for (char* next = argv[++i]; *next != '\0' && size_count < MAX_SIZES;) {
+                long value = strtol(next, &next, 10);
+                if (value > 0) sizes[size_count++] = value;
+                if (*next == ',') next++;
+                else if (*next != '\0') break;
+            }
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_file = argv[++i];
+        }
+        else {
+            fprintf(stderr, "usage: CoreBench [--sizes 1000,1000000,10000000] [--out results.json]\n");
+            return 1;
+        }
+    }
+    if (size_count == 0) {
+        fprintf(stderr, "CoreBench: no sizes\n");
+        return 1;
+    }
+
+    // the report goes where stdout was; stdout itself goes to the null device
+    FILE* report;
+    if (out_file) fopen_s(&report, out_file, "w");
+    else report = openFileDescriptor(dupFile(_fileno(stdout)), "w");
+    if (!report) {
+        fprintf(stderr, "CoreBench: can't write the results\n");
+        return 1;
+    }
+    FILE* silenced;
+#ifdef _MSC_VER
+    freopen_s(&silenced, NULL_DEVICE, "w", stdout);
+#else
+    silenced = freopen(NULL_DEVICE, "w", stdout);
+#endif
+    if (!silenced) fprintf(stderr, "CoreBench: couldn't silence stdout\n");
+
+    struct size_result results[MAX_SIZES];
+    for (int s = 0; s < size_count; s++) {
+        fprintf(stderr, "CoreBench: %ld tasks...\n", sizes[s]);
+        runSize(sizes[s], &results[s]);
+    }
+
+    writeJson(report, results, size_count);
+    fclose(report);
+    return 0;
+}
@@ -0,0 +1,142 @@
+// Event ring (EventRing.h): what publishing costs the writer, and how long a
+// subscriber following the ring takes to see each event.
+//
+// First times single-task adds with no ring and with a ring set, so the cost per mutation
+// is visible. Then a producer publishes events in small bursts while subscribers
+// wait on the ring; each subscriber records, per event, the time between the
+// publish and its waitEvents returning it, and the percentiles are printed for
+// both overflow modes.
+//
+// usage: EventFollow [events] [subscribers]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/EventRing.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define MAX_SUBSCRIBERS 16
+#define BURST 8
+
+struct follower {
+    struct event_subscriber* subscriber;
+    const long long* published_at;      // by sequence
+    long long* latencies;
+    long count;
+    long expected;
+    unsigned long long lost;
+};
+
+static void followEvents(void* arg) {
+    struct follower* f = (struct follower*)arg;
+    struct task_event events[64];
+
+    while (f->count + (long)f->lost < f->expected) {
+        unsigned long long lost = 0;
+        int n = waitEvents(f->subscriber, events, 64, &lost, 100);
+        long long now = platformNowNanos();
+        f->lost += lost;
+        for (int i = 0; i < n; i++) {
+            f->latencies[f->count++] = now - f->published_at[events[i].sequence];
+        }
+    }
+}
+
+static int compareLongLong(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void runFollow(const char* label, enum event_ring_overflow overflow, long events, int subscribers) {
+
+    struct event_ring* ring = createEventRing(4096, overflow, 50);
+    long long* published_at = (long long*)calloc((size_t)events + 1, sizeof(long long));
+    struct follower followers[MAX_SUBSCRIBERS];
+    platform_thread threads[MAX_SUBSCRIBERS];
+
+    for (int i = 0; i < subscribers; i++) {
+        followers[i].subscriber = subscribeEvents(ring, 0);
+        followers[i].published_at = published_at;
+        followers[i].latencies = (long long*)malloc((size_t)events * sizeof(long long));
+        followers[i].count = 0;
+        followers[i].expected = events;
+        followers[i].lost = 0;
+        threadStart(&threads[i], followEvents, &followers[i]);
+    }
+
+    long long start = platformNowNanos();
+    for (long i = 1; i <= events; i++) {
+        published_at[i] = platformNowNanos();
+        publishEvent(ring, TASK_EVENT_ADD, 2025, 1, 1, (int)i);
+        if (i % BURST == 0) threadYield();
+    }
+    double publish_ms = (platformNowNanos() - start) / 1e6;
+
+    long long* all = (long long*)malloc((size_t)events * subscribers * sizeof(long long));
+    long total = 0;
+    unsigned long long lost = 0;
+    for (int i = 0; i < subscribers; i++) {
+        threadJoin(threads[i]);
+        memcpy(all + total, followers[i].latencies, (size_t)followers[i].count * sizeof(long long));
+        total += followers[i].count;
+        lost += followers[i].lost;
+        free(followers[i].latencies);
+        unsubscribeEvents(followers[i].subscriber);
+    }
+
+    struct event_ring_stats stats;
+    getEventRingStats(ring, &stats);
+    qsort(all, (size_t)total, sizeof(long long), compareLongLong);
+
+    printf("%-10s %10.1f %9.2f %9.2f %9.2f %9.2f %8llu %8llu\n", label,
+        events / publish_ms / 1000.0,
+        total ? all[total / 2] / 1e3 : 0.0,
+        total ? all[total * 90 / 100] / 1e3 : 0.0,
+        total ? all[total * 99 / 100] / 1e3 : 0.0,
+        total ? all[total - 1] / 1e3 : 0.0,
+        lost, stats.producer_waits);
+
+    free(all);
+    free(published_at);
+    freeEventRing(ring);
+}
+
+static double timeAdds(int tasks) {
+    struct years* calendar = NULL;
+    long long start = platformNowNanos();
+    for (int i = 0; i < tasks; i++) {
+        // one at a time, like separate edits (addTask itself prints)
+        struct task_entry entry = { 2000 + i % 50, 1 + i % 12, 1 + i % 28, "event bench" };
+        addTasks(&calendar, &entry, 1, NULL);
+    }
+    double ms = (platformNowNanos() - start) / 1e6;
+    freeCalendar(calendar);
+    return ms;
+}
+
+int main(int argc, char** argv) {
+
+    long events = argc > 1 ? atol(argv[1]) : 200000;
+    int subscribers = argc > 2 ? atoi(argv[2]) : 2;
+    if (events < 1) events = 1;
+    if (subscribers < 1) subscribers = 1;
+    if (subscribers > MAX_SUBSCRIBERS) subscribers = MAX_SUBSCRIBERS;
+
+    double plain = timeAdds(100000);
+    struct event_ring* ring = createEventRing(4096, EVENT_RING_OVERWRITE, 0);
+    setTaskEventRing(ring);
+    double with_ring = timeAdds(100000);
+    setTaskEventRing(NULL);
+    freeEventRing(ring);
+    printf("100000 adds: %.1f ms without a ring, %.1f ms publishing (%.0f ns per event)\n\n",
+        plain, with_ring, (with_ring - plain) * 1e6 / 100000);
+
+    printf("%ld events, %d subscribers, bursts of %d\n", events, subscribers, BURST);
+    printf("%-10s %10s %9s %9s %9s %9s %8s %8s\n", "", "M ev/s", "p50 us", "p90 us", "p99 us", "max us",
+        "lost", "waits");
+    runFollow("overwrite", EVENT_RING_OVERWRITE, events, subscribers);
+    runFollow("wait", EVENT_RING_WAIT, events, subscribers);
+    return 0;
+}
@@ -0,0 +1,214 @@
+// Tasks file load / save through each I/O backend (AsyncFile.h), against the
+// plain stdio loadTasks / saveTasks.
+//
+// Builds a calendar of random tasks, then for every backend saves it and loads it
+// back a few times, printing the best wall time and the CPU time of that run
+// (user + kernel, so time the kernel spends on our behalf counts). Every file
+// written is compared with the one saveTasks writes. A second table times the
+// file reads / writes alone, without the parsing. With --cold the file is
+// dropped from the page cache before each load (Linux), so loads hit the disk.
+//
+// usage: FileIOBench [tasks] [runs] [--cold]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../My Calendar Project Repo/AsyncFile.h"
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2000
+#define YEAR_COUNT 25
+#define REFERENCE_FILE "file_io_reference.txt"
+#define BENCH_FILE "file_io_bench.txt"
+
+static const char* g_words[] = {
+    "meeting", "review", "dentist", "budget", "release", "lunch", "gym", "call",
+    "invoice", "design", "standup", "trip", "school", "doctor", "report", "party"
+};
+
+// xorshift
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// 1 if both files have the same bytes
+static int sameFile(const char* a, const char* b) {
+    FILE* fa;
+    FILE* fb;
+    fopen_s(&fa, a, "rb");
+    fopen_s(&fb, b, "rb");
+    int same = fa && fb;
+
+    char ba[4096], bb[4096];
+    while (same) {
+        size_t na = fread(ba, 1, sizeof(ba), fa);
+        size_t nb = fread(bb, 1, sizeof(bb), fb);
+        if (na != nb || memcmp(ba, bb, na) != 0) same = 0;
+        if (na == 0) break;
+    }
+
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+// pushes the file out of the page cache (Linux; a no-op elsewhere)
+static void dropCache(const char* filename) {
+#ifdef __linux__
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#else
+    (void)filename;
+#endif
+}
+
+struct timing {
+    double wall_ms;
+    double cpu_ms;
+};
+
+static void keepBest(struct timing* best, long long wall_start, long long cpu_start) {
+    double wall = (platformNowNanos() - wall_start) / 1e6;
+    double cpu = (platformCpuNanos() - cpu_start) / 1e6;
+    if (best->wall_ms < 0 || wall < best->wall_ms) {
+        best->wall_ms = wall;
+        best->cpu_ms = cpu;
+    }
+}
+
+static long countTasks(struct years* calendar_head) {
+    long count = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) count += y->task_count;
+    return count;
+}
+
+// backend < 0: the stdio loadTasks / saveTasks
+static void runBackend(const char* label, int backend, struct years* calendar, long tasks, int runs, int cold) {
+
+    struct timing save = { -1, 0 }, load = { -1, 0 };
+    int ok = 1;
+
+    for (int r = 0; r < runs; r++) {
+        long long wall = platformNowNanos(), cpu = platformCpuNanos();
+        if (backend < 0) saveTasks(BENCH_FILE, calendar);
+        else saveTasksAsync(BENCH_FILE, calendar, (enum file_io_backend)backend, NULL);
+        keepBest(&save, wall, cpu);
+        if (!sameFile(REFERENCE_FILE, BENCH_FILE)) ok = 0;
+
+        if (cold) dropCache(BENCH_FILE);
+
+        wall = platformNowNanos();
+        cpu = platformCpuNanos();
+        struct years* loaded = backend < 0 ? loadTasks(BENCH_FILE)
+            : loadTasksAsync(BENCH_FILE, (enum file_io_backend)backend, NULL);
+        keepBest(&load, wall, cpu);
+        if (countTasks(loaded) != tasks) ok = 0;
+        freeCalendar(loaded);
+    }
+
+    printf("%-14s %10.1f %10.1f %10.1f %10.1f   %s\n", label, save.wall_ms, save.cpu_ms, load.wall_ms, load.cpu_ms,
+        ok ? "ok" : "MISMATCH");
+}
+
+// just the I/O: the reference file read whole and written back in 64 KB pieces
+static void runRaw(const char* label, enum file_io_backend backend, int runs, int cold) {
+
+    struct timing write = { -1, 0 }, read = { -1, 0 };
+    size_t size = 0;
+    char* data = readFileWith(REFERENCE_FILE, &size, FILE_IO_STDIO);
+    int ok = data != NULL;
+
+    for (int r = 0; r < runs && ok; r++) {
+        long long wall = platformNowNanos(), cpu = platformCpuNanos();
+        struct async_writer* writer = openAsyncWriter(BENCH_FILE, backend);
+        for (size_t at = 0; writer && at < size; at += 65536) {
+            asyncWrite(writer, data + at, size - at < 65536 ? size - at : 65536);
+        }
+        if (!writer || !closeAsyncWriter(writer)) ok = 0;
+        keepBest(&write, wall, cpu);
+
+        if (cold) dropCache(BENCH_FILE);
+
+        size_t got = 0;
+        wall = platformNowNanos();
+        cpu = platformCpuNanos();
+        char* back = readFileWith(BENCH_FILE, &got, backend);
+        keepBest(&read, wall, cpu);
+        if (!back || got != size || memcmp(back, data, size) != 0) ok = 0;
+        free(back);
+    }
+
+    free(data);
+    printf("%-14s %10.1f %10.1f %10.1f %10.1f   %s\n", label, write.wall_ms, write.cpu_ms, read.wall_ms, read.cpu_ms,
+        ok ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv) {
+
+    int tasks = 1000000, runs = 3, cold = 0, positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cold") == 0) cold = 1;
+        else if (positional++ == 0) tasks = atoi(argv[i]);
+        else runs = atoi(argv[i]);
+    }
+    if (tasks < 1) tasks = 1;
+    if (runs < 1) runs = 1;
+
+    struct task_entry* entries = (struct task_entry*)malloc(tasks * sizeof(struct task_entry));
+    char* text = (char*)malloc((size_t)tasks * 48);
+    if (!entries || !text) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    unsigned int seed = 4242;
+    for (int i = 0; i < tasks; i++) {
+        char* desc = text + (size_t)i * 48;
+        snprintf(desc, 48, "%s %s #%d", g_words[nextRandom(&seed) % 16], g_words[nextRandom(&seed) % 16], i);
+        entries[i].year = FIRST_YEAR + (int)(nextRandom(&seed) % YEAR_COUNT);
+        entries[i].month = 1 + (int)(nextRandom(&seed) % 12);
+        entries[i].day = 1 + (int)(nextRandom(&seed) % 28);
+        entries[i].description = desc;
+    }
+
+    struct years* calendar = NULL;
+    addTasks(&calendar, entries, tasks, NULL);
+    free(entries);
+    free(text);
+    saveTasks(REFERENCE_FILE, calendar);
+
+    printf("file I/O: %d tasks, best of %d%s, io_uring %s\n", tasks, runs, cold ? ", cold loads" : "",
+        resolveFileIOBackend(FILE_IO_URING) == FILE_IO_URING ? "available" : "unavailable (falls back to pread)");
+    printf("%-14s %10s %10s %10s %10s\n", "", "save ms", "save cpu", "load ms", "load cpu");
+
+    runBackend("stdio (fgets)", -1, calendar, tasks, runs, cold);
+    runBackend("stdio", FILE_IO_STDIO, calendar, tasks, runs, cold);
+    runBackend("pread", FILE_IO_PREAD, calendar, tasks, runs, cold);
+    runBackend("uring", FILE_IO_URING, calendar, tasks, runs, cold);
+
+    printf("\nraw file I/O only (no parsing / formatting)\n");
+    printf("%-14s %10s %10s %10s %10s\n", "", "write ms", "write cpu", "read ms", "read cpu");
+    runRaw("stdio", FILE_IO_STDIO, runs, cold);
+    runRaw("pread", FILE_IO_PREAD, runs, cold);
+    runRaw("uring", FILE_IO_URING, runs, cold);
+
+    freeCalendar(calendar);
+    remove(REFERENCE_FILE);
+    remove(BENCH_FILE);
+    return 0;
+}
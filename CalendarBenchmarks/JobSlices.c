@@ -0,0 +1,157 @@
+// Resumable jobs (CalendarJobs.h): how long the caller is blocked at a time.
+//
+// Times the blocking search / save / year view on a big calendar, then runs the
+// same work as jobs with a few step budgets and prints the total time, the number
+// of steps and the longest single step (what an event loop would stall for).
+// The search hits and the saved file are checked against the blocking versions.
+//
+// usage: JobSlices [tasks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/CalendarJobs.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2000
+#define YEAR_COUNT 25
+#define REFERENCE_FILE "job_slices_reference.txt"
+#define JOB_FILE "job_slices_job.txt"
+
+static const char* g_words[] = {
+    "meeting", "review", "dentist", "budget", "release", "lunch", "gym", "call",
+    "invoice", "design", "standup", "trip", "school", "doctor", "report", "party"
+};
+
+// xorshift
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// order-sensitive checksum of the hits
+static int hashMatch(const struct task_match* match, void* user_data) {
+    unsigned long long* hash = (unsigned long long*)user_data;
+    *hash = *hash * 1000003ULL + (unsigned long long)(size_t)match->task;
+    return 1;
+}
+
+static long fileSize(const char* filename) {
+    FILE* fp;
+    fopen_s(&fp, filename, "rb");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+struct step_stats {
+    double total_ms;
+    double worst_ms;
+    long steps;
+};
+
+static int runSteps(struct calendar_job* job, int budget, struct step_stats* stats) {
+
+    stats->total_ms = stats->worst_ms = 0;
+    stats->steps = 0;
+    int status;
+    do {
+        long long start = platformNowNanos();
+        status = stepJob(job, budget);
+        double ms = (platformNowNanos() - start) / 1e6;
+        stats->total_ms += ms;
+        if (ms > stats->worst_ms) stats->worst_ms = ms;
+        stats->steps++;
+    } while (status == JOB_RUNNING);
+    return status;
+}
+
+static void printRow(const char* label, int budget, const struct step_stats* stats, int same) {
+    printf("%-12s %8d %10.1f %10ld %12.3f   %s\n", label, budget, stats->total_ms, stats->steps, stats->worst_ms,
+        same ? "same" : "DIFFERENT");
+}
+
+int main(int argc, char** argv) {
+
+    int tasks = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (tasks < 1) tasks = 1;
+
+    struct task_entry* entries = (struct task_entry*)malloc(tasks * sizeof(struct task_entry));
+    char* text = (char*)malloc((size_t)tasks * 48);
+    if (!entries || !text) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    unsigned int seed = 99;
+    for (int i = 0; i < tasks; i++) {
+        char* desc = text + (size_t)i * 48;
+        snprintf(desc, 48, "%s %s #%d", g_words[nextRandom(&seed) % 16], g_words[nextRandom(&seed) % 16], i);
+        entries[i].year = FIRST_YEAR + (int)(nextRandom(&seed) % YEAR_COUNT);
+        entries[i].month = 1 + (int)(nextRandom(&seed) % 12);
+        entries[i].day = 1 + (int)(nextRandom(&seed) % 28);
+        entries[i].description = desc;
+    }
+
+    struct years* calendar = NULL;
+    addTasks(&calendar, entries, tasks, NULL);
+    free(entries);
+
+    // the blocking versions
+    unsigned long long expected_hash = 0;
+    long long start = platformNowNanos();
+    searchTasksEach(calendar, "design", 0, hashMatch, &expected_hash);
+    double search_ms = (platformNowNanos() - start) / 1e6;
+
+    start = platformNowNanos();
+    saveTasks(REFERENCE_FILE, calendar);
+    double save_ms = (platformNowNanos() - start) / 1e6;
+    long expected_size = fileSize(REFERENCE_FILE);
+
+    printf("%d tasks; blocking: search %.1f ms, save %.1f ms\n\n", tasks, search_ms, save_ms);
+    printf("%-12s %8s %10s %10s %12s\n", "job", "budget", "total ms", "steps", "longest ms");
+
+    const int budgets[] = { 1000, 10000, 100000 };
+    for (int b = 0; b < 3; b++) {
+        struct step_stats stats;
+        unsigned long long hash = 0;
+        struct calendar_job* job = startSearchJob(calendar, "design", 0, hashMatch, &hash);
+        runSteps(job, budgets[b], &stats);
+        freeJob(job);
+        printRow("search", budgets[b], &stats, hash == expected_hash);
+    }
+
+    for (int b = 0; b < 3; b++) {
+        struct step_stats stats;
+        struct calendar_job* job = startSaveJob(calendar, JOB_FILE);
+        int status = runSteps(job, budgets[b], &stats);
+        freeJob(job);
+        printRow("save", budgets[b], &stats, status == JOB_DONE && fileSize(JOB_FILE) == expected_size);
+    }
+
+    FILE* sink;
+    fopen_s(&sink, "job_slices_view.txt", "w");
+    for (int b = 0; b < 3; b++) {
+        struct step_stats stats;
+        struct calendar_job* job = startYearViewJob(calendar, FIRST_YEAR + 7, sink);
+        int status = runSteps(job, budgets[b], &stats);
+        freeJob(job);
+        printRow("year view", budgets[b], &stats, status == JOB_DONE);
+    }
+    if (sink) fclose(sink);
+
+    freeCalendar(calendar);
+    free(text);
+    remove(REFERENCE_FILE);
+    remove(JOB_FILE);
+    remove("job_slices_view.txt");
+    return 0;
+}
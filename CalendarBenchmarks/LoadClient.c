@@ -0,0 +1,277 @@
+// Load generator for the socket server (calendar --socket path).
+//
+// Each client thread opens its own connection and sends a mix of reads (day
+// views and counts) and writes (adds, with a delete now and then) over two
+// years of dates, "pipeline" commands per write, then reads all the replies
+// back. Reports commands per second over all clients and the round-trip latency
+// percentiles of those batches (with a pipeline of 1 that's per command).
+//
+// usage: LoadClient socket [clients] [seconds] [pipeline] [write percent] [--shutdown]
+// (POSIX only, like the server)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2025
+#define YEAR_COUNT 2
+#define MAX_SAMPLES 1000000
+#define READ_BUFFER_SIZE 65536
+
+struct load_run {
+    const char* socket_path;
+    int pipeline;
+    int write_percent;
+    volatile long stop;
+};
+
+struct load_client {
+    struct load_run* run;
+    unsigned int seed;
+    int fd;
+
+    char buffer[READ_BUFFER_SIZE];  // reply bytes not consumed yet
+    size_t start;
+    size_t end;
+
+    long long commands;
+    long long errors;
+    long long* samples;             // nanoseconds per batch
+    int sample_count;
+    int failed;                     // connection lost / couldn't connect
+};
+
+// xorshift, one per thread
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int connectTo(const char* socket_path) {
+    struct sockaddr_un address;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path, strlen(socket_path) + 1);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int sendAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written <= 0) return 0;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+// next reply line (newline stripped), or NULL if the connection closed
+static const char* readLine(struct load_client* client) {
+    for (;;) {
+        char* newline = (char*)memchr(client->buffer + client->start, '\n', client->end - client->start);
+        if (newline) {
+            *newline = '\0';
+            const char* line = client->buffer + client->start;
+            client->start = (size_t)(newline - client->buffer) + 1;
+            return line;
+        }
+
+        // keep the partial line, make room after it
+        memmove(client->buffer, client->buffer + client->start, client->end - client->start);
+        client->end -= client->start;
+        client->start = 0;
+        if (client->end == READ_BUFFER_SIZE) return NULL;
+
+        ssize_t got = read(client->fd, client->buffer + client->end, READ_BUFFER_SIZE - client->end);
+        if (got <= 0) return NULL;
+        client->end += (size_t)got;
+    }
+}
+
+// reads one whole reply ("OK n" + n lines, or one ERR line); 0 if the connection closed
+static int readReply(struct load_client* client) {
+    const char* line = readLine(client);
+    if (!line) return 0;
+
+    if (strncmp(line, "OK ", 3) == 0) {
+        int data_lines = atoi(line + 3);
+        for (int i = 0; i < data_lines; i++) {
+            if (!readLine(client)) return 0;
+        }
+    }
+    else {
+        client->errors++;
+    }
+    return 1;
+}
+
+static void clientLoop(void* arg) {
+    struct load_client* client = (struct load_client*)arg;
+    struct load_run* run = client->run;
+
+    client->fd = connectTo(run->socket_path);
+    if (client->fd < 0) {
+        client->failed = 1;
+        return;
+    }
+
+    char* batch = (char*)malloc((size_t)run->pipeline * 96);
+    if (!batch) {
+        client->failed = 1;
+        close(client->fd);
+        return;
+    }
+
+    while (!atomicLoadLong(&run->stop) && client->sample_count < MAX_SAMPLES) {
+        size_t length = 0;
+        for (int i = 0; i < run->pipeline; i++) {
+            int year = FIRST_YEAR + (int)(nextRandom(&client->seed) % YEAR_COUNT);
+            int month = 1 + (int)(nextRandom(&client->seed) % 12);
+            int day = 1 + (int)(nextRandom(&client->seed) % 28);
+            int pick = (int)(nextRandom(&client->seed) % 100);
+
+            if (pick < run->write_percent) {
+                // mostly adds, every 4th write a delete so the days don't only grow
+                if (pick % 4 == 3) length += sprintf(batch + length, "delete %d %d %d 1\n", year, month, day);
+                else length += sprintf(batch + length, "add %d %d %d load client task %u\n", year, month, day, client->seed % 1000);
+            }
+            else if (pick % 2 == 0) {
+                length += sprintf(batch + length, "day %d %d %d\n", year, month, day);
+            }
+            else {
+                length += sprintf(batch + length, "count %d %d %d\n", year, month, day);
+            }
+        }
+
+        long long start = platformNowNanos();
+        int ok = sendAll(client->fd, batch, length);
+        for (int i = 0; i < run->pipeline && ok; i++) ok = readReply(client);
+        if (!ok) {
+            client->failed = 1;
+            break;
+        }
+
+        client->samples[client->sample_count++] = platformNowNanos() - start;
+        client->commands += run->pipeline;
+    }
+
+    free(batch);
+    close(client->fd);
+}
+
+static int compareSamples(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentileMicros(const long long* sorted, long long count, double percentile) {
+    if (count == 0) return 0.0;
+    long long at = (long long)(percentile / 100.0 * (count - 1) + 0.5);
+    return sorted[at] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: LoadClient socket [clients] [seconds] [pipeline] [write percent] [--shutdown]\n");
+        return 2;
+    }
+
+    struct load_run run;
+    run.socket_path = argv[1];
+    int client_count = argc > 2 ? atoi(argv[2]) : 4;
+    double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+    run.pipeline = argc > 4 ? atoi(argv[4]) : 1;
+    run.write_percent = argc > 5 ? atoi(argv[5]) : 20;
+    run.stop = 0;
+    int send_shutdown = argc > 6 && strcmp(argv[6], "--shutdown") == 0;
+
+    if (client_count < 1) client_count = 1;
+    if (seconds <= 0) seconds = 3.0;
+    if (run.pipeline < 1) run.pipeline = 1;
+    if (run.write_percent < 0 || run.write_percent > 100) run.write_percent = 20;
+
+    struct load_client* clients = (struct load_client*)calloc(client_count, sizeof(struct load_client));
+    platform_thread* threads = (platform_thread*)calloc(client_count, sizeof(platform_thread));
+    if (!clients || !threads) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    int started = 0, ok = 1;
+    for (int i = 0; i < client_count && ok; i++) {
+        clients[i].run = &run;
+        clients[i].seed = 88172645u + 7919u * (unsigned int)i;
+        clients[i].samples = (long long*)malloc(MAX_SAMPLES * sizeof(long long));
+        ok = clients[i].samples && threadStart(&threads[started], clientLoop, &clients[i]);
+        if (ok) started++;
+    }
+
+    long long start = platformNowNanos();
+    while (ok && (platformNowNanos() - start) / 1e9 < seconds) threadSleepMillis(10);
+    atomicStoreLong(&run.stop, 1);
+    for (int i = 0; i < started; i++) threadJoin(threads[i]);
+    double elapsed = (platformNowNanos() - start) / 1e9;
+
+    long long commands = 0, errors = 0, total_samples = 0;
+    int failed = 0;
+    for (int i = 0; i < started; i++) {
+        commands += clients[i].commands;
+        errors += clients[i].errors;
+        total_samples += clients[i].sample_count;
+        failed += clients[i].failed;
+    }
+
+    long long* all = (long long*)malloc((total_samples > 0 ? total_samples : 1) * sizeof(long long));
+    if (all) {
+        long long at = 0;
+        for (int i = 0; i < started; i++) {
+            memcpy(all + at, clients[i].samples, clients[i].sample_count * sizeof(long long));
+            at += clients[i].sample_count;
+        }
+        qsort(all, (size_t)total_samples, sizeof(long long), compareSamples);
+
+        printf("%d clients, pipeline %d, %d%% writes, %.1f s\n", started, run.pipeline, run.write_percent, elapsed);
+        printf("%lld commands  %.0f commands/s  %lld error replies  %d connections failed\n",
+            commands, commands / elapsed, errors, failed);
+        printf("round trip per batch: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f us\n",
+            percentileMicros(all, total_samples, 50), percentileMicros(all, total_samples, 90),
+            percentileMicros(all, total_samples, 99), percentileMicros(all, total_samples, 99.9),
+            total_samples ? all[total_samples - 1] / 1000.0 : 0.0);
+    }
+
+    if (send_shutdown) {
+        int fd = connectTo(run.socket_path);
+        if (fd >= 0) {
+            sendAll(fd, "shutdown\n", 9);
+            char reply[64];
+            if (read(fd, reply, sizeof(reply)) < 0) failed++;
+            close(fd);
+        }
+    }
+
+    free(all);
+    for (int i = 0; i < client_count; i++) free(clients[i].samples);
+    free(clients);
+    free(threads);
+    return ok && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// Whole-calendar ops, serial vs. on a work pool (WorkPool.h).
+//
+// Builds a calendar of random tasks, saves it once as the input file, then times
+// load, save, keyword search and the term index build serially and with pools of
+// 1, 2, 4 ... threads (up to the CPU count). Every pooled result is checked
+// against the serial one: same file bytes, same number of search hits.
+//
+// usage: ParallelScan [tasks] [max threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/Platform.h"
+#include "../My Calendar Project Repo/TermIndex.h"
+#include "../My Calendar Project Repo/WorkPool.h"
+
+#define FIRST_YEAR 2000
+#define YEAR_COUNT 25
+#define INPUT_FILE "parallel_scan_input.txt"
+#define OUTPUT_FILE "parallel_scan_output.txt"
+
+static const char* g_words[] = {
+    "meeting", "review", "dentist", "budget", "release", "lunch", "gym", "call",
+    "invoice", "design", "standup", "trip", "school", "doctor", "report", "party"
+};
+
+// xorshift
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int countHit(const struct task_match* match, void* user_data) {
+    (void)match;
+    (*(long*)user_data)++;
+    return 1;
+}
+
+// 1 if both files have the same bytes
+static int sameFile(const char* a, const char* b) {
+    FILE* fa;
+    FILE* fb;
+    fopen_s(&fa, a, "rb");
+    fopen_s(&fb, b, "rb");
+    int same = fa && fb;
+
+    char ba[4096], bb[4096];
+    while (same) {
+        size_t na = fread(ba, 1, sizeof(ba), fa);
+        size_t nb = fread(bb, 1, sizeof(bb), fb);
+        if (na != nb || memcmp(ba, bb, na) != 0) same = 0;
+        if (na == 0) break;
+    }
+
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+static double millisSince(long long start) {
+    return (platformNowNanos() - start) / 1e6;
+}
+
+// one row: every op once with this pool (NULL = serial)
+static void runOps(const char* label, struct work_pool* pool, long expected_hits) {
+
+    long long start = platformNowNanos();
+    struct years* calendar = loadTasksParallel(INPUT_FILE, pool);
+    double load_ms = millisSince(start);
+
+    start = platformNowNanos();
+    saveTasksParallel(OUTPUT_FILE, calendar, pool);
+    double save_ms = millisSince(start);
+
+    long hits = 0;
+    start = platformNowNanos();
+    searchTasksParallel(calendar, "budget", 0, countHit, &hits, pool);
+    double search_ms = millisSince(start);
+
+    start = platformNowNanos();
+    struct term_index* index = buildTermIndexParallel(calendar, pool);
+    double index_ms = millisSince(start);
+
+    int ok = sameFile(INPUT_FILE, OUTPUT_FILE) && (expected_hits < 0 || hits == expected_hits) && index != NULL;
+    printf("%-10s %10.1f %10.1f %10.1f %10.1f   %s\n", label, load_ms, save_ms, search_ms, index_ms,
+        ok ? "ok" : "MISMATCH");
+
+    freeTermIndex(index);
+    freeCalendar(calendar);
+}
+
+int main(int argc, char** argv) {
+
+    int tasks = argc > 1 ? atoi(argv[1]) : 500000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : platformCpuCount();
+    if (tasks < 1) tasks = 1;
+    if (max_threads < 1) max_threads = 1;
+
+    // the input file every row loads
+    struct task_entry* entries = (struct task_entry*)malloc(tasks * sizeof(struct task_entry));
+    char* text = (char*)malloc((size_t)tasks * 48);
+    if (!entries || !text) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < tasks; i++) {
+        char* desc = text + (size_t)i * 48;
+        snprintf(desc, 48, "%s %s #%d", g_words[nextRandom(&seed) % 16], g_words[nextRandom(&seed) % 16], i);
+        entries[i].year = FIRST_YEAR + (int)(nextRandom(&seed) % YEAR_COUNT);
+        entries[i].month = 1 + (int)(nextRandom(&seed) % 12);
+        entries[i].day = 1 + (int)(nextRandom(&seed) % 28);
+        entries[i].description = desc;
+    }
+
+    struct years* calendar = NULL;
+    addTasks(&calendar, entries, tasks, NULL);
+    saveTasks(INPUT_FILE, calendar);
+    freeCalendar(calendar);
+    free(entries);
+    free(text);
+
+    printf("parallel scan: %d tasks, %d CPUs\n", tasks, platformCpuCount());
+    printf("%-10s %10s %10s %10s %10s\n", "", "load ms", "save ms", "search ms", "index ms");
+
+    // the serial row sets the hit count the pooled rows are checked against
+    struct years* reference = loadTasks(INPUT_FILE);
+    long expected_hits = 0;
+    searchTasksEach(reference, "budget", 0, countHit, &expected_hits);
+    freeCalendar(reference);
+
+    runOps("serial", NULL, expected_hits);
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        struct work_pool* pool = createWorkPool(threads);
+        if (!pool) break;
+
+        char label[32];
+        snprintf(label, sizeof(label), "pool x%d", threads);
+        runOps(label, pool, expected_hits);
+
+        struct work_pool_stats stats;
+        getWorkPoolStats(pool, &stats);
+        printf("           %llu work items, %llu stolen\n", stats.executed, stats.stolen);
+        freeWorkPool(pool);
+    }
+
+    remove(INPUT_FILE);
+    remove(OUTPUT_FILE);
+    return 0;
+}
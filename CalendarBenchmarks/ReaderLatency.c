@@ -0,0 +1,225 @@
+// Reader latency under a concurrent write load, per locking policy.
+//
+// Readers run month views (a month range walk that touches every description)
+// and keyword searches on the same years the writers are busy adding, editing and
+// deleting tasks in, and time every read. Percentiles show how long readers stall
+// behind writers: with the lock-based policies they queue on the rwlocks, with
+// CALENDAR_LOCK_EPOCH they shouldn't wait at all.
+//
+// usage: ReaderLatency [readers] [writers] [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../My Calendar Project Repo/CalendarContext.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2025
+#define YEAR_COUNT 2
+#define TASKS_PER_DAY 8
+#define MAX_SAMPLES 2000000
+
+struct latency_run {
+    struct calendar* calendar;
+    volatile long stop;
+};
+
+struct reader {
+    struct latency_run* run;
+    unsigned int seed;
+    long long* samples;         // nanoseconds per read
+    int sample_count;
+    unsigned long checksum;     // keeps the reads from being optimized away
+};
+
+struct writer {
+    struct latency_run* run;
+    unsigned int seed;
+    long long ops;
+};
+
+// xorshift, one per thread
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static int sumDescription(const struct task_match* match, void* user_data) {
+    *(unsigned long*)user_data += (unsigned long)strlen(match->task->task_description);
+    return 1;
+}
+
+static void readerLoop(void* arg) {
+    struct reader* reader = (struct reader*)arg;
+    struct calendar* calendar = reader->run->calendar;
+
+    while (!atomicLoadLong(&reader->run->stop) && reader->sample_count < MAX_SAMPLES) {
+        int year = FIRST_YEAR + (int)(nextRandom(&reader->seed) % YEAR_COUNT);
+        int month = 1 + (int)(nextRandom(&reader->seed) % 12);
+
+        long long start = platformNowNanos();
+
+        // mostly month views, every 8th read a keyword search over everything
+        if (nextRandom(&reader->seed) % 8 == 0) {
+            calendarSearch(calendar, "edited", 0, sumDescription, &reader->checksum);
+        }
+        else {
+            calendarForEachInRange(calendar, year, month, 1, year, month, 31, sumDescription, &reader->checksum);
+        }
+
+        reader->samples[reader->sample_count++] = platformNowNanos() - start;
+    }
+}
+
+static void writerLoop(void* arg) {
+    struct writer* writer = (struct writer*)arg;
+    struct calendar* calendar = writer->run->calendar;
+
+    while (!atomicLoadLong(&writer->run->stop)) {
+        int year = FIRST_YEAR + (int)(nextRandom(&writer->seed) % YEAR_COUNT);
+        int month = 1 + (int)(nextRandom(&writer->seed) % 12);
+        int day = 1 + (int)(nextRandom(&writer->seed) % 28);
+
+        calendarAddTask(calendar, year, month, day, "written under load");
+
+        int count = calendarCountTasks(calendar, year, month, day);
+        if (count > 0) {
+            int id = 1 + (int)(nextRandom(&writer->seed) % count);
+            calendarUpdateTask(calendar, year, month, day, id, "edited under load");
+            calendarDeleteTask(calendar, year, month, day, 1 + (int)(nextRandom(&writer->seed) % count));
+        }
+        writer->ops += 3;
+    }
+}
+
+static int compareSamples(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentileMicros(const long long* sorted, int count, double percentile) {
+    if (count == 0) return 0.0;
+    int at = (int)(percentile / 100.0 * (count - 1) + 0.5);
+    return sorted[at] / 1000.0;
+}
+
+static const char* policyName(enum calendar_lock_policy policy) {
+    switch (policy) {
+    case CALENDAR_LOCK_GLOBAL: return "global";
+    case CALENDAR_LOCK_PER_YEAR: return "per-year";
+    case CALENDAR_LOCK_EPOCH: return "epoch";
+    default: return "none";
+    }
+}
+
+static int runPolicy(enum calendar_lock_policy policy, int reader_count, int writer_count, double seconds) {
+
+    struct calendar_options options;
+    initCalendarOptions(&options);
+    options.silent = 1;
+    options.locking = policy;
+
+    struct latency_run run;
+    run.calendar = createCalendar(&options);
+    run.stop = 0;
+    if (!run.calendar) return 0;
+
+    for (int y = FIRST_YEAR; y < FIRST_YEAR + YEAR_COUNT; y++) {
+        for (int m = 1; m <= 12; m++) {
+            for (int d = 1; d <= 28; d++) {
+                for (int t = 0; t < TASKS_PER_DAY; t++) {
+                    calendarAddTask(run.calendar, y, m, d, "preloaded task");
+                }
+            }
+        }
+    }
+
+    struct reader* readers = (struct reader*)calloc(reader_count, sizeof(struct reader));
+    struct writer* writers = (struct writer*)calloc(writer_count > 0 ? writer_count : 1, sizeof(struct writer));
+    platform_thread* threads = (platform_thread*)calloc(reader_count + writer_count, sizeof(platform_thread));
+    if (!readers || !writers || !threads) {
+        free(readers);
+        free(writers);
+        free(threads);
+        destroyCalendar(run.calendar);
+        return 0;
+    }
+
+    int started = 0, ok = 1;
+    for (int i = 0; i < reader_count && ok; i++) {
+        readers[i].run = &run;
+        readers[i].seed = 88172645u + 7919u * (unsigned int)i;
+        readers[i].samples = (long long*)malloc(MAX_SAMPLES * sizeof(long long));
+        ok = readers[i].samples && threadStart(&threads[started], readerLoop, &readers[i]);
+        if (ok) started++;
+    }
+    for (int i = 0; i < writer_count && ok; i++) {
+        writers[i].run = &run;
+        writers[i].seed = 2463534242u + 104729u * (unsigned int)i;
+        ok = threadStart(&threads[started], writerLoop, &writers[i]);
+        if (ok) started++;
+    }
+
+    long long start = platformNowNanos();
+    while (ok && (platformNowNanos() - start) / 1e9 < seconds) threadSleepMillis(10);
+    atomicStoreLong(&run.stop, 1);
+    for (int i = 0; i < started; i++) threadJoin(threads[i]);
+    double elapsed = (platformNowNanos() - start) / 1e9;
+
+    // all readers' samples together
+    long long total_samples = 0, write_ops = 0;
+    for (int i = 0; i < reader_count; i++) total_samples += readers[i].sample_count;
+    for (int i = 0; i < writer_count; i++) write_ops += writers[i].ops;
+
+    long long* all = (long long*)malloc((total_samples > 0 ? total_samples : 1) * sizeof(long long));
+    if (ok && all) {
+        long long at = 0;
+        for (int i = 0; i < reader_count; i++) {
+            memcpy(all + at, readers[i].samples, readers[i].sample_count * sizeof(long long));
+            at += readers[i].sample_count;
+        }
+        qsort(all, (size_t)total_samples, sizeof(long long), compareSamples);
+
+        int n = (int)total_samples;
+        printf("%-9s %10lld reads %9.0f writes/s   p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %9.1f  max %9.1f us\n",
+            policyName(policy), total_samples, write_ops / elapsed,
+            percentileMicros(all, n, 50), percentileMicros(all, n, 90), percentileMicros(all, n, 99),
+            percentileMicros(all, n, 99.9), n ? all[n - 1] / 1000.0 : 0.0);
+    }
+    else {
+        printf("%-9s could not start (out of memory or threads)\n", policyName(policy));
+        ok = 0;
+    }
+
+    free(all);
+    for (int i = 0; i < reader_count; i++) free(readers[i].samples);
+    free(readers);
+    free(writers);
+    free(threads);
+    destroyCalendar(run.calendar);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+
+    int reader_count = argc > 1 ? atoi(argv[1]) : 2;
+    int writer_count = argc > 2 ? atoi(argv[2]) : 2;
+    double seconds = argc > 3 ? atof(argv[3]) : 2.0;
+    if (reader_count < 1) reader_count = 1;
+    if (writer_count < 0) writer_count = 0;
+    if (seconds <= 0) seconds = 2.0;
+
+    printf("reader latency: %d readers, %d writers, %.1f s per policy, %d tasks/day preloaded\n",
+        reader_count, writer_count, seconds, TASKS_PER_DAY);
+
+    int ok = runPolicy(CALENDAR_LOCK_GLOBAL, reader_count, writer_count, seconds);
+    ok &= runPolicy(CALENDAR_LOCK_PER_YEAR, reader_count, writer_count, seconds);
+    ok &= runPolicy(CALENDAR_LOCK_EPOCH, reader_count, writer_count, seconds);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,510 @@
+// How the core operations scale with each dimension that drives their cost:
+//
+//   years          loaded years; getDayNode / addTask walk the year list to the last one
+//   tasks_per_day  tasks on one day; addTask walks to the tail, updateTask scans,
+//                  deleteTask scans and renumbers (getDayNode is there as a flat control)
+//   total_tasks    tasks in the calendar (16 per day); search, save and load visit them all
+//   desc_length    description length; search runs containsIgnoreCase over every one
+//
+// Every point is the time per operation: repeated until it has run for a while,
+// best of three.
+// Each curve gets a slope: the least squares fit of log(time) against
+// log(dimension), so about 0 is constant time, 1 linear and 2 quadratic.
+// That's what is compared with a baseline, since unlike the times themselves
+// it means the same on any machine: a curve fails when its slope is more than
+// the tolerance above the baseline's (an O(1) path gone O(n), an O(n) one gone
+// O(n^2)). With --time-factor the time at the largest point is checked too.
+//
+// Writes the curves as JSON, to stdout or to --out file; the check goes to stderr
+// and a failed check makes the exit code 1.
+//
+// usage: ScalingBench [--quick] [--out results.json] [--baseline file [--tolerance 0.3] [--time-factor f]]
+//                     [--write-baseline file]
+//
+// --quick uses smaller sizes and shorter runs (ctest runs it against
+// scaling_baseline.txt); baselines remember which mode made them.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#define dupFile _dup
+#define openFileDescriptor _fdopen
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#define dupFile dup
+#define openFileDescriptor fdopen
+#endif
+
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/Platform.h"
+
+#define FIRST_YEAR 2000
+#define DAYS_PER_YEAR (12 * 28)         // only days 1-28, so every month is the same
+#define TASKS_PER_DAY 16                // for the total_tasks calendars
+#define MAX_POINTS 8
+#define MAX_CURVES 16
+#define TIMING_ROUNDS 3
+#define TASKS_FILE "scaling_bench_tasks.txt"
+#define MISSING_WORD "zqxj"             // in no description
+
+static const char* g_words[] = {
+    "meeting", "review", "dentist", "budget", "release", "lunch", "gym", "call",
+    "invoice", "design", "standup", "trip", "school", "doctor", "report", "party"
+};
+
+struct sweep {
+    const char* dimension;
+    long full[MAX_POINTS];
+    long quick[MAX_POINTS];
+};
+
+static const struct sweep g_sweeps[] = {
+    { "years",          { 16, 64, 256, 1024, 4096 },             { 8, 32, 128, 512 } },
+    { "tasks_per_day",  { 16, 64, 256, 1024, 4096 },             { 16, 64, 256, 1024 } },
+    { "total_tasks",    { 4000, 16000, 64000, 256000, 1024000 }, { 2000, 8000, 32000 } },
+    { "desc_length",    { 16, 32, 64, 128, 255 },                { 16, 64, 255 } },
+};
+#define SWEEPS ((int)(sizeof(g_sweeps) / sizeof(g_sweeps[0])))
+
+struct curve {
+    const char* dimension;
+    const char* op;
+    int points;
+    long x[MAX_POINTS];
+    double nanos[MAX_POINTS];   // per operation
+    double slope;
+};
+
+struct bench {
+    int quick;
+    long long min_nanos;        // how long each point is repeated for
+    struct curve curves[MAX_CURVES];
+    int curve_count;
+};
+
+// =====================
+// MEASURING
+// =====================
+
+// one timed operation (state is whatever the sweep set up)
+typedef void (*OpFn)(void* state);
+
+// runs op in doubling batches until the batches took min_nanos, TIMING_ROUNDS
+// times over; the time per call of the quickest round (the least disturbed one)
+static double timeOp(const struct bench* bench, OpFn op, void* state) {
+
+    double best = 0;
+    for (int round = 0; round < TIMING_ROUNDS; round++) {
+        long calls = 0;
+        long long spent = 0;
+        for (long batch = 1; spent < bench->min_nanos; batch *= 2) {
+            long long start = platformNowNanos();
+            for (long i = 0; i < batch; i++) op(state);
+            spent += platformNowNanos() - start;
+            calls += batch;
+        }
+        double nanos = (double)spent / calls;
+        if (round == 0 || nanos < best) best = nanos;
+    }
+    return best;
+}
+
+static struct curve* findCurve(struct bench* bench, const char* dimension, const char* op) {
+
+    for (int i = 0; i < bench->curve_count; i++) {
+        if (strcmp(bench->curves[i].dimension, dimension) == 0 && strcmp(bench->curves[i].op, op) == 0) return &bench->curves[i];
+    }
+    if (bench->curve_count == MAX_CURVES) return NULL;
+
+    struct curve* curve = &bench->curves[bench->curve_count++];
+    memset(curve, 0, sizeof(*curve));
+    curve->dimension = dimension;
+    curve->op = op;
+    return curve;
+}
+
+static void addPoint(struct bench* bench, const char* dimension, const char* op, long x, double nanos) {
+    struct curve* curve = findCurve(bench, dimension, op);
+    if (!curve || curve->points == MAX_POINTS) return;
+    curve->x[curve->points] = x;
+    curve->nanos[curve->points] = nanos;
+    curve->points++;
+}
+
+static void fitSlope(struct curve* curve) {
+
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = curve->points;
+    for (int i = 0; i < n; i++) {
+        double x = log((double)curve->x[i]);
+        double y = log(curve->nanos[i] > 0 ? curve->nanos[i] : 1e-3);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double denominator = n * sxx - sx * sx;
+    curve->slope = n > 1 && denominator != 0 ? (n * sxy - sx * sy) / denominator : 0;
+}
+
+// =====================
+// SWEEPS
+// =====================
+
+struct op_state {
+    struct years* calendar;
+    int year;
+    int month;
+    int day;
+    int task_id;
+    int counter;
+    const char* keyword;
+};
+
+static void opGetDayNode(void* arg) {
+    struct op_state* state = (struct op_state*)arg;
+    if (!getDayNode(state->calendar, state->year, state->month, state->day)) state->counter++;
+}
+
+// adds to the end of a day and takes it off again, so the day doesn't grow
+static void opAddDeleteLast(void* arg) {
+    struct op_state* state = (struct op_state*)arg;
+    addTask(&state->calendar, state->year, state->month, state->day, "scaling");
+    deleteTask(state->calendar, state->year, state->month, state->day, state->task_id);
+}
+
+// deletes the first task (every other one is renumbered) and adds one at the end
+static void opDeleteFirstAdd(void* arg) {
+    struct op_state* state = (struct op_state*)arg;
+    deleteTask(state->calendar, state->year, state->month, state->day, 1);
+    addTask(&state->calendar, state->year, state->month, state->day, "scaling");
+}
+
+static void opUpdateMiddle(void* arg) {
+    struct op_state* state = (struct op_state*)arg;
+    updateTask(state->calendar, state->year, state->month, state->day, state->task_id, (state->counter++ & 1) ? "odd" : "even");
+}
+
+static int countMatch(const struct task_match* match, void* user_data) {
+    (*(int*)user_data)++;
+    return 1;
+}
+
+static void opSearch(void* arg) {
+    struct op_state* state = (struct op_state*)arg;
+    searchTasksEach(state->calendar, state->keyword, 0, countMatch, &state->counter);
+}
+
+static void opSave(void* arg) {
+    struct op_state* state = (struct op_state*)arg;
+    saveTasks(TASKS_FILE, state->calendar);
+}
+
+static void opLoad(void* arg) {
+    (void)arg;
+    freeCalendar(loadTasks(TASKS_FILE));
+}
+
+// years..., one task on the first day of each
+static void sweepYears(struct bench* bench, long years) {
+
+    struct op_state state;
+    memset(&state, 0, sizeof(state));
+    for (long y = years - 1; y >= 0; y--) addTask(&state.calendar, FIRST_YEAR + (int)y, 1, 1, "first");
+
+    // the last year, at the end of the list
+    state.year = FIRST_YEAR + (int)years - 1;
+    state.month = 6;
+    state.day = 15;
+    state.task_id = 1;
+
+    addPoint(bench, "years", "getDayNode", years, timeOp(bench, opGetDayNode, &state));
+    addPoint(bench, "years", "addTask+deleteTask", years, timeOp(bench, opAddDeleteLast, &state));
+    freeCalendar(state.calendar);
+}
+
+// one day with tasks tasks on it
+static void sweepTasksPerDay(struct bench* bench, long tasks) {
+
+    struct op_state state;
+    memset(&state, 0, sizeof(state));
+    state.year = FIRST_YEAR;
+    state.month = 3;
+    state.day = 3;
+
+    char desc[64];
+    for (long i = 0; i < tasks; i++) {
+        snprintf(desc, sizeof(desc), "%s #%ld", g_words[i % 16], i);
+        addTask(&state.calendar, state.year, state.month, state.day, desc);
+    }
+
+    state.task_id = (int)tasks / 2;
+    addPoint(bench, "tasks_per_day", "getDayNode", tasks, timeOp(bench, opGetDayNode, &state));
+    addPoint(bench, "tasks_per_day", "updateTask", tasks, timeOp(bench, opUpdateMiddle, &state));
+    addPoint(bench, "tasks_per_day", "deleteTask(first)+addTask", tasks, timeOp(bench, opDeleteFirstAdd, &state));
+    state.task_id = (int)tasks + 1;
+    addPoint(bench, "tasks_per_day", "addTask+deleteTask", tasks, timeOp(bench, opAddDeleteLast, &state));
+    freeCalendar(state.calendar);
+}
+
+// a calendar of tasks tasks (TASKS_PER_DAY a day) with descriptions of desc_length
+static struct years* buildCalendar(long tasks, int desc_length) {
+
+    int years = (int)((tasks + (long)TASKS_PER_DAY * DAYS_PER_YEAR - 1) / ((long)TASKS_PER_DAY * DAYS_PER_YEAR));
+    struct task_entry* entries = (struct task_entry*)malloc((size_t)tasks * sizeof(struct task_entry));
+    char* text = (char*)malloc((size_t)tasks * (desc_length + 1));
+    if (!entries || !text) {
+        free(entries);
+        free(text);
+        return NULL;
+    }
+
+    for (long i = 0; i < tasks; i++) {
+        long slot = i / TASKS_PER_DAY;
+        entries[i].year = FIRST_YEAR + years - 1 - (int)(slot / DAYS_PER_YEAR);
+        entries[i].month = 1 + (int)(slot % DAYS_PER_YEAR) / 28;
+        entries[i].day = 1 + (int)(slot % DAYS_PER_YEAR) % 28;
+
+        // words until the length is reached
+        char* desc = text + i * (desc_length + 1);
+        int at = 0;
+        for (long w = i; at < desc_length; w = w * 7 + 3) {
+            const char* word = g_words[w % 16];
+            for (int c = 0; word[c] && at < desc_length; c++) desc[at++] = word[c];
+            if (at < desc_length) desc[at++] = ' ';
+        }
+        desc[at] = '\0';
+        entries[i].description = desc;
+    }
+
+    struct years* calendar = NULL;
+    addTasks(&calendar, entries, (int)tasks, NULL);
+    free(entries);
+    free(text);
+    return calendar;
+}
+
+static void sweepTotalTasks(struct bench* bench, long tasks) {
+
+    struct op_state state;
+    memset(&state, 0, sizeof(state));
+    state.calendar = buildCalendar(tasks, 40);
+    state.keyword = MISSING_WORD;
+
+    addPoint(bench, "total_tasks", "search", tasks, timeOp(bench, opSearch, &state));
+    addPoint(bench, "total_tasks", "saveTasks", tasks, timeOp(bench, opSave, &state));
+    addPoint(bench, "total_tasks", "loadTasks", tasks, timeOp(bench, opLoad, &state));
+
+    freeCalendar(state.calendar);
+    remove(TASKS_FILE);
+}
+
+static void sweepDescLength(struct bench* bench, long length) {
+
+    struct op_state state;
+    memset(&state, 0, sizeof(state));
+    state.calendar = buildCalendar(bench->quick ? 4000 : 20000, (int)length);
+    state.keyword = MISSING_WORD;
+
+    addPoint(bench, "desc_length", "search", length, timeOp(bench, opSearch, &state));
+    freeCalendar(state.calendar);
+}
+
+static void runSweeps(struct bench* bench) {
+
+    for (int s = 0; s < SWEEPS; s++) {
+        const struct sweep* sweep = &g_sweeps[s];
+        const long* sizes = bench->quick ? sweep->quick : sweep->full;
+
+        for (int p = 0; p < MAX_POINTS && sizes[p] > 0; p++) {
+            fprintf(stderr, "ScalingBench: %s %ld...\n", sweep->dimension, sizes[p]);
+            if (strcmp(sweep->dimension, "years") == 0) sweepYears(bench, sizes[p]);
+            else if (strcmp(sweep->dimension, "tasks_per_day") == 0) sweepTasksPerDay(bench, sizes[p]);
+            else if (strcmp(sweep->dimension, "total_tasks") == 0) sweepTotalTasks(bench, sizes[p]);
+            else sweepDescLength(bench, sizes[p]);
+        }
+    }
+
+    for (int i = 0; i < bench->curve_count; i++) fitSlope(&bench->curves[i]);
+}
+
+// =====================
+// OUTPUT + BASELINES
+// =====================
+
+static void writeJson(FILE* out, const struct bench* bench) {
+
+    fprintf(out, "{\n  \"benchmark\": \"ScalingBench\",\n  \"mode\": \"%s\",\n  \"curves\": [\n", bench->quick ? "quick" : "full");
+    for (int c = 0; c < bench->curve_count; c++) {
+        const struct curve* curve = &bench->curves[c];
+        fprintf(out, "    {\n      \"dimension\": \"%s\",\n      \"op\": \"%s\",\n      \"slope\": %.3f,\n      \"points\": [\n",
+            curve->dimension, curve->op, curve->slope);
+        for (int p = 0; p < curve->points; p++) {
+            fprintf(out, "        { \"x\": %ld, \"ns_per_op\": %.1f }%s\n", curve->x[p], curve->nanos[p],
+                p + 1 < curve->points ? "," : "");
+        }
+        fprintf(out, "      ]\n    }%s\n", c + 1 < bench->curve_count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// "mode quick|full", then "dimension op slope ns_per_op_at_largest_point" per curve
+static int writeBaseline(const char* filename, const struct bench* bench) {
+
+    FILE* fp;
+    fopen_s(&fp, filename, "w");
+    if (!fp) return 0;
+
+    fprintf(fp, "# ScalingBench baseline (--write-baseline): per curve, the log-log slope of time\n");
+    fprintf(fp, "# per operation against the dimension, and the time at its largest point\n");
+    fprintf(fp, "mode %s\n", bench->quick ? "quick" : "full");
+    for (int c = 0; c < bench->curve_count; c++) {
+        const struct curve* curve = &bench->curves[c];
+        fprintf(fp, "%s %s %.3f %.1f\n", curve->dimension, curve->op, curve->slope, curve->nanos[curve->points - 1]);
+    }
+    return fclose(fp) == 0;
+}
+
+// splits line in place at spaces / tabs / newlines; returns how many fields
+static int splitFields(char* line, char** fields, int max_fields) {
+
+    int count = 0;
+    char* at = line;
+    while (count < max_fields) {
+        while (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r') at++;
+        if (!*at) break;
+        fields[count++] = at;
+        while (*at && *at != ' ' && *at != '\t' && *at != '\n' && *at != '\r') at++;
+        if (*at) *at++ = '\0';
+    }
+    return count;
+}
+
+// returns how many curves failed, or -1 if the baseline can't be used
+static int checkBaseline(const char* filename, const struct bench* bench, double tolerance, double time_factor) {
+
+    FILE* fp;
+    fopen_s(&fp, filename, "r");
+    if (!fp) {
+        fprintf(stderr, "ScalingBench: can't read %s\n", filename);
+        return -1;
+    }
+
+    int failed = 0, checked = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        char* fields[4];
+        int field_count = splitFields(line, fields, 4);
+        if (field_count == 2 && strcmp(fields[0], "mode") == 0) {
+            if (strcmp(fields[1], bench->quick ? "quick" : "full") != 0) {
+                fprintf(stderr, "ScalingBench: %s is a %s baseline; run with%s --quick\n", filename, fields[1], bench->quick ? "out" : "");
+                fclose(fp);
+                return -1;
+            }
+            continue;
+        }
+        if (field_count != 4) continue;
+
+        const char* dimension = fields[0];
+        const char* op = fields[1];
+        double slope = atof(fields[2]);
+        double nanos = atof(fields[3]);
+
+        const struct curve* curve = NULL;
+        for (int c = 0; c < bench->curve_count && !curve; c++) {
+            if (strcmp(bench->curves[c].dimension, dimension) == 0 && strcmp(bench->curves[c].op, op) == 0) curve = &bench->curves[c];
+        }
+        if (!curve) {
+            fprintf(stderr, "FAIL %-14s %-26s not measured\n", dimension, op);
+            failed++;
+            continue;
+        }
+
+        double largest = curve->nanos[curve->points - 1];
+        int slope_ok = curve->slope <= slope + tolerance;
+        int time_ok = time_factor <= 0 || largest <= nanos * time_factor;
+        fprintf(stderr, "%s %-14s %-26s slope %6.3f (baseline %6.3f)  %12.1f ns at %ld (baseline %.1f)\n",
+            slope_ok && time_ok ? "ok  " : "FAIL", dimension, op, curve->slope, slope, largest, curve->x[curve->points - 1], nanos);
+        if (!slope_ok || !time_ok) failed++;
+        checked++;
+    }
+    fclose(fp);
+
+    if (checked == 0) {
+        fprintf(stderr, "ScalingBench: no curves in %s\n", filename);
+        return -1;
+    }
+    return failed;
+}
+
+// =====================
+// MAIN
+// =====================
+
+static int printUsage(void) {
+    fprintf(stderr, "usage: ScalingBench [--quick] [--out results.json] [--baseline file [--tolerance 0.3] [--time-factor f]]\n"
+        "                    [--write-baseline file]\n");
+    return 1;
+}
+
+int main(int argc, char** argv) {
+
+    static struct bench bench;
+    const char* out_file = NULL;
+    const char* baseline = NULL;
+    const char* new_baseline = NULL;
+    double tolerance = 0.3, time_factor = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) bench.quick = 1;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_file = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline = argv[++i];
+        else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) new_baseline = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--time-factor") == 0 && i + 1 < argc) time_factor = atof(argv[++i]);
+        else return printUsage();
+    }
+    bench.min_nanos = bench.quick ? 5000000LL : 50000000LL;
+
+    // the report goes where stdout was; stdout itself goes to the null device
+    FILE* report;
+    if (out_file) fopen_s(&report, out_file, "w");
+    else report = openFileDescriptor(dupFile(_fileno(stdout)), "w");
+    if (!report) {
+        fprintf(stderr, "ScalingBench: can't write the results\n");
+        return 1;
+    }
+    FILE* silenced;
+#ifdef _MSC_VER
+    freopen_s(&silenced, NULL_DEVICE, "w", stdout);
+#else
+    silenced = freopen(NULL_DEVICE, "w", stdout);
+#endif
+    if (!silenced) fprintf(stderr, "ScalingBench: couldn't silence stdout\n");
+
+    runSweeps(&bench);
+    writeJson(report, &bench);
+    fclose(report);
+
+    if (new_baseline && !writeBaseline(new_baseline, &bench)) {
+        fprintf(stderr, "ScalingBench: can't write %s\n", new_baseline);
+        return 1;
+    }
+    if (baseline) {
+        int failed = checkBaseline(baseline, &bench, tolerance, time_factor);
+        if (failed != 0) {
+            if (failed > 0) fprintf(stderr, "ScalingBench: %d curve(s) scale worse than the baseline\n", failed);
+            return 1;
+        }
+        fprintf(stderr, "ScalingBench: every curve within %.2f of its baseline slope\n", tolerance);
+    }
+    return 0;
+}
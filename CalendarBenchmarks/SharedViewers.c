@@ -0,0 +1,185 @@
+// Read-only viewers: parsing tasks.txt vs. mapping the shared calendar
+// (SharedCalendar.h).
+//
+// First compares what a viewer pays to get going and answer one question
+// (today's tasks): loading the tasks file, or opening the shared segment. Then
+// forks viewer processes that do day lookups and searches on the segment while
+// this process keeps republishing a changing calendar, and prints the lookups
+// per second they managed and how long each publish took. Linux only.
+//
+// usage: SharedViewers [tasks] [viewers] [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "../My Calendar Project Repo/Calendar.h"
+#include "../My Calendar Project Repo/Platform.h"
+#include "../My Calendar Project Repo/SharedCalendar.h"
+
+#define FIRST_YEAR 2000
+#define YEAR_COUNT 25
+#define SHARED_NAME "/calendar_viewers_bench"
+#define TASKS_FILE "shared_viewers_bench.txt"
+
+static const char* g_words[] = {
+    "meeting", "review", "dentist", "budget", "release", "lunch", "gym", "call",
+    "invoice", "design", "standup", "trip", "school", "doctor", "report", "party"
+};
+
+// xorshift
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+#ifdef __linux__
+
+// what one viewer process did, in memory shared with the parent
+struct viewer_result {
+    long long day_lookups;
+    long long searches;
+};
+
+static void runViewer(struct viewer_result* result, int seconds, unsigned int seed) {
+
+    struct shared_calendar_view* view = openSharedCalendar(SHARED_NAME);
+    if (!view) return;
+
+    static struct shared_task tasks[64];
+    long long end = platformNowNanos() + (long long)seconds * 1000000000LL;
+
+    while (platformNowNanos() < end) {
+        for (int i = 0; i < 1000; i++) {
+            int year = FIRST_YEAR + (int)(nextRandom(&seed) % YEAR_COUNT);
+            sharedDayTasks(view, year, 1 + (int)(nextRandom(&seed) % 12), 1 + (int)(nextRandom(&seed) % 28), tasks, 64);
+        }
+        result->day_lookups += 1000;
+
+        sharedSearchTasks(view, g_words[nextRandom(&seed) % 16], tasks, 64);
+        result->searches++;
+    }
+    closeSharedCalendar(view);
+}
+
+int main(int argc, char** argv) {
+
+    int tasks = argc > 1 ? atoi(argv[1]) : 200000;
+    int viewers = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    if (tasks < 1) tasks = 1;
+    if (viewers < 1) viewers = 1;
+    if (seconds < 1) seconds = 1;
+
+    struct task_entry* entries = (struct task_entry*)malloc(tasks * sizeof(struct task_entry));
+    char* text = (char*)malloc((size_t)tasks * 48);
+    if (!entries || !text) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    unsigned int seed = 777;
+    for (int i = 0; i < tasks; i++) {
+        char* desc = text + (size_t)i * 48;
+        snprintf(desc, 48, "%s %s #%d", g_words[nextRandom(&seed) % 16], g_words[nextRandom(&seed) % 16], i);
+        entries[i].year = FIRST_YEAR + (int)(nextRandom(&seed) % YEAR_COUNT);
+        entries[i].month = 1 + (int)(nextRandom(&seed) % 12);
+        entries[i].day = 1 + (int)(nextRandom(&seed) % 28);
+        entries[i].description = desc;
+    }
+
+    struct years* calendar = NULL;
+    addTasks(&calendar, entries, tasks, NULL);
+    saveTasks(TASKS_FILE, calendar);
+
+    struct shared_calendar* shared = createSharedCalendar(SHARED_NAME);
+    if (!shared) {
+        printf("could not create shared memory %s\n", SHARED_NAME);
+        return 1;
+    }
+    long long start = platformNowNanos();
+    publishSharedCalendar(shared, calendar);
+    printf("%d tasks, first publish %.1f ms\n\n", tasks, (platformNowNanos() - start) / 1e6);
+
+    // a viewer starting up and answering one question
+    start = platformNowNanos();
+    struct years* loaded = loadTasks(TASKS_FILE);
+    struct days* day = getDayNode(loaded, 2010, 6, 15);
+    int parsed_count = 0;
+    for (struct tasks* t = day ? day->tasks_head : NULL; t != NULL; t = t->next) parsed_count++;
+    double parse_ms = (platformNowNanos() - start) / 1e6;
+    freeCalendar(loaded);
+
+    start = platformNowNanos();
+    struct shared_calendar_view* view = openSharedCalendar(SHARED_NAME);
+    int shared_count = sharedCountTasks(view, 2010, 6, 15);
+    double map_ms = (platformNowNanos() - start) / 1e6;
+    closeSharedCalendar(view);
+
+    printf("viewer start + one day lookup: parse tasks file %.2f ms, map shared calendar %.3f ms (%s)\n\n",
+        parse_ms, map_ms, parsed_count == shared_count ? "same answer" : "MISMATCH");
+
+    // viewers reading while the writer keeps changing and republishing
+    struct viewer_result* results = (struct viewer_result*)mmap(NULL, viewers * sizeof(struct viewer_result),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memset(results, 0, viewers * sizeof(struct viewer_result));
+
+    for (int i = 0; i < viewers; i++) {
+        if (fork() == 0) {
+            runViewer(&results[i], seconds, 1234u + (unsigned int)i);
+            _exit(0);
+        }
+    }
+
+    long long publishes = 0, publish_nanos = 0, worst = 0;
+    long long end = platformNowNanos() + (long long)seconds * 1000000000LL;
+    while (platformNowNanos() < end) {
+        struct task_entry entry = { FIRST_YEAR + (int)(publishes % YEAR_COUNT), 6, 15, "republished" };
+        addTasks(&calendar, &entry, 1, NULL);
+
+        long long t0 = platformNowNanos();
+        publishSharedCalendar(shared, calendar);
+        long long took = platformNowNanos() - t0;
+        publish_nanos += took;
+        if (took > worst) worst = took;
+        publishes++;
+        threadSleepMillis(10);
+    }
+    for (int i = 0; i < viewers; i++) wait(NULL);
+
+    long long lookups = 0, searches = 0;
+    for (int i = 0; i < viewers; i++) {
+        lookups += results[i].day_lookups;
+        searches += results[i].searches;
+    }
+    printf("%d viewers for %d s, %lld publishes (avg %.2f ms, max %.2f ms)\n", viewers, seconds, publishes,
+        publishes ? publish_nanos / 1e6 / publishes : 0.0, worst / 1e6);
+    printf("  day lookups: %.0f/s   searches: %.1f/s\n", lookups / (double)seconds, searches / (double)seconds);
+
+    munmap(results, viewers * sizeof(struct viewer_result));
+    destroySharedCalendar(shared);
+    freeCalendar(calendar);
+    free(entries);
+    free(text);
+    remove(TASKS_FILE);
+    return 0;
+}
+
+#else
+
+int main(void) {
+    printf("SharedViewers needs Linux (shm_open, fork).\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,225 @@
+// Synthetic workloads (Workload.h): big tasks files, command scripts and
+// operation traces, and a replayer that runs a trace through the command API
+// and prints how long each kind of operation took.
+//
+// usage:
+//   WorkloadGen tasks N [options]          N tasks in tasks.txt format
+//   WorkloadGen commands N [options]       the same tasks as "add" commands (app --batch)
+//   WorkloadGen trace N OPS [options]      OPS operations against the N-task calendar above
+//   WorkloadGen replay TASKS TRACE         loads TASKS, runs TRACE, prints times per operation
+//
+// options (use the same ones for a tasks file and its trace):
+//   --seed n  --years 2000-2099  --skew 1.0  --lengths 8-60  --long-tail
+//   --words file (one word per line)  --word-skew 1.0  --mix add,update,delete,search (weights, default 40,30,10,20)
+//   --out file (default stdout)
+//
+// e.g. WorkloadGen tasks 1000000 --out big.txt && WorkloadGen trace 1000000 200000 --out trace.txt
+//      && WorkloadGen replay big.txt trace.txt
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../My Calendar Project Repo/CalendarContext.h"
+#include "../My Calendar Project Repo/Commands.h"
+#include "../My Calendar Project Repo/Platform.h"
+#include "../My Calendar Project Repo/Workload.h"
+
+#define MAX_WORDS 65536
+#define LINE_LEN 1024
+
+static int printUsage(void) {
+    fprintf(stderr,
+        "usage: WorkloadGen tasks N [options]\n"
+        "       WorkloadGen commands N [options]\n"
+        "       WorkloadGen trace N OPS [options]\n"
+        "       WorkloadGen replay TASKS TRACE\n"
+        "options: --seed n --years A-B --skew x --lengths A-B --long-tail --words file --word-skew x\n"
+        "         --mix add,update,delete,search --out file\n");
+    return 1;
+}
+
+// one word per line; the words stay allocated until the program exits
+static int readWords(const char* filename, const char** words) {
+
+    FILE* fp;
+    fopen_s(&fp, filename, "r");
+    if (!fp) return -1;
+
+    int count = 0;
+    char line[LINE_LEN];
+    while (count < MAX_WORDS && fgets(line, sizeof(line), fp)) {
+        size_t length = strcspn(line, " \t\r\n");
+        if (length == 0) continue;
+        char* word = (char*)malloc(length + 1);
+        if (!word) break;
+        memcpy(word, line, length);
+        word[length] = '\0';
+        words[count++] = word;
+    }
+    fclose(fp);
+    return count;
+}
+
+// =====================
+// REPLAY
+// =====================
+
+struct replay_stats {
+    const char* verb;
+    long count;
+    long errors;
+    long long nanos;
+    long long worst;
+};
+
+static int replayTrace(const char* tasks_file, const char* trace_file) {
+
+    struct calendar_options options;
+    initCalendarOptions(&options);
+    options.silent = 1;
+    options.locking = CALENDAR_LOCK_NONE;
+    struct calendar* calendar = createCalendar(&options);
+    if (!calendar) return 1;
+
+    long long start = platformNowNanos();
+    int loaded = calendarLoad(calendar, tasks_file);
+    if (loaded < 0) {
+        fprintf(stderr, "Could not open %s\n", tasks_file);
+        destroyCalendar(calendar);
+        return 1;
+    }
+    printf("loaded %d tasks in %.1f ms\n\n", loaded, (platformNowNanos() - start) / 1e6);
+
+    FILE* trace;
+    fopen_s(&trace, trace_file, "r");
+    if (!trace) {
+        fprintf(stderr, "Could not open %s\n", trace_file);
+        destroyCalendar(calendar);
+        return 1;
+    }
+
+    struct command_session* session = createCommandSession(calendar, tasks_file);
+    struct replay_stats stats[] = { { "add" }, { "update" }, { "delete" }, { "search" }, { "other" } };
+    const int kinds = (int)(sizeof(stats) / sizeof(stats[0]));
+
+    char line[LINE_LEN];
+    while (fgets(line, sizeof(line), trace)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        int kind = 0;
+        size_t verb_length = strcspn(line, " ");
+        while (kind < kinds - 1 && !(strlen(stats[kind].verb) == verb_length && strncmp(line, stats[kind].verb, verb_length) == 0)) kind++;
+
+        long long t0 = platformNowNanos();
+        executeCommand(session, line);
+        long long took = platformNowNanos() - t0;
+
+        size_t length;
+        const char* reply = commandOutput(session, &length);
+        if (length < 2 || strncmp(reply, "OK", 2) != 0) stats[kind].errors++;
+        clearCommandOutput(session);
+
+        stats[kind].count++;
+        stats[kind].nanos += took;
+        if (took > stats[kind].worst) stats[kind].worst = took;
+    }
+    fclose(trace);
+
+    printf("%-8s %10s %8s %12s %12s %12s\n", "op", "count", "errors", "total ms", "avg us", "max us");
+    for (int i = 0; i < kinds; i++) {
+        if (stats[i].count == 0) continue;
+        printf("%-8s %10ld %8ld %12.1f %12.2f %12.1f\n", stats[i].verb, stats[i].count, stats[i].errors,
+            stats[i].nanos / 1e6, stats[i].nanos / 1e3 / stats[i].count, stats[i].worst / 1e3);
+    }
+
+    freeCommandSession(session);
+    destroyCalendar(calendar);
+    return 0;
+}
+
+// =====================
+// MAIN
+// =====================
+
+int main(int argc, char** argv) {
+
+    if (argc < 3) return printUsage();
+    const char* mode = argv[1];
+
+    if (strcmp(mode, "replay") == 0) {
+        if (argc != 4) return printUsage();
+        return replayTrace(argv[2], argv[3]);
+    }
+
+    int is_trace = strcmp(mode, "trace") == 0;
+    if (!is_trace && strcmp(mode, "tasks") != 0 && strcmp(mode, "commands") != 0) return printUsage();
+    if (is_trace && argc < 4) return printUsage();
+
+    long tasks = atol(argv[2]);
+    long operations = is_trace ? atol(argv[3]) : 0;
+    if (tasks < 0 || operations < 0) return printUsage();
+
+    struct workload_options options;
+    initWorkloadOptions(&options);
+    struct workload_mix mix = { 40, 30, 10, 20 };
+    const char* out_file = NULL;
+    static const char* words[MAX_WORDS];
+
+    for (int i = is_trace ? 4 : 3; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(argv[i], "--long-tail") == 0) {
+            options.length_distribution = WORKLOAD_LENGTH_LONG_TAIL;
+            continue;
+        }
+        if (!value) return printUsage();
+        i++;
+
+        if (strcmp(argv[i - 1], "--seed") == 0) options.seed = (unsigned int)strtoul(value, NULL, 10);
+        else if (strcmp(argv[i - 1], "--years") == 0) {
+            if (sscanf_s(value, "%d-%d", &options.first_year, &options.last_year) != 2) return printUsage();
+        }
+        else if (strcmp(argv[i - 1], "--skew") == 0) options.date_skew = atof(value);
+        else if (strcmp(argv[i - 1], "--lengths") == 0) {
+            if (sscanf_s(value, "%d-%d", &options.min_length, &options.max_length) != 2) return printUsage();
+        }
+        else if (strcmp(argv[i - 1], "--words") == 0) {
+            options.vocabulary_size = readWords(value, words);
+            options.vocabulary = words;
+            if (options.vocabulary_size < 1) {
+                fprintf(stderr, "No words in %s\n", value);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i - 1], "--word-skew") == 0) options.word_skew = atof(value);
+        else if (strcmp(argv[i - 1], "--mix") == 0) {
+            if (sscanf_s(value, "%d,%d,%d,%d", &mix.add_weight, &mix.update_weight, &mix.delete_weight, &mix.search_weight) != 4) {
+                return printUsage();
+            }
+        }
+        else if (strcmp(argv[i - 1], "--out") == 0) out_file = value;
+        else return printUsage();
+    }
+
+    FILE* out = stdout;
+    if (out_file) {
+        fopen_s(&out, out_file, "w");
+        if (!out) {
+            fprintf(stderr, "Could not open %s\n", out_file);
+            return 1;
+        }
+    }
+
+    long written;
+    if (is_trace) written = writeWorkloadTrace(&options, tasks, &mix, operations, out);
+    else written = writeWorkloadTasks(&options, tasks, strcmp(mode, "tasks") == 0 ? WORKLOAD_TASKS_FILE : WORKLOAD_COMMANDS, out);
+
+    if (out != stdout && fclose(out) != 0) written = -1;
+    if (written < 0) {
+        fprintf(stderr, "Could not generate the %s (check the options).\n", mode);
+        return 1;
+    }
+    return 0;
+}
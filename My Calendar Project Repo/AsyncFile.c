@@ -0,0 +1,590 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "AsyncFile.h"
+#include "CalendarInternal.h"
+
+// size of one read / write request
+#define FILE_IO_BLOCK (256 * 1024)
+// requests in flight at once (uring)
+#define FILE_IO_DEPTH 8
+
+const char* fileIOBackendName(enum file_io_backend backend) {
+    switch (backend) {
+    case FILE_IO_AUTO: return "auto";
+    case FILE_IO_URING: return "uring";
+    case FILE_IO_PREAD: return "pread";
+    case FILE_IO_STDIO: return "stdio";
+    }
+    return "?";
+}
+
+int parseFileIOBackend(const char* name, enum file_io_backend* backend) {
+    for (int b = FILE_IO_AUTO; b <= FILE_IO_STDIO; b++) {
+        if (strcmp(name, fileIOBackendName((enum file_io_backend)b)) == 0) {
+            *backend = (enum file_io_backend)b;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// =====================
+// STDIO
+// =====================
+
+// text mode, so line endings come out the way fgets sees them
+static char* readFileStdio(const char* filename, size_t* size) {
+    FILE* fp;
+    fopen_s(&fp, filename, "r");
+    if (!fp) return NULL;
+
+    size_t capacity = 1 << 16, length = 0;
+    char* data = (char*)malloc(capacity);
+
+    while (data) {
+        length += fread(data + length, 1, capacity - length, fp);
+        if (length < capacity) break;
+
+        char* grown = (char*)realloc(data, capacity * 2);
+        if (!grown) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = grown;
+        capacity *= 2;
+    }
+
+    fclose(fp);
+    *size = length;
+    return data;
+}
+
+#ifndef __linux__
+
+// only stdio here
+
+enum file_io_backend resolveFileIOBackend(enum file_io_backend backend) {
+    (void)backend;
+    return FILE_IO_STDIO;
+}
+
+char* readFileWith(const char* filename, size_t* size, enum file_io_backend backend) {
+    (void)backend;
+    return readFileStdio(filename, size);
+}
+
+struct async_writer {
+    FILE* fp;
+    int failed;
+};
+
+struct async_writer* openAsyncWriter(const char* filename, enum file_io_backend backend) {
+    (void)backend;
+
+    struct async_writer* writer = (struct async_writer*)calloc(1, sizeof(struct async_writer));
+    if (!writer) return NULL;
+
+    fopen_s(&writer->fp, filename, "w");
+    if (!writer->fp) {
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int asyncWrite(struct async_writer* writer, const char* data, size_t length) {
+    if (!writer->failed && fwrite(data, 1, length, writer->fp) != length) writer->failed = 1;
+    return !writer->failed;
+}
+
+int closeAsyncWriter(struct async_writer* writer) {
+    int ok = !writer->failed;
+    if (fclose(writer->fp) != 0) ok = 0;
+    free(writer);
+    return ok;
+}
+
+#else
+
+// =====================
+// IO_URING
+// =====================
+// just enough of a ring to queue reads and writes (raw syscalls, so there's no
+// liburing dependency)
+
+struct uring {
+    int fd;
+
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    struct io_uring_cqe* cqes;
+    unsigned cq_mask;
+
+    unsigned unsubmitted;       // queued since the last io_uring_enter
+};
+
+static void uringFree(struct uring* ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map) munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+}
+
+// 0 if this kernel (or its policy) won't give us a ring
+static int uringInit(struct uring* ring, unsigned entries) {
+
+    memset(ring, 0, sizeof(*ring));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return 0;
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map && ring->cq_map_size > ring->sq_map_size) ring->sq_map_size = ring->cq_map_size;
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        uringFree(ring);
+        return 0;
+    }
+
+    ring->cq_map = single_map ? ring->sq_map
+        : mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_map == MAP_FAILED) {
+        ring->cq_map = NULL;
+        uringFree(ring);
+        return 0;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        uringFree(ring);
+        return 0;
+    }
+
+    char* sq = (char*)ring->sq_map;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+
+    char* cq = (char*)ring->cq_map;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    return 1;
+}
+
+// queues one readv / writev (callers never have more in flight than the ring holds)
+static void uringQueue(struct uring* ring, int opcode, int fd, struct iovec* iov, long long offset, unsigned long long user_data) {
+
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & ring->sq_mask;
+
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (unsigned char)opcode;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long)(size_t)iov;
+    sqe->len = 1;
+    sqe->off = (unsigned long long)offset;
+    sqe->user_data = user_data;
+
+    ring->sq_array[index] = index;
+    // the kernel may look at the entry as soon as it sees the new tail
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->unsubmitted++;
+}
+
+// submits what's queued and waits until at least wait_for requests have completed
+static int uringEnter(struct uring* ring, unsigned wait_for) {
+    for (;;) {
+        int submitted = (int)syscall(__NR_io_uring_enter, ring->fd, ring->unsubmitted, wait_for,
+            wait_for ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted >= 0) {
+            ring->unsubmitted -= (unsigned)submitted;
+            return 1;
+        }
+        if (errno != EINTR) return 0;
+    }
+}
+
+// takes one completion if there is one
+static int uringReap(struct uring* ring, struct io_uring_cqe* completion) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) return 0;
+
+    *completion = ring->cqes[head & ring->cq_mask];
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+enum file_io_backend resolveFileIOBackend(enum file_io_backend backend) {
+    if (backend == FILE_IO_PREAD || backend == FILE_IO_STDIO) return backend;
+
+    struct uring ring;
+    if (!uringInit(&ring, FILE_IO_DEPTH)) return FILE_IO_PREAD;
+    uringFree(&ring);
+    return FILE_IO_URING;
+}
+
+// =====================
+// READ
+// =====================
+
+// one read request; a short read is re-queued for the rest
+struct read_slot {
+    long long offset;
+    struct iovec iov;
+    int busy;
+};
+
+// every block of [0, size) queued at once (FILE_IO_DEPTH at a time); returns
+// how many bytes there really were (the file can shrink under us), or -1
+static long long readBlocksUring(struct uring* ring, int fd, char* data, long long size) {
+
+    struct read_slot slots[FILE_IO_DEPTH];
+    memset(slots, 0, sizeof(slots));
+
+    long long next = 0, end = size;
+    int in_flight = 0, failed = 0;
+
+    for (;;) {
+        for (int s = 0; s < FILE_IO_DEPTH && next < end && !failed; s++) {
+            if (slots[s].busy) continue;
+
+            long long length = end - next < FILE_IO_BLOCK ? end - next : FILE_IO_BLOCK;
+            slots[s].offset = next;
+            slots[s].iov.iov_base = data + next;
+            slots[s].iov.iov_len = (size_t)length;
+            slots[s].busy = 1;
+            uringQueue(ring, IORING_OP_READV, fd, &slots[s].iov, next, (unsigned long long)s);
+            next += length;
+            in_flight++;
+        }
+
+        if (in_flight == 0) break;
+        if (!uringEnter(ring, 1)) {
+            // nothing more can be submitted or waited for; the buffers are ours
+            // again only once the ring is gone, which the caller does next
+            return -1;
+        }
+
+        struct io_uring_cqe completion;
+        while (uringReap(ring, &completion)) {
+            struct read_slot* slot = &slots[completion.user_data];
+            int res = completion.res;
+
+            if (res == -EINTR || res == -EAGAIN) {
+                uringQueue(ring, IORING_OP_READV, fd, &slot->iov, slot->offset, completion.user_data);
+                continue;
+            }
+
+            in_flight--;
+            slot->busy = 0;
+
+            if (res < 0) failed = 1;
+            else if (res == 0) {
+                // end of file came early
+                if (slot->offset < end) end = slot->offset;
+            }
+            else if ((size_t)res < slot->iov.iov_len) {
+                slot->offset += res;
+                slot->iov.iov_base = (char*)slot->iov.iov_base + res;
+                slot->iov.iov_len -= (size_t)res;
+                slot->busy = 1;
+                in_flight++;
+                uringQueue(ring, IORING_OP_READV, fd, &slot->iov, slot->offset, completion.user_data);
+            }
+        }
+    }
+
+    return failed ? -1 : end;
+}
+
+// the same blocks, one pread at a time
+static long long readBlocksPread(int fd, char* data, long long size) {
+    long long done = 0;
+    while (done < size) {
+        size_t want = size - done < FILE_IO_BLOCK ? (size_t)(size - done) : FILE_IO_BLOCK;
+        ssize_t got = pread(fd, data + done, want, (off_t)done);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (got == 0) break;
+        done += got;
+    }
+    return done;
+}
+
+char* readFileWith(const char* filename, size_t* size, enum file_io_backend backend) {
+
+    if (backend == FILE_IO_STDIO) return readFileStdio(filename, size);
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    long long length = (long long)info.st_size;
+    char* data = (char*)malloc(length > 0 ? (size_t)length : 1);
+    if (!data) {
+        close(fd);
+        return NULL;
+    }
+
+    struct uring ring;
+    long long got;
+    if (backend != FILE_IO_PREAD && length > 0 && uringInit(&ring, FILE_IO_DEPTH)) {
+        got = readBlocksUring(&ring, fd, data, length);
+        uringFree(&ring);
+    }
+    else {
+        got = readBlocksPread(fd, data, length);
+    }
+
+    close(fd);
+    if (got < 0) {
+        free(data);
+        return NULL;
+    }
+
+    *size = (size_t)got;
+    return data;
+}
+
+// =====================
+// WRITE
+// =====================
+
+// one block of output; while busy it belongs to the kernel
+struct write_block {
+    char* data;
+    size_t length;
+    long long offset;
+    struct iovec iov;           // what's still to be written
+    int busy;
+};
+
+struct async_writer {
+    enum file_io_backend backend;
+    FILE* fp;                   // STDIO
+    int fd;                     // PREAD / URING
+    struct uring ring;          // URING
+
+    struct write_block blocks[FILE_IO_DEPTH];
+    int block_count;            // 1 for PREAD (written in place)
+    int current;                // the block being filled
+    long long offset;           // where the current block goes
+    int in_flight;
+    int failed;
+};
+
+static int pwriteAll(int fd, const char* data, size_t length, long long offset) {
+    while (length > 0) {
+        ssize_t put = pwrite(fd, data, length, (off_t)offset);
+        if (put < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += put;
+        length -= (size_t)put;
+        offset += put;
+    }
+    return 1;
+}
+
+// handles whatever has completed; short writes go back in the queue
+static void reapWrites(struct async_writer* writer) {
+    struct io_uring_cqe completion;
+    while (uringReap(&writer->ring, &completion)) {
+        struct write_block* block = &writer->blocks[completion.user_data];
+        int res = completion.res;
+
+        if (res == -EINTR || res == -EAGAIN) {
+            uringQueue(&writer->ring, IORING_OP_WRITEV, writer->fd, &block->iov, block->offset, completion.user_data);
+            continue;
+        }
+        if (res > 0 && (size_t)res < block->iov.iov_len) {
+            block->offset += res;
+            block->iov.iov_base = (char*)block->iov.iov_base + res;
+            block->iov.iov_len -= (size_t)res;
+            uringQueue(&writer->ring, IORING_OP_WRITEV, writer->fd, &block->iov, block->offset, completion.user_data);
+            continue;
+        }
+
+        if (res <= 0) writer->failed = 1;
+        block->busy = 0;
+        block->length = 0;
+        writer->in_flight--;
+    }
+}
+
+static void waitForWrite(struct async_writer* writer) {
+    if (!uringEnter(&writer->ring, 1)) {
+        // can't wait on the ring any more: nothing in it can be trusted
+        writer->failed = 1;
+        writer->in_flight = 0;
+        return;
+    }
+    reapWrites(writer);
+}
+
+// sends the current block off and moves on to the next free one
+static void flushBlock(struct async_writer* writer) {
+
+    struct write_block* block = &writer->blocks[writer->current];
+    if (block->length == 0) return;
+
+    if (writer->backend == FILE_IO_PREAD) {
+        if (!pwriteAll(writer->fd, block->data, block->length, writer->offset)) writer->failed = 1;
+        writer->offset += (long long)block->length;
+        block->length = 0;
+        return;
+    }
+
+    block->offset = writer->offset;
+    block->iov.iov_base = block->data;
+    block->iov.iov_len = block->length;
+    block->busy = 1;
+    writer->offset += (long long)block->length;
+    writer->in_flight++;
+
+    // submitted right away, so the kernel writes it while we fill the next one
+    uringQueue(&writer->ring, IORING_OP_WRITEV, writer->fd, &block->iov, block->offset, (unsigned long long)writer->current);
+    if (!uringEnter(&writer->ring, 0)) {
+        writer->failed = 1;
+        writer->in_flight = 0;
+    }
+    reapWrites(writer);
+
+    writer->current = (writer->current + 1) % writer->block_count;
+    while (writer->blocks[writer->current].busy && writer->in_flight > 0) waitForWrite(writer);
+}
+
+struct async_writer* openAsyncWriter(const char* filename, enum file_io_backend backend) {
+
+    struct async_writer* writer = (struct async_writer*)calloc(1, sizeof(struct async_writer));
+    if (!writer) return NULL;
+    writer->backend = backend == FILE_IO_AUTO ? FILE_IO_URING : backend;
+    writer->fd = -1;
+
+    if (writer->backend == FILE_IO_STDIO) {
+        fopen_s(&writer->fp, filename, "w");
+        if (!writer->fp) {
+            free(writer);
+            return NULL;
+        }
+        return writer;
+    }
+
+    writer->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (writer->fd < 0) {
+        free(writer);
+        return NULL;
+    }
+
+    if (writer->backend == FILE_IO_URING && !uringInit(&writer->ring, FILE_IO_DEPTH)) {
+        writer->backend = FILE_IO_PREAD;
+    }
+    writer->block_count = writer->backend == FILE_IO_URING ? FILE_IO_DEPTH : 1;
+    return writer;
+}
+
+int asyncWrite(struct async_writer* writer, const char* data, size_t length) {
+
+    if (writer->failed) return 0;
+
+    if (writer->backend == FILE_IO_STDIO) {
+        if (fwrite(data, 1, length, writer->fp) != length) writer->failed = 1;
+        return !writer->failed;
+    }
+
+    while (length > 0 && !writer->failed) {
+        struct write_block* block = &writer->blocks[writer->current];
+
+        // blocks are only allocated once they're needed (small files use one)
+        if (!block->data) {
+            block->data = (char*)malloc(FILE_IO_BLOCK);
+            if (!block->data) {
+                writer->failed = 1;
+                break;
+            }
+        }
+
+        size_t room = FILE_IO_BLOCK - block->length;
+        size_t take = length < room ? length : room;
+        memcpy(block->data + block->length, data, take);
+        block->length += take;
+        data += take;
+        length -= take;
+
+        if (block->length == FILE_IO_BLOCK) flushBlock(writer);
+    }
+    return !writer->failed;
+}
+
+int closeAsyncWriter(struct async_writer* writer) {
+
+    if (writer->backend == FILE_IO_STDIO) {
+        int ok = !writer->failed;
+        if (fclose(writer->fp) != 0) ok = 0;
+        free(writer);
+        return ok;
+    }
+
+    if (!writer->failed) flushBlock(writer);
+    while (writer->in_flight > 0) waitForWrite(writer);
+
+    // the ring goes before the blocks: after that the kernel can't touch them
+    if (writer->backend == FILE_IO_URING) uringFree(&writer->ring);
+
+    int ok = !writer->failed;
+    if (close(writer->fd) != 0) ok = 0;
+
+    for (int b = 0; b < FILE_IO_DEPTH; b++) free(writer->blocks[b].data);
+    free(writer);
+    return ok;
+}
+
+#endif
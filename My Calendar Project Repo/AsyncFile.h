@@ -0,0 +1,59 @@
+#pragma once
+#ifndef ASYNC_FILE_H
+#define ASYNC_FILE_H
+
+#include <stddef.h>
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // File I/O backends for the tasks file.
+    //
+    // FILE_IO_URING queues large reads / writes on an io_uring (Linux): a load asks
+    // for the whole file at once in big blocks, and a save hands each full block to
+    // the kernel and carries on filling the next one while it's being written.
+    // FILE_IO_PREAD does the same blocks with plain pread/pwrite, one at a time;
+    // it's what FILE_IO_URING falls back to when io_uring can't be set up (old
+    // kernel, disabled by policy). FILE_IO_STDIO is fread/fwrite, the only one
+    // outside Linux. FILE_IO_AUTO picks the best that works here.
+    //
+    // Every backend reads and writes the same bytes.
+    enum file_io_backend {
+        FILE_IO_AUTO,
+        FILE_IO_URING,
+        FILE_IO_PREAD,
+        FILE_IO_STDIO
+    };
+
+    // what a backend really ends up as on this machine (never FILE_IO_AUTO)
+    enum file_io_backend resolveFileIOBackend(enum file_io_backend backend);
+    const char* fileIOBackendName(enum file_io_backend backend);
+    // "auto" / "uring" / "pread" / "stdio"; returns 0 for anything else
+    int parseFileIOBackend(const char* name, enum file_io_backend* backend);
+
+    // the whole file (malloc'd, not NUL-terminated); NULL if it can't be read
+    char* readFileWith(const char* filename, size_t* size, enum file_io_backend backend);
+
+    // buffered writer that writes each full buffer in the background (uring)
+    struct async_writer;
+
+    // creates / truncates filename; NULL if it can't be opened
+    struct async_writer* openAsyncWriter(const char* filename, enum file_io_backend backend);
+    // copies data into the writer; returns 0 once any write has failed
+    int asyncWrite(struct async_writer* writer, const char* data, size_t length);
+    // writes what's left, waits for everything and closes; 1 if every write succeeded
+    int closeAsyncWriter(struct async_writer* writer);
+
+    // loadTasks / saveTasks through a backend (pool: see loadTasksParallel;
+    // NULL = on this thread). Same tasks and same file contents as the stdio versions.
+    struct years* loadTasksAsync(const char* filename, enum file_io_backend backend, struct work_pool* pool);
+    int saveTasksAsync(const char* filename, struct years* calendar_head, enum file_io_backend backend, struct work_pool* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,8 @@
 
 #include <stdio.h>
 
+#include "Compat.h"
+
 #define DESC_LEN 256
 
 #ifdef __cplusplus
@@ -14,26 +16,49 @@ extern "C" {
     struct months;
     struct days;
     struct tasks;
+    struct work_pool;
+    struct year_skeleton;
 
     struct years {
         int year_number;
         struct months* months;
-        struct years* next;
+        struct years* next;         // kept sorted by year_number (oldest first)
+        int task_count;             // tasks in the whole year (lets range walks skip empty years)
+        unsigned long long generation; // calendarGeneration() when this year last changed
+        const struct year_skeleton* skeleton; // names, lengths and weekdays (shared, see below)
     };
 
     struct months {
         int month_number;
         const char* month_name;
-        struct days* days;
+        struct days* days;          // shared and empty (read-only) until the month's first task
         int num_days;
+        int task_count;             // tasks in this month
+        unsigned int occupied_days; // bit (d - 1) set when day d has at least one task
     };
 
+    // a day is just its task list; its number is its index + 1 and its name
+    // comes from the year's skeleton (dayName)
     struct days {
-        int day_number;
-        const char* day_name;
         struct tasks* tasks_head;
     };
 
+    // Everything about a year that doesn't depend on its tasks is decided by
+    // Jan 1's weekday and whether it's a leap year, so there are only 14 of
+    // these; they're built once and shared (read-only) by every year node.
+    struct month_skeleton {
+        const char* month_name;
+        int num_days;
+        int first_weekday;          // of the 1st, 0 = Sunday
+        int days_before;            // days of the year before the 1st
+    };
+
+    struct year_skeleton {
+        int first_weekday;          // of Jan 1
+        int leap;
+        struct month_skeleton months[12];
+    };
+
     struct tasks {
         int task_id;
         char* task_description;
@@ -42,29 +67,99 @@ extern "C" {
         struct tasks* loop;
     };
 
+    // one search hit: where it was found + the task node itself
+    struct task_match {
+        int year;
+        int month;
+        int day;
+        struct days* day_node;
+        struct tasks* task;
+    };
+
+    // result of the status-returning task ops (calendar contexts, bulk ops)
+    enum calendar_status {
+        CALENDAR_OK = 0,
+        CALENDAR_INVALID_DATE,      // bad month/day, or the year isn't loaded
+        CALENDAR_NOT_FOUND,         // no task with that id on that day
+        CALENDAR_NO_MEMORY
+    };
+
+    // called once per hit; return 0 to stop the search early
+    typedef int (*TaskMatchFn)(const struct task_match* match, void* user_data);
+
     // date helpers
     int dayOfWeek(int year, int month, int day);
     int isLeap(int year);
     int daysInMonth(int year, int month);
+    const struct year_skeleton* yearSkeleton(int year);
+    const char* dayName(int year, int month, int day); // "Sunday"... ("" for an invalid date)
 
     // calendar creation
     struct years* findOrAddYear(struct years** calendar_head, int year_number);
+    struct years* findYear(struct years* calendar_head, int year_number); // NULL if not loaded
 
     // task ops
     void addTask(struct years** calendar_head, int year, int month, int day, const char* desc);
+    // NULL for an invalid date, a year that isn't loaded or a month that has never had a task
     struct days* getDayNode(struct years* calendar_head, int year, int month, int day);
     int listTasksForDayNode(struct days* day_node);
     int updateTask(struct years* calendar_head, int year, int month, int day, int task_id, const char* new_desc);
     int deleteTask(struct years* calendar_head, int year, int month, int day, int task_id);
 
+    // batch task ops (for importers): entries are grouped by day internally and each
+    // day is updated in one pass; nothing is printed, every entry gets a status
+    struct task_entry {
+        int year;
+        int month;
+        int day;
+        const char* description;
+    };
+
+    struct task_ref {
+        int year;
+        int month;
+        int day;
+        int task_id;                // the id the task had before the batch started
+    };
+
+    // statuses is optional (one enum calendar_status per entry); returns how many succeeded
+    // tasks for the same day are added in the order they appear in entries
+    int addTasks(struct years** calendar_head, const struct task_entry* entries, int count, int* statuses);
+    int deleteTasks(struct years* calendar_head, const struct task_ref* refs, int count, int* statuses);
+
     // search helpers
     int containsIgnoreCase(const char* text, const char* key);
-    void searchTasks(struct years* calendar_head, const char* keyword); // prints results
+    int searchTasksEach(struct years* calendar_head, const char* keyword, int limit, TaskMatchFn on_match, void* user_data);
+    int searchTasksInto(struct years* calendar_head, const char* keyword, struct task_match* results, int max_results);
+    void searchTasks(struct years* calendar_head, const char* keyword); // prints results (wrapper over searchTasksEach)
+
+    // mutation generation: goes up on every add/update/delete, new year or freeCalendar
+    unsigned long long calendarGeneration(void);
+
+    // range queries
+    // reports every task dated from..to (inclusive) in chronological order, using the
+    // sorted year list and the month/day occupancy info to skip empty parts
+    // out-of-range month/day numbers are clamped; return 0 from the callback to stop
+    // returns how many tasks were reported
+    int forEachTaskInRange(struct years* calendar_head,
+        int from_year, int from_month, int from_day,
+        int to_year, int to_month, int to_day,
+        TaskMatchFn on_task, void* user_data);
 
     // file I/O
     struct years* loadTasks(const char* filename);
     int saveTasks(const char* filename, struct years* calendar_head);
 
+    // the whole-calendar ops again, with the work spread over a work pool
+    // (WorkPool.h; NULL = the serial version). Same results as the serial ones:
+    // same file contents, same tasks and ids, matches reported in date order on
+    // the calling thread. Messages about bad lines in a loaded file may come out
+    // in a different order.
+    struct years* loadTasksParallel(const char* filename, struct work_pool* pool);
+    int saveTasksParallel(const char* filename, struct years* calendar_head, struct work_pool* pool);
+    int searchTasksParallel(struct years* calendar_head, const char* keyword, int limit,
+        TaskMatchFn on_match, void* user_data, struct work_pool* pool);
+
     // memory cleanup
     void freeCalendar(struct years* calendar_head);
 
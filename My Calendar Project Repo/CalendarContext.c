@@ -0,0 +1,611 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalendarContext.h"
+#include "CalendarInternal.h"
+#include "Epoch.h"
+#include "EventRing.h"
+#include "Platform.h"
+#include "Render.h"
+
+// one loaded year + its lock
+// slots are allocated one by one and never freed before the calendar is, so a
+// slot pointer stays valid after the index lock is dropped
+struct year_slot {
+    int year_number;
+    struct years* node;
+    platform_rwlock lock;       // PER_YEAR and EPOCH (EPOCH: writers only)
+};
+
+// the year index: replaced as a whole (copy on write) when a year is added, so
+// lock-free readers can keep using the one they picked up
+struct slot_table {
+    int count;
+    struct year_slot* slots[];  // sorted by year_number, for binary search
+};
+
+struct calendar {
+    struct years* head;         // the usual sorted year list (so the core functions work on it)
+    struct slot_table* table;   // never NULL
+
+    // GLOBAL: the only lock (read for reads, write for changes)
+    // PER_YEAR / EPOCH: read while using the slots, write only to add years or load
+    // (EPOCH readers don't take it)
+    // lock order is always index -> one year
+    platform_rwlock index_lock;
+
+    struct epoch_domain* epoch; // EPOCH only
+    struct calendar_options options;
+};
+
+void initCalendarOptions(struct calendar_options* options) {
+    if (!options) return;
+    options->silent = 0;
+    options->output = NULL;
+    options->locking = CALENDAR_LOCK_PER_YEAR;
+    options->pool = NULL;
+    options->io = FILE_IO_STDIO;
+    options->events = NULL;
+}
+
+struct calendar* createCalendar(const struct calendar_options* options) {
+
+    struct calendar* calendar = (struct calendar*)calloc(1, sizeof(struct calendar));
+    if (!calendar) return NULL;
+
+    if (options) calendar->options = *options;
+    else initCalendarOptions(&calendar->options);
+
+    calendar->table = (struct slot_table*)calloc(1, sizeof(struct slot_table));
+    if (calendar->options.locking == CALENDAR_LOCK_EPOCH) {
+        calendar->epoch = createEpochDomain();
+    }
+    if (!calendar->table || (calendar->options.locking == CALENDAR_LOCK_EPOCH && !calendar->epoch)) {
+        free(calendar->table);
+        free(calendar);
+        return NULL;
+    }
+
+    rwlockInit(&calendar->index_lock);
+    return calendar;
+}
+
+void destroyCalendar(struct calendar* calendar) {
+    if (!calendar) return;
+
+    // retired tasks/tables first, they may point into what's freed below
+    freeEpochDomain(calendar->epoch);
+
+    for (int i = 0; i < calendar->table->count; i++) {
+        rwlockDestroy(&calendar->table->slots[i]->lock);
+        free(calendar->table->slots[i]);
+    }
+    free(calendar->table);
+
+    freeCalendar(calendar->head);
+    rwlockDestroy(&calendar->index_lock);
+    free(calendar);
+}
+
+struct event_ring* calendarEventRing(struct calendar* calendar) {
+    return calendar->options.events;
+}
+
+// =====================
+// LOCKING
+// =====================
+
+// year locks for readers (PER_YEAR) / writers (PER_YEAR and EPOCH)
+static int perYearReads(const struct calendar* calendar) {
+    return calendar->options.locking == CALENDAR_LOCK_PER_YEAR;
+}
+
+static int perYear(const struct calendar* calendar) {
+    return calendar->options.locking == CALENDAR_LOCK_PER_YEAR
+        || calendar->options.locking == CALENDAR_LOCK_EPOCH;
+}
+
+// readers: the index read lock, or just an epoch ticket with EPOCH
+// returns what endRead needs back
+static int beginRead(struct calendar* calendar) {
+    if (calendar->options.locking == CALENDAR_LOCK_EPOCH) return epochEnter(calendar->epoch);
+    if (calendar->options.locking != CALENDAR_LOCK_NONE) rwlockRead(&calendar->index_lock);
+    return -1;
+}
+
+static void endRead(struct calendar* calendar, int ticket) {
+    if (calendar->options.locking == CALENDAR_LOCK_EPOCH) epochExit(calendar->epoch, ticket);
+    else if (calendar->options.locking != CALENDAR_LOCK_NONE) rwlockReadDone(&calendar->index_lock);
+}
+
+// GLOBAL: exclusive, PER_YEAR / EPOCH: shared (the year lock is what makes it exclusive)
+static void lockForChange(struct calendar* calendar) {
+    if (calendar->options.locking == CALENDAR_LOCK_GLOBAL) rwlockWrite(&calendar->index_lock);
+    else if (perYear(calendar)) rwlockRead(&calendar->index_lock);
+}
+
+static void unlockForChange(struct calendar* calendar) {
+    if (calendar->options.locking == CALENDAR_LOCK_GLOBAL) rwlockWriteDone(&calendar->index_lock);
+    else if (perYear(calendar)) rwlockReadDone(&calendar->index_lock);
+}
+
+// exclusive access to everything (load)
+static void lockAll(struct calendar* calendar) {
+    if (calendar->options.locking != CALENDAR_LOCK_NONE) rwlockWrite(&calendar->index_lock);
+}
+
+static void unlockAll(struct calendar* calendar) {
+    if (calendar->options.locking != CALENDAR_LOCK_NONE) rwlockWriteDone(&calendar->index_lock);
+}
+
+// message streams for the core ops
+static FILE* messageStream(const struct calendar* calendar) {
+    if (calendar->options.silent) return NULL;
+    return calendar->options.output ? calendar->options.output : stdout;
+}
+
+// one event into this calendar's own ring (not the one set with setTaskEventRing)
+static void emitChange(struct calendar* calendar, int type, int year, int month, int day, int task_id) {
+    if (calendar->options.events) publishEvent(calendar->options.events, type, year, month, day, task_id);
+}
+
+// =====================
+// YEAR INDEX
+// =====================
+
+// the current index (readers without the index lock get it through here)
+static struct slot_table* currentTable(struct calendar* calendar) {
+    return (struct slot_table*)atomicReadPointer((void* volatile*)&calendar->table);
+}
+
+// position of the first slot with year_number >= year
+static int lowerSlot(const struct slot_table* table, int year) {
+    int low = 0, high = table->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (table->slots[mid]->year_number < year) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static struct year_slot* findSlot(const struct slot_table* table, int year) {
+    int at = lowerSlot(table, year);
+    if (at < table->count && table->slots[at]->year_number == year) {
+        return table->slots[at];
+    }
+    return NULL;
+}
+
+// call with the index held exclusively (or no locking)
+static struct year_slot* addSlot(struct calendar* calendar, int year) {
+
+    struct years* node = findOrAddYear(&calendar->head, year);
+    if (!node) return NULL;
+
+    struct slot_table* old_table = calendar->table;
+    struct slot_table* table = (struct slot_table*)malloc(sizeof(struct slot_table)
+        + (old_table->count + 1) * sizeof(struct year_slot*));
+    struct year_slot* slot = (struct year_slot*)malloc(sizeof(struct year_slot));
+    if (!table || !slot) {
+        free(table);
+        free(slot);
+        return NULL;
+    }
+
+    slot->year_number = year;
+    slot->node = node;
+    rwlockInit(&slot->lock);
+
+    // copy with the new slot in its sorted place
+    int at = lowerSlot(old_table, year);
+    memcpy(table->slots, old_table->slots, at * sizeof(struct year_slot*));
+    table->slots[at] = slot;
+    memcpy(&table->slots[at + 1], &old_table->slots[at], (old_table->count - at) * sizeof(struct year_slot*));
+    table->count = old_table->count + 1;
+
+    atomicPublishPointer((void* volatile*)&calendar->table, table);
+    if (calendar->epoch) epochRetire(calendar->epoch, old_table, free);
+    else free(old_table);
+
+    return slot;
+}
+
+// slot for a year that's about to get a task, creating the year if needed
+// call with lockForChange held; with per-year locking this briefly swaps to the
+// exclusive index lock, since that's the only way to add a slot
+static struct year_slot* slotForAdd(struct calendar* calendar, int year) {
+
+    struct year_slot* slot = findSlot(calendar->table, year);
+    if (slot) return slot;
+
+    if (!perYear(calendar)) return addSlot(calendar, year);
+
+    rwlockReadDone(&calendar->index_lock);
+    rwlockWrite(&calendar->index_lock);
+
+    // another writer may have created it while we weren't holding anything
+    slot = findSlot(calendar->table, year);
+    if (!slot) slot = addSlot(calendar, year);
+
+    rwlockWriteDone(&calendar->index_lock);
+    rwlockRead(&calendar->index_lock);
+    return slot;
+}
+
+// =====================
+// FILE I/O
+// =====================
+
+// gives any years the list has gained a slot (index write-locked)
+static void addMissingSlots(struct calendar* calendar) {
+    for (struct years* y = calendar->head; y != NULL; y = y->next) {
+        if (!findSlot(calendar->table, y->year_number)) addSlot(calendar, y->year_number);
+    }
+}
+
+int calendarLoad(struct calendar* calendar, const char* filename) {
+
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    // with a pool (or another I/O backend) the file is parsed into a list of its
+    // own first, without any locks, and only the merge is done with everyone locked out
+    if (calendar->options.pool || calendar->options.io != FILE_IO_STDIO) {
+        struct years* parsed;
+        size_t size = 0;
+        int loaded = parseTasksFile(filename, &parsed, messageStream(calendar),
+            calendar->options.pool, calendar->options.io, &size);
+        if (loaded < 0) return -1;
+
+        TRACE_BEGIN(merge_span);
+        lockAll(calendar);
+        mergeYears(&calendar->head, parsed);
+        addMissingSlots(calendar);
+        emitChange(calendar, TASK_EVENT_RELOAD, 0, 0, 0, loaded);
+        unlockAll(calendar);
+        TRACE_END(merge_span, "merge into calendar", "load", "tasks", loaded);
+
+        OP_TIMER_END(timer, OP_LOAD, size);
+        TRACE_END(span, "calendarLoad", "load", "tasks", loaded);
+        return loaded;
+    }
+
+    FILE* fp;
+    fopen_s(&fp, filename, "r");
+    if (!fp) return -1;
+
+    lockAll(calendar);
+
+    int loaded = readTasksFrom(fp, &calendar->head, messageStream(calendar));
+    addMissingSlots(calendar);
+    emitChange(calendar, TASK_EVENT_RELOAD, 0, 0, 0, loaded);
+
+    unlockAll(calendar);
+
+    OP_TIMER_END(timer, OP_LOAD, (unsigned long long)ftell(fp));
+    TRACE_END(span, "calendarLoad", "load", "tasks", loaded);
+    fclose(fp);
+    return loaded;
+}
+
+// a consistent snapshot: every year read-locked (in order) until unlockSnapshot,
+// which keeps writers out (EPOCH writers use the same year locks)
+static void lockSnapshot(struct calendar* calendar) {
+    if (calendar->options.locking != CALENDAR_LOCK_NONE) rwlockRead(&calendar->index_lock);
+
+    struct slot_table* table = calendar->table;
+    if (perYear(calendar)) {
+        for (int i = 0; i < table->count; i++) rwlockRead(&table->slots[i]->lock);
+    }
+}
+
+static void unlockSnapshot(struct calendar* calendar) {
+    struct slot_table* table = calendar->table;
+    if (perYear(calendar)) {
+        for (int i = table->count - 1; i >= 0; i--) rwlockReadDone(&table->slots[i]->lock);
+    }
+    if (calendar->options.locking != CALENDAR_LOCK_NONE) rwlockReadDone(&calendar->index_lock);
+}
+
+int calendarSave(struct calendar* calendar, const char* filename) {
+
+    lockSnapshot(calendar);
+    int saved = calendar->options.io == FILE_IO_STDIO
+        ? saveTasksParallel(filename, calendar->head, calendar->options.pool)
+        : saveTasksAsync(filename, calendar->head, calendar->options.io, calendar->options.pool);
+    unlockSnapshot(calendar);
+    return saved;
+}
+
+int calendarPublishShared(struct calendar* calendar, struct shared_calendar* shared) {
+    lockSnapshot(calendar);
+    int published = publishSharedCalendar(shared, calendar->head);
+    unlockSnapshot(calendar);
+    return published;
+}
+
+// =====================
+// TASK OPS
+// =====================
+
+int calendarAddTask(struct calendar* calendar, int year, int month, int day, const char* desc) {
+
+    OP_TIMER_START(timer);
+    FILE* messages = messageStream(calendar);
+
+    lockForChange(calendar);
+
+    struct year_slot* slot = slotForAdd(calendar, year);
+    if (!slot) {
+        unlockForChange(calendar);
+        OP_TIMER_END(timer, OP_ADD_TASK, 0);
+        return CALENDAR_NO_MEMORY;
+    }
+
+    if (perYear(calendar)) rwlockWrite(&slot->lock);
+    int status = insertTask(slot->node, month, day, desc, messages, messages);
+    // published while the year is still locked, so events for it come out in order
+    if (status == CALENDAR_OK) emitChange(calendar, TASK_EVENT_ADD, year, month, day, lastTaskId(slot->node, month, day));
+    if (perYear(calendar)) rwlockWriteDone(&slot->lock);
+
+    unlockForChange(calendar);
+    OP_TIMER_END(timer, OP_ADD_TASK, desc ? strlen(desc) : 0);
+    return status;
+}
+
+int calendarUpdateTask(struct calendar* calendar, int year, int month, int day, int task_id, const char* new_desc) {
+
+    OP_TIMER_START(timer);
+    FILE* messages = messageStream(calendar);
+
+    lockForChange(calendar);
+
+    struct year_slot* slot = findSlot(calendar->table, year);
+    char* replaced = NULL;
+    int status;
+    if (!slot) {
+        status = editTask(NULL, month, day, task_id, new_desc, messages, messages, NULL);
+    }
+    else {
+        if (perYear(calendar)) rwlockWrite(&slot->lock);
+        status = editTask(slot->node, month, day, task_id, new_desc, messages, messages,
+            calendar->epoch ? &replaced : NULL);
+        if (status == CALENDAR_OK) emitChange(calendar, TASK_EVENT_UPDATE, year, month, day, task_id);
+        if (perYear(calendar)) rwlockWriteDone(&slot->lock);
+    }
+
+    unlockForChange(calendar);
+
+    // lock-free readers may still be reading the old description
+    if (replaced) epochRetire(calendar->epoch, replaced, calendarFree);
+    OP_TIMER_END(timer, OP_UPDATE_TASK, new_desc ? strlen(new_desc) : 0);
+    return status;
+}
+
+// retire callback for a deleted task node and the old nodes after it
+static void freeTaskNodes(void* memory) {
+    freeTaskChain((struct tasks*)memory);
+}
+
+int calendarDeleteTask(struct calendar* calendar, int year, int month, int day, int task_id) {
+
+    OP_TIMER_START(timer);
+    FILE* messages = messageStream(calendar);
+
+    lockForChange(calendar);
+
+    struct year_slot* slot = findSlot(calendar->table, year);
+    struct tasks* removed = NULL;
+    int status;
+    if (!slot) {
+        status = removeTask(NULL, month, day, task_id, messages, messages, NULL);
+    }
+    else {
+        if (perYear(calendar)) rwlockWrite(&slot->lock);
+        status = removeTask(slot->node, month, day, task_id, messages, messages,
+            calendar->epoch ? &removed : NULL);
+        if (status == CALENDAR_OK) emitChange(calendar, TASK_EVENT_DELETE, year, month, day, task_id);
+        if (perYear(calendar)) rwlockWriteDone(&slot->lock);
+    }
+
+    unlockForChange(calendar);
+
+    // lock-free readers may still be standing on the node
+    if (removed) epochRetire(calendar->epoch, removed, freeTaskNodes);
+    OP_TIMER_END(timer, OP_DELETE_TASK, 0);
+    return status;
+}
+
+int calendarCountTasks(struct calendar* calendar, int year, int month, int day) {
+
+    int ticket = beginRead(calendar);
+
+    struct year_slot* slot = findSlot(currentTable(calendar), year);
+    int count = 0;
+    if (slot && month >= 1 && month <= 12) {
+        if (perYearReads(calendar)) rwlockRead(&slot->lock);
+
+        struct months* month_node = &slot->node->months[month - 1];
+        if (day >= 1 && day <= month_node->num_days) {
+            struct tasks* const* link = &monthDays(month_node)[day - 1].tasks_head;
+            struct tasks* t;
+            while ((t = (struct tasks*)atomicReadPointer((void* volatile*)link)) != NULL) {
+                count++;
+                link = &t->next;
+            }
+        }
+
+        if (perYearReads(calendar)) rwlockReadDone(&slot->lock);
+    }
+
+    endRead(calendar, ticket);
+    return count;
+}
+
+// =====================
+// READS
+// =====================
+
+// remembers whether the caller's callback asked to stop, so a per-year walk
+// knows not to carry on into the next year
+struct guarded_walk {
+    TaskMatchFn on_task;
+    void* user_data;
+    int stopped;
+};
+
+static int guardedCall(const struct task_match* match, void* user_data) {
+    struct guarded_walk* walk = (struct guarded_walk*)user_data;
+    if (!walk->on_task(match, walk->user_data)) {
+        walk->stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+int calendarForEachInRange(struct calendar* calendar,
+    int from_year, int from_month, int from_day,
+    int to_year, int to_month, int to_day,
+    TaskMatchFn on_task, void* user_data) {
+
+    if (!on_task) return 0;
+
+    int ticket = beginRead(calendar);
+
+    if (!perYear(calendar)) {
+        int reported = forEachTaskInRange(calendar->head, from_year, from_month, from_day,
+            to_year, to_month, to_day, on_task, user_data);
+        endRead(calendar, ticket);
+        return reported;
+    }
+
+    // one year at a time (each under its own read lock with PER_YEAR); the range is
+    // split so every call stays inside one year
+    struct guarded_walk walk = { on_task, user_data, 0 };
+    struct slot_table* table = currentTable(calendar);
+    int reported = 0;
+
+    for (int i = lowerSlot(table, from_year); i < table->count && !walk.stopped; i++) {
+        struct year_slot* slot = table->slots[i];
+        int year = slot->year_number;
+        if (year > to_year) break;
+
+        if (perYearReads(calendar)) rwlockRead(&slot->lock);
+        if (slot->node->task_count > 0) {
+            reported += forEachTaskInRange(slot->node,
+                year, year == from_year ? from_month : 1, year == from_year ? from_day : 1,
+                year, year == to_year ? to_month : 12, year == to_year ? to_day : 31,
+                guardedCall, &walk);
+        }
+        if (perYearReads(calendar)) rwlockReadDone(&slot->lock);
+    }
+
+    endRead(calendar, ticket);
+    return reported;
+}
+
+// keyword filter in front of the caller's callback (see searchTasksEach)
+struct context_search {
+    const char* keyword;
+    int limit;
+    int reported;
+    TaskMatchFn on_match;
+    void* user_data;
+};
+
+static int searchFilter(const struct task_match* match, void* user_data) {
+    struct context_search* search = (struct context_search*)user_data;
+
+    if (!containsIgnoreCase(match->task->task_description, search->keyword)) return 1;
+
+    search->reported++;
+    if (!search->on_match(match, search->user_data)) return 0;
+    return !(search->limit > 0 && search->reported >= search->limit);
+}
+
+int calendarSearch(struct calendar* calendar, const char* keyword, int limit,
+    TaskMatchFn on_match, void* user_data) {
+
+    if (!keyword || keyword[0] == '\0' || !on_match) return 0;
+
+    // pooled: months are searched on the pool, all at once, so every year is
+    // read-locked for the whole search (EPOCH readers still need no locks)
+    if (calendar->options.pool) {
+        int ticket = 0;
+        if (calendar->options.locking == CALENDAR_LOCK_EPOCH) ticket = beginRead(calendar);
+        else lockSnapshot(calendar);
+
+        int reported = searchTasksParallel(calendar->head, keyword, limit, on_match, user_data, calendar->options.pool);
+
+        if (calendar->options.locking == CALENDAR_LOCK_EPOCH) endRead(calendar, ticket);
+        else unlockSnapshot(calendar);
+        return reported;
+    }
+
+    // (the pooled search above counts itself)
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+    struct context_search search = { keyword, limit, 0, on_match, user_data };
+    calendarForEachInRange(calendar, INT_MIN, 1, 1, INT_MAX, 12, 31, searchFilter, &search);
+    OP_TIMER_END(timer, OP_SEARCH, strlen(keyword));
+    TRACE_END(span, "calendarSearch", "search", "hits", search.reported);
+    return search.reported;
+}
+
+// =====================
+// VIEWS
+// =====================
+
+void calendarPrintMonth(struct calendar* calendar, int year, int month) {
+
+    int ticket = beginRead(calendar);
+    struct year_slot* slot = findSlot(currentTable(calendar), year);
+
+    // the view only looks at the year it's given, so the slot's node works as a head
+    if (slot && perYearReads(calendar)) rwlockRead(&slot->lock);
+    printTasksForMonthPretty(slot ? slot->node : NULL, year, month);
+    if (slot && perYearReads(calendar)) rwlockReadDone(&slot->lock);
+
+    endRead(calendar, ticket);
+}
+
+void calendarPrintYear(struct calendar* calendar, int year) {
+
+    int ticket = beginRead(calendar);
+    struct year_slot* slot = findSlot(currentTable(calendar), year);
+
+    if (slot && perYearReads(calendar)) rwlockRead(&slot->lock);
+    printTasksForYearPretty(slot ? slot->node : NULL, year);
+    if (slot && perYearReads(calendar)) rwlockReadDone(&slot->lock);
+
+    endRead(calendar, ticket);
+}
+
+int calendarRenderMonth(struct calendar* calendar, struct render_buffer* buffer, int year, int month) {
+
+    int ticket = beginRead(calendar);
+    struct year_slot* slot = findSlot(currentTable(calendar), year);
+
+    if (slot && perYearReads(calendar)) rwlockRead(&slot->lock);
+    int rendered = renderMonthCalendar(buffer, slot ? slot->node : NULL, year, month);
+    if (slot && perYearReads(calendar)) rwlockReadDone(&slot->lock);
+
+    endRead(calendar, ticket);
+    return rendered;
+}
+
+int calendarRenderYear(struct calendar* calendar, struct render_buffer* buffer, int year) {
+
+    int ticket = beginRead(calendar);
+    struct year_slot* slot = findSlot(currentTable(calendar), year);
+
+    if (slot && perYearReads(calendar)) rwlockRead(&slot->lock);
+    int rendered = renderYearCalendar(buffer, slot ? slot->node : NULL, year);
+    if (slot && perYearReads(calendar)) rwlockReadDone(&slot->lock);
+
+    endRead(calendar, ticket);
+    return rendered;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef CALENDAR_CONTEXT_H
+#define CALENDAR_CONTEXT_H
+
+#include <stdio.h>
+
+#include "AsyncFile.h"
+#include "Calendar.h"
+#include "SharedCalendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // A calendar that can be shared between threads.
+    //
+    // The context owns its years (plus a sorted index of them for lookups) and its
+    // own options, so nothing depends on process-wide state. How much locking it
+    // does is picked when it's created:
+    // - CALENDAR_LOCK_NONE      single-threaded use, no locking at all
+    // - CALENDAR_LOCK_GLOBAL    one reader-writer lock for the whole calendar
+    // - CALENDAR_LOCK_PER_YEAR  a reader-writer lock per year, so readers and
+    //                           writers working on different years don't wait on
+    //                           each other (the index lock is only taken exclusively
+    //                           when a new year gets created, or for load)
+    // - CALENDAR_LOCK_EPOCH     readers take no locks at all; writers lock per year
+    //                           and publish their changes atomically, and anything
+    //                           they unlink (deleted tasks, replaced descriptions)
+    //                           is freed only after every reader that might still
+    //                           see it has left (see Epoch.h)
+    //
+    // Callbacks run while the calendar is read-locked: they can look at the task
+    // nodes they're given but must not call back into the same context to change it
+    // (except with CALENDAR_LOCK_EPOCH, where readers hold no locks). With EPOCH a
+    // reader sees each day's list either before or after a change, never half of it.
+    struct calendar;
+    struct event_ring;
+    struct render_buffer;
+
+    enum calendar_lock_policy {
+        CALENDAR_LOCK_NONE,
+        CALENDAR_LOCK_GLOBAL,
+        CALENDAR_LOCK_PER_YEAR,
+        CALENDAR_LOCK_EPOCH
+    };
+
+    struct calendar_options {
+        int silent;                         // 1 = no messages at all, just return codes
+        FILE* output;                       // where messages go (NULL = stdout)
+        enum calendar_lock_policy locking;
+        struct work_pool* pool;             // spreads load / save / search over it (NULL = serial; not owned)
+        enum file_io_backend io;            // how load / save reach the file (AsyncFile.h)
+        struct event_ring* events;          // where this calendar's changes are published (EventRing.h;
+                                            // NULL = nowhere; not owned, must outlive the calendar)
+    };
+
+    // defaults: messages on stdout, per-year locking, no work pool, stdio, no events
+    void initCalendarOptions(struct calendar_options* options);
+
+    // options can be NULL for the defaults; returns NULL if memory runs out
+    struct calendar* createCalendar(const struct calendar_options* options);
+    void destroyCalendar(struct calendar* calendar);
+
+    // the ring from the options (NULL if none)
+    struct event_ring* calendarEventRing(struct calendar* calendar);
+
+    // adds the tasks from a tasks.txt style file; returns how many, or -1 if it can't be opened
+    int calendarLoad(struct calendar* calendar, const char* filename);
+    // returns 1 on success, 0 if the file can't be written (same as saveTasks)
+    int calendarSave(struct calendar* calendar, const char* filename);
+    // publishes the calendar for readers in other processes (SharedCalendar.h),
+    // holding off writers meanwhile; 1 on success
+    int calendarPublishShared(struct calendar* calendar, struct shared_calendar* shared);
+
+    // task ops, all return an enum calendar_status
+    int calendarAddTask(struct calendar* calendar, int year, int month, int day, const char* desc);
+    int calendarUpdateTask(struct calendar* calendar, int year, int month, int day, int task_id, const char* new_desc);
+    int calendarDeleteTask(struct calendar* calendar, int year, int month, int day, int task_id);
+
+    // tasks on one day (0 if the date isn't loaded)
+    int calendarCountTasks(struct calendar* calendar, int year, int month, int day);
+
+    // same contracts as forEachTaskInRange / searchTasksEach
+    int calendarForEachInRange(struct calendar* calendar,
+        int from_year, int from_month, int from_day,
+        int to_year, int to_month, int to_day,
+        TaskMatchFn on_task, void* user_data);
+    int calendarSearch(struct calendar* calendar, const char* keyword, int limit,
+        TaskMatchFn on_match, void* user_data);
+
+    // the compact month / year views (printed to stdout)
+    void calendarPrintMonth(struct calendar* calendar, int year, int month);
+    void calendarPrintYear(struct calendar* calendar, int year);
+
+    // the month grid / year calendar into a render buffer (Render.h); flushing
+    // is left to the caller, so several views can go out in one write
+    int calendarRenderMonth(struct calendar* calendar, struct render_buffer* buffer, int year, int month);
+    int calendarRenderYear(struct calendar* calendar, struct render_buffer* buffer, int year);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
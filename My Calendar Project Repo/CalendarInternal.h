@@ -0,0 +1,154 @@
+#pragma once
+#ifndef CALENDAR_INTERNAL_H
+#define CALENDAR_INTERNAL_H
+
+#include <stdio.h>
+
+#include "AsyncFile.h"
+#include "Calendar.h"
+#include "MemStats.h"
+#include "OpStats.h"
+#include "Trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    struct work_pool;
+
+    // times one call of an operation for OpStats.h (needs Platform.h); with
+    // CALENDAR_NO_STATS both expand to nothing, bytes expression included
+#ifdef CALENDAR_NO_STATS
+#define OP_TIMER_START(timer)
+#define OP_TIMER_END(timer, op, bytes)
+#else
+#define OP_TIMER_START(timer) long long timer = platformNowNanos()
+#define OP_TIMER_END(timer, op, bytes) recordOp((op), platformNowNanos() - (timer), (bytes))
+#endif
+
+    // a Trace.h span around a phase: TRACE_RESTART starts an ended span over
+    // (for one span per section of a loop); also gone with CALENDAR_NO_STATS
+#ifdef CALENDAR_NO_STATS
+#define TRACE_BEGIN(span)
+#define TRACE_RESTART(span) ((void)0)
+#define TRACE_END(span, name, category, arg_name, arg) ((void)0)
+#else
+#define TRACE_BEGIN(span) long long span = traceBegin()
+#define TRACE_RESTART(span) (span) = traceBegin()
+#define TRACE_END(span, name, category, arg_name, arg) traceEnd((span), (name), (category), (arg_name), (arg))
+#endif
+
+    // the calendar's own memory (year skeletons, tasks, descriptions) goes through
+    // these so MemStats.h can say which year and kind it belongs to; text is how
+    // many of the size bytes are a description kept in a block of another kind
+    // (a task node's own text). Blocks from calendarAlloc must be freed with
+    // calendarFree, and nothing else may be.
+    void* calendarAlloc(int kind, int year, size_t size, size_t text);
+    void calendarFree(void* memory);
+
+    // A month's days start out as one shared, read-only empty array. Anything
+    // that links a task into a month asks for its own array first (allocated
+    // and published on the first call, NULL when out of memory); freeMonthDays
+    // frees it, if there is one.
+    struct days* monthDaysForWrite(struct years* year_node, struct months* month_node);
+    // the month's day array for readers that may hold no lock (CALENDAR_LOCK_EPOCH):
+    // read with acquire, so a freshly published array is seen zeroed; const, as
+    // it may be the shared empty one
+    const struct days* monthDays(const struct months* month_node);
+    int monthHasOwnDays(const struct months* month_node);
+    void freeMonthDays(struct months* month_node);
+
+    // stamps a year as changed (calendarGeneration moves on); returns the new generation
+    unsigned long long markYearChanged(struct years* year_node);
+
+    // task nodes are allocated together with their description; always free them
+    // with freeTask (the description may or may not be a separate block)
+    struct tasks* allocTask(int year, const char* desc);
+    void freeTask(struct tasks* task);
+    // frees task and every task after it (following next)
+    void freeTaskChain(struct tasks* task);
+
+    // Core task ops on a year node the caller already holds, shared by Source.c and
+    // the modules layered on top of it (not part of the public API).
+    //
+    // Messages go to the given streams instead of always stdout: "errors" gets the
+    // failure lines, "info" the "Task added" / "Updated" / "Deleted" lines.
+    // Either can be NULL to stay quiet. All return an enum calendar_status.
+    //
+    // List changes are published atomically (new nodes are complete before they're
+    // linked). editTask / removeTask free what they replace or unlink, unless
+    // "replaced" / "removed" is given: then it's handed back instead, for callers
+    // that have to wait until no reader can still be looking at it (*replaced is
+    // NULL when the old text was part of the node). With "removed", the later tasks
+    // of the day are replaced by renumbered copies instead of renumbered in place,
+    // and *removed still leads (through next) to the old ones: free them all with
+    // freeTaskChain.
+    int insertTask(struct years* year_node, int month, int day, const char* desc, FILE* errors, FILE* info);
+    int editTask(struct years* year_node, int month, int day, int task_id, const char* new_desc,
+        FILE* errors, FILE* info, char** replaced);
+    int removeTask(struct years* year_node, int month, int day, int task_id,
+        FILE* errors, FILE* info, struct tasks** removed);
+
+    // compact views (print to stdout)
+    void printTasksForMonthPretty(struct years* calendar_head, int year, int month);
+    void printTasksForYearPretty(struct years* calendar_head, int year);
+
+    // "month day description" from a tasks file line; returns the fields read (2 = no description)
+    int parseTaskLine(const char* line, int* month, int* day, char* desc);
+
+    // the interactive menu loop (Main.c runs it when there are no arguments)
+    void menu(struct years** calendar_head);
+
+    // id of the last task on a day (0 if none); the date must be valid
+    int lastTaskId(struct years* year_node, int month, int day);
+
+    // state for the compact month / year views: which day / month line we're on,
+    // so tasks from the same day end up comma-separated on one line
+    struct compact_printer {
+        FILE* output;
+        int last_month;
+        int last_day;
+        int print_month_headers;
+    };
+
+    // prints one task of a compact view (a TaskMatchFn, user_data = compact_printer)
+    int printCompactTask(const struct task_match* match, void* user_data);
+
+    // publishes to the ring set with setTaskEventRing, if any (EventRing.h);
+    // for the plain functions, a context publishes to its own ring
+    void emitTaskEvent(int type, int year, int month, int day, int task_id);
+
+    // reads tasks.txt formatted text from fp into *calendar_head (adding to what's
+    // already there); returns how many tasks were added
+    int readTasksFrom(FILE* fp, struct years** calendar_head, FILE* errors);
+
+    // Pieces of the pooled whole-calendar ops (CalendarParallel.c), for modules
+    // that hold their own locks around them.
+
+    // a month that has tasks, with its year node
+    struct month_key {
+        struct years* year_node;
+        int year;
+        int month;
+    };
+
+    // every month with tasks, in date order (*months is malloc'd, NULL when there
+    // are none); returns the count, or -1 if memory runs out
+    int listTaskMonths(struct years* calendar_head, struct month_key** months);
+
+    // parses a tasks.txt file (read through backend) into a new year list of its
+    // own (no locks needed, nothing shared is touched); returns how many tasks, or
+    // -1 if it can't be read
+    int parseTasksFile(const char* filename, struct years** parsed, FILE* errors,
+        struct work_pool* pool, enum file_io_backend backend, size_t* bytes_read);
+
+    // moves every year of source into *calendar_head: new years are linked in,
+    // tasks for years already there go after the ones they have (ids continue).
+    // Changes are published like insertTask's. source is used up.
+    void mergeYears(struct years** calendar_head, struct years* source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
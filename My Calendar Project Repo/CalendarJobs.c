@@ -0,0 +1,328 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalendarInternal.h"
+#include "CalendarJobs.h"
+#include "Platform.h"
+
+// a year the job will walk, as it was when the job started
+struct year_stamp {
+    int year;
+    unsigned long long generation;
+};
+
+enum job_kind {
+    JOB_SEARCH,
+    JOB_SAVE,
+    JOB_YEAR_VIEW
+};
+
+struct calendar_job {
+    enum job_kind kind;
+    int status;
+    volatile long cancelled;
+    unsigned long long generation;      // calendarGeneration() when the years were last checked
+    struct year_stamp* years;           // the years to walk, in list order
+    int year_count;
+    int stamp;                          // years[stamp] is the one the walk is in
+    long progress;
+    long result;
+
+    // where the walk is: the next task to hand out is "task", on day_node; after
+    // that come the days in days_left, then the rest of the months / years
+    struct years* year;
+    int last_year;
+    int month;                          // 1-12, 0 = year not entered yet
+    unsigned int days_left;
+    struct days* day_node;
+    int day;
+    struct tasks* task;
+
+    // JOB_SEARCH
+    char* keyword;
+    int limit;
+    TaskMatchFn on_match;
+    void* user_data;
+
+    // JOB_SAVE
+    FILE* file;
+    char* filename;
+    char* temp_file;
+
+    // JOB_YEAR_VIEW
+    struct compact_printer printer;
+    int year_number;
+};
+
+static struct calendar_job* newJob(enum job_kind kind, struct years* first_year, int last_year) {
+
+    struct calendar_job* job = (struct calendar_job*)calloc(1, sizeof(struct calendar_job));
+    if (!job) return NULL;
+
+    job->kind = kind;
+    job->status = JOB_RUNNING;
+    job->generation = calendarGeneration();
+    job->year = first_year;
+    job->last_year = last_year;
+
+    int count = 0;
+    for (struct years* y = first_year; y && y->year_number <= last_year; y = y->next) count++;
+    job->years = (struct year_stamp*)malloc((count > 0 ? count : 1) * sizeof(struct year_stamp));
+    if (!job->years) {
+        free(job);
+        return NULL;
+    }
+    for (struct years* y = first_year; y && y->year_number <= last_year; y = y->next) {
+        job->years[job->year_count].year = y->year_number;
+        job->years[job->year_count].generation = y->generation;
+        job->year_count++;
+    }
+    return job;
+}
+
+// the years still to walk are the ones the job started with and none of them
+// has changed since (the walk holds task nodes in the current one); changes to
+// other calendars, or to years already walked, don't matter
+static int yearsUnchanged(struct calendar_job* job) {
+    int i = job->stamp;
+    for (struct years* y = job->year; y && y->year_number <= job->last_year; y = y->next, i++) {
+        if (i == job->year_count) return 0;
+        if (job->years[i].year != y->year_number || job->years[i].generation != y->generation) return 0;
+    }
+    return i == job->year_count;
+}
+
+// =====================
+// THE WALK
+// =====================
+// Same order as forEachTaskInRange: years, months, occupied days, tasks.
+
+// moves to the next month that has tasks; 0 when there's none left
+static int nextMonth(struct calendar_job* job) {
+
+    while (job->year) {
+        if (job->month == 0) {
+            // a save writes every year's header, even for years with no tasks
+            if (job->kind == JOB_SAVE) fprintf(job->file, "[YEAR] %d\n", job->year->year_number);
+            if (job->year->task_count == 0) job->month = 12;
+        }
+
+        if (job->month < 12) {
+            struct months* month_node = &job->year->months[job->month++];
+            if (month_node->task_count == 0) continue;
+            job->days_left = month_node->occupied_days;
+            return 1;
+        }
+
+        job->month = 0;
+        job->stamp++;
+        job->year = job->year->next;
+        if (job->year && job->year->year_number > job->last_year) job->year = NULL;
+    }
+    return 0;
+}
+
+// the next task in date order; 0 at the end of the walk
+static int nextTask(struct calendar_job* job, struct task_match* match) {
+
+    while (!job->task) {
+        if (job->days_left == 0) {
+            if (!nextMonth(job)) return 0;
+            continue;
+        }
+
+        int d = 0;
+        while (!(job->days_left & (1u << d))) d++;
+        job->days_left &= job->days_left - 1;
+
+        job->day = d + 1;
+        job->day_node = &job->year->months[job->month - 1].days[d];
+        job->task = job->day_node->tasks_head;
+    }
+
+    match->year = job->year->year_number;
+    match->month = job->month;
+    match->day = job->day;
+    match->day_node = job->day_node;
+    match->task = job->task;
+    job->task = job->task->next;
+    return 1;
+}
+
+// =====================
+// JOBS
+// =====================
+
+struct calendar_job* startSearchJob(struct years* calendar_head, const char* keyword, int limit,
+    TaskMatchFn on_match, void* user_data) {
+
+    struct calendar_job* job = newJob(JOB_SEARCH, calendar_head, INT_MAX);
+    if (!job) return NULL;
+
+    // nothing to look for: done before it starts, like searchTasksEach
+    if (!keyword || keyword[0] == '\0' || !on_match) {
+        job->status = JOB_DONE;
+        return job;
+    }
+
+    // the caller's string may not outlive the first step
+    size_t length = strlen(keyword);
+    job->keyword = (char*)malloc(length + 1);
+    if (!job->keyword) {
+        free(job->years);
+        free(job);
+        return NULL;
+    }
+    memcpy(job->keyword, keyword, length + 1);
+
+    job->limit = limit;
+    job->on_match = on_match;
+    job->user_data = user_data;
+    return job;
+}
+
+struct calendar_job* startSaveJob(struct years* calendar_head, const char* filename) {
+
+    struct calendar_job* job = newJob(JOB_SAVE, calendar_head, INT_MAX);
+    if (!job) return NULL;
+
+    size_t length = strlen(filename);
+    job->filename = (char*)malloc(length + 1);
+    job->temp_file = (char*)malloc(length + 5);
+    if (job->filename && job->temp_file) {
+        memcpy(job->filename, filename, length + 1);
+        memcpy(job->temp_file, filename, length);
+        memcpy(job->temp_file + length, ".tmp", 5);
+        fopen_s(&job->file, job->temp_file, "w");
+    }
+
+    if (!job->file) {
+        free(job->filename);
+        free(job->temp_file);
+        free(job->years);
+        free(job);
+        return NULL;
+    }
+    return job;
+}
+
+struct calendar_job* startYearViewJob(struct years* calendar_head, int year, FILE* output) {
+
+    struct years* year_node = findYear(calendar_head, year);
+    struct calendar_job* job = newJob(JOB_YEAR_VIEW, year_node, year);
+    if (!job) return NULL;
+
+    job->year_number = year;
+    job->printer.output = output ? output : stdout;
+    job->printer.print_month_headers = 1;
+
+    if (!year_node) {
+        fprintf(job->printer.output, "No data for year %d.\n", year);
+        job->status = JOB_DONE;
+        return job;
+    }
+
+    fprintf(job->printer.output, "\n=== Tasks for %d ===\n", year);
+    return job;
+}
+
+// one task of a job; 0 when the job is finished early (search stopped)
+static int visitTask(struct calendar_job* job, const struct task_match* match) {
+
+    switch (job->kind) {
+    case JOB_SEARCH:
+        if (!containsIgnoreCase(match->task->task_description, job->keyword)) return 1;
+        job->result++;
+        if (!job->on_match(match, job->user_data)) return 0;
+        return !(job->limit > 0 && job->result >= job->limit);
+
+    case JOB_SAVE:
+        fprintf(job->file, "%d %d %s\n", match->month, match->day, match->task->task_description);
+        job->result++;
+        return 1;
+
+    case JOB_YEAR_VIEW:
+        printCompactTask(match, &job->printer);
+        job->result++;
+        return 1;
+    }
+    return 0;
+}
+
+// wraps the job up (closing / renaming / removing the file, the view's last lines)
+static int endJob(struct calendar_job* job, int status) {
+
+    if (job->kind == JOB_SAVE) {
+        int written = !ferror(job->file);
+        written = fclose(job->file) == 0 && written;
+        job->file = NULL;
+
+        if (status == JOB_DONE && !(written && platformReplaceFile(job->temp_file, job->filename))) status = JOB_FAILED;
+        if (status != JOB_DONE) remove(job->temp_file);
+    }
+
+    if (job->kind == JOB_YEAR_VIEW && status == JOB_DONE) {
+        if (job->result > 0) fprintf(job->printer.output, "\n");
+        else fprintf(job->printer.output, "No tasks stored for %d.\n", job->year_number);
+        fprintf(job->printer.output, "\n");
+    }
+
+    job->status = status;
+    return status;
+}
+
+int stepJob(struct calendar_job* job, int budget) {
+
+    if (job->status != JOB_RUNNING) return job->status;
+    if (atomicLoadLong(&job->cancelled)) return endJob(job, JOB_CANCELLED);
+    // something changed somewhere: the task nodes the walk holds may be gone
+    unsigned long long generation = calendarGeneration();
+    if (generation != job->generation) {
+        if (!yearsUnchanged(job)) return endJob(job, JOB_FAILED);
+        job->generation = generation;
+    }
+
+    if (budget < 1) budget = 1;
+
+    struct task_match match;
+    for (int i = 0; i < budget; i++) {
+        if (!nextTask(job, &match)) return endJob(job, JOB_DONE);
+        job->progress++;
+        if (!visitTask(job, &match)) return endJob(job, JOB_DONE);
+        if (atomicLoadLong(&job->cancelled)) return endJob(job, JOB_CANCELLED);
+    }
+    return JOB_RUNNING;
+}
+
+int finishJob(struct calendar_job* job, int budget) {
+    while (stepJob(job, budget) == JOB_RUNNING) {}
+    return job->status;
+}
+
+void cancelJob(struct calendar_job* job) {
+    atomicStoreLong(&job->cancelled, 1);
+}
+
+int jobStatus(struct calendar_job* job) {
+    return job->status;
+}
+
+long jobProgress(struct calendar_job* job) {
+    return job->progress;
+}
+
+long jobResult(struct calendar_job* job) {
+    return job->result;
+}
+
+void freeJob(struct calendar_job* job) {
+    if (!job) return;
+    if (job->status == JOB_RUNNING) endJob(job, JOB_CANCELLED);
+    free(job->years);
+    free(job->keyword);
+    free(job->filename);
+    free(job->temp_file);
+    free(job);
+}
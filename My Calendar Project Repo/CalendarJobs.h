@@ -0,0 +1,70 @@
+#pragma once
+#ifndef CALENDAR_JOBS_H
+#define CALENDAR_JOBS_H
+
+#include <stdio.h>
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Resumable versions of the whole-calendar operations, for callers with an
+    // event loop that can't be blocked while a big calendar is searched, saved or
+    // printed.
+    //
+    // start*Job sets a job up without doing any of the work; each stepJob then
+    // does a bit of it (at most "budget" tasks) and returns, remembering where it
+    // got to. Driving a job with stepJob until it isn't JOB_RUNNING gives exactly
+    // what the blocking version gives: the same matches in the same order, the
+    // same file, the same text.
+    //
+    // The years a job walks must not change while it is unfinished (the job holds
+    // on to task nodes between steps). If one does, or a year is added among
+    // them, the next step notices (the year's generation moved) and the job ends
+    // with JOB_FAILED instead of reading freed memory. Changes to other calendars,
+    // or to years the job has already finished, don't stop it. Free the job
+    // before the calendar.
+    //
+    // cancelJob can be called from anywhere, including another thread or a
+    // callback the job is running; the job stops before its next task. A cancelled or
+    // failed save leaves the file as it was: saves go to "<file>.tmp", which only
+    // replaces the file once the last task is written.
+    struct calendar_job;
+
+    enum job_status {
+        JOB_RUNNING,
+        JOB_DONE,
+        JOB_CANCELLED,
+        JOB_FAILED                  // the calendar changed, or a write failed
+    };
+
+    // searchTasksEach, a step at a time (on_match can return 0 to stop, as there)
+    struct calendar_job* startSearchJob(struct years* calendar_head, const char* keyword, int limit,
+        TaskMatchFn on_match, void* user_data);
+    // saveTasks; NULL if the temporary file can't be created
+    struct calendar_job* startSaveJob(struct years* calendar_head, const char* filename);
+    // printTasksForYearPretty, into output instead of stdout
+    struct calendar_job* startYearViewJob(struct years* calendar_head, int year, FILE* output);
+
+    // does up to budget tasks' worth of work (budget < 1 counts as 1); returns an enum job_status
+    int stepJob(struct calendar_job* job, int budget);
+    // runs the job to the end, budget tasks at a time; returns the final status
+    int finishJob(struct calendar_job* job, int budget);
+    void cancelJob(struct calendar_job* job);
+
+    int jobStatus(struct calendar_job* job);
+    // tasks looked at so far
+    long jobProgress(struct calendar_job* job);
+    // search: matches reported; save / year view: tasks written
+    long jobResult(struct calendar_job* job);
+
+    // an unfinished job is cancelled first
+    void freeJob(struct calendar_job* job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
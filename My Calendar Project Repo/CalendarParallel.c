@@ -0,0 +1,550 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AsyncFile.h"
+#include "Calendar.h"
+#include "CalendarInternal.h"
+#include "EventRing.h"
+#include "Platform.h"
+#include "WorkPool.h"
+
+// readTasksFrom reads with fgets into this much, so lines are cut the same way here
+#define LOAD_LINE_SIZE 512
+// smallest piece of a file worth parsing on its own
+#define LOAD_CHUNK_MIN (64 * 1024)
+
+// =====================
+// MONTH LIST
+// =====================
+// whole-calendar work is split by month: every month with tasks is one piece
+
+int listTaskMonths(struct years* calendar_head, struct month_key** months) {
+
+    int count = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        if (y->task_count == 0) continue;
+        for (int m = 0; m < 12; m++) {
+            if (y->months[m].task_count > 0) count++;
+        }
+    }
+
+    *months = NULL;
+    if (count == 0) return 0;
+
+    *months = (struct month_key*)malloc(count * sizeof(struct month_key));
+    if (!*months) return -1;
+
+    int at = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        if (y->task_count == 0) continue;
+        for (int m = 0; m < 12; m++) {
+            if (y->months[m].task_count == 0) continue;
+            (*months)[at].year_node = y;
+            (*months)[at].year = y->year_number;
+            (*months)[at].month = m + 1;
+            at++;
+        }
+    }
+    return count;
+}
+
+// every task of one month, through the year node (it works as a list head)
+static void forEachTaskInMonth(const struct month_key* key, TaskMatchFn on_task, void* user_data) {
+    forEachTaskInRange(key->year_node, key->year, key->month, 1, key->year, key->month, 31, on_task, user_data);
+}
+
+// =====================
+// LOAD
+// =====================
+
+// one piece of the file, parsed into a year list of its own
+struct load_chunk {
+    const char* begin;
+    const char* end;
+    int has_year;               // a [YEAR] line came before the chunk...
+    int year;                   // ...and this is the year it set
+    struct years* parsed;
+    int loaded;
+};
+
+struct parallel_load {
+    struct load_chunk* chunks;
+    FILE* errors;
+};
+
+// end of the line starting at "at", cut the way fgets(line, LOAD_LINE_SIZE) cuts it
+static const char* lineEnd(const char* at, const char* end) {
+    size_t room = (size_t)(end - at);
+    if (room > LOAD_LINE_SIZE - 1) room = LOAD_LINE_SIZE - 1;
+
+    const char* newline = (const char*)memchr(at, '\n', room);
+    return newline ? newline + 1 : at + room;
+}
+
+// the [YEAR] check readTasksFrom does (line is NUL-terminated)
+static int readYearMarker(const char* line, int* year) {
+    return line[0] == '[' && sscanf_s(line, "[YEAR] %d", year) == 1;
+}
+
+// same rules as readTasksFrom, on one chunk
+static void parseChunk(struct load_chunk* chunk, FILE* errors) {
+
+    TRACE_BEGIN(span);
+    char line[LOAD_LINE_SIZE];
+    struct years* year_node = chunk->has_year ? findOrAddYear(&chunk->parsed, chunk->year) : NULL;
+
+    const char* at = chunk->begin;
+    while (at < chunk->end) {
+        const char* next = lineEnd(at, chunk->end);
+        size_t length = (size_t)(next - at);
+        memcpy(line, at, length);
+        line[length] = '\0';
+        at = next;
+
+        int year;
+        if (readYearMarker(line, &year)) {
+            year_node = findOrAddYear(&chunk->parsed, year);
+        }
+        else if (year_node != NULL) {
+            int month, day;
+            char desc[DESC_LEN] = "";
+
+            if (parseTaskLine(line, &month, &day, desc) >= 2) {
+                if (insertTask(year_node, month, day, desc, errors, NULL) == CALENDAR_OK) {
+                    chunk->loaded++;
+                }
+            }
+        }
+    }
+    TRACE_END(span, "parse chunk", "load", "tasks", chunk->loaded);
+}
+
+static void parseChunks(int begin, int end, void* arg) {
+    struct parallel_load* load = (struct parallel_load*)arg;
+    for (int i = begin; i < end; i++) parseChunk(&load->chunks[i], load->errors);
+}
+
+int parseTasksFile(const char* filename, struct years** parsed, FILE* errors,
+    struct work_pool* pool, enum file_io_backend backend, size_t* bytes_read) {
+
+    *parsed = NULL;
+
+    TRACE_BEGIN(read_span);
+    size_t size;
+    char* data = readFileWith(filename, &size, backend);
+    if (!data) return -1;
+    if (bytes_read) *bytes_read = size;
+    TRACE_END(read_span, "read file", "load", "bytes", (long long)size);
+
+    // chunks of roughly equal size, cut at line starts; a quick pass notes the
+    // year in effect at each cut, so chunks can be parsed in any order
+    size_t target = size / ((size_t)workPoolThreads(pool) * 4);
+    if (target < LOAD_CHUNK_MIN) target = LOAD_CHUNK_MIN;
+
+    int capacity = (int)(size / target) + 2;
+    struct load_chunk* chunks = (struct load_chunk*)calloc(capacity, sizeof(struct load_chunk));
+    if (!chunks) {
+        free(data);
+        return -1;
+    }
+
+    TRACE_BEGIN(split_span);
+    const char* end = data + size;
+    int count = 0, has_year = 0, year = 0;
+    char line[LOAD_LINE_SIZE];
+
+    chunks[0].begin = data;
+    for (const char* at = data; at < end; ) {
+        if ((size_t)(at - chunks[count].begin) >= target && count + 1 < capacity) {
+            chunks[count].end = at;
+            count++;
+            chunks[count].begin = at;
+            chunks[count].has_year = has_year;
+            chunks[count].year = year;
+        }
+
+        const char* next = lineEnd(at, end);
+        if (*at == '[') {
+            size_t length = (size_t)(next - at);
+            memcpy(line, at, length);
+            line[length] = '\0';
+            if (readYearMarker(line, &year)) has_year = 1;
+        }
+        at = next;
+    }
+    chunks[count].end = end;
+    count++;
+    TRACE_END(split_span, "split into chunks", "load", "chunks", count);
+
+    struct parallel_load load = { chunks, errors };
+    parallelFor(pool, count, 1, parseChunks, &load);
+
+    // stitch the chunks together in file order
+    TRACE_BEGIN(merge_span);
+    int loaded = 0;
+    for (int i = 0; i < count; i++) {
+        mergeYears(parsed, chunks[i].parsed);
+        loaded += chunks[i].loaded;
+    }
+    TRACE_END(merge_span, "merge chunks", "load", "chunks", count);
+
+    free(chunks);
+    free(data);
+    return loaded;
+}
+
+// frees a year node whose tasks have all been moved out
+static void freeEmptyYear(struct years* year_node) {
+    for (int m = 0; m < 12; m++) freeMonthDays(&year_node->months[m]);
+    calendarFree(year_node->months);
+    calendarFree(year_node);
+}
+
+// appends every day list of "extra" to the same day of "target"
+static void appendYear(struct years* target, struct years* extra) {
+
+    for (int m = 0; m < 12; m++) {
+        struct months* into = &target->months[m];
+        struct months* from = &extra->months[m];
+        if (from->task_count == 0) continue;
+
+        // a month that never had tasks takes the whole day array as it is
+        if (!monthHasOwnDays(into)) {
+            struct days* shared = into->days;
+            atomicPublishPointer((void* volatile*)&into->days, from->days);
+            from->days = shared;
+            into->task_count = from->task_count;
+            into->occupied_days = from->occupied_days;
+            continue;
+        }
+
+        for (int d = 0; d < from->num_days; d++) {
+            struct tasks* first = from->days[d].tasks_head;
+            if (!first) continue;
+            from->days[d].tasks_head = NULL;
+
+            struct tasks* tail = into->days[d].tasks_head;
+            while (tail != NULL && tail->next != NULL) tail = tail->next;
+
+            // ids continue after the ones already there; the run is complete
+            // before it's linked in (readers may be walking the list)
+            if (tail) {
+                for (struct tasks* t = first; t != NULL; t = t->next) t->task_id += tail->task_id;
+                first->prev = tail;
+                atomicPublishPointer((void* volatile*)&tail->next, first);
+            }
+            else {
+                atomicPublishPointer((void* volatile*)&into->days[d].tasks_head, first);
+            }
+        }
+
+        into->task_count += from->task_count;
+        into->occupied_days |= from->occupied_days;
+    }
+
+    target->task_count += extra->task_count;
+    markYearChanged(target);
+}
+
+void mergeYears(struct years** calendar_head, struct years* source) {
+
+    // both lists are sorted, so each search carries on from the last one
+    struct years** link = calendar_head;
+
+    while (source != NULL) {
+        struct years* year_node = source;
+        source = source->next;
+
+        while (*link != NULL && (*link)->year_number < year_node->year_number) {
+            link = &(*link)->next;
+        }
+
+        if (*link != NULL && (*link)->year_number == year_node->year_number) {
+            appendYear(*link, year_node);
+            freeEmptyYear(year_node);
+        }
+        else {
+            year_node->next = *link;
+            atomicPublishPointer((void* volatile*)link, year_node);
+            link = &year_node->next;
+        }
+    }
+}
+
+struct years* loadTasksAsync(const char* filename, enum file_io_backend backend, struct work_pool* pool) {
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    struct years* calendar_head = NULL;
+    size_t size = 0;
+    int loaded = parseTasksFile(filename, &calendar_head, stdout, pool, backend, &size);
+    if (loaded >= 0) {
+        emitTaskEvent(TASK_EVENT_RELOAD, 0, 0, 0, loaded);
+        OP_TIMER_END(timer, OP_LOAD, size);
+        TRACE_END(span, "loadTasksAsync", "load", "tasks", loaded);
+    }
+    return calendar_head;
+}
+
+struct years* loadTasksParallel(const char* filename, struct work_pool* pool) {
+    if (!pool) return loadTasks(filename);
+    return loadTasksAsync(filename, FILE_IO_STDIO, pool);
+}
+
+// =====================
+// SAVE
+// =====================
+
+// one month's lines of the file
+struct text_buffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;
+};
+
+static int reserveText(struct text_buffer* buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) return 1;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra) capacity *= 2;
+
+    char* grown = (char*)realloc(buffer->data, capacity);
+    if (!grown) {
+        buffer->failed = 1;
+        return 0;
+    }
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+// decimal digits of a non-negative number (what %d gives for month/day numbers)
+static size_t formatNumber(char* out, int value) {
+    char digits[12];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (size_t i = 0; i < count; i++) out[i] = digits[count - 1 - i];
+    return count;
+}
+
+// "month day description\n", same as saveTasks writes it
+static int formatTask(const struct task_match* match, void* user_data) {
+    struct text_buffer* buffer = (struct text_buffer*)user_data;
+
+    size_t desc_len = strlen(match->task->task_description);
+    if (!reserveText(buffer, desc_len + 24)) return 0;
+
+    char* out = buffer->data + buffer->length;
+    size_t at = formatNumber(out, match->month);
+    out[at++] = ' ';
+    at += formatNumber(out + at, match->day);
+    out[at++] = ' ';
+    memcpy(out + at, match->task->task_description, desc_len);
+    at += desc_len;
+    out[at++] = '\n';
+
+    buffer->length += at;
+    return 1;
+}
+
+struct parallel_save {
+    const struct month_key* months;
+    struct text_buffer* buffers;
+};
+
+static void formatMonths(int begin, int end, void* arg) {
+    struct parallel_save* save = (struct parallel_save*)arg;
+    TRACE_BEGIN(span);
+    for (int i = begin; i < end; i++) forEachTaskInMonth(&save->months[i], formatTask, &save->buffers[i]);
+    TRACE_END(span, "format months", "save", "months", end - begin);
+}
+
+// writes the file through writer: a header for every year (empty ones too, like
+// saveTasks), then its months' lines (from buffers when they were built in
+// parallel, otherwise formatted here one month at a time)
+static int writeTasks(struct async_writer* writer, struct years* calendar_head,
+    const struct month_key* months, int count, const struct text_buffer* buffers, unsigned long long* written) {
+
+    struct text_buffer scratch;
+    memset(&scratch, 0, sizeof(scratch));
+
+    int at = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        char header[32];
+        int length = snprintf(header, sizeof(header), "[YEAR] %d\n", y->year_number);
+        asyncWrite(writer, header, (size_t)length);
+        *written += (unsigned long long)length;
+
+        for (; at < count && months[at].year_node == y; at++) {
+            if (buffers) {
+                asyncWrite(writer, buffers[at].data, buffers[at].length);
+                *written += buffers[at].length;
+                continue;
+            }
+
+            scratch.length = 0;
+            forEachTaskInMonth(&months[at], formatTask, &scratch);
+            if (scratch.failed) break;
+            asyncWrite(writer, scratch.data, scratch.length);
+            *written += scratch.length;
+        }
+        if (scratch.failed) break;
+    }
+
+    free(scratch.data);
+    return !scratch.failed;
+}
+
+int saveTasksAsync(const char* filename, struct years* calendar_head, enum file_io_backend backend, struct work_pool* pool) {
+
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    struct month_key* months;
+    int count = listTaskMonths(calendar_head, &months);
+    if (count < 0) return saveTasks(filename, calendar_head);
+
+    // with a pool the text is built in parallel, month by month, before anything is written
+    struct text_buffer* buffers = NULL;
+    if (pool && count > 0) {
+        buffers = (struct text_buffer*)calloc(count, sizeof(struct text_buffer));
+        if (buffers) {
+            struct parallel_save save = { months, buffers };
+            parallelFor(pool, count, 1, formatMonths, &save);
+
+            int failed = 0;
+            for (int i = 0; i < count; i++) failed |= buffers[i].failed;
+            if (failed) {
+                for (int i = 0; i < count; i++) free(buffers[i].data);
+                free(buffers);
+                buffers = NULL;
+            }
+        }
+    }
+
+    int saved = 0, formatted = 1;
+    unsigned long long written = 0;
+    TRACE_BEGIN(write_span);
+    struct async_writer* writer = openAsyncWriter(filename, backend);
+    if (writer) {
+        formatted = writeTasks(writer, calendar_head, months, count, buffers, &written);
+        saved = closeAsyncWriter(writer) && formatted;
+    }
+    TRACE_END(write_span, "write file", "save", "bytes", (long long)written);
+
+    if (buffers) {
+        for (int i = 0; i < count; i++) free(buffers[i].data);
+        free(buffers);
+    }
+    free(months);
+
+    // out of memory building the text: the stdio version needs none (and counts itself)
+    if (!formatted) return saveTasks(filename, calendar_head);
+    OP_TIMER_END(timer, OP_SAVE, written);
+    TRACE_END(span, "saveTasksAsync", "save", "bytes", (long long)written);
+    return saved;
+}
+
+int saveTasksParallel(const char* filename, struct years* calendar_head, struct work_pool* pool) {
+    if (!pool) return saveTasks(filename, calendar_head);
+    return saveTasksAsync(filename, calendar_head, FILE_IO_STDIO, pool);
+}
+
+// =====================
+// SEARCH
+// =====================
+
+// one month's hits, in date order
+struct match_list {
+    const char* keyword;
+    struct task_match* items;
+    int count;
+    int capacity;
+    int failed;
+};
+
+static int keepMatch(const struct task_match* match, void* user_data) {
+    struct match_list* list = (struct match_list*)user_data;
+
+    if (!containsIgnoreCase(match->task->task_description, list->keyword)) return 1;
+
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        struct task_match* grown = (struct task_match*)realloc(list->items, capacity * sizeof(struct task_match));
+        if (!grown) {
+            list->failed = 1;
+            return 0;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+
+    list->items[list->count++] = *match;
+    return 1;
+}
+
+struct parallel_search {
+    const struct month_key* months;
+    struct match_list* found;
+};
+
+static void searchMonths(int begin, int end, void* arg) {
+    struct parallel_search* search = (struct parallel_search*)arg;
+    TRACE_BEGIN(span);
+    for (int i = begin; i < end; i++) forEachTaskInMonth(&search->months[i], keepMatch, &search->found[i]);
+    TRACE_END(span, "search months", "search", "months", end - begin);
+}
+
+int searchTasksParallel(struct years* calendar_head, const char* keyword, int limit,
+    TaskMatchFn on_match, void* user_data, struct work_pool* pool) {
+
+    if (!keyword || keyword[0] == '\0' || !on_match) return 0;
+    if (!pool) return searchTasksEach(calendar_head, keyword, limit, on_match, user_data);
+
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    struct month_key* months;
+    int count = listTaskMonths(calendar_head, &months);
+    if (count == 0) return 0;
+
+    struct match_list* found = count > 0 ? (struct match_list*)calloc(count, sizeof(struct match_list)) : NULL;
+    if (!found) {
+        free(months);
+        return searchTasksEach(calendar_head, keyword, limit, on_match, user_data);
+    }
+
+    // every month is searched (a limit can't stop the other threads early)...
+    for (int i = 0; i < count; i++) found[i].keyword = keyword;
+    struct parallel_search search = { months, found };
+    parallelFor(pool, count, 1, searchMonths, &search);
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) failed |= found[i].failed;
+
+    // ...then the hits are reported here, in order, until the limit or a "stop"
+    int reported = 0, stopped = failed;
+    for (int i = 0; i < count && !stopped; i++) {
+        for (int j = 0; j < found[i].count && !stopped; j++) {
+            reported++;
+            if (!on_match(&found[i].items[j], user_data)) stopped = 1;
+            else if (limit > 0 && reported >= limit) stopped = 1;
+        }
+    }
+
+    for (int i = 0; i < count; i++) free(found[i].items);
+    free(found);
+    free(months);
+
+    // (a fallback counts itself)
+    if (failed) return searchTasksEach(calendar_head, keyword, limit, on_match, user_data);
+    OP_TIMER_END(timer, OP_SEARCH, strlen(keyword));
+    TRACE_END(span, "searchTasksParallel", "search", "hits", reported);
+    return reported;
+}
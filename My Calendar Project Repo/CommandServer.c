@@ -0,0 +1,506 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "CommandServer.h"
+#include "Commands.h"
+#include "Platform.h"
+
+// how much a worker reads from a connection at a time
+#define SERVER_READ_SIZE 65536
+// reads per turn before the connection goes to the back of the queue, so one
+// client streaming commands can't keep a worker to itself
+#define SERVER_READS_PER_TURN 4
+#define SERVER_EVENTS 64
+// how often the autosave thread looks at the clock
+#define SERVER_POLL_MILLIS 100
+
+void initCommandServerOptions(struct command_server_options* options) {
+    options->socket_path = NULL;
+    options->tasks_file = "tasks.txt";
+    options->workers = 0;
+    options->persist_millis = 2000;
+    options->shared = NULL;
+}
+
+#ifndef __linux__
+
+int runCommandServer(struct calendar* calendar, const struct command_server_options* options) {
+    (void)calendar;
+    (void)options;
+    fprintf(stderr, "Socket server mode isn't available in this build.\n");
+    return -1;
+}
+
+#else
+
+// one client; belongs to either the epoll thread (waiting for input) or one
+// worker (queued / being run), never both
+struct connection {
+    int fd;
+    struct command_session* session;
+    volatile long turns;                // bumped by each worker before handing it back
+    size_t sent;                        // how much of the session's output is already written
+    int writing;                        // replies left over: wait for the client to read, not to send
+    int closing;                        // the client quit: close once those are out
+    struct connection* next_ready;      // work queue
+    struct connection* prev;            // every open connection, for the final cleanup
+    struct connection* next;
+};
+
+struct command_server {
+    struct calendar* calendar;
+    struct command_server_options options;
+    volatile long stop;
+    int epoll_fd;
+    int wake_fd;                        // eventfd that gets the epoll thread out for shutdown
+
+    // work queue + the open connections list, under one lock
+    platform_mutex lock;
+    platform_cond work_ready;
+    struct connection* ready_head;
+    struct connection* ready_tail;
+    struct connection* open;
+
+    // the one writer of the tasks file
+    platform_mutex save_lock;
+    char* temp_file;
+    unsigned long long saved_generation;
+
+    // only touched by the background thread (and before / after it runs)
+    unsigned long long shared_generation;
+};
+
+// =====================
+// PERSISTENCE
+// =====================
+
+// writes the calendar to the tasks file if it changed since the last save (or
+// always, when forced); returns 1 on success
+static int persistCalendar(struct command_server* server, int force) {
+
+    mutexLock(&server->save_lock);
+
+    // read before saving: anything that lands during the write makes the next
+    // check save again, which is harmless
+    unsigned long long generation = calendarGeneration();
+    int saved = 1;
+
+    if (force || generation != server->saved_generation) {
+        // a reader of the tasks file sees the old version or the new one, never half
+        saved = calendarSave(server->calendar, server->temp_file)
+            && rename(server->temp_file, server->options.tasks_file) == 0;
+        if (saved) server->saved_generation = generation;
+        else remove(server->temp_file);
+    }
+
+    mutexUnlock(&server->save_lock);
+    return saved;
+}
+
+// "save" from any session
+static int saveFromSession(void* user_data) {
+    return persistCalendar((struct command_server*)user_data, 1);
+}
+
+// republishes the shared calendar if anything changed since the last time
+static void publishShared(struct command_server* server) {
+
+    if (!server->options.shared) return;
+
+    unsigned long long generation = calendarGeneration();
+    if (generation == server->shared_generation) return;
+    if (calendarPublishShared(server->calendar, server->options.shared)) server->shared_generation = generation;
+}
+
+static void autosaveLoop(void* arg) {
+    struct command_server* server = (struct command_server*)arg;
+    long long last = platformNowNanos();
+
+    while (!atomicLoadLong(&server->stop)) {
+        threadSleepMillis(SERVER_POLL_MILLIS);
+        publishShared(server);
+
+        long long now = platformNowNanos();
+        if (server->options.persist_millis > 0 && (now - last) / 1000000 >= server->options.persist_millis) {
+            if (!persistCalendar(server, 0)) fprintf(stderr, "Autosave to %s failed.\n", server->options.tasks_file);
+            last = now;
+        }
+    }
+}
+
+// =====================
+// CONNECTIONS
+// =====================
+
+static struct connection* openConnection(struct command_server* server, int fd) {
+    struct connection* conn = (struct connection*)calloc(1, sizeof(struct connection));
+    if (!conn) return NULL;
+
+    conn->fd = fd;
+    conn->session = createCommandSession(server->calendar, server->options.tasks_file);
+    if (!conn->session) {
+        free(conn);
+        return NULL;
+    }
+    setCommandSaveHandler(conn->session, saveFromSession, server);
+    disallowCommandFiles(conn->session);
+
+    mutexLock(&server->lock);
+    conn->next = server->open;
+    if (server->open) server->open->prev = conn;
+    server->open = conn;
+    mutexUnlock(&server->lock);
+    return conn;
+}
+
+static void closeConnection(struct command_server* server, struct connection* conn) {
+    mutexLock(&server->lock);
+    if (conn->prev) conn->prev->next = conn->next;
+    else server->open = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    mutexUnlock(&server->lock);
+
+    // closing also takes it out of the epoll set
+    close(conn->fd);
+    freeCommandSession(conn->session);
+    free(conn);
+}
+
+// hands the connection back to the epoll thread until the client sends more
+// (or, with replies left over, until it has read enough to make room for
+// them); once this succeeds another worker may already have the connection
+static int waitForClient(struct command_server* server, struct connection* conn, int op) {
+    struct epoll_event event;
+    // no EPOLLRDHUP while writing: a client that stopped sending would keep waking it up
+    event.events = (conn->writing ? EPOLLOUT : EPOLLIN | EPOLLRDHUP) | EPOLLONESHOT;
+    event.data.ptr = conn;
+    int fd = conn->fd;
+
+    // the next worker may be another thread: publish what this one did to the
+    // session (the kernel orders the re-arm too, but that's invisible to us and
+    // to race checkers); queueConnection reads it back
+    atomicAddLong(&conn->turns, 1);
+
+    return epoll_ctl(server->epoll_fd, op, fd, &event) == 0;
+}
+
+// writes as much of the session's output as the socket takes without
+// blocking; returns 1 once all of it is out, 0 if some is left until the
+// client reads, -1 if the client is gone
+static int flushOutput(struct connection* conn) {
+    size_t length;
+    const char* output = commandOutput(conn->session, &length);
+
+    while (conn->sent < length) {
+        ssize_t sent = send(conn->fd, output + conn->sent, length - conn->sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (sent <= 0) return -1;
+        conn->sent += (size_t)sent;
+    }
+
+    clearCommandOutput(conn->session);
+    conn->sent = 0;
+    return 1;
+}
+
+// =====================
+// WORKERS
+// =====================
+
+static void stopServer(struct command_server* server) {
+    atomicStoreLong(&server->stop, 1);
+
+    unsigned long long one = 1;
+    if (write(server->wake_fd, &one, sizeof(one)) < 0) {
+        // the epoll thread also checks the flag every time it wakes up
+    }
+
+    mutexLock(&server->lock);
+    condBroadcast(&server->work_ready);
+    mutexUnlock(&server->lock);
+}
+
+// reads what the client has sent, runs it and sends the replies; returns
+// COMMAND_CONTINUE if the connection stays open
+static int serveConnection(struct command_server* server, struct connection* conn, char* buffer) {
+
+    // replies left from an earlier turn go first, and nothing more is read until
+    // they're out: a client that doesn't read can neither hold a worker nor make
+    // the server pile up replies for it
+    if (conn->writing) {
+        int flushed = flushOutput(conn);
+        if (flushed < 0) return COMMAND_QUIT;
+        conn->writing = flushed == 0;
+        if (conn->writing) return COMMAND_CONTINUE;
+        if (conn->closing) return COMMAND_QUIT;
+    }
+
+    int result = COMMAND_CONTINUE;
+
+    for (int reads = 0; reads < SERVER_READS_PER_TURN && result == COMMAND_CONTINUE; reads++) {
+        ssize_t got = recv(conn->fd, buffer, SERVER_READ_SIZE, MSG_DONTWAIT);
+        if (got > 0) {
+            result = feedCommands(conn->session, buffer, (size_t)got);
+            if ((size_t)got < SERVER_READ_SIZE) break;
+        }
+        else if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        else if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            // the client is done sending (or gone)
+            result = finishCommands(conn->session);
+            if (result == COMMAND_CONTINUE) result = COMMAND_QUIT;
+        }
+    }
+
+    // every reply for this turn in one write, or as much as fits
+    int flushed = flushOutput(conn);
+    if (flushed < 0 && result == COMMAND_CONTINUE) result = COMMAND_QUIT;
+    conn->writing = flushed == 0;
+
+    return result;
+}
+
+static void workerLoop(void* arg) {
+    struct command_server* server = (struct command_server*)arg;
+
+    char* buffer = (char*)malloc(SERVER_READ_SIZE);
+    if (!buffer) return;
+
+    for (;;) {
+        mutexLock(&server->lock);
+        while (!server->ready_head && !atomicLoadLong(&server->stop)) {
+            condWait(&server->work_ready, &server->lock);
+        }
+        struct connection* conn = server->ready_head;
+        if (conn) {
+            server->ready_head = conn->next_ready;
+            if (!server->ready_head) server->ready_tail = NULL;
+        }
+        mutexUnlock(&server->lock);
+
+        // stopping and nothing left to answer
+        if (!conn) break;
+
+        int result = serveConnection(server, conn, buffer);
+        if (result == COMMAND_SHUTDOWN) stopServer(server);
+
+        // once stopping, connections aren't handed back; the cleanup closes them
+        if (atomicLoadLong(&server->stop)) continue;
+
+        // a client that quit still gets the rest of its replies
+        if (result == COMMAND_QUIT && conn->writing) {
+            conn->closing = 1;
+            result = COMMAND_CONTINUE;
+        }
+
+        if (result != COMMAND_CONTINUE || !waitForClient(server, conn, EPOLL_CTL_MOD)) {
+            closeConnection(server, conn);
+        }
+    }
+
+    free(buffer);
+}
+
+static void queueConnection(struct command_server* server, struct connection* conn) {
+    atomicLoadLong(&conn->turns);
+
+    mutexLock(&server->lock);
+    conn->next_ready = NULL;
+    if (server->ready_tail) server->ready_tail->next_ready = conn;
+    else server->ready_head = conn;
+    server->ready_tail = conn;
+    condSignal(&server->work_ready);
+    mutexUnlock(&server->lock);
+}
+
+// =====================
+// EVENT LOOP
+// =====================
+
+static int openListener(const char* socket_path) {
+    struct sockaddr_un address;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_path, strlen(socket_path) + 1);
+
+    // a stale socket file from an earlier run would make bind fail
+    unlink(socket_path);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 128) != 0) {
+        perror("bind/listen");
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+static void acceptClients(struct command_server* server, int listener) {
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;     // EAGAIN: no more waiting (or out of fds, tried again on the next event)
+        }
+        // non-blocking, so a client that stops reading can't stall a worker in send
+        if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+            close(fd);
+            continue;
+        }
+
+        struct connection* conn = openConnection(server, fd);
+        if (!conn) {
+            close(fd);
+        }
+        else if (!waitForClient(server, conn, EPOLL_CTL_ADD)) {
+            closeConnection(server, conn);
+        }
+    }
+}
+
+static void eventLoop(struct command_server* server, int listener) {
+    struct epoll_event events[SERVER_EVENTS];
+
+    while (!atomicLoadLong(&server->stop)) {
+        int count = epoll_wait(server->epoll_fd, events, SERVER_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == &server->wake_fd) continue;
+            if (events[i].data.ptr == NULL) acceptClients(server, listener);
+            else queueConnection(server, (struct connection*)events[i].data.ptr);
+        }
+    }
+}
+
+// =====================
+// SERVER
+// =====================
+
+int runCommandServer(struct calendar* calendar, const struct command_server_options* options) {
+
+    struct command_server* server = (struct command_server*)calloc(1, sizeof(struct command_server));
+    if (!server) return -1;
+
+    server->calendar = calendar;
+    server->options = *options;
+    if (!server->options.tasks_file) server->options.tasks_file = "tasks.txt";
+    if (server->options.workers < 1) server->options.workers = platformCpuCount();
+
+    size_t length = strlen(server->options.tasks_file);
+    server->temp_file = (char*)malloc(length + 5);
+    platform_thread* threads = (platform_thread*)calloc(server->options.workers + 1, sizeof(platform_thread));
+
+    server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    server->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int listener = -1;
+    if (server->temp_file && threads && options->socket_path && server->epoll_fd >= 0 && server->wake_fd >= 0) {
+        listener = openListener(options->socket_path);
+    }
+
+    // the listener is told apart by a NULL pointer, the wake-up by its own address
+    struct epoll_event event;
+    int watching = 0;
+    if (listener >= 0) {
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+        watching = epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, listener, &event) == 0;
+        event.data.ptr = &server->wake_fd;
+        watching = watching && epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &event) == 0;
+    }
+
+    if (!watching) {
+        if (listener >= 0) {
+            close(listener);
+            unlink(options->socket_path);
+        }
+        if (server->wake_fd >= 0) close(server->wake_fd);
+        if (server->epoll_fd >= 0) close(server->epoll_fd);
+        free(threads);
+        free(server->temp_file);
+        free(server);
+        return -1;
+    }
+
+    memcpy(server->temp_file, server->options.tasks_file, length);
+    memcpy(server->temp_file + length, ".tmp", 5);
+
+    mutexInit(&server->lock);
+    mutexInit(&server->save_lock);
+    condInit(&server->work_ready);
+
+    // whatever the calendar holds now (what the caller loaded) counts as saved
+    server->saved_generation = calendarGeneration();
+    if (server->options.shared) calendarPublishShared(calendar, server->options.shared);
+    server->shared_generation = server->saved_generation;
+
+    int started = 0;
+    for (int i = 0; i < server->options.workers; i++) {
+        if (threadStart(&threads[started], workerLoop, server)) started++;
+    }
+    int workers = started;
+    if (workers > 0 && (server->options.persist_millis > 0 || server->options.shared)) {
+        if (threadStart(&threads[started], autosaveLoop, server)) started++;
+    }
+
+    if (workers > 0) eventLoop(server, listener);
+    else fprintf(stderr, "Could not start any server threads.\n");
+
+    close(listener);
+    unlink(options->socket_path);
+
+    stopServer(server);
+    for (int i = 0; i < started; i++) threadJoin(threads[i]);
+
+    // nobody else touches the connections now
+    while (server->open) closeConnection(server, server->open);
+
+    // the final save, once nobody can change anything any more
+    int result = 0;
+    if (workers == 0) result = -1;
+    else if (!persistCalendar(server, 0)) {
+        fprintf(stderr, "Could not write %s.\n", server->options.tasks_file);
+        result = -1;
+    }
+
+    close(server->wake_fd);
+    close(server->epoll_fd);
+    condDestroy(&server->work_ready);
+    mutexDestroy(&server->save_lock);
+    mutexDestroy(&server->lock);
+    free(threads);
+    free(server->temp_file);
+    free(server);
+    return result;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef COMMAND_SERVER_H
+#define COMMAND_SERVER_H
+
+#include "CalendarContext.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Serves the line protocol from Commands.h on a local (Unix domain) socket, so
+    // several tools can share one in-memory calendar instead of each loading
+    // tasks.txt and overwriting the others' changes on exit.
+    //
+    // One thread waits on every connection with epoll; when a client has sent
+    // something, its connection goes to a pool of worker threads, which reads what
+    // has arrived, runs the complete lines and writes the replies in one go. A
+    // connection is only ever with one worker at a time (so its replies stay in
+    // order), but idle clients don't hold a worker, so any number can stay
+    // connected. Replies a client isn't reading stay queued on its connection
+    // (and nothing more is read from it) until its socket has room again, so it
+    // doesn't hold a worker either. All sessions work on the same calendar, which
+    // does its own locking (create it with CALENDAR_LOCK_PER_YEAR or
+    // CALENDAR_LOCK_EPOCH).
+    //
+    // Only the server writes the tasks file: "save" with no argument, the
+    // periodic autosave and the final save at shutdown all go through one writer,
+    // which writes a temporary file and renames it over the old one; "save file"
+    // and "load file" are refused (ERR unavailable). A client sending "shutdown"
+    // stops the server; commands it has already read are answered, then every
+    // connection is closed.
+    //
+    // With a shared calendar (SharedCalendar.h) the same background thread
+    // republishes it whenever the calendar has changed, a few times a second, so
+    // viewers in other processes can read it without going through the socket.
+    //
+    // Linux only (epoll); elsewhere runCommandServer just reports that.
+    struct command_server_options {
+        const char* socket_path;
+        const char* tasks_file;     // where saves go (default tasks.txt)
+        int workers;                // threads running commands (0 = one per CPU)
+        int persist_millis;         // autosave this often if anything changed (0 = only on save / shutdown)
+        struct shared_calendar* shared; // kept up to date for other processes (NULL = none; not owned)
+    };
+
+    void initCommandServerOptions(struct command_server_options* options);
+
+    // blocks until a client sends "shutdown"; returns 0 on success, -1 if the
+    // socket can't be set up (or this isn't Linux) or the final save fails
+    int runCommandServer(struct calendar* calendar, const struct command_server_options* options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,705 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "CommandServer.h"
+#include "Commands.h"
+#include "EventRing.h"
+#include "MemStats.h"
+#include "OpStats.h"
+#include "Trace.h"
+
+// how much unprocessed input a stream keeps (also the longest line accepted)
+#define COMMAND_BUFFER_SIZE 65536
+// events one "events" reply carries by default / at most
+#define COMMAND_EVENTS_DEFAULT 1000
+#define COMMAND_EVENTS_MAX 10000
+// event ring size in command mode (--events)
+#define COMMAND_EVENT_RING 4096
+
+// growable output buffer
+struct command_buffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;                 // an append ran out of memory
+};
+
+struct command_session {
+    struct calendar* calendar;
+    char* tasks_file;
+
+    CommandSaveFn save;             // NULL = "save" writes tasks_file directly
+    void* save_data;
+    int no_files;                   // "save file" / "load file" aren't allowed
+
+    struct command_buffer output;   // finished replies
+    struct command_buffer lines;    // data lines of the reply being built
+    int line_count;
+
+    struct command_buffer partial;  // start of a line fed without its newline yet
+    struct command_buffer line;     // the line being run, trimmed (kept off the stack)
+    int discarding;                 // skipping the rest of a line that was too long
+
+    struct event_subscriber* events;    // from the first "events" command on
+};
+
+// =====================
+// BUFFERS
+// =====================
+
+static int reserveBuffer(struct command_buffer* buffer, size_t extra) {
+    if (buffer->length + extra + 1 <= buffer->capacity) return 1;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->length + extra + 1) capacity *= 2;
+
+    char* grown = (char*)realloc(buffer->data, capacity);
+    if (!grown) {
+        buffer->failed = 1;
+        return 0;
+    }
+    buffer->data = grown;
+    buffer->capacity = capacity;
+    return 1;
+}
+
+static void appendText(struct command_buffer* buffer, const char* text, size_t length) {
+    if (!reserveBuffer(buffer, length)) return;
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void appendFormat(struct command_buffer* buffer, const char* format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0 || !reserveBuffer(buffer, (size_t)needed)) return;
+
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, (size_t)needed + 1, format, args);
+    va_end(args);
+    buffer->length += (size_t)needed;
+}
+
+// =====================
+// SESSIONS
+// =====================
+
+struct command_session* createCommandSession(struct calendar* calendar, const char* tasks_file) {
+
+    struct command_session* session = (struct command_session*)calloc(1, sizeof(struct command_session));
+    if (!session) return NULL;
+
+    if (!tasks_file) tasks_file = "tasks.txt";
+    size_t length = strlen(tasks_file) + 1;
+    session->tasks_file = (char*)malloc(length);
+    if (!session->tasks_file) {
+        free(session);
+        return NULL;
+    }
+    memcpy(session->tasks_file, tasks_file, length);
+
+    session->calendar = calendar;
+    return session;
+}
+
+void freeCommandSession(struct command_session* session) {
+    if (!session) return;
+    unsubscribeEvents(session->events);
+    free(session->output.data);
+    free(session->lines.data);
+    free(session->partial.data);
+    free(session->line.data);
+    free(session->tasks_file);
+    free(session);
+}
+
+void setCommandSaveHandler(struct command_session* session, CommandSaveFn save, void* user_data) {
+    session->save = save;
+    session->save_data = user_data;
+}
+
+void disallowCommandFiles(struct command_session* session) {
+    session->no_files = 1;
+}
+
+const char* commandOutput(const struct command_session* session, size_t* length) {
+    if (length) *length = session->output.length;
+    return session->output.data ? session->output.data : "";
+}
+
+void clearCommandOutput(struct command_session* session) {
+    session->output.length = 0;
+    if (session->output.data) session->output.data[0] = '\0';
+}
+
+// =====================
+// REPLIES
+// =====================
+
+static void startReply(struct command_session* session) {
+    session->lines.length = 0;
+    session->lines.failed = 0;
+    session->line_count = 0;
+}
+
+static void replyError(struct command_session* session, const char* code, const char* message) {
+    appendFormat(&session->output, "ERR %s %s\n", code, message);
+}
+
+static void replyOk(struct command_session* session) {
+    if (session->lines.failed) {
+        replyError(session, "no_memory", "Out of memory building the reply.");
+        return;
+    }
+    appendFormat(&session->output, "OK %d\n", session->line_count);
+    appendText(&session->output, session->lines.data ? session->lines.data : "", session->lines.length);
+}
+
+static void replyStatus(struct command_session* session, int status) {
+    switch (status) {
+    case CALENDAR_OK: replyOk(session); break;
+    case CALENDAR_INVALID_DATE: replyError(session, "invalid_date", "Invalid date / year not found."); break;
+    case CALENDAR_NOT_FOUND: replyError(session, "not_found", "No task with that id on that date."); break;
+    default: replyError(session, "no_memory", "Out of memory."); break;
+    }
+}
+
+static void addLine(struct command_session* session, const char* format, ...) {
+    char line[512];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    appendText(&session->lines, line, strlen(line));
+    appendText(&session->lines, "\n", 1);
+    session->line_count++;
+}
+
+// one data line per task
+static int addTaskLine(const struct task_match* match, void* user_data) {
+    struct command_session* session = (struct command_session*)user_data;
+    appendFormat(&session->lines, "%04d-%02d-%02d\t%d\t%s\n",
+        match->year, match->month, match->day, match->task->task_id, match->task->task_description);
+    session->line_count++;
+    return 1;
+}
+
+// "events": what changed since this session's last "events" (the first one
+// subscribes, so it only starts the stream)
+static void replyEvents(struct command_session* session, int max) {
+
+    struct event_ring* ring = calendarEventRing(session->calendar);
+    if (!ring) {
+        replyError(session, "unavailable", "The event stream is off.");
+        return;
+    }
+    if (!session->events) {
+        session->events = subscribeEvents(ring, 0);
+        if (!session->events) {
+            replyError(session, "unavailable", "Too many event subscribers.");
+            return;
+        }
+    }
+
+    struct task_event events[64];
+    int taken = 0;
+
+    while (taken < max) {
+        unsigned long long lost = 0;
+        int want = max - taken < 64 ? max - taken : 64;
+        int count = pollEvents(session->events, events, want, &lost);
+
+        // anything overwritten before it could be read is reported where it was
+        if (lost > 0) {
+            addLine(session, "lost\t%llu", lost);
+        }
+        for (int i = 0; i < count; i++) {
+            addLine(session, "%llu\t%s\t%04d-%02d-%02d\t%d", events[i].sequence, taskEventName(events[i].type),
+                events[i].year, events[i].month, events[i].day, events[i].task_id);
+        }
+
+        taken += count;
+        if (count < want) break;
+    }
+    replyOk(session);
+}
+
+static void addStatsLine(const char* line, void* user_data) {
+    addLine((struct command_session*)user_data, "%s", line);
+}
+
+// =====================
+// PARSING
+// =====================
+
+static const char* skipSpaces(const char* text) {
+    while (*text == ' ' || *text == '\t') text++;
+    return text;
+}
+
+// reads "count" whole numbers from the front of text; *rest is left on what follows
+// returns 0 if there aren't that many, or one has junk after it or doesn't fit an int
+static int parseInts(const char* text, int* values, int count, const char** rest) {
+    for (int i = 0; i < count; i++) {
+        text = skipSpaces(text);
+
+        char* end;
+        errno = 0;
+        long value = strtol(text, &end, 10);
+        if (end == text || (*end != '\0' && *end != ' ' && *end != '\t')) return 0;
+        if (errno == ERANGE || value < INT_MIN || value > INT_MAX) return 0;
+
+        values[i] = (int)value;
+        text = end;
+    }
+    if (rest) *rest = skipSpaces(text);
+    return 1;
+}
+
+// a description has to fit what loadTasks reads back
+static int checkDescription(struct command_session* session, const char* text) {
+    if (*text == '\0') {
+        replyError(session, "bad_args", "Missing description.");
+        return 0;
+    }
+    if (strlen(text) >= DESC_LEN) {
+        replyError(session, "bad_args", "Description too long.");
+        return 0;
+    }
+    return 1;
+}
+
+// =====================
+// COMMANDS
+// =====================
+
+// runs one line of "length" bytes (it doesn't have to be NUL-terminated)
+static int runLine(struct command_session* session, const char* line, size_t length) {
+
+    // own copy, so the line can be trimmed (and callers can pass string literals);
+    // it lives in the session, so server workers don't each carry a line-sized
+    // buffer on their stacks
+    if (length >= COMMAND_BUFFER_SIZE) {
+        replyError(session, "line_too_long", "Command line too long.");
+        return COMMAND_CONTINUE;
+    }
+    session->line.length = 0;
+    appendText(&session->line, line, length);
+    if (session->line.failed) {
+        replyError(session, "no_memory", "Out of memory reading the command.");
+        session->line.failed = 0;
+        return COMMAND_CONTINUE;
+    }
+    char* text = session->line.data;
+
+    // strip the line ending (scripts from Windows have \r\n)
+    while (length > 0 && (text[length - 1] == '\r' || text[length - 1] == '\n')) text[--length] = '\0';
+
+    const char* name = skipSpaces(text);
+
+    // blank lines and # comments aren't commands and get no reply
+    if (*name == '\0' || *name == '#') return COMMAND_CONTINUE;
+
+    char* name_end = (char*)name;
+    while (*name_end != '\0' && *name_end != ' ' && *name_end != '\t') name_end++;
+    const char* args = skipSpaces(name_end);
+    *name_end = '\0';
+
+    startReply(session);
+
+    int v[6];
+    const char* rest;
+
+    if (strcmp(name, "add") == 0) {
+        if (!parseInts(args, v, 3, &rest)) replyError(session, "bad_args", "Usage: add Y M D text");
+        else if (checkDescription(session, rest)) {
+            replyStatus(session, calendarAddTask(session->calendar, v[0], v[1], v[2], rest));
+        }
+    }
+    else if (strcmp(name, "update") == 0) {
+        if (!parseInts(args, v, 4, &rest)) replyError(session, "bad_args", "Usage: update Y M D ID text");
+        else if (checkDescription(session, rest)) {
+            replyStatus(session, calendarUpdateTask(session->calendar, v[0], v[1], v[2], v[3], rest));
+        }
+    }
+    else if (strcmp(name, "delete") == 0) {
+        if (!parseInts(args, v, 4, &rest) || *rest) replyError(session, "bad_args", "Usage: delete Y M D ID");
+        else replyStatus(session, calendarDeleteTask(session->calendar, v[0], v[1], v[2], v[3]));
+    }
+    else if (strcmp(name, "day") == 0) {
+        if (!parseInts(args, v, 3, &rest) || *rest) replyError(session, "bad_args", "Usage: day Y M D");
+        else {
+            calendarForEachInRange(session->calendar, v[0], v[1], v[2], v[0], v[1], v[2], addTaskLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "month") == 0) {
+        if (!parseInts(args, v, 2, &rest) || *rest) replyError(session, "bad_args", "Usage: month Y M");
+        else if (v[1] < 1 || v[1] > 12) replyError(session, "invalid_date", "Invalid month.");
+        else {
+            calendarForEachInRange(session->calendar, v[0], v[1], 1, v[0], v[1], 31, addTaskLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "year") == 0) {
+        if (!parseInts(args, v, 1, &rest) || *rest) replyError(session, "bad_args", "Usage: year Y");
+        else {
+            calendarForEachInRange(session->calendar, v[0], 1, 1, v[0], 12, 31, addTaskLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "range") == 0) {
+        if (!parseInts(args, v, 6, &rest) || *rest) replyError(session, "bad_args", "Usage: range Y M D Y M D");
+        else {
+            calendarForEachInRange(session->calendar, v[0], v[1], v[2], v[3], v[4], v[5], addTaskLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "search") == 0) {
+        if (*args == '\0') replyError(session, "bad_args", "Usage: search text");
+        else {
+            calendarSearch(session->calendar, args, 0, addTaskLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "count") == 0) {
+        if (!parseInts(args, v, 3, &rest) || *rest) replyError(session, "bad_args", "Usage: count Y M D");
+        else {
+            addLine(session, "%d", calendarCountTasks(session->calendar, v[0], v[1], v[2]));
+            replyOk(session);
+        }
+    }
+    else if ((strcmp(name, "save") == 0 || strcmp(name, "load") == 0) && *args && session->no_files) {
+        replyError(session, "unavailable", "Files can't be named in this session.");
+    }
+    else if (strcmp(name, "save") == 0) {
+        int saved;
+        if (!*args && session->save) saved = session->save(session->save_data);
+        else saved = calendarSave(session->calendar, *args ? args : session->tasks_file);
+
+        if (saved) replyOk(session);
+        else replyError(session, "io", "Could not write the tasks file.");
+    }
+    else if (strcmp(name, "load") == 0) {
+        int loaded = *args ? calendarLoad(session->calendar, args) : -1;
+        if (!*args) replyError(session, "bad_args", "Usage: load file");
+        else if (loaded < 0) replyError(session, "io", "Could not open the tasks file.");
+        else {
+            addLine(session, "%d", loaded);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "events") == 0) {
+        if (!*args) v[0] = COMMAND_EVENTS_DEFAULT;
+        if (*args && (!parseInts(args, v, 1, &rest) || *rest || v[0] < 1)) replyError(session, "bad_args", "Usage: events [max]");
+        else replyEvents(session, v[0] < COMMAND_EVENTS_MAX ? v[0] : COMMAND_EVENTS_MAX);
+    }
+    else if (strcmp(name, "stats") == 0) {
+        if (*args && strcmp(args, "text") != 0 && strcmp(args, "prometheus") != 0) {
+            replyError(session, "bad_args", "Usage: stats [text|prometheus]");
+        }
+        else {
+            formatOpStats(strcmp(args, "prometheus") == 0 ? OP_STATS_PROMETHEUS : OP_STATS_TEXT, addStatsLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "memory") == 0) {
+        if (*args) replyError(session, "bad_args", "Usage: memory");
+        else {
+            formatMemStats(addStatsLine, session);
+            replyOk(session);
+        }
+    }
+    else if (strcmp(name, "ping") == 0) {
+        replyOk(session);
+    }
+    else if (strcmp(name, "help") == 0) {
+        addLine(session, "add Y M D text | update Y M D ID text | delete Y M D ID");
+        addLine(session, "day Y M D | month Y M | year Y | range Y M D Y M D");
+        addLine(session, "search text | count Y M D | save [file] | load file");
+        addLine(session, "events [max] | stats [text|prometheus] | memory | ping | help | quit | shutdown");
+        replyOk(session);
+    }
+    else if (strcmp(name, "quit") == 0) {
+        replyOk(session);
+        return COMMAND_QUIT;
+    }
+    else if (strcmp(name, "shutdown") == 0) {
+        replyOk(session);
+        return COMMAND_SHUTDOWN;
+    }
+    else {
+        replyError(session, "bad_command", "Unknown command (try help).");
+    }
+
+    return COMMAND_CONTINUE;
+}
+
+int executeCommand(struct command_session* session, const char* line) {
+    return runLine(session, line, strlen(line));
+}
+
+// =====================
+// STREAMS
+// =====================
+
+int feedCommands(struct command_session* session, const char* data, size_t length) {
+
+    int result = COMMAND_CONTINUE;
+
+    while (length > 0 && result == COMMAND_CONTINUE) {
+        const char* newline = (const char*)memchr(data, '\n', length);
+        size_t take = newline ? (size_t)(newline - data) : length;
+
+        if (session->discarding) {
+            if (newline) session->discarding = 0;
+        }
+        else if (session->partial.length + take >= COMMAND_BUFFER_SIZE) {
+            // reported once, the rest of the line is skipped
+            replyError(session, "line_too_long", "Command line too long.");
+            session->partial.length = 0;
+            session->discarding = newline == NULL;
+        }
+        else if (!newline) {
+            // keep the start of the line until the rest arrives
+            appendText(&session->partial, data, take);
+            if (session->partial.failed) {
+                replyError(session, "no_memory", "Out of memory reading the command.");
+                session->partial.length = 0;
+                session->partial.failed = 0;
+                session->discarding = 1;
+            }
+        }
+        else if (session->partial.length > 0) {
+            appendText(&session->partial, data, take);
+            if (session->partial.failed) {
+                replyError(session, "no_memory", "Out of memory reading the command.");
+                session->partial.failed = 0;
+            }
+            else {
+                result = runLine(session, session->partial.data, session->partial.length);
+            }
+            session->partial.length = 0;
+        }
+        else {
+            // the usual case: a whole line straight from the caller's buffer
+            result = runLine(session, data, take);
+        }
+
+        if (!newline) break;
+        data += take + 1;
+        length -= take + 1;
+    }
+    return result;
+}
+
+int finishCommands(struct command_session* session) {
+    int result = COMMAND_CONTINUE;
+
+    // a last line without a newline still counts
+    if (session->partial.length > 0 && !session->discarding) {
+        result = runLine(session, session->partial.data, session->partial.length);
+    }
+    session->partial.length = 0;
+    session->discarding = 0;
+    return result;
+}
+
+static long readSome(int fd, char* buffer, size_t size) {
+#ifdef _WIN32
+    return _read(fd, buffer, (unsigned int)size);
+#else
+    return (long)read(fd, buffer, size);
+#endif
+}
+
+static int writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+#ifdef _WIN32
+        long written = _write(fd, data, (unsigned int)length);
+#else
+        long written = (long)write(fd, data, length);
+#endif
+        if (written <= 0) return 0;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+// sends everything collected so far; returns 0 if the other side is gone
+static int flushOutput(struct command_session* session, int out_fd) {
+    int ok = writeAll(out_fd, session->output.data, session->output.length);
+    clearCommandOutput(session);
+    return ok;
+}
+
+int runCommandStream(struct command_session* session, int in_fd, int out_fd) {
+
+    char* buffer = (char*)malloc(COMMAND_BUFFER_SIZE);
+    if (!buffer) return COMMAND_QUIT;
+
+    int result = COMMAND_CONTINUE;
+    while (result == COMMAND_CONTINUE) {
+        long got = readSome(in_fd, buffer, COMMAND_BUFFER_SIZE);
+        if (got <= 0) {
+            result = finishCommands(session);
+            break;
+        }
+
+        // run every complete line we have, then answer all of them with one write
+        result = feedCommands(session, buffer, (size_t)got);
+        if (!flushOutput(session, out_fd)) result = COMMAND_QUIT;
+    }
+
+    flushOutput(session, out_fd);
+    free(buffer);
+    return result == COMMAND_CONTINUE ? COMMAND_QUIT : result;
+}
+
+// =====================
+// ENTRY POINT
+// =====================
+
+static int printUsage(void) {
+    fprintf(stderr,
+        "usage: calendar --batch [file]   run commands from file (or stdin), replies on stdout\n"
+        "       calendar --socket path    serve commands on a Unix socket until \"shutdown\"\n"
+        "options:\n"
+        "       --tasks file              loaded at start and written by \"save\" (default tasks.txt)\n"
+        "       --workers n               socket: threads running commands (default one per CPU)\n"
+        "       --persist-ms n            socket: autosave interval if anything changed (default 2000, 0 = off)\n"
+        "       --shm name                socket: keep the calendar in shared memory for viewers (e.g. /calendar)\n"
+        "       --io backend              how the tasks file is read / written: stdio (default), pread, uring, auto\n"
+        "       --events n                size of the change event ring \"events\" reads (default 4096, 0 = off)\n"
+        "       --trace file              write a Chrome trace (JSON) of the load, saves, searches... at exit\n"
+        "batch mode saves only when a \"save\" command says so; the socket server also\n"
+        "autosaves and saves at shutdown\n");
+    return 2;
+}
+
+int commandMain(int argc, char** argv) {
+
+    const char* tasks_file = "tasks.txt";
+    const char* batch_file = NULL;
+    const char* socket_path = NULL;
+    const char* shared_name = NULL;
+    const char* trace_file = NULL;
+    int batch = 0;
+    enum file_io_backend io = FILE_IO_STDIO;
+    int event_ring_size = COMMAND_EVENT_RING;
+
+    struct command_server_options server_options;
+    initCommandServerOptions(&server_options);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) batch_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) socket_path = argv[++i];
+        else if (strcmp(argv[i], "--tasks") == 0 && i + 1 < argc) tasks_file = argv[++i];
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) server_options.workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--persist-ms") == 0 && i + 1 < argc) server_options.persist_millis = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) event_ring_size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) shared_name = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) trace_file = argv[++i];
+        else if (strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+            if (!parseFileIOBackend(argv[++i], &io)) return printUsage();
+        }
+        else return printUsage();
+    }
+    if (batch == (socket_path != NULL)) return printUsage();
+    // a batch run would take its segment away again when it exits
+    if (shared_name && !socket_path) return printUsage();
+
+    if (trace_file) {
+        if (traceStart(0)) traceThreadName("main");
+        else fprintf(stderr, "Tracing is not available; running without it.\n");
+    }
+
+    // replies carry the status, so the core stays quiet
+    struct calendar_options options;
+    initCalendarOptions(&options);
+    options.silent = 1;
+    options.io = resolveFileIOBackend(io);
+
+    // overwrite mode: a client that stops reading events must not stall the others
+    struct event_ring* events = event_ring_size > 0 ? createEventRing(event_ring_size, EVENT_RING_OVERWRITE, 0) : NULL;
+    options.events = events;
+
+    struct calendar* calendar = createCalendar(&options);
+    if (!calendar) {
+        fprintf(stderr, "Out of memory.\n");
+        freeEventRing(events);
+        return 1;
+    }
+    calendarLoad(calendar, tasks_file);
+
+    int exit_code = 0;
+
+    if (socket_path) {
+        server_options.socket_path = socket_path;
+        server_options.tasks_file = tasks_file;
+        if (shared_name) {
+            server_options.shared = createSharedCalendar(shared_name);
+            if (!server_options.shared) fprintf(stderr, "Could not create shared memory %s; serving without it.\n", shared_name);
+        }
+        exit_code = runCommandServer(calendar, &server_options) == 0 ? 0 : 1;
+        destroySharedCalendar(server_options.shared);
+    }
+    else {
+        FILE* input = stdin;
+        if (batch_file && strcmp(batch_file, "-") != 0) {
+            fopen_s(&input, batch_file, "r");
+            if (!input) {
+                fprintf(stderr, "Could not open %s\n", batch_file);
+                destroyCalendar(calendar);
+                freeEventRing(events);
+                return 1;
+            }
+        }
+
+        struct command_session* session = createCommandSession(calendar, tasks_file);
+        if (session) {
+            fflush(stdout);
+#ifdef _WIN32
+            runCommandStream(session, _fileno(input), _fileno(stdout));
+#else
+            runCommandStream(session, fileno(input), fileno(stdout));
+#endif
+            freeCommandSession(session);
+        }
+        else {
+            exit_code = 1;
+        }
+
+        if (input != stdin) fclose(input);
+    }
+
+    destroyCalendar(calendar);
+    freeEventRing(events);
+
+    if (traceActive()) {
+        traceStop();
+        if (!saveTrace(trace_file)) fprintf(stderr, "Could not write the trace to %s\n", trace_file);
+        traceClear();
+    }
+    return exit_code;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stddef.h>
+
+#include "CalendarContext.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Line-based command protocol, for driving the calendar from scripts and load
+    // tests instead of the interactive menu.
+    //
+    // One command per line, arguments separated by spaces; the description is the
+    // rest of the line:
+    //   add Y M D text          update Y M D ID text      delete Y M D ID
+    //   day Y M D               month Y M                 year Y
+    //   range Y M D Y M D       search text               count Y M D
+    //   save [file]             load file                 events [max]
+    //   stats [text|prometheus] memory                    ping
+    //   help                    quit                      shutdown
+    //
+    // Every command gets exactly one reply, in order:
+    //   OK n                    followed by n data lines
+    //   ERR code message        code: bad_command, bad_args, invalid_date,
+    //                           not_found, no_memory, io, line_too_long, unavailable
+    // Task data lines are "YYYY-MM-DD<TAB>id<TAB>description"; count and help
+    // reply with plain lines.
+    //
+    // "events" follows the change stream (EventRing.h): the first one in a session
+    // subscribes, every later one returns what changed since the previous call as
+    // "sequence<TAB>add|update|delete|reload<TAB>YYYY-MM-DD<TAB>id" lines, with a
+    // "lost<TAB>n" line where n events were overwritten before the session asked.
+    //
+    // "stats" replies with the per-operation counters and latencies (OpStats.h),
+    // one line each, as a table or in Prometheus text format.
+    // "memory" replies with the calendar's live memory per year and kind, and the
+    // peaks (MemStats.h).
+    //
+    // Replies are buffered, and a stream only writes once it has run every complete
+    // line it has read, so a client can pipeline thousands of commands per write.
+    // The server (CommandServer.h) serves the same protocol on a Unix socket.
+    struct command_session;
+
+    enum command_result {
+        COMMAND_CONTINUE,
+        COMMAND_QUIT,           // end this session
+        COMMAND_SHUTDOWN        // end this session and stop the server
+    };
+
+    // tasks_file is what "save" with no argument writes to
+    struct command_session* createCommandSession(struct calendar* calendar, const char* tasks_file);
+    void freeCommandSession(struct command_session* session);
+
+    // lets the owner do "save" with no argument itself (the server uses this so
+    // every session's save goes through one writer); returns 1 on success
+    typedef int (*CommandSaveFn)(void* user_data);
+    void setCommandSaveHandler(struct command_session* session, CommandSaveFn save, void* user_data);
+    // "save file" and "load file" reply ERR unavailable from then on ("save" with
+    // no argument still works); the server does this, so clients can't read or
+    // write arbitrary paths as the server, or save around its one writer
+    void disallowCommandFiles(struct command_session* session);
+
+    // runs one command (no trailing newline needed); the reply is appended to the
+    // session's output; returns an enum command_result
+    int executeCommand(struct command_session* session, const char* line);
+
+    // runs every complete line in data; the start of a line without its newline
+    // is kept until the next call. Stops at quit / shutdown (anything after that
+    // is dropped) and returns an enum command_result.
+    int feedCommands(struct command_session* session, const char* data, size_t length);
+    // at end of input: runs a last line that never got its newline
+    int finishCommands(struct command_session* session);
+
+    // replies collected so far (not NUL-terminated when length is given)
+    const char* commandOutput(const struct command_session* session, size_t* length);
+    void clearCommandOutput(struct command_session* session);
+
+    // reads commands from in_fd until EOF / quit, writing replies to out_fd
+    // returns an enum command_result (COMMAND_QUIT at EOF)
+    int runCommandStream(struct command_session* session, int in_fd, int out_fd);
+
+    // entry point for the non-interactive modes (see usage in Commands.c);
+    // returns the process exit code
+    int commandMain(int argc, char** argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef COMPAT_H
+#define COMPAT_H
+
+// The MSVC "secure" CRT calls the code is written with (fopen_s, strcpy_s, ...),
+// for every other compiler, so the same sources build with gcc / clang.
+// With MSVC this header does nothing.
+//
+// sscanf_s / scanf_s only ever get plain numeric conversions (no %s, %c or %[,
+// which would need the extra buffer size arguments), so they map straight onto
+// sscanf / scanf. The description in a tasks file line is read with
+// parseTaskLine instead.
+
+#ifndef _MSC_VER
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline int fopen_s(FILE** file, const char* filename, const char* mode) {
+    *file = fopen(filename, mode);
+    return *file ? 0 : errno;
+}
+
+// too small a buffer leaves it empty and returns ERANGE (MSVC would stop the program)
+static inline int strcpy_s(char* destination, size_t size, const char* source) {
+    size_t length = strlen(source);
+    if (length >= size) {
+        if (size > 0) destination[0] = '\0';
+        return ERANGE;
+    }
+    memcpy(destination, source, length + 1);
+    return 0;
+}
+
+static inline int strcat_s(char* destination, size_t size, const char* source) {
+    size_t used = 0;
+    while (used < size && destination[used] != '\0') used++;
+    size_t length = strlen(source);
+    if (used + length >= size) {
+        if (size > 0) destination[0] = '\0';
+        return ERANGE;
+    }
+    memcpy(destination + used, source, length + 1);
+    return 0;
+}
+
+#define sscanf_s sscanf
+#define scanf_s scanf
+
+#ifndef _WIN32
+#define _fileno fileno
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
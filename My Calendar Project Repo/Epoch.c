@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Epoch.h"
+#include "Platform.h"
+
+// more readers than this at once just wait for a free slot
+#define EPOCH_READER_SLOTS 64
+
+// one reader's announcement: 0 = free, otherwise (epoch << 1) | 1
+// epochs are unsigned 64-bit (long is 32 bits on Windows), so neither the
+// epoch nor the shifted state wraps in any realistic run
+// padded to a cache line so readers on different slots don't fight over it
+struct reader_slot {
+    volatile unsigned long long state;
+    char padding[64 - sizeof(unsigned long long)];
+};
+
+struct retired {
+    void* memory;
+    EpochFreeFn free_fn;
+    struct retired* next;
+};
+
+struct epoch_domain {
+    struct reader_slot readers[EPOCH_READER_SLOTS];
+    volatile unsigned long long epoch;
+
+    // retire lists for the last three epochs (index epoch % 3), writers only
+    platform_mutex retire_lock;
+    struct retired* lists[3];
+    long pending;
+    unsigned long long freed;
+};
+
+struct epoch_domain* createEpochDomain(void) {
+    struct epoch_domain* domain = (struct epoch_domain*)calloc(1, sizeof(struct epoch_domain));
+    if (!domain) return NULL;
+    mutexInit(&domain->retire_lock);
+    return domain;
+}
+
+static int freeList(struct epoch_domain* domain, int index) {
+    int count = 0;
+    struct retired* item = domain->lists[index];
+    domain->lists[index] = NULL;
+
+    while (item) {
+        struct retired* next = item->next;
+        item->free_fn(item->memory);
+        free(item);
+        item = next;
+        count++;
+    }
+
+    domain->pending -= count;
+    domain->freed += count;
+    return count;
+}
+
+void freeEpochDomain(struct epoch_domain* domain) {
+    if (!domain) return;
+    for (int i = 0; i < 3; i++) freeList(domain, i);
+    mutexDestroy(&domain->retire_lock);
+    free(domain);
+}
+
+int epochEnter(struct epoch_domain* domain) {
+
+    // start somewhere that depends on the thread (its stack), so readers spread out
+    int local;
+    int start = (int)(((size_t)&local >> 12) % EPOCH_READER_SLOTS);
+
+    for (;;) {
+        unsigned long long epoch = atomicLoad64(&domain->epoch);
+
+        for (int i = 0; i < EPOCH_READER_SLOTS; i++) {
+            int slot = (start + i) % EPOCH_READER_SLOTS;
+
+            // the (full barrier) CAS publishes us before we read anything shared;
+            // if the epoch moved on meanwhile we just hold it back a little longer
+            if (atomicLoadRelaxed64(&domain->readers[slot].state) == 0
+                && atomicCompareSwap64(&domain->readers[slot].state, 0, (epoch << 1) | 1)) {
+                return slot;
+            }
+        }
+        threadYield();
+    }
+}
+
+void epochExit(struct epoch_domain* domain, int slot) {
+    atomicStore64(&domain->readers[slot].state, 0);
+}
+
+// call with retire_lock held
+// the epoch can only move on when every reader inside has seen the current one
+static int tryAdvance(struct epoch_domain* domain) {
+
+    unsigned long long epoch = atomicLoad64(&domain->epoch);
+
+    for (int i = 0; i < EPOCH_READER_SLOTS; i++) {
+        unsigned long long state = atomicLoad64(&domain->readers[i].state);
+        if (state != 0 && (state >> 1) != epoch) return 0;
+    }
+
+    // everything retired two epochs ago is unreachable now
+    unsigned long long next = epoch + 1;
+    atomicStore64(&domain->epoch, next);
+    return freeList(domain, (int)((next + 1) % 3));
+}
+
+void epochRetire(struct epoch_domain* domain, void* memory, EpochFreeFn free_fn) {
+
+    if (!memory) return;
+
+    struct retired* item = (struct retired*)malloc(sizeof(struct retired));
+
+    mutexLock(&domain->retire_lock);
+
+    if (!item) {
+        // no memory for the record: wait it out instead (two epoch moves)
+        unsigned long long target = atomicLoad64(&domain->epoch) + 2;
+        while (atomicLoad64(&domain->epoch) < target) {
+            if (!tryAdvance(domain)) {
+                mutexUnlock(&domain->retire_lock);
+                threadYield();
+                mutexLock(&domain->retire_lock);
+            }
+        }
+        mutexUnlock(&domain->retire_lock);
+        free_fn(memory);
+        return;
+    }
+
+    unsigned long long epoch = atomicLoad64(&domain->epoch);
+    item->memory = memory;
+    item->free_fn = free_fn;
+    item->next = domain->lists[epoch % 3];
+    domain->lists[epoch % 3] = item;
+    domain->pending++;
+
+    tryAdvance(domain);
+
+    mutexUnlock(&domain->retire_lock);
+}
+
+int epochCollect(struct epoch_domain* domain) {
+    mutexLock(&domain->retire_lock);
+    int freed = tryAdvance(domain);
+    mutexUnlock(&domain->retire_lock);
+    return freed;
+}
+
+void getEpochStats(struct epoch_domain* domain, struct epoch_stats* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!domain) return;
+
+    mutexLock(&domain->retire_lock);
+    stats->epoch = atomicLoad64(&domain->epoch);
+    stats->pending = domain->pending;
+    stats->freed = domain->freed;
+    mutexUnlock(&domain->retire_lock);
+}
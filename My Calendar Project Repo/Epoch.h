@@ -0,0 +1,49 @@
+#pragma once
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Epoch-based reclamation, so readers can walk shared lists without locks.
+    //
+    // Readers bracket their walk with epochEnter / epochExit. A writer that unlinks
+    // something hands it to epochRetire instead of freeing it; it's freed once every
+    // reader that was inside when it was unlinked has left (the global epoch has
+    // moved on twice). Readers never wait; writers only pay for the retire record
+    // and an occasional scan of the reader slots.
+    //
+    // A reader must not hold on to anything it found after epochExit.
+    struct epoch_domain;
+
+    typedef void (*EpochFreeFn)(void* memory);
+
+    struct epoch_stats {
+        unsigned long long epoch;   // current global epoch
+        long pending;               // retired, not freed yet
+        unsigned long long freed;   // freed so far
+    };
+
+    struct epoch_domain* createEpochDomain(void);
+
+    // frees everything still pending; no reader may be inside
+    void freeEpochDomain(struct epoch_domain* domain);
+
+    // returns the reader slot to give back to epochExit
+    int epochEnter(struct epoch_domain* domain);
+    void epochExit(struct epoch_domain* domain, int slot);
+
+    // memory will be passed to free_fn once no reader can see it any more
+    void epochRetire(struct epoch_domain* domain, void* memory, EpochFreeFn free_fn);
+
+    // tries to move the epoch on and free what became safe; returns how many were freed
+    int epochCollect(struct epoch_domain* domain);
+
+    void getEpochStats(struct epoch_domain* domain, struct epoch_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
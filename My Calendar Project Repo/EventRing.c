@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalendarInternal.h"
+#include "EventRing.h"
+#include "Platform.h"
+
+#define EVENT_MAX_SUBSCRIBERS 64
+// polls before a waiting subscriber yields, then before it goes to sleep
+#define EVENT_SPINS 64
+#define EVENT_YIELDS 16
+
+// one event; every field is written atomically so subscribers can read a slot
+// while the producer may be writing it (the stamp tells them afterwards)
+struct event_slot {
+    volatile unsigned long long stamp;  // 2 * sequence once written, odd while being written
+    volatile long type;
+    volatile long year;
+    volatile long month;
+    volatile long day;
+    volatile long task_id;
+};
+
+struct event_ring {
+    struct event_slot* slots;
+    unsigned long long capacity;        // power of two
+    unsigned long long mask;
+    enum event_ring_overflow overflow;
+    int max_wait_millis;
+
+    platform_mutex produce_lock;        // one producer at a time
+    volatile unsigned long long head;   // next sequence; everything before it is written
+
+    // next sequence each subscriber will read (0 = free entry); the producer
+    // looks at them in WAIT mode
+    volatile unsigned long long cursors[EVENT_MAX_SUBSCRIBERS];
+    // WAIT: 1 once the producer gave up waiting for that subscriber; it isn't
+    // waited for again until it has caught up
+    volatile long dropped[EVENT_MAX_SUBSCRIBERS];
+
+    // sleeping subscribers
+    volatile long sleepers;
+    platform_mutex wake_lock;
+    platform_cond wake;
+
+    volatile unsigned long long producer_waits;
+    volatile unsigned long long forced;
+    volatile unsigned long long drops;
+};
+
+struct event_subscriber {
+    struct event_ring* ring;
+    int index;
+};
+
+struct event_ring* createEventRing(int capacity, enum event_ring_overflow overflow, int max_wait_millis) {
+
+    unsigned long long size = 16;
+    while (size < (unsigned long long)capacity) size *= 2;
+
+    struct event_ring* ring = (struct event_ring*)calloc(1, sizeof(struct event_ring));
+    if (!ring) return NULL;
+
+    ring->slots = (struct event_slot*)calloc((size_t)size, sizeof(struct event_slot));
+    if (!ring->slots) {
+        free(ring);
+        return NULL;
+    }
+
+    ring->capacity = size;
+    ring->mask = size - 1;
+    ring->overflow = overflow;
+    ring->max_wait_millis = max_wait_millis;
+    ring->head = 1;
+    mutexInit(&ring->produce_lock);
+    mutexInit(&ring->wake_lock);
+    condInit(&ring->wake);
+    return ring;
+}
+
+void freeEventRing(struct event_ring* ring) {
+    if (!ring) return;
+    condDestroy(&ring->wake);
+    mutexDestroy(&ring->wake_lock);
+    mutexDestroy(&ring->produce_lock);
+    free(ring->slots);
+    free(ring);
+}
+
+// =====================
+// PRODUCER
+// =====================
+
+// 1 if sequence can be written without overwriting anything a subscriber hasn't read
+static int hasRoom(struct event_ring* ring, unsigned long long sequence) {
+    for (int i = 0; i < EVENT_MAX_SUBSCRIBERS; i++) {
+        unsigned long long cursor = atomicLoad64(&ring->cursors[i]);
+        if (cursor != 0 && sequence - cursor >= ring->capacity && !atomicLoadLong(&ring->dropped[i])) return 0;
+    }
+    return 1;
+}
+
+// past the deadline: stops waiting for everyone who still hasn't made room, so
+// one stuck subscriber costs one wait, not one per publish
+static void dropLagging(struct event_ring* ring, unsigned long long sequence) {
+    for (int i = 0; i < EVENT_MAX_SUBSCRIBERS; i++) {
+        unsigned long long cursor = atomicLoad64(&ring->cursors[i]);
+        if (cursor != 0 && sequence - cursor >= ring->capacity && !atomicLoadLong(&ring->dropped[i])) {
+            atomicStoreLong(&ring->dropped[i], 1);
+            atomicIncrement64(&ring->drops);
+        }
+    }
+}
+
+// WAIT mode: backs off until the slowest subscriber has made room, or the deadline passes
+static void waitForRoom(struct event_ring* ring, unsigned long long sequence) {
+
+    if (hasRoom(ring, sequence)) return;
+    atomicIncrement64(&ring->producer_waits);
+
+    long long deadline = platformNowNanos() + (long long)ring->max_wait_millis * 1000000LL;
+    for (int round = 0; !hasRoom(ring, sequence); round++) {
+        if (platformNowNanos() >= deadline) {
+            atomicIncrement64(&ring->forced);
+            dropLagging(ring, sequence);
+            return;
+        }
+        if (round < EVENT_YIELDS) threadYield();
+        else threadSleepMillis(1);
+    }
+}
+
+unsigned long long publishEvent(struct event_ring* ring, int type, int year, int month, int day, int task_id) {
+
+    mutexLock(&ring->produce_lock);
+
+    unsigned long long sequence = ring->head;
+    if (ring->overflow == EVENT_RING_WAIT) waitForRoom(ring, sequence);
+
+    struct event_slot* slot = &ring->slots[sequence & ring->mask];
+    atomicStore64(&slot->stamp, 2 * sequence - 1);
+    atomicStoreLong(&slot->type, type);
+    atomicStoreLong(&slot->year, year);
+    atomicStoreLong(&slot->month, month);
+    atomicStoreLong(&slot->day, day);
+    atomicStoreLong(&slot->task_id, task_id);
+    atomicStore64(&slot->stamp, 2 * sequence);
+    atomicStore64(&ring->head, sequence + 1);
+
+    mutexUnlock(&ring->produce_lock);
+
+    // a subscriber that went to sleep has bumped sleepers before its last look at
+    // head, so one of the two always sees the other
+    if (atomicLoadLong(&ring->sleepers) > 0) {
+        mutexLock(&ring->wake_lock);
+        condBroadcast(&ring->wake);
+        mutexUnlock(&ring->wake_lock);
+    }
+    return sequence;
+}
+
+// =====================
+// SUBSCRIBERS
+// =====================
+
+struct event_subscriber* subscribeEvents(struct event_ring* ring, int from_start) {
+
+    struct event_subscriber* subscriber = (struct event_subscriber*)malloc(sizeof(struct event_subscriber));
+    if (!subscriber) return NULL;
+
+    unsigned long long head = atomicLoad64(&ring->head);
+    unsigned long long start = head;
+    if (from_start) start = head > ring->capacity ? head - ring->capacity : 1;
+
+    for (int i = 0; i < EVENT_MAX_SUBSCRIBERS; i++) {
+        if (atomicCompareSwap64(&ring->cursors[i], 0, start)) {
+            subscriber->ring = ring;
+            subscriber->index = i;
+            return subscriber;
+        }
+    }
+
+    free(subscriber);
+    return NULL;
+}
+
+void unsubscribeEvents(struct event_subscriber* subscriber) {
+    if (!subscriber) return;
+    atomicStoreLong(&subscriber->ring->dropped[subscriber->index], 0);
+    atomicStore64(&subscriber->ring->cursors[subscriber->index], 0);
+    free(subscriber);
+}
+
+int pollEvents(struct event_subscriber* subscriber, struct task_event* events, int max, unsigned long long* lost) {
+
+    struct event_ring* ring = subscriber->ring;
+    unsigned long long cursor = atomicLoad64(&ring->cursors[subscriber->index]);
+    unsigned long long skipped = 0;
+    int count = 0;
+
+    while (count < max) {
+        unsigned long long head = atomicLoad64(&ring->head);
+        if (cursor >= head) break;
+
+        // a whole ring behind: everything before head - capacity is gone
+        if (head - cursor > ring->capacity) {
+            skipped += head - ring->capacity - cursor;
+            cursor = head - ring->capacity;
+        }
+
+        struct event_slot* slot = &ring->slots[cursor & ring->mask];
+        unsigned long long stamp = atomicLoad64(&slot->stamp);
+
+        struct task_event event;
+        event.sequence = cursor;
+        event.type = (int)atomicLoadLong(&slot->type);
+        event.year = (int)atomicLoadLong(&slot->year);
+        event.month = (int)atomicLoadLong(&slot->month);
+        event.day = (int)atomicLoadLong(&slot->day);
+        event.task_id = (int)atomicLoadLong(&slot->task_id);
+
+        // the producer got to the slot first (or while we were reading it)
+        if (stamp != 2 * cursor || atomicLoad64(&slot->stamp) != stamp) {
+            skipped++;
+            cursor++;
+            continue;
+        }
+
+        events[count++] = event;
+        cursor++;
+    }
+
+    atomicStore64(&ring->cursors[subscriber->index], cursor);
+    // a dropped subscriber that has caught up is waited for again
+    if (atomicLoadLong(&ring->dropped[subscriber->index]) && cursor >= atomicLoad64(&ring->head)) {
+        atomicStoreLong(&ring->dropped[subscriber->index], 0);
+    }
+    if (lost) *lost = skipped;
+    return count;
+}
+
+int waitEvents(struct event_subscriber* subscriber, struct task_event* events, int max,
+    unsigned long long* lost, int timeout_millis) {
+
+    int count = pollEvents(subscriber, events, max, lost);
+    if (count > 0 || (lost && *lost > 0) || timeout_millis == 0) return count;
+
+    struct event_ring* ring = subscriber->ring;
+    unsigned long long cursor = atomicLoad64(&ring->cursors[subscriber->index]);
+
+    // changes often come in bursts: a short spin catches the next one cheaply
+    for (int i = 0; i < EVENT_SPINS + EVENT_YIELDS; i++) {
+        if (atomicLoad64(&ring->head) > cursor) return pollEvents(subscriber, events, max, lost);
+        if (i >= EVENT_SPINS) threadYield();
+    }
+
+    long long deadline = platformNowNanos() + (long long)timeout_millis * 1000000LL;
+
+    atomicAddLong(&ring->sleepers, 1);
+    mutexLock(&ring->wake_lock);
+    while (atomicLoad64(&ring->head) <= cursor) {
+        long long left = (deadline - platformNowNanos()) / 1000000LL;
+        if (timeout_millis > 0 && left <= 0) break;
+        if (timeout_millis < 0) condWait(&ring->wake, &ring->wake_lock);
+        else condWaitMillis(&ring->wake, &ring->wake_lock, (int)left + 1);
+    }
+    mutexUnlock(&ring->wake_lock);
+    atomicAddLong(&ring->sleepers, -1);
+
+    return pollEvents(subscriber, events, max, lost);
+}
+
+void getEventRingStats(struct event_ring* ring, struct event_ring_stats* stats) {
+    stats->published = atomicLoad64(&ring->head) - 1;
+    stats->producer_waits = atomicLoad64(&ring->producer_waits);
+    stats->forced = atomicLoad64(&ring->forced);
+    stats->dropped = atomicLoad64(&ring->drops);
+    stats->subscribers = 0;
+    for (int i = 0; i < EVENT_MAX_SUBSCRIBERS; i++) {
+        if (atomicLoad64(&ring->cursors[i]) != 0) stats->subscribers++;
+    }
+}
+
+// =====================
+// CALENDAR HOOKUP
+// =====================
+
+static struct event_ring* volatile g_taskEvents = NULL;
+
+void setTaskEventRing(struct event_ring* ring) {
+    atomicPublishPointer((void* volatile*)&g_taskEvents, ring);
+}
+
+struct event_ring* taskEventRing(void) {
+    return (struct event_ring*)atomicReadPointer((void* volatile*)&g_taskEvents);
+}
+
+void emitTaskEvent(int type, int year, int month, int day, int task_id) {
+    struct event_ring* ring = taskEventRing();
+    if (ring) publishEvent(ring, type, year, month, day, task_id);
+}
+
+const char* taskEventName(int type) {
+    switch (type) {
+    case TASK_EVENT_ADD: return "add";
+    case TASK_EVENT_UPDATE: return "update";
+    case TASK_EVENT_DELETE: return "delete";
+    case TASK_EVENT_RELOAD: return "reload";
+    }
+    return "?";
+}
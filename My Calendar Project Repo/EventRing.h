@@ -0,0 +1,100 @@
+#pragma once
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Stream of task changes, for things that want to follow the calendar (a
+    // notifier, an index kept up to date) without diffing tasks.txt.
+    //
+    // A calendar context (CalendarContext.h) publishes one small event per change
+    // into the ring in its options; the plain functions (addTask / updateTask /
+    // deleteTask, the batch ops and the loads) publish into the ring set with
+    // setTaskEventRing. Events only say what changed where: the description is in
+    // the calendar.
+    //
+    // The ring is bounded (a power of two of slots) and has one producer at a time:
+    // publishers take a short lock among themselves, which also puts the events
+    // in the order the changes were made. Subscribers never lock: each one has a
+    // cursor and copies events out of the slots, checking each slot's stamp to
+    // notice when the producer has lapped it.
+    //
+    // What happens when a subscriber falls a whole ring behind is up to the ring:
+    // - EVENT_RING_OVERWRITE  the producer never waits; the oldest events are
+    //                         overwritten and the subscriber is told how many it lost
+    // - EVENT_RING_WAIT       the producer waits (up to max_wait_millis) for the
+    //                         slowest subscriber to make room, which slows down the
+    //                         writers instead of losing events; past the deadline
+    //                         it overwrites anyway and drops the subscribers it was
+    //                         waiting for, so a stuck one costs one wait and not
+    //                         one per change (a dropped subscriber loses events like
+    //                         in OVERWRITE until it has caught up, then counts again)
+    struct event_ring;
+    struct event_subscriber;
+
+    enum task_event_type {
+        TASK_EVENT_ADD = 1,         // task_id is the new task's id
+        TASK_EVENT_UPDATE,          // description of task_id replaced
+        TASK_EVENT_DELETE,          // task_id removed, later ids on that day moved down by one
+        TASK_EVENT_RELOAD           // a file was loaded: task_id = how many tasks it added (no date)
+    };
+
+    struct task_event {
+        unsigned long long sequence;    // 1, 2, 3 ... per ring, no gaps
+        int type;                       // enum task_event_type
+        int year;
+        int month;
+        int day;
+        int task_id;
+    };
+
+    enum event_ring_overflow {
+        EVENT_RING_OVERWRITE,
+        EVENT_RING_WAIT
+    };
+
+    struct event_ring_stats {
+        unsigned long long published;
+        unsigned long long producer_waits;  // WAIT: times the producer had to wait for room
+        unsigned long long forced;          // WAIT: events written over unread ones after the deadline
+        unsigned long long dropped;         // WAIT: subscribers no longer waited for after a deadline
+        int subscribers;
+    };
+
+    // capacity is rounded up to a power of two; NULL if memory runs out
+    struct event_ring* createEventRing(int capacity, enum event_ring_overflow overflow, int max_wait_millis);
+    // every subscriber must be gone, and nothing may be publishing into it
+    void freeEventRing(struct event_ring* ring);
+
+    // returns the event's sequence number
+    unsigned long long publishEvent(struct event_ring* ring, int type, int year, int month, int day, int task_id);
+
+    // from_start = 1: every event still in the ring, otherwise only new ones;
+    // NULL when the subscriber table (64) is full
+    struct event_subscriber* subscribeEvents(struct event_ring* ring, int from_start);
+    void unsubscribeEvents(struct event_subscriber* subscriber);
+
+    // copies up to max events, oldest first; *lost (optional) gets how many were
+    // overwritten before this subscriber could read them. Never blocks.
+    int pollEvents(struct event_subscriber* subscriber, struct task_event* events, int max, unsigned long long* lost);
+    // same, but waits up to timeout_millis for at least one event (spinning briefly first)
+    int waitEvents(struct event_subscriber* subscriber, struct task_event* events, int max,
+        unsigned long long* lost, int timeout_millis);
+
+    void getEventRingStats(struct event_ring* ring, struct event_ring_stats* stats);
+
+    // the ring the plain mutation functions publish to (NULL = none, the default);
+    // contexts don't use it, each has its own (calendar_options.events)
+    void setTaskEventRing(struct event_ring* ring);
+    struct event_ring* taskEventRing(void);
+
+    // "add" / "update" / "delete" / "reload"
+    const char* taskEventName(int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
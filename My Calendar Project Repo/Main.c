@@ -0,0 +1,63 @@
+#include <stdio.h>
+
+#include "Calendar.h"
+#include "CalendarInternal.h"
+#include "Commands.h"
+
+// =====================
+// MAIN
+// =====================
+//All Contributed
+int main(int argc, char** argv) {
+
+    // any arguments = non-interactive command mode (see Commands.h)
+    if (argc > 1) {
+        return commandMain(argc, argv);
+    }
+
+    // Load existing calendar from disk if it exists
+    struct years* calendar = loadTasks("tasks.txt");
+
+    // If no calendar is loaded, ask the user what year to start with
+    if (!calendar) {
+
+        printf("No calendar file found or file is empty.\n");
+
+        int start_year = 0;
+        printf("What year would you like to start with? ");
+
+        // keep asking until we get a valid integer year
+        while (scanf_s("%d", &start_year) != 1 || start_year < 1) {
+
+            printf("Invalid input. Please enter a valid year (e.g., 2025): ");
+
+            // clear input buffer in case of non-numeric input
+            int ch;
+            while ((ch = getchar()) != '\n' && ch != EOF);
+        }
+
+        // create the initial year structure
+        findOrAddYear(&calendar, start_year);
+
+        // save immediately so tasks.txt exists for the next run
+        if (!saveTasks("tasks.txt", calendar)) {
+            printf("Error: Could not save initial calendar file.\n");
+        }
+        else {
+            printf("Calendar for %d created and saved.\n", start_year);
+        }
+    }
+
+    // run menu UI
+    menu(&calendar);
+
+    // save back to disk on exit
+    if (!saveTasks("tasks.txt", calendar)) {
+        printf("Error saving tasks to file.\n");
+    }
+
+    // free everything before exiting
+    freeCalendar(calendar);
+
+    return 0;
+}
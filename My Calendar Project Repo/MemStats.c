@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalendarInternal.h"
+#include "MemStats.h"
+#include "Platform.h"
+
+static const char* g_kind_names[MEM_KIND_COUNT] = {
+    "years", "months", "days", "tasks", "descriptions"
+};
+
+struct mem_counters {
+    unsigned long long bytes[MEM_KIND_COUNT];
+    unsigned long long count[MEM_KIND_COUNT];
+    unsigned long long total;
+    unsigned long long total_peak;
+};
+
+// per year counters live in an open addressing table; a slot is claimed the
+// first time its year allocates and stays with that year, so lookups never lock
+#define MEM_YEAR_SLOTS 4096
+
+enum slot_state { SLOT_EMPTY, SLOT_CLAIMED, SLOT_READY };
+
+struct mem_year_slot {
+    long state;                 // enum slot_state
+    int year;                   // set before state becomes SLOT_READY
+    struct mem_counters counters;
+};
+
+static struct mem_year_slot g_year_slots[MEM_YEAR_SLOTS];
+static struct mem_counters g_other_years;   // years that found no free slot
+
+// only total / total_peak; the per kind totals are summed up from the years
+// when asked for, which keeps an allocation down to one set of counters
+static struct mem_counters g_totals;
+
+// in front of every tracked block (16 bytes, so the block keeps malloc's alignment);
+// it says which counters the block went to, so freeing it doesn't look anything up
+struct mem_tag {
+    int kind;
+    int slot;                   // index into g_year_slots, -1 = g_other_years
+    unsigned int size;
+    unsigned int text;          // bytes of size that are a description
+};
+
+int memStatsEnabled(void) {
+#ifdef CALENDAR_NO_MEM_STATS
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+const char* memKindName(int kind) {
+    return kind >= 0 && kind < MEM_KIND_COUNT ? g_kind_names[kind] : "unknown";
+}
+
+// =====================
+// COUNTERS
+// =====================
+
+static struct mem_year_slot* findYearSlot(int year, int create) {
+
+    unsigned int start = ((unsigned int)year * 2654435761u) >> 20;     // top 12 bits
+
+    for (int i = 0; i < MEM_YEAR_SLOTS; i++) {
+        struct mem_year_slot* slot = &g_year_slots[(start + i) & (MEM_YEAR_SLOTS - 1)];
+
+        long state = atomicLoadLong(&slot->state);
+        if (state == SLOT_EMPTY) {
+            // slots are never given back, so the year isn't further along either
+            if (!create) return NULL;
+            if (atomicCompareSwapLong(&slot->state, SLOT_EMPTY, SLOT_CLAIMED)) {
+                slot->year = year;
+                atomicStoreLong(&slot->state, SLOT_READY);
+                return slot;
+            }
+            state = atomicLoadLong(&slot->state);
+        }
+        while (state == SLOT_CLAIMED) {
+            threadYield();
+            state = atomicLoadLong(&slot->state);
+        }
+        if (slot->year == year) return slot;
+    }
+    return NULL;                // more years than slots (they go to g_other_years)
+}
+
+#ifndef CALENDAR_NO_MEM_STATS
+// the last year this thread allocated for (a year's blocks tend to come in runs)
+static PLATFORM_THREAD_LOCAL struct mem_year_slot* t_last_slot = NULL;
+
+static int slotFor(int year) {
+
+    struct mem_year_slot* slot = t_last_slot;
+    if (!slot || slot->year != year) {
+        slot = findYearSlot(year, 1);
+        if (!slot) return -1;
+        t_last_slot = slot;
+    }
+    return (int)(slot - g_year_slots);
+}
+
+static void raisePeak(unsigned long long* peak, unsigned long long value) {
+    unsigned long long seen = atomicLoad64(peak);
+    while (value > seen && !atomicCompareSwap64(peak, seen, value)) seen = atomicLoad64(peak);
+}
+
+// allocated = 0 takes the block back off (the adds wrap around to subtract);
+// relaxed adds, nothing else is ordered by these counters
+static void countBlock(const struct mem_tag* tag, int allocated) {
+
+    struct mem_counters* counters = tag->slot >= 0 ? &g_year_slots[tag->slot].counters : &g_other_years;
+    unsigned long long sign = allocated ? 1 : 0 - 1ULL;
+
+    atomicAddRelaxed64(&counters->bytes[tag->kind], (tag->size - tag->text) * sign);
+    atomicAddRelaxed64(&counters->count[tag->kind], sign);
+    if (tag->text) {
+        atomicAddRelaxed64(&counters->bytes[MEM_DESCRIPTIONS], tag->text * sign);
+        atomicAddRelaxed64(&counters->count[MEM_DESCRIPTIONS], sign);
+    }
+
+    unsigned long long year_total = atomicAddRelaxed64(&counters->total, tag->size * sign);
+    unsigned long long total = atomicAddRelaxed64(&g_totals.total, tag->size * sign);
+    if (allocated) {
+        raisePeak(&counters->total_peak, year_total);
+        raisePeak(&g_totals.total_peak, total);
+    }
+}
+#endif
+
+// =====================
+// ALLOCATOR
+// =====================
+
+void* calendarAlloc(int kind, int year, size_t size, size_t text) {
+#ifdef CALENDAR_NO_MEM_STATS
+    return malloc(size);
+#else
+    if (size > 0xffffffffu) return NULL;
+
+    struct mem_tag* tag = (struct mem_tag*)malloc(sizeof(struct mem_tag) + size);
+    if (!tag) return NULL;
+
+    tag->kind = kind;
+    tag->slot = slotFor(year);
+    tag->size = (unsigned int)size;
+    tag->text = (unsigned int)text;
+    countBlock(tag, 1);
+    return tag + 1;
+#endif
+}
+
+void calendarFree(void* memory) {
+#ifdef CALENDAR_NO_MEM_STATS
+    free(memory);
+#else
+    if (!memory) return;
+
+    struct mem_tag* tag = (struct mem_tag*)memory - 1;
+    countBlock(tag, 0);
+    free(tag);
+#endif
+}
+
+// =====================
+// REPORTS
+// =====================
+
+static void copyCounters(struct mem_counters* source, int year, struct mem_stats* stats) {
+
+    memset(stats, 0, sizeof(*stats));
+    stats->year = year;
+    if (!source) return;
+
+    for (int k = 0; k < MEM_KIND_COUNT; k++) {
+        stats->kinds[k].bytes = atomicLoad64(&source->bytes[k]);
+        stats->kinds[k].count = atomicLoad64(&source->count[k]);
+    }
+    stats->bytes = atomicLoad64(&source->total);
+    stats->peak_bytes = atomicLoad64(&source->total_peak);
+}
+
+static void addKinds(const struct mem_stats* from, struct mem_stats* into) {
+    for (int k = 0; k < MEM_KIND_COUNT; k++) {
+        into->kinds[k].bytes += from->kinds[k].bytes;
+        into->kinds[k].count += from->kinds[k].count;
+    }
+}
+
+void getMemStats(struct mem_stats* totals) {
+
+    copyCounters(&g_totals, MEM_ALL_YEARS, totals);
+
+    struct mem_stats part;
+    copyCounters(&g_other_years, MEM_ALL_YEARS, &part);
+    addKinds(&part, totals);
+    for (int i = 0; i < MEM_YEAR_SLOTS; i++) {
+        if (atomicLoadLong(&g_year_slots[i].state) != SLOT_READY) continue;
+        copyCounters(&g_year_slots[i].counters, MEM_ALL_YEARS, &part);
+        addKinds(&part, totals);
+    }
+}
+
+void getYearMemStats(int year, struct mem_stats* stats) {
+    struct mem_year_slot* slot = findYearSlot(year, 0);
+    copyCounters(slot ? &slot->counters : NULL, year, stats);
+}
+
+static int compareYears(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+int listYearMemStats(struct mem_stats* years, int max_years) {
+
+    int known[MEM_YEAR_SLOTS];
+    int count = 0;
+    for (int i = 0; i < MEM_YEAR_SLOTS; i++) {
+        if (atomicLoadLong(&g_year_slots[i].state) == SLOT_READY) known[count++] = g_year_slots[i].year;
+    }
+    qsort(known, (size_t)count, sizeof(int), compareYears);
+
+    for (int i = 0; i < count && i < max_years; i++) getYearMemStats(known[i], &years[i]);
+    return count;
+}
+
+static void resetPeaks(struct mem_counters* counters) {
+    atomicStore64(&counters->total_peak, atomicLoad64(&counters->total));
+}
+
+void resetMemPeaks(void) {
+    resetPeaks(&g_totals);
+    resetPeaks(&g_other_years);
+    for (int i = 0; i < MEM_YEAR_SLOTS; i++) {
+        if (atomicLoadLong(&g_year_slots[i].state) == SLOT_READY) resetPeaks(&g_year_slots[i].counters);
+    }
+}
+
+static void formatRow(const struct mem_stats* stats, MemStatsLineFn on_line, void* user_data) {
+
+    char year[16];
+    if (stats->year == MEM_ALL_YEARS) strcpy_s(year, sizeof(year), "all");
+    else snprintf(year, sizeof(year), "%d", stats->year);
+
+    // a year skeleton without a single task in it
+    int unused = stats->year != MEM_ALL_YEARS && stats->kinds[MEM_YEAR_NODES].count > 0
+        && stats->kinds[MEM_TASK_NODES].count == 0;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-6s %10llu %10llu %10llu %10llu %12llu %12llu %12llu %12llu%s", year,
+        stats->kinds[MEM_TASK_NODES].count, stats->kinds[MEM_YEAR_NODES].bytes, stats->kinds[MEM_MONTH_ARRAYS].bytes,
+        stats->kinds[MEM_DAY_ARRAYS].bytes, stats->kinds[MEM_TASK_NODES].bytes, stats->kinds[MEM_DESCRIPTIONS].bytes,
+        stats->bytes, stats->peak_bytes, unused ? "  no tasks" : "");
+    on_line(line, user_data);
+}
+
+void formatMemStats(MemStatsLineFn on_line, void* user_data) {
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-6s %10s %10s %10s %10s %12s %12s %12s %12s", "year", "tasks",
+        "year B", "months B", "days B", "tasks B", "text B", "live B", "peak B");
+    on_line(line, user_data);
+
+    int count = listYearMemStats(NULL, 0);
+    struct mem_stats* years = count > 0 ? (struct mem_stats*)malloc((size_t)count * sizeof(struct mem_stats)) : NULL;
+    if (years) {
+        // more years can show up in between; these ones are enough
+        listYearMemStats(years, count);
+        for (int i = 0; i < count; i++) {
+            if (years[i].bytes > 0) formatRow(&years[i], on_line, user_data);
+        }
+        free(years);
+    }
+
+    struct mem_stats totals;
+    getMemStats(&totals);
+    formatRow(&totals, on_line, user_data);
+}
+
+static void printLine(const char* line, void* user_data) {
+    fprintf((FILE*)user_data, "%s\n", line);
+}
+
+void printMemStats(FILE* out) {
+    formatMemStats(printLine, out);
+}
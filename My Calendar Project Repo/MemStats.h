@@ -0,0 +1,83 @@
+#pragma once
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Where the calendar's memory goes: every year node, months array, day
+    // array, task node and description is allocated through one tracked
+    // allocator that tags it with its kind and year, so live bytes and counts
+    // can be reported per year and overall, with peaks.
+    //
+    // Bytes are what was asked for; malloc's own overhead and the 16 byte tag
+    // in front of every block aren't counted. A task's first description lives
+    // in the same block as its node but still counts as a description.
+    //
+    // A year that shows skeleton bytes and no task nodes was created without
+    // ever getting a task (a lookup that went through findOrAddYear, say).
+    //
+    // Building with CALENDAR_NO_MEM_STATS leaves plain malloc/free and reports
+    // nothing; CALENDAR_NO_STATS (everything off, like OpStats.h) implies it.
+    // Op stats and traces can stay on without it.
+#if defined(CALENDAR_NO_STATS) && !defined(CALENDAR_NO_MEM_STATS)
+#define CALENDAR_NO_MEM_STATS
+#endif
+
+    enum mem_kind {
+        MEM_YEAR_NODES,             // struct years
+        MEM_MONTH_ARRAYS,           // the 12 struct months of a year
+        MEM_DAY_ARRAYS,             // a month's struct days
+        MEM_TASK_NODES,             // struct tasks
+        MEM_DESCRIPTIONS,           // task text (inline or replaced by an update)
+        MEM_KIND_COUNT
+    };
+
+    // the totals' year
+#define MEM_ALL_YEARS (-2147483647 - 1)
+
+    struct mem_usage {
+        unsigned long long bytes;
+        unsigned long long count;
+    };
+
+    struct mem_stats {
+        int year;                                   // or MEM_ALL_YEARS
+        struct mem_usage kinds[MEM_KIND_COUNT];
+        unsigned long long bytes;                   // all kinds
+        unsigned long long peak_bytes;              // highest "bytes" has been
+    };
+
+    // 0 when built with CALENDAR_NO_MEM_STATS (or CALENDAR_NO_STATS)
+    int memStatsEnabled(void);
+
+    // "years", "months", "days", "tasks", "descriptions"
+    const char* memKindName(int kind);
+
+    // everything, whatever the year
+    void getMemStats(struct mem_stats* totals);
+
+    // one year (all zero if nothing was ever allocated for it)
+    void getYearMemStats(int year, struct mem_stats* stats);
+
+    // every year that ever had memory, in year order, up to max_years of them;
+    // returns how many there are (which can be more than max_years)
+    int listYearMemStats(struct mem_stats* years, int max_years);
+
+    // peaks start again from what is live now
+    void resetMemPeaks(void);
+
+    // a table: a line per year with live memory, then the totals (no newlines),
+    // or straight to a file
+    typedef void (*MemStatsLineFn)(const char* line, void* user_data);
+    void formatMemStats(MemStatsLineFn on_line, void* user_data);
+    void printMemStats(FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
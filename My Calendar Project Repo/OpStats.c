@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "OpStats.h"
+#include "Platform.h"
+
+static const char* g_op_names[OP_COUNT] = {
+    "addTask", "addTasks", "updateTask", "deleteTask", "deleteTasks", "search", "load", "save"
+};
+
+// Every thread records into a shard of its own, claimed on its first call, so
+// recording is a handful of relaxed loads and stores to memory no other thread
+// writes (no locked instructions, no shared cache lines); getOpStats adds the
+// shards up. Shards aren't handed back when a thread ends: once
+// OP_STATS_SHARDS threads have recorded, later ones share g_shared_shard,
+// with relaxed atomic adds.
+#define OP_STATS_SHARDS 32
+
+struct op_shard {
+    struct op_stats ops[OP_COUNT];
+};
+
+static struct op_shard* volatile g_shards[OP_STATS_SHARDS];
+static long g_shards_claimed = 0;
+static struct op_shard g_shared_shard;
+
+static PLATFORM_THREAD_LOCAL struct op_shard* t_shard = NULL;
+static PLATFORM_THREAD_LOCAL int t_owns_shard = 0;
+
+// Prometheus bucket bounds (seconds), picked out of the fine buckets
+static const double g_prometheus_bounds[] = { 1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1, 10 };
+#define PROMETHEUS_BOUNDS ((int)(sizeof(g_prometheus_bounds) / sizeof(g_prometheus_bounds[0])))
+
+int opStatsEnabled(void) {
+#ifdef CALENDAR_NO_STATS
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+const char* opName(int op) {
+    return op >= 0 && op < OP_COUNT ? g_op_names[op] : "unknown";
+}
+
+// =====================
+// BUCKETS
+// =====================
+
+static int highestBit(unsigned long long value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+// below 16 ns one bucket per nanosecond, then OP_STATS_SUB_BUCKETS per power of two
+static int bucketFor(unsigned long long nanos) {
+    if (nanos < OP_STATS_SUB_BUCKETS) return (int)nanos;
+
+    int bit = highestBit(nanos);
+    int bucket = (bit - OP_STATS_SUB_BITS + 1) * OP_STATS_SUB_BUCKETS
+        + (int)((nanos >> (bit - OP_STATS_SUB_BITS)) & (OP_STATS_SUB_BUCKETS - 1));
+    return bucket < OP_STATS_BUCKETS ? bucket : OP_STATS_BUCKETS - 1;
+}
+
+unsigned long long opStatsBucketStart(int bucket) {
+    if (bucket < OP_STATS_SUB_BUCKETS) return (unsigned long long)bucket;
+
+    int bit = bucket / OP_STATS_SUB_BUCKETS + OP_STATS_SUB_BITS - 1;
+    unsigned long long sub = (unsigned long long)(bucket % OP_STATS_SUB_BUCKETS);
+    return (OP_STATS_SUB_BUCKETS + sub) << (bit - OP_STATS_SUB_BITS);
+}
+
+// =====================
+// RECORDING
+// =====================
+
+static void claimShard(void) {
+
+    long index = atomicAddLong(&g_shards_claimed, 1) - 1;
+    struct op_shard* shard = index < OP_STATS_SHARDS ? (struct op_shard*)calloc(1, sizeof(struct op_shard)) : NULL;
+    if (shard) {
+        atomicPublishPointer((void* volatile*)&g_shards[index], shard);
+        t_owns_shard = 1;
+    }
+    else {
+        shard = &g_shared_shard;
+    }
+    t_shard = shard;
+}
+
+// only the owner writes its shard, so a plain read-add-write is enough there
+static void addTo(volatile unsigned long long* counter, unsigned long long delta) {
+    if (t_owns_shard) atomicStoreRelaxed64(counter, atomicLoadRelaxed64(counter) + delta);
+    else atomicAddRelaxed64(counter, delta);
+}
+
+void recordOp(int op, long long nanos, unsigned long long bytes) {
+
+    if (!t_shard) claimShard();
+    struct op_stats* stats = &t_shard->ops[op];
+    unsigned long long value = nanos > 0 ? (unsigned long long)nanos : 0;
+
+    addTo(&stats->calls, 1);
+    if (bytes) addTo(&stats->bytes, bytes);
+    addTo(&stats->total_nanos, value);
+    addTo(&stats->buckets[bucketFor(value)], 1);
+
+    unsigned long long seen = atomicLoadRelaxed64(&stats->max_nanos);
+    if (value <= seen) return;
+    if (t_owns_shard) atomicStoreRelaxed64(&stats->max_nanos, value);
+    else {
+        while (value > seen && !atomicCompareSwap64(&stats->max_nanos, seen, value)) seen = atomicLoad64(&stats->max_nanos);
+    }
+}
+
+static void addShard(struct op_stats* total, struct op_stats* shard) {
+    total->calls += atomicLoadRelaxed64(&shard->calls);
+    total->bytes += atomicLoadRelaxed64(&shard->bytes);
+    total->total_nanos += atomicLoadRelaxed64(&shard->total_nanos);
+
+    unsigned long long max_nanos = atomicLoadRelaxed64(&shard->max_nanos);
+    if (max_nanos > total->max_nanos) total->max_nanos = max_nanos;
+
+    for (int i = 0; i < OP_STATS_BUCKETS; i++) total->buckets[i] += atomicLoadRelaxed64(&shard->buckets[i]);
+}
+
+static void clearShard(struct op_shard* shard) {
+    for (int op = 0; op < OP_COUNT; op++) {
+        struct op_stats* stats = &shard->ops[op];
+        atomicStoreRelaxed64(&stats->calls, 0);
+        atomicStoreRelaxed64(&stats->bytes, 0);
+        atomicStoreRelaxed64(&stats->total_nanos, 0);
+        atomicStoreRelaxed64(&stats->max_nanos, 0);
+        for (int i = 0; i < OP_STATS_BUCKETS; i++) atomicStoreRelaxed64(&stats->buckets[i], 0);
+    }
+}
+
+void getOpStats(int op, struct op_stats* stats) {
+
+    memset(stats, 0, sizeof(*stats));
+    if (op < 0 || op >= OP_COUNT) return;
+
+    for (int i = 0; i < OP_STATS_SHARDS; i++) {
+        struct op_shard* shard = (struct op_shard*)atomicReadPointer((void* volatile*)&g_shards[i]);
+        if (shard) addShard(stats, &shard->ops[op]);
+    }
+    addShard(stats, &g_shared_shard.ops[op]);
+}
+
+void resetOpStats(void) {
+    for (int i = 0; i < OP_STATS_SHARDS; i++) {
+        struct op_shard* shard = (struct op_shard*)atomicReadPointer((void* volatile*)&g_shards[i]);
+        if (shard) clearShard(shard);
+    }
+    clearShard(&g_shared_shard);
+}
+
+unsigned long long opStatsPercentile(const struct op_stats* stats, double fraction) {
+
+    unsigned long long total = 0;
+    for (int i = 0; i < OP_STATS_BUCKETS; i++) total += stats->buckets[i];
+    if (total == 0) return 0;
+
+    if (fraction < 0) fraction = 0;
+    if (fraction > 1) fraction = 1;
+    unsigned long long wanted = (unsigned long long)(fraction * (double)total + 0.999999);
+    if (wanted == 0) wanted = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < OP_STATS_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen < wanted) continue;
+
+        // the top of the bucket, but never past the slowest call seen
+        unsigned long long top = i + 1 < OP_STATS_BUCKETS ? opStatsBucketStart(i + 1) - 1 : stats->max_nanos;
+        return top < stats->max_nanos ? top : stats->max_nanos;
+    }
+    return stats->max_nanos;
+}
+
+// =====================
+// REPORTS
+// =====================
+
+static void formatText(OpStatsLineFn on_line, void* user_data) {
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-12s %10s %14s %10s %10s %10s %10s %10s", "op", "calls", "bytes",
+        "mean us", "p50 us", "p90 us", "p99 us", "max us");
+    on_line(line, user_data);
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        struct op_stats stats;
+        getOpStats(op, &stats);
+        if (stats.calls == 0) continue;
+
+        snprintf(line, sizeof(line), "%-12s %10llu %14llu %10.2f %10.2f %10.2f %10.2f %10.2f", opName(op),
+            stats.calls, stats.bytes, stats.total_nanos / 1e3 / stats.calls,
+            opStatsPercentile(&stats, 0.5) / 1e3, opStatsPercentile(&stats, 0.9) / 1e3,
+            opStatsPercentile(&stats, 0.99) / 1e3, stats.max_nanos / 1e3);
+        on_line(line, user_data);
+    }
+}
+
+static void formatPrometheus(OpStatsLineFn on_line, void* user_data) {
+
+    char line[256];
+    struct op_stats stats;
+
+    on_line("# HELP calendar_op_calls_total Calls of each calendar operation.", user_data);
+    on_line("# TYPE calendar_op_calls_total counter", user_data);
+    for (int op = 0; op < OP_COUNT; op++) {
+        getOpStats(op, &stats);
+        snprintf(line, sizeof(line), "calendar_op_calls_total{op=\"%s\"} %llu", opName(op), stats.calls);
+        on_line(line, user_data);
+    }
+
+    on_line("# HELP calendar_op_bytes_total Bytes handled by each calendar operation.", user_data);
+    on_line("# TYPE calendar_op_bytes_total counter", user_data);
+    for (int op = 0; op < OP_COUNT; op++) {
+        getOpStats(op, &stats);
+        snprintf(line, sizeof(line), "calendar_op_bytes_total{op=\"%s\"} %llu", opName(op), stats.bytes);
+        on_line(line, user_data);
+    }
+
+    on_line("# HELP calendar_op_duration_seconds Time each calendar operation took.", user_data);
+    on_line("# TYPE calendar_op_duration_seconds histogram", user_data);
+    for (int op = 0; op < OP_COUNT; op++) {
+        getOpStats(op, &stats);
+
+        // a fine bucket counts toward a bound once all of it is below the bound
+        unsigned long long cumulative = 0;
+        int bucket = 0;
+        for (int b = 0; b < PROMETHEUS_BOUNDS; b++) {
+            unsigned long long limit = (unsigned long long)(g_prometheus_bounds[b] * 1e9 + 0.5);
+            while (bucket < OP_STATS_BUCKETS - 1 && opStatsBucketStart(bucket + 1) <= limit + 1) {
+                cumulative += stats.buckets[bucket++];
+            }
+            snprintf(line, sizeof(line), "calendar_op_duration_seconds_bucket{op=\"%s\",le=\"%g\"} %llu",
+                opName(op), g_prometheus_bounds[b], cumulative);
+            on_line(line, user_data);
+        }
+        snprintf(line, sizeof(line), "calendar_op_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu", opName(op), stats.calls);
+        on_line(line, user_data);
+        snprintf(line, sizeof(line), "calendar_op_duration_seconds_sum{op=\"%s\"} %.9f", opName(op), stats.total_nanos / 1e9);
+        on_line(line, user_data);
+        snprintf(line, sizeof(line), "calendar_op_duration_seconds_count{op=\"%s\"} %llu", opName(op), stats.calls);
+        on_line(line, user_data);
+    }
+}
+
+void formatOpStats(enum op_stats_format format, OpStatsLineFn on_line, void* user_data) {
+    if (format == OP_STATS_PROMETHEUS) formatPrometheus(on_line, user_data);
+    else formatText(on_line, user_data);
+}
+
+static void printLine(const char* line, void* user_data) {
+    fprintf((FILE*)user_data, "%s\n", line);
+}
+
+void printOpStats(FILE* out, enum op_stats_format format) {
+    formatOpStats(format, printLine, out);
+}
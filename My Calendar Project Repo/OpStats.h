@@ -0,0 +1,86 @@
+#pragma once
+#ifndef OP_STATS_H
+#define OP_STATS_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Call counts, bytes and latency histograms for the main calendar
+    // operations, kept by the operations themselves (the core functions and the
+    // calendar context ones alike) so a running program can be asked where its
+    // time goes.
+    //
+    // Each operation has a log-linear histogram, like HdrHistogram: every power
+    // of two of nanoseconds is split into OP_STATS_SUB_BUCKETS equal buckets, so a
+    // latency is known to within about 6% from 1 ns up to about 18 minutes.
+    // Recording is two clock reads and a few relaxed stores into a per-thread
+    // shard (merged when the numbers are read), so threads recording at the
+    // same time don't slow each other down.
+    //
+    // Building with CALENDAR_NO_STATS defined takes the recording out completely;
+    // the functions below still exist and report nothing.
+    enum calendar_op {
+        OP_ADD_TASK,                // addTask, calendarAddTask (bytes: description)
+        OP_ADD_TASKS,               // addTasks, one call per batch (bytes: descriptions)
+        OP_UPDATE_TASK,             // updateTask, calendarUpdateTask (bytes: new description)
+        OP_DELETE_TASK,             // deleteTask, calendarDeleteTask
+        OP_DELETE_TASKS,            // deleteTasks, one call per batch
+        OP_SEARCH,                  // searchTasks* and calendarSearch (bytes: keyword)
+        OP_LOAD,                    // loadTasks*, calendarLoad (bytes: file read)
+        OP_SAVE,                    // saveTasks*, calendarSave (bytes: file written)
+        OP_COUNT
+    };
+
+#define OP_STATS_SUB_BITS 4
+#define OP_STATS_SUB_BUCKETS (1 << OP_STATS_SUB_BITS)
+    // buckets 0..15 are single nanoseconds, then 16 per power of two up to 2^40 ns
+#define OP_STATS_BUCKETS ((40 - OP_STATS_SUB_BITS + 1) * OP_STATS_SUB_BUCKETS)
+
+    struct op_stats {
+        unsigned long long calls;
+        unsigned long long bytes;
+        unsigned long long total_nanos;
+        unsigned long long max_nanos;
+        unsigned long long buckets[OP_STATS_BUCKETS];
+    };
+
+    enum op_stats_format {
+        OP_STATS_TEXT,              // a table: calls, bytes, mean / p50 / p90 / p99 / max
+        OP_STATS_PROMETHEUS         // Prometheus text exposition (counters + a histogram per operation)
+    };
+
+    // 0 when built with CALENDAR_NO_STATS
+    int opStatsEnabled(void);
+
+    // "addTask", "search", ...
+    const char* opName(int op);
+
+    // copies one operation's numbers, added up over every thread (each field is
+    // read atomically, but a call finishing meanwhile may show in some fields and
+    // not others yet)
+    void getOpStats(int op, struct op_stats* stats);
+    // (a call being recorded meanwhile on another thread may survive the reset)
+    void resetOpStats(void);
+
+    // latency below which the given fraction (0-1) of the calls finished: the top
+    // of the bucket it falls in, so at most ~6% high; 0 if there were no calls
+    unsigned long long opStatsPercentile(const struct op_stats* stats, double fraction);
+    // smallest latency that lands in the bucket
+    unsigned long long opStatsBucketStart(int bucket);
+
+    // the report, one line at a time (no newline), or straight to a file
+    typedef void (*OpStatsLineFn)(const char* line, void* user_data);
+    void formatOpStats(enum op_stats_format format, OpStatsLineFn on_line, void* user_data);
+    void printOpStats(FILE* out, enum op_stats_format format);
+
+    // for the operations themselves: one finished call
+    void recordOp(int op, long long nanos, unsigned long long bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,481 @@
+#pragma once
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Thin wrappers over the OS threading bits we need (Win32 or pthreads), so the
+// rest of the code doesn't have #ifdefs everywhere. Everything is static inline.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// =====================
+// LOCKS
+// =====================
+
+#ifdef _WIN32
+typedef SRWLOCK platform_rwlock;
+typedef SRWLOCK platform_mutex;
+#else
+typedef pthread_rwlock_t platform_rwlock;
+typedef pthread_mutex_t platform_mutex;
+#endif
+
+static inline void rwlockInit(platform_rwlock* lock) {
+#ifdef _WIN32
+    InitializeSRWLock(lock);
+#else
+    pthread_rwlock_init(lock, NULL);
+#endif
+}
+
+static inline void rwlockDestroy(platform_rwlock* lock) {
+#ifdef _WIN32
+    (void)lock; // SRW locks need no cleanup
+#else
+    pthread_rwlock_destroy(lock);
+#endif
+}
+
+static inline void rwlockRead(platform_rwlock* lock) {
+#ifdef _WIN32
+    AcquireSRWLockShared(lock);
+#else
+    pthread_rwlock_rdlock(lock);
+#endif
+}
+
+static inline void rwlockReadDone(platform_rwlock* lock) {
+#ifdef _WIN32
+    ReleaseSRWLockShared(lock);
+#else
+    pthread_rwlock_unlock(lock);
+#endif
+}
+
+static inline void rwlockWrite(platform_rwlock* lock) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(lock);
+#else
+    pthread_rwlock_wrlock(lock);
+#endif
+}
+
+static inline void rwlockWriteDone(platform_rwlock* lock) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(lock);
+#else
+    pthread_rwlock_unlock(lock);
+#endif
+}
+
+static inline void mutexInit(platform_mutex* mutex) {
+#ifdef _WIN32
+    InitializeSRWLock(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static inline void mutexDestroy(platform_mutex* mutex) {
+#ifdef _WIN32
+    (void)mutex;
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+static inline void mutexLock(platform_mutex* mutex) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static inline void mutexUnlock(platform_mutex* mutex) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+// =====================
+// CONDITION VARIABLES
+// =====================
+// always used with a platform_mutex; waits can wake up spuriously, so re-check
+
+#ifdef _WIN32
+typedef CONDITION_VARIABLE platform_cond;
+#else
+typedef pthread_cond_t platform_cond;
+#endif
+
+static inline void condInit(platform_cond* cond) {
+#ifdef _WIN32
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+static inline void condDestroy(platform_cond* cond) {
+#ifdef _WIN32
+    (void)cond;
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+// mutex must be locked; it's released while waiting and locked again on return
+static inline void condWait(platform_cond* cond, platform_mutex* mutex) {
+#ifdef _WIN32
+    SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+// same, but gives up after about "milliseconds"; returns 0 if it timed out
+static inline int condWaitMillis(platform_cond* cond, platform_mutex* mutex, int milliseconds) {
+#ifdef _WIN32
+    return SleepConditionVariableSRW(cond, mutex, (DWORD)milliseconds, 0) ? 1 : 0;
+#else
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += milliseconds / 1000;
+    until.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, mutex, &until) == 0;
+#endif
+}
+
+static inline void condSignal(platform_cond* cond) {
+#ifdef _WIN32
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+static inline void condBroadcast(platform_cond* cond) {
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+// =====================
+// THREADS
+// =====================
+
+typedef void (*platform_thread_fn)(void* arg);
+
+// for per-thread variables (static PLATFORM_THREAD_LOCAL int x;)
+#ifdef _WIN32
+#define PLATFORM_THREAD_LOCAL __declspec(thread)
+#else
+#define PLATFORM_THREAD_LOCAL __thread
+#endif
+
+#ifdef _WIN32
+typedef HANDLE platform_thread;
+#else
+typedef pthread_t platform_thread;
+#endif
+
+// the OS wants its own entry point signature, so we bounce through this
+struct platform_thread_start {
+    platform_thread_fn fn;
+    void* arg;
+};
+
+#ifdef _WIN32
+static inline DWORD WINAPI platformThreadEntry(LPVOID param) {
+#else
+static inline void* platformThreadEntry(void* param) {
+#endif
+    struct platform_thread_start start = *(struct platform_thread_start*)param;
+    free(param);
+    start.fn(start.arg);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// returns 1 if the thread started
+static inline int threadStart(platform_thread* thread, platform_thread_fn fn, void* arg) {
+    struct platform_thread_start* start = (struct platform_thread_start*)malloc(sizeof(struct platform_thread_start));
+    if (!start) return 0;
+    start->fn = fn;
+    start->arg = arg;
+
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, platformThreadEntry, start, 0, NULL);
+    if (*thread == NULL) {
+        free(start);
+        return 0;
+    }
+#else
+    if (pthread_create(thread, NULL, platformThreadEntry, start) != 0) {
+        free(start);
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+static inline void threadJoin(platform_thread thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+static inline void threadYield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static inline void threadSleepMillis(int milliseconds) {
+#ifdef _WIN32
+    Sleep((DWORD)milliseconds);
+#else
+    struct timespec wait;
+    wait.tv_sec = milliseconds / 1000;
+    wait.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    nanosleep(&wait, NULL);
+#endif
+}
+
+static inline int platformCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// =====================
+// ATOMICS
+// =====================
+// sequentially consistent unless the name says otherwise
+
+static inline unsigned long long atomicIncrement64(volatile unsigned long long* value) {
+#ifdef _WIN32
+    return (unsigned long long)InterlockedIncrement64((volatile LONG64*)value);
+#else
+    return __atomic_add_fetch(value, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline unsigned long long atomicAdd64(volatile unsigned long long* value, unsigned long long delta) {
+#ifdef _WIN32
+    return (unsigned long long)InterlockedExchangeAdd64((volatile LONG64*)value, (LONG64)delta) + delta;
+#else
+    return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline unsigned long long atomicLoad64(volatile unsigned long long* value) {
+#ifdef _WIN32
+    return (unsigned long long)InterlockedCompareExchange64((volatile LONG64*)value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void atomicStore64(volatile unsigned long long* value, unsigned long long desired) {
+#ifdef _WIN32
+    InterlockedExchange64((volatile LONG64*)value, (LONG64)desired);
+#else
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline int atomicCompareSwap64(volatile unsigned long long* value, unsigned long long expected, unsigned long long desired) {
+#ifdef _WIN32
+    return (unsigned long long)InterlockedCompareExchange64((volatile LONG64*)value, (LONG64)desired, (LONG64)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline long atomicAddLong(volatile long* value, long delta) {
+#ifdef _WIN32
+    return InterlockedExchangeAdd(value, delta) + delta;
+#else
+    return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline long atomicLoadLong(volatile long* value) {
+#ifdef _WIN32
+    return InterlockedCompareExchange(value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline void atomicStoreLong(volatile long* value, long desired) {
+#ifdef _WIN32
+    InterlockedExchange(value, desired);
+#else
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static inline int atomicCompareSwapLong(volatile long* value, long expected, long desired) {
+#ifdef _WIN32
+    return InterlockedCompareExchange(value, desired, expected) == expected;
+#else
+    return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// relaxed: atomic (never torn), but no ordering with anything else; for
+// counters that nothing else is synchronized through
+static inline unsigned long long atomicLoadRelaxed64(volatile unsigned long long* value) {
+#if defined(_WIN64)
+    return *value;
+#elif defined(_WIN32)
+    return (unsigned long long)InterlockedCompareExchange64((volatile LONG64*)value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void atomicStoreRelaxed64(volatile unsigned long long* value, unsigned long long desired) {
+#if defined(_WIN64)
+    *value = desired;
+#elif defined(_WIN32)
+    InterlockedExchange64((volatile LONG64*)value, (LONG64)desired);
+#else
+    __atomic_store_n(value, desired, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline unsigned long long atomicAddRelaxed64(volatile unsigned long long* value, unsigned long long delta) {
+#ifdef _WIN32
+    return (unsigned long long)InterlockedExchangeAddNoFence64((volatile LONG64*)value, (LONG64)delta) + delta;
+#else
+    return __atomic_add_fetch(value, delta, __ATOMIC_RELAXED);
+#endif
+}
+
+// full barrier: no load or store moves across it (for seqlock style readers)
+static inline void atomicFence(void) {
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+// pointer publishing for readers that don't lock: everything written before
+// atomicPublishPointer is visible to a reader that got the pointer from
+// atomicReadPointer (release / acquire)
+static inline void atomicPublishPointer(void* volatile* target, void* value) {
+#ifdef _WIN32
+    InterlockedExchangePointer(target, value);
+#else
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static inline void* atomicReadPointer(void* volatile* source) {
+#ifdef _WIN32
+    void* value = *source;  // volatile reads are acquire with MSVC's default /volatile:ms
+    _ReadWriteBarrier();
+    return value;
+#else
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// =====================
+// CLOCK
+// =====================
+
+// monotonic time in nanoseconds (only differences mean anything)
+static inline long long platformNowNanos(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (long long)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+// CPU time the whole process has used (user + kernel, every thread), in nanoseconds
+static inline long long platformCpuNanos(void) {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (long long)(k.QuadPart + u.QuadPart) * 100;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+// =====================
+// FILES
+// =====================
+
+// moves from over to (replacing it); readers of "to" see the old file or the new
+// one, never half of one. 1 on success.
+static inline int platformReplaceFile(const char* from, const char* to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
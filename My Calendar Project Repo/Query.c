@@ -0,0 +1,1191 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Query.h"
+#include "TermIndex.h"
+
+// =====================
+// QUERY TREE
+// =====================
+
+enum query_kind {
+    QUERY_TEXT,   // word or "phrase" (substring match)
+    QUERY_DATE,   // inclusive date range
+    QUERY_MONTH,  // inclusive range of months, in any year
+    QUERY_AND,
+    QUERY_OR,
+    QUERY_NOT
+};
+
+struct query_node {
+    enum query_kind kind;
+
+    char* text;                     // QUERY_TEXT
+    int is_phrase;                  // only changes how explain prints it
+
+    int date_from;                  // QUERY_DATE, as yyyymmdd keys
+    int date_to;
+
+    int month_from;                 // QUERY_MONTH, 1..12
+    int month_to;
+
+    struct query_node** children;   // AND / OR: 2 or more, NOT: exactly 1
+    int child_count;
+
+    // planner estimates (filled in by planQuery)
+    double cost;                    // rough work per task evaluated
+    double selectivity;             // fraction of tasks expected to pass
+    int index_count;                // QUERY_TEXT: postings in the term index, -1 = it can't answer
+    struct query_node** order;      // AND / OR: the planner's copy of children, in evaluation order
+};
+
+enum query_access {
+    QUERY_ACCESS_SCAN,              // every task
+    QUERY_ACCESS_RANGE,             // only the days in [range_from, range_to]
+    QUERY_ACCESS_INDEX              // only the tasks the term index has for index_term
+};
+
+struct query {
+    struct query_node* root;
+
+    // access path chosen by the planner
+    enum query_access access;
+    int range_from;
+    int range_to;
+    const struct query_node* index_term;
+    const struct term_index* index;
+    double access_cost;             // estimated work for the whole query
+    int planned;
+};
+
+// the largest year whose date keys still fit an int; year:/date: refuse later ones
+#define QUERY_MAX_YEAR ((INT_MAX - 1231) / 10000)
+
+// date keys compare the same way the dates do: 2025-11-29 -> 20251129
+static int dateKey(int year, int month, int day) {
+    return year * 10000 + month * 100 + day;
+}
+
+// a task's key; years no predicate can name sort before / after every bound
+static int taskDateKey(int year, int month, int day) {
+    if (year < 1) return 0;
+    if (year > QUERY_MAX_YEAR) return INT_MAX;
+    return dateKey(year, month, day);
+}
+
+static struct query_node* newNode(enum query_kind kind) {
+    struct query_node* node = (struct query_node*)calloc(1, sizeof(struct query_node));
+    if (node) node->kind = kind;
+    return node;
+}
+
+static void freeNode(struct query_node* node) {
+    if (!node) return;
+
+    for (int i = 0; i < node->child_count; i++) {
+        freeNode(node->children[i]);
+    }
+    free(node->children);
+    free(node->order);
+    free(node->text);
+    free(node);
+}
+
+static int appendChild(struct query_node* parent, struct query_node* child) {
+    struct query_node** grown = (struct query_node**)realloc(parent->children,
+        (parent->child_count + 1) * sizeof(struct query_node*));
+    if (!grown) return 0;
+
+    parent->children = grown;
+    parent->children[parent->child_count++] = child;
+    return 1;
+}
+
+// joins two subtrees with AND/OR, flattening "a AND b AND c" into one node
+static struct query_node* joinNodes(enum query_kind kind, struct query_node* left, struct query_node* right) {
+    if (!left || !right) {
+        freeNode(left);
+        freeNode(right);
+        return NULL;
+    }
+
+    struct query_node* parent = left;
+    if (left->kind != kind) {
+        parent = newNode(kind);
+        if (!parent || !appendChild(parent, left)) {
+            free(parent);
+            freeNode(left);
+            freeNode(right);
+            return NULL;
+        }
+    }
+
+    if (!appendChild(parent, right)) {
+        freeNode(parent);
+        freeNode(right);
+        return NULL;
+    }
+    return parent;
+}
+
+// =====================
+// PARSER
+// =====================
+
+enum token_kind {
+    TOKEN_END,
+    TOKEN_WORD,
+    TOKEN_PHRASE,
+    TOKEN_AND,
+    TOKEN_OR,
+    TOKEN_NOT,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN
+};
+
+struct query_parser {
+    const char* pos;
+    enum token_kind token;
+    char text[DESC_LEN];
+
+    char* error;
+    size_t error_size;
+    int failed;
+};
+
+static void parseError(struct query_parser* parser, const char* message) {
+    // keep the first error, later ones are usually just fallout
+    if (parser->failed) return;
+    parser->failed = 1;
+
+    if (parser->error && parser->error_size > 0) {
+        snprintf(parser->error, parser->error_size, "%s", message);
+    }
+}
+
+static void nextToken(struct query_parser* parser) {
+
+    const char* p = parser->pos;
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+
+    parser->text[0] = '\0';
+
+    if (*p == '\0') {
+        parser->token = TOKEN_END;
+        parser->pos = p;
+        return;
+    }
+
+    if (*p == '(' || *p == ')') {
+        parser->token = (*p == '(') ? TOKEN_LPAREN : TOKEN_RPAREN;
+        parser->pos = p + 1;
+        return;
+    }
+
+    size_t len = 0;
+
+    if (*p == '"') {
+        // phrase: everything up to the closing quote
+        p++;
+        while (*p != '\0' && *p != '"') {
+            if (len + 1 < sizeof(parser->text)) parser->text[len++] = *p;
+            p++;
+        }
+        if (*p != '"') {
+            parseError(parser, "Missing closing quote.");
+        }
+        else {
+            p++;
+        }
+        parser->text[len] = '\0';
+        parser->token = TOKEN_PHRASE;
+        parser->pos = p;
+        return;
+    }
+
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r'
+        && *p != '(' && *p != ')' && *p != '"') {
+        if (len + 1 < sizeof(parser->text)) parser->text[len++] = *p;
+        p++;
+    }
+    parser->text[len] = '\0';
+    parser->pos = p;
+
+    // operators are uppercase only, so "and" / "or" can still be searched for
+    if (strcmp(parser->text, "AND") == 0) parser->token = TOKEN_AND;
+    else if (strcmp(parser->text, "OR") == 0) parser->token = TOKEN_OR;
+    else if (strcmp(parser->text, "NOT") == 0) parser->token = TOKEN_NOT;
+    else parser->token = TOKEN_WORD;
+}
+
+// reads YYYY, YYYY-MM or YYYY-MM-DD; an end bound rounds up to the last day
+// returns 0 if it isn't a date, -1 if the year is past QUERY_MAX_YEAR
+static int parseDateBound(const char* text, int is_end, int* key) {
+
+    // digits and dashes only, so "2025x" isn't quietly read as 2025
+    if (text[0] == '\0' || text[strspn(text, "0123456789-")] != '\0') return 0;
+
+    // the year is checked before it's read, so a long one can't overflow
+    size_t year_digits = strcspn(text, "-");
+    if (year_digits > 6) return -1;
+
+    int year = 0, month = 0, day = 0;
+    int fields = sscanf_s(text, "%d-%d-%d", &year, &month, &day);
+
+    if (fields < 1 || year < 1) return 0;
+    if (year > QUERY_MAX_YEAR) return -1;
+
+    if (fields == 1) {
+        month = is_end ? 12 : 1;
+    }
+    if (month < 1 || month > 12) return 0;
+
+    if (fields <= 2) {
+        day = is_end ? daysInMonth(year, month) : 1;
+    }
+    if (day < 1 || day > daysInMonth(year, month)) return 0;
+
+    *key = dateKey(year, month, day);
+    return 1;
+}
+
+// splits a predicate value "A" or "A..B" into its two ends; 0 if one is too long
+static int splitRange(const char* value, char* from_text, char* to_text, size_t size) {
+
+    const char* dots = strstr(value, "..");
+    if (dots) {
+        size_t from_len = (size_t)(dots - value);
+        if (from_len >= size || strlen(dots + 2) >= size) return 0;
+        memcpy(from_text, value, from_len);
+        from_text[from_len] = '\0';
+        strcpy_s(to_text, size, dots + 2);
+    }
+    else {
+        if (strlen(value) >= size) return 0;
+        strcpy_s(from_text, size, value);
+        strcpy_s(to_text, size, value);
+    }
+    return 1;
+}
+
+// year:/date: predicate value, either "A" or "A..B"
+static struct query_node* parseDatePredicate(struct query_parser* parser, const char* value) {
+
+    char from_text[64];
+    char to_text[64];
+
+    if (!splitRange(value, from_text, to_text, sizeof(from_text))) {
+        parseError(parser, "Date is too long.");
+        return NULL;
+    }
+
+    int from_key, to_key;
+    int from_ok = parseDateBound(from_text, 0, &from_key);
+    int to_ok = parseDateBound(to_text, 1, &to_key);
+    if (from_ok < 0 || to_ok < 0) {
+        parseError(parser, "Year is out of range.");
+        return NULL;
+    }
+    if (!from_ok || !to_ok) {
+        parseError(parser, "Bad date, expected YYYY, YYYY-MM or YYYY-MM-DD.");
+        return NULL;
+    }
+    if (from_key > to_key) {
+        parseError(parser, "Date range ends before it starts.");
+        return NULL;
+    }
+
+    struct query_node* node = newNode(QUERY_DATE);
+    if (!node) {
+        parseError(parser, "Out of memory.");
+        return NULL;
+    }
+    node->date_from = from_key;
+    node->date_to = to_key;
+    return node;
+}
+
+// a month number 1..12; 0 if it's anything else
+static int parseMonthNumber(const char* text) {
+    if (text[0] == '\0' || strlen(text) > 2 || text[strspn(text, "0123456789")] != '\0') return 0;
+    int month = atoi(text);
+    return (month >= 1 && month <= 12) ? month : 0;
+}
+
+// month: predicate value, "M" or "M..N"
+static struct query_node* parseMonthPredicate(struct query_parser* parser, const char* value) {
+
+    char from_text[64];
+    char to_text[64];
+
+    int from = 0, to = 0;
+    if (splitRange(value, from_text, to_text, sizeof(from_text))) {
+        from = parseMonthNumber(from_text);
+        to = parseMonthNumber(to_text);
+    }
+    if (!from || !to) {
+        parseError(parser, "Bad month, expected a number 1-12 or a range like 6..8.");
+        return NULL;
+    }
+    if (from > to) {
+        parseError(parser, "Month range ends before it starts.");
+        return NULL;
+    }
+
+    struct query_node* node = newNode(QUERY_MONTH);
+    if (!node) {
+        parseError(parser, "Out of memory.");
+        return NULL;
+    }
+    node->month_from = from;
+    node->month_to = to;
+    return node;
+}
+
+static struct query_node* textNode(struct query_parser* parser, const char* text, int is_phrase) {
+
+    if (text[0] == '\0') {
+        parseError(parser, "Empty search term.");
+        return NULL;
+    }
+
+    struct query_node* node = newNode(QUERY_TEXT);
+    size_t len = strlen(text) + 1;
+    if (node) node->text = (char*)malloc(len);
+    if (!node || !node->text) {
+        free(node);
+        parseError(parser, "Out of memory.");
+        return NULL;
+    }
+
+    strcpy_s(node->text, len, text);
+    node->is_phrase = is_phrase;
+    return node;
+}
+
+static int startsWithIgnoreCase(const char* text, const char* prefix) {
+    while (*prefix) {
+        char a = *text++, b = *prefix++;
+        if (a >= 'A' && a <= 'Z') a = (char)(a - 'A' + 'a');
+        if (a != b) return 0;
+    }
+    return 1;
+}
+
+static struct query_node* parseOr(struct query_parser* parser);
+
+static struct query_node* parseUnary(struct query_parser* parser) {
+
+    if (parser->failed) return NULL;
+
+    switch (parser->token) {
+
+    case TOKEN_NOT: {
+        nextToken(parser);
+        struct query_node* child = parseUnary(parser);
+        if (!child) return NULL;
+
+        struct query_node* node = newNode(QUERY_NOT);
+        if (!node || !appendChild(node, child)) {
+            free(node);
+            freeNode(child);
+            parseError(parser, "Out of memory.");
+            return NULL;
+        }
+        return node;
+    }
+
+    case TOKEN_LPAREN: {
+        nextToken(parser);
+        struct query_node* inner = parseOr(parser);
+        if (!inner) return NULL;
+
+        if (parser->token != TOKEN_RPAREN) {
+            freeNode(inner);
+            parseError(parser, "Missing closing parenthesis.");
+            return NULL;
+        }
+        nextToken(parser);
+        return inner;
+    }
+
+    case TOKEN_PHRASE: {
+        struct query_node* node = textNode(parser, parser->text, 1);
+        nextToken(parser);
+        return node;
+    }
+
+    case TOKEN_WORD: {
+        struct query_node* node;
+        const char* word = parser->text;
+
+        if (startsWithIgnoreCase(word, "year:")) node = parseDatePredicate(parser, word + 5);
+        else if (startsWithIgnoreCase(word, "month:")) node = parseMonthPredicate(parser, word + 6);
+        else if (startsWithIgnoreCase(word, "date:")) node = parseDatePredicate(parser, word + 5);
+        else node = textNode(parser, word, 0);
+
+        nextToken(parser);
+        return node;
+    }
+
+    case TOKEN_END:
+        parseError(parser, "Query ended early, expected a term.");
+        return NULL;
+
+    default:
+        parseError(parser, "Expected a term, phrase, NOT or '('.");
+        return NULL;
+    }
+}
+
+static struct query_node* parseAnd(struct query_parser* parser) {
+
+    struct query_node* left = parseUnary(parser);
+
+    while (left && !parser->failed) {
+
+        if (parser->token == TOKEN_AND) {
+            nextToken(parser);
+        }
+        else if (parser->token != TOKEN_WORD && parser->token != TOKEN_PHRASE
+            && parser->token != TOKEN_NOT && parser->token != TOKEN_LPAREN) {
+            break;
+        }
+
+        // "a b" and "a NOT b" are both implicit ANDs
+        struct query_node* right = parseUnary(parser);
+        if (!right) {
+            freeNode(left);
+            return NULL;
+        }
+        left = joinNodes(QUERY_AND, left, right);
+        if (!left) parseError(parser, "Out of memory.");
+    }
+
+    return left;
+}
+
+static struct query_node* parseOr(struct query_parser* parser) {
+
+    struct query_node* left = parseAnd(parser);
+
+    while (left && !parser->failed && parser->token == TOKEN_OR) {
+        nextToken(parser);
+
+        struct query_node* right = parseAnd(parser);
+        if (!right) {
+            freeNode(left);
+            return NULL;
+        }
+        left = joinNodes(QUERY_OR, left, right);
+        if (!left) parseError(parser, "Out of memory.");
+    }
+
+    return left;
+}
+
+struct query* parseQuery(const char* text, char* error, size_t error_size) {
+
+    if (error && error_size > 0) error[0] = '\0';
+
+    struct query_parser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.pos = text ? text : "";
+    parser.error = error;
+    parser.error_size = error_size;
+
+    nextToken(&parser);
+    if (parser.token == TOKEN_END) {
+        parseError(&parser, "Query can't be empty.");
+        return NULL;
+    }
+
+    struct query_node* root = parseOr(&parser);
+    if (root && !parser.failed && parser.token != TOKEN_END) {
+        parseError(&parser, "Unexpected text after the end of the query.");
+    }
+    if (parser.failed) {
+        freeNode(root);
+        return NULL;
+    }
+
+    struct query* query = (struct query*)calloc(1, sizeof(struct query));
+    if (!query) {
+        freeNode(root);
+        parseError(&parser, "Out of memory.");
+        return NULL;
+    }
+    query->root = root;
+    return query;
+}
+
+void freeQuery(struct query* query) {
+    if (!query) return;
+    freeNode(query->root);
+    free(query);
+}
+
+// =====================
+// PLANNER
+// =====================
+//
+// The estimates are heuristics, helped by the term index when there's a current one:
+// - date and month predicates cost one integer compare; a date predicate's
+//   selectivity is the share of loaded days it covers, a month one's the share
+//   of the year
+// - text terms cost roughly their length (containsIgnoreCase is a scan); with
+//   an index their selectivity is how many tasks the index has for them,
+//   otherwise longer terms are assumed to be rarer
+//
+// AND children are run in order of cost / (1 - selectivity), so cheap filters
+// that throw most tasks away go first; OR children in order of
+// cost / selectivity, so cheap likely hits short-circuit first. The order is
+// kept in a copy of the children, the parsed tree is left alone.
+//
+// The access path is whichever is expected to do the least work:
+// - full scan: every task (empty months/days are still skipped)
+// - date range: if the whole query is bounded to a date range, only the tasks
+//   in the months it touches (forEachTaskInRange)
+// - term index: if the query is a word, or an AND with a word in it, only the
+//   tasks the index has for that word (looking it up goes through the whole
+//   dictionary, since a word can sit inside longer ones)
+
+#define QUERY_TEXT_BASE_COST 4.0
+#define QUERY_VISIT_COST 1.0            // reaching a task on a walk
+#define QUERY_POSTING_COST 2.0          // copying + sorting one posting
+#define QUERY_DICTIONARY_COST 0.25      // checking one dictionary word
+#define QUERY_NO_BOUND_FROM 0
+#define QUERY_NO_BOUND_TO 0x7fffffff
+
+struct query_planner {
+    struct years* calendar_head;
+    const struct term_index* index;     // NULL unless current
+    double total_tasks;
+};
+
+// day of year (1-based) for a date key
+static int dayOfYearForKey(int key) {
+    int year = key / 10000, month = (key / 100) % 100, day = key % 100;
+    for (int m = 1; m < month; m++) {
+        day += daysInMonth(year, m);
+    }
+    return day;
+}
+
+// how many loaded calendar days fall inside [from, to]
+static long countLoadedDays(struct years* calendar_head, int from, int to, long* total_days) {
+
+    long inside = 0;
+    *total_days = 0;
+
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        *total_days += isLeap(y->year_number) ? 366 : 365;
+
+        // years no date key can name are outside every range
+        if (y->year_number < 1 || y->year_number > QUERY_MAX_YEAR) continue;
+
+        int year_from = dateKey(y->year_number, 1, 1);
+        int year_to = dateKey(y->year_number, 12, 31);
+
+        int lo = from > year_from ? from : year_from;
+        int hi = to < year_to ? to : year_to;
+        if (lo <= hi) {
+            inside += dayOfYearForKey(hi) - dayOfYearForKey(lo) + 1;
+        }
+    }
+    return inside;
+}
+
+// tasks in the months [from, to] touches (what a range walk visits)
+static double countTasksInRange(struct years* calendar_head, int from, int to) {
+
+    int from_year = from / 10000, from_month = (from / 100) % 100;
+    int to_year = to / 10000, to_month = (to / 100) % 100;
+    double tasks = 0.0;
+
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        if (y->year_number < from_year || y->year_number > to_year) continue;
+        for (int m = 1; m <= 12; m++) {
+            if (y->year_number == from_year && m < from_month) continue;
+            if (y->year_number == to_year && m > to_month) continue;
+            tasks += y->months[m - 1].task_count;
+        }
+    }
+    return tasks;
+}
+
+static double andRank(const struct query_node* node) {
+    double pass = 1.0 - node->selectivity;
+    if (pass < 1e-9) pass = 1e-9;
+    return node->cost / pass;
+}
+
+static double orRank(const struct query_node* node) {
+    double hit = node->selectivity;
+    if (hit < 1e-9) hit = 1e-9;
+    return node->cost / hit;
+}
+
+static int compareAndRank(const void* a, const void* b) {
+    double ra = andRank(*(const struct query_node* const*)a);
+    double rb = andRank(*(const struct query_node* const*)b);
+    return (ra > rb) - (ra < rb);
+}
+
+static int compareOrRank(const void* a, const void* b) {
+    double ra = orRank(*(const struct query_node* const*)a);
+    double rb = orRank(*(const struct query_node* const*)b);
+    return (ra > rb) - (ra < rb);
+}
+
+// AND / OR children in evaluation order (parse order until planned)
+static struct query_node* const* childOrder(const struct query_node* node) {
+    return node->order ? node->order : node->children;
+}
+
+static void estimateNode(struct query_node* node, const struct query_planner* planner) {
+
+    switch (node->kind) {
+
+    case QUERY_TEXT: {
+        double len = (double)strlen(node->text);
+        node->cost = QUERY_TEXT_BASE_COST + len;
+        node->index_count = planner->index ? countTermMatches(planner->index, node->text) : -1;
+
+        if (node->index_count >= 0 && planner->total_tasks > 0) {
+            node->selectivity = node->index_count / planner->total_tasks;
+            if (node->selectivity > 1.0) node->selectivity = 1.0;
+        }
+        else {
+            node->selectivity = 0.5 / len;
+            if (node->selectivity < 0.01) node->selectivity = 0.01;
+        }
+        break;
+    }
+
+    case QUERY_DATE: {
+        long total_days;
+        long inside = countLoadedDays(planner->calendar_head, node->date_from, node->date_to, &total_days);
+        node->cost = 1.0;
+        node->selectivity = total_days > 0 ? (double)inside / (double)total_days : 0.0;
+        break;
+    }
+
+    case QUERY_MONTH:
+        node->cost = 1.0;
+        node->selectivity = (node->month_to - node->month_from + 1) / 12.0;
+        break;
+
+    case QUERY_NOT:
+        estimateNode(node->children[0], planner);
+        node->cost = node->children[0]->cost;
+        node->selectivity = 1.0 - node->children[0]->selectivity;
+        break;
+
+    case QUERY_AND:
+    case QUERY_OR: {
+        for (int i = 0; i < node->child_count; i++) {
+            estimateNode(node->children[i], planner);
+        }
+
+        // sorted in the planner's own copy (if there's no memory for one, the
+        // parse order is as good as any)
+        if (!node->order) node->order = (struct query_node**)malloc(node->child_count * sizeof(struct query_node*));
+        if (node->order) {
+            memcpy(node->order, node->children, node->child_count * sizeof(struct query_node*));
+            qsort(node->order, node->child_count, sizeof(struct query_node*),
+                node->kind == QUERY_AND ? compareAndRank : compareOrRank);
+        }
+
+        // expected cost with short-circuiting, in the chosen order
+        struct query_node* const* children = childOrder(node);
+        double reach = 1.0;
+        node->cost = 0.0;
+        for (int i = 0; i < node->child_count; i++) {
+            const struct query_node* child = children[i];
+            node->cost += reach * child->cost;
+            reach *= (node->kind == QUERY_AND) ? child->selectivity : (1.0 - child->selectivity);
+        }
+        node->selectivity = (node->kind == QUERY_AND) ? reach : 1.0 - reach;
+        break;
+    }
+    }
+}
+
+// date bounds implied by a subtree; returns 0 if it can match any date
+static int nodeBounds(const struct query_node* node, int* from, int* to) {
+
+    switch (node->kind) {
+
+    case QUERY_DATE:
+        *from = node->date_from;
+        *to = node->date_to;
+        return 1;
+
+    case QUERY_AND: {
+        // every child must hold, so any bounded child narrows the range
+        int bounded = 0;
+        *from = QUERY_NO_BOUND_FROM;
+        *to = QUERY_NO_BOUND_TO;
+        for (int i = 0; i < node->child_count; i++) {
+            int child_from, child_to;
+            if (nodeBounds(node->children[i], &child_from, &child_to)) {
+                if (child_from > *from) *from = child_from;
+                if (child_to < *to) *to = child_to;
+                bounded = 1;
+            }
+        }
+        return bounded;
+    }
+
+    case QUERY_OR: {
+        // only bounded if every branch is
+        *from = QUERY_NO_BOUND_TO;
+        *to = QUERY_NO_BOUND_FROM;
+        for (int i = 0; i < node->child_count; i++) {
+            int child_from, child_to;
+            if (!nodeBounds(node->children[i], &child_from, &child_to)) return 0;
+            if (child_from < *from) *from = child_from;
+            if (child_to > *to) *to = child_to;
+        }
+        return 1;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+// the word whose postings hold every task the query can match: the query itself,
+// or the AND term with the fewest postings; NULL if there's none
+static const struct query_node* indexTerm(const struct query_node* root) {
+
+    if (root->kind == QUERY_TEXT) return root->index_count >= 0 ? root : NULL;
+    if (root->kind != QUERY_AND) return NULL;
+
+    const struct query_node* best = NULL;
+    for (int i = 0; i < root->child_count; i++) {
+        const struct query_node* child = root->children[i];
+        if (child->kind == QUERY_TEXT && child->index_count >= 0 && (!best || child->index_count < best->index_count)) {
+            best = child;
+        }
+    }
+    return best;
+}
+
+void planQueryWithIndex(struct query* query, struct years* calendar_head, const struct term_index* index) {
+    if (!query) return;
+
+    struct query_planner planner = { calendar_head, NULL, 0.0 };
+    if (isTermIndexCurrent(index, calendar_head)) planner.index = index;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        planner.total_tasks += y->task_count;
+    }
+
+    estimateNode(query->root, &planner);
+    double per_task = QUERY_VISIT_COST + query->root->cost;
+
+    query->access = QUERY_ACCESS_SCAN;
+    query->access_cost = planner.total_tasks * per_task;
+    query->range_from = QUERY_NO_BOUND_FROM;
+    query->range_to = QUERY_NO_BOUND_TO;
+    query->index_term = NULL;
+    query->index = NULL;
+
+    int from, to;
+    if (nodeBounds(query->root, &from, &to)) {
+        double cost = countTasksInRange(calendar_head, from, to) * per_task;
+        if (cost <= query->access_cost) {
+            query->access = QUERY_ACCESS_RANGE;
+            query->access_cost = cost;
+            query->range_from = from;
+            query->range_to = to;
+        }
+    }
+
+    const struct query_node* term = planner.index ? indexTerm(query->root) : NULL;
+    if (term) {
+        double cost = termIndexSize(planner.index) * QUERY_DICTIONARY_COST
+            + term->index_count * (QUERY_POSTING_COST + query->root->cost);
+        if (cost < query->access_cost) {
+            query->access = QUERY_ACCESS_INDEX;
+            query->access_cost = cost;
+            query->index_term = term;
+            query->index = planner.index;
+        }
+    }
+    query->planned = 1;
+}
+
+void planQuery(struct query* query, struct years* calendar_head) {
+    planQueryWithIndex(query, calendar_head, NULL);
+}
+
+// =====================
+// EXECUTION
+// =====================
+
+static int evalNode(const struct query_node* node, int date_key, const struct task_match* match) {
+
+    switch (node->kind) {
+
+    case QUERY_TEXT:
+        return containsIgnoreCase(match->task->task_description, node->text);
+
+    case QUERY_DATE:
+        return date_key >= node->date_from && date_key <= node->date_to;
+
+    case QUERY_MONTH:
+        return match->month >= node->month_from && match->month <= node->month_to;
+
+    case QUERY_NOT:
+        return !evalNode(node->children[0], date_key, match);
+
+    case QUERY_AND: {
+        struct query_node* const* children = childOrder(node);
+        for (int i = 0; i < node->child_count; i++) {
+            if (!evalNode(children[i], date_key, match)) return 0;
+        }
+        return 1;
+    }
+
+    case QUERY_OR: {
+        struct query_node* const* children = childOrder(node);
+        for (int i = 0; i < node->child_count; i++) {
+            if (evalNode(children[i], date_key, match)) return 1;
+        }
+        return 0;
+    }
+    }
+    return 0;
+}
+
+// state for runQuery: filters the walk down to tasks the query accepts
+struct query_filter {
+    const struct query_node* root;
+    int limit;
+    int reported;
+    TaskMatchFn on_match;
+    void* user_data;
+};
+
+static int filterQuery(const struct task_match* match, void* user_data) {
+    struct query_filter* filter = (struct query_filter*)user_data;
+
+    int key = taskDateKey(match->year, match->month, match->day);
+    if (!evalNode(filter->root, key, match)) return 1;
+
+    filter->reported++;
+    if (!filter->on_match(match, filter->user_data)) return 0;
+    return !(filter->limit > 0 && filter->reported >= filter->limit);
+}
+
+int runQueryWithIndex(struct years* calendar_head, const struct term_index* index, struct query* query,
+    int limit, TaskMatchFn on_match, void* user_data) {
+
+    if (!query || !on_match) return 0;
+
+    planQueryWithIndex(query, calendar_head, index);
+
+    struct query_filter filter = { query->root, limit, 0, on_match, user_data };
+
+    if (query->access == QUERY_ACCESS_INDEX) {
+        // index access path: only the tasks with the word, already in date order
+        struct task_match* matches;
+        int count = collectTermMatches(query->index, query->index_term->text, &matches);
+        if (count >= 0) {
+            for (int i = 0; i < count && filterQuery(&matches[i], &filter); i++) {}
+            free(matches);
+            return filter.reported;
+        }
+        // no memory for the candidates: walking the calendar still works
+    }
+
+    if (query->access == QUERY_ACCESS_RANGE) {
+        // range access path: only the years/months/days inside the bounds are visited
+        forEachTaskInRange(calendar_head,
+            query->range_from / 10000, (query->range_from / 100) % 100, query->range_from % 100,
+            query->range_to / 10000, (query->range_to / 100) % 100, query->range_to % 100,
+            filterQuery, &filter);
+    }
+    else {
+        forEachTaskInRange(calendar_head, INT_MIN, 1, 1, INT_MAX, 12, 31, filterQuery, &filter);
+    }
+
+    return filter.reported;
+}
+
+int runQuery(struct years* calendar_head, struct query* query, int limit, TaskMatchFn on_match, void* user_data) {
+    return runQueryWithIndex(calendar_head, NULL, query, limit, on_match, user_data);
+}
+
+// =====================
+// EXPLAIN / PRINT
+// =====================
+
+struct text_builder {
+    char* buffer;
+    size_t size;
+    size_t len;     // total length wanted, may be more than what fit
+};
+
+static void appendText(struct text_builder* out, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    char* dest = NULL;
+    size_t room = 0;
+    if (out->buffer && out->len < out->size) {
+        dest = out->buffer + out->len;
+        room = out->size - out->len;
+    }
+
+    int written = vsnprintf(dest, room, format, args);
+    if (written > 0) out->len += (size_t)written;
+
+    va_end(args);
+}
+
+static void explainNode(const struct query_node* node, int depth, struct text_builder* out) {
+
+    for (int i = 0; i < depth; i++) appendText(out, "  ");
+
+    switch (node->kind) {
+    case QUERY_TEXT:
+        if (node->is_phrase) appendText(out, "\"%s\"", node->text);
+        else appendText(out, "%s", node->text);
+        break;
+    case QUERY_DATE:
+        appendText(out, "date %d-%02d-%02d..%d-%02d-%02d",
+            node->date_from / 10000, (node->date_from / 100) % 100, node->date_from % 100,
+            node->date_to / 10000, (node->date_to / 100) % 100, node->date_to % 100);
+        break;
+    case QUERY_MONTH:
+        appendText(out, "month %d..%d", node->month_from, node->month_to);
+        break;
+    case QUERY_AND: appendText(out, "AND"); break;
+    case QUERY_OR: appendText(out, "OR"); break;
+    case QUERY_NOT: appendText(out, "NOT"); break;
+    }
+
+    appendText(out, " (cost %.2f, sel %.3f)\n", node->cost, node->selectivity);
+
+    // AND / OR in the order they're evaluated
+    struct query_node* const* children = node->kind == QUERY_NOT ? node->children : childOrder(node);
+    for (int i = 0; i < node->child_count; i++) {
+        explainNode(children[i], depth + 1, out);
+    }
+}
+
+int explainQuery(const struct query* query, char* buffer, size_t size) {
+
+    struct text_builder out = { buffer, size, 0 };
+    if (buffer && size > 0) buffer[0] = '\0';
+    if (!query) return 0;
+
+    if (!query->planned) {
+        appendText(&out, "not planned yet\n");
+    }
+    else if (query->access == QUERY_ACCESS_RANGE) {
+        appendText(&out, "access: date range %d..%d (cost %.0f)\n", query->range_from, query->range_to, query->access_cost);
+    }
+    else if (query->access == QUERY_ACCESS_INDEX) {
+        appendText(&out, "access: term index \"%s\", %d postings (cost %.0f)\n",
+            query->index_term->text, query->index_term->index_count, query->access_cost);
+    }
+    else {
+        appendText(&out, "access: full scan (cost %.0f)\n", query->access_cost);
+    }
+
+    explainNode(query->root, 0, &out);
+    return (int)out.len;
+}
+
+// =====================
+// CANONICAL FORM
+// =====================
+
+struct canonical_part {
+    char* text;
+};
+
+static int compareCanonical(const void* a, const void* b) {
+    return strcmp(((const struct canonical_part*)a)->text, ((const struct canonical_part*)b)->text);
+}
+
+// builds the canonical text of a subtree into a new heap string (NULL if out of memory)
+static char* canonicalNode(const struct query_node* node) {
+
+    char date_text[64];
+
+    switch (node->kind) {
+
+    case QUERY_TEXT: {
+        size_t len = strlen(node->text);
+        int quoted = strpbrk(node->text, " \t") != NULL;
+        char* out = (char*)malloc(len + 3);
+        if (!out) return NULL;
+
+        size_t pos = 0;
+        if (quoted) out[pos++] = '"';
+        for (size_t i = 0; i < len; i++) {
+            char c = node->text[i];
+            if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+            out[pos++] = c;
+        }
+        if (quoted) out[pos++] = '"';
+        out[pos] = '\0';
+        return out;
+    }
+
+    case QUERY_DATE: {
+        int len = snprintf(date_text, sizeof(date_text), "date:%d-%02d-%02d..%d-%02d-%02d",
+            node->date_from / 10000, (node->date_from / 100) % 100, node->date_from % 100,
+            node->date_to / 10000, (node->date_to / 100) % 100, node->date_to % 100);
+        char* out = (char*)malloc((size_t)len + 1);
+        if (out) memcpy(out, date_text, (size_t)len + 1);
+        return out;
+    }
+
+    case QUERY_MONTH: {
+        int len = node->month_from == node->month_to
+            ? snprintf(date_text, sizeof(date_text), "month:%d", node->month_from)
+            : snprintf(date_text, sizeof(date_text), "month:%d..%d", node->month_from, node->month_to);
+        char* out = (char*)malloc((size_t)len + 1);
+        if (out) memcpy(out, date_text, (size_t)len + 1);
+        return out;
+    }
+
+    case QUERY_NOT: {
+        char* inner = canonicalNode(node->children[0]);
+        if (!inner) return NULL;
+
+        int wrap = node->children[0]->kind == QUERY_AND || node->children[0]->kind == QUERY_OR;
+        size_t len = strlen(inner) + 7;
+        char* out = (char*)malloc(len);
+        if (out) snprintf(out, len, wrap ? "NOT (%s)" : "NOT %s", inner);
+        free(inner);
+        return out;
+    }
+
+    case QUERY_AND:
+    case QUERY_OR: {
+        struct canonical_part* parts = (struct canonical_part*)calloc(node->child_count, sizeof(struct canonical_part));
+        if (!parts) return NULL;
+
+        const char* separator = (node->kind == QUERY_AND) ? " AND " : " OR ";
+        size_t total = 1;
+        int ok = 1;
+
+        for (int i = 0; i < node->child_count && ok; i++) {
+            const struct query_node* child = node->children[i];
+            char* inner = canonicalNode(child);
+            if (!inner) {
+                ok = 0;
+                break;
+            }
+
+            // nested AND/OR get parentheses so precedence survives
+            if (child->kind == QUERY_AND || child->kind == QUERY_OR) {
+                size_t len = strlen(inner) + 3;
+                parts[i].text = (char*)malloc(len);
+                if (parts[i].text) snprintf(parts[i].text, len, "(%s)", inner);
+                else ok = 0;
+                free(inner);
+            }
+            else {
+                parts[i].text = inner;
+            }
+            if (ok) total += strlen(parts[i].text) + strlen(separator);
+        }
+
+        char* out = NULL;
+        if (ok) {
+            // operand order doesn't change the result, so sort it away
+            qsort(parts, node->child_count, sizeof(struct canonical_part), compareCanonical);
+
+            out = (char*)malloc(total);
+            if (out) {
+                out[0] = '\0';
+                for (int i = 0; i < node->child_count; i++) {
+                    if (i > 0) strcat_s(out, total, separator);
+                    strcat_s(out, total, parts[i].text);
+                }
+            }
+        }
+
+        for (int i = 0; i < node->child_count; i++) {
+            free(parts[i].text);
+        }
+        free(parts);
+        return out;
+    }
+    }
+    return NULL;
+}
+
+int formatQuery(const struct query* query, char* buffer, size_t size) {
+
+    if (buffer && size > 0) buffer[0] = '\0';
+    if (!query) return 0;
+
+    char* text = canonicalNode(query->root);
+    if (!text) return -1;
+
+    int len = (int)strlen(text);
+    if (buffer && size > 0) snprintf(buffer, size, "%s", text);
+    free(text);
+    return len;
+}
+
+int queryDateBounds(const struct query* query, int* from_key, int* to_key) {
+    if (!query) return 0;
+    return nodeBounds(query->root, from_key, to_key);
+}
+
+struct query_printer {
+    const char* text;
+    int found;
+};
+
+static int printQueryMatch(const struct task_match* match, void* user_data) {
+    struct query_printer* printer = (struct query_printer*)user_data;
+
+    if (!printer->found) {
+        printf("\nQuery results for \"%s\":\n", printer->text);
+    }
+    printer->found = 1;
+
+    printf(" - %d-%02d-%02d (Task %d): %s\n",
+        match->year,
+        match->month,
+        match->day,
+        match->task->task_id,
+        match->task->task_description);
+    return 1;
+}
+
+void queryTasks(struct years* calendar_head, const char* text) {
+
+    char error[128];
+    struct query* query = parseQuery(text, error, sizeof(error));
+    if (!query) {
+        printf("Bad query: %s\n", error);
+        return;
+    }
+
+    struct query_printer printer = { text, 0 };
+    runQuery(calendar_head, query, 0, printQueryMatch, &printer);
+
+    if (!printer.found) {
+        printf("No tasks match \"%s\".\n", text);
+    }
+    else {
+        printf("\n");
+    }
+
+    freeQuery(query);
+}
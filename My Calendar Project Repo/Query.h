@@ -0,0 +1,67 @@
+#pragma once
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stddef.h>
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Small boolean query language over task descriptions and dates.
+    //
+    //   deploy AND prod NOT staging
+    //   "code review" OR standup
+    //   (gym OR run) year:2025
+    //   dentist date:2025-11-01..2025-12-31
+    //   gym month:6..8
+    //
+    // - words match case-insensitively anywhere in the description (like searchTasks)
+    // - "quoted text" matches the whole phrase, spaces included
+    // - AND / OR / NOT must be uppercase; two terms next to each other mean AND
+    // - year: and date: take YYYY, YYYY-MM or YYYY-MM-DD, or a range A..B (years
+    //   up to 214748, so dates fit a yyyymmdd int)
+    // - month: takes a month number 1-12 or a range like 6..8, in any year
+    // - parentheses group; NOT binds tightest, then AND, then OR
+    struct query;
+    struct term_index;
+
+    // parses a query string; returns NULL and fills error (if given) on a syntax error
+    struct query* parseQuery(const char* text, char* error, size_t error_size);
+    void freeQuery(struct query* query);
+
+    // picks the access path (full scan, date range or term index, whichever is
+    // estimated to be cheapest) and term order for this calendar
+    // runQuery does this itself, it's only public so explainQuery has something to show
+    void planQuery(struct query* query, struct years* calendar_head);
+    // same, also considering a term index (TermIndex.h; ignored unless it's current)
+    void planQueryWithIndex(struct query* query, struct years* calendar_head, const struct term_index* index);
+
+    // runs a query, reporting hits like searchTasksEach (limit <= 0 means no limit),
+    // in date order either way; returns how many matches were reported
+    int runQuery(struct years* calendar_head, struct query* query, int limit, TaskMatchFn on_match, void* user_data);
+    int runQueryWithIndex(struct years* calendar_head, const struct term_index* index, struct query* query,
+        int limit, TaskMatchFn on_match, void* user_data);
+
+    // writes the current plan as text (access path + evaluation order with estimates)
+    // returns the length it needed, like snprintf
+    int explainQuery(const struct query* query, char* buffer, size_t size);
+
+    // canonical text for a query: terms lowercased, AND/OR operands sorted, dates spelled
+    // out in full, so equivalent queries ("Prod deploy" / "deploy AND prod") come out the same
+    // returns the length it needed like snprintf, or -1 if it ran out of memory
+    int formatQuery(const struct query* query, char* buffer, size_t size);
+
+    // date bounds implied by the query as yyyymmdd keys; returns 0 if it can match any date
+    int queryDateBounds(const struct query* query, int* from_key, int* to_key);
+
+    // parse + run + print, for the menu
+    void queryTasks(struct years* calendar_head, const char* text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,283 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Query.h"
+#include "QueryCache.h"
+
+// one cached query
+struct cache_entry {
+    char* key;                      // canonical query text
+    unsigned long hash;
+
+    struct task_match* results;
+    int result_count;
+
+    unsigned long long generation;       // calendarGeneration() when filled
+    int from_year;                  // years the query can touch
+    int to_year;
+    int years_in_range;             // loaded years in that range when filled
+
+    struct cache_entry* lru_prev;   // most recently used at the front
+    struct cache_entry* lru_next;
+    struct cache_entry* bucket_next;
+};
+
+struct query_cache {
+    struct cache_entry** buckets;
+    int bucket_count;               // power of two
+
+    struct cache_entry* lru_front;
+    struct cache_entry* lru_back;
+
+    int capacity;
+    int entries;
+    struct query_cache_stats stats;
+};
+
+// FNV-1a, plenty for short query strings
+static unsigned long hashText(const char* text) {
+    unsigned long hash = 2166136261u;
+    while (*text) {
+        hash ^= (unsigned char)*text++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct query_cache* createQueryCache(int capacity) {
+
+    if (capacity < 1) capacity = 1;
+
+    struct query_cache* cache = (struct query_cache*)calloc(1, sizeof(struct query_cache));
+    if (!cache) return NULL;
+
+    // about two buckets per entry keeps the chains short
+    cache->bucket_count = 1;
+    while (cache->bucket_count < capacity * 2) cache->bucket_count <<= 1;
+
+    cache->buckets = (struct cache_entry**)calloc(cache->bucket_count, sizeof(struct cache_entry*));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+    return cache;
+}
+
+static void unlinkLru(struct query_cache* cache, struct cache_entry* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else cache->lru_front = entry->lru_next;
+
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else cache->lru_back = entry->lru_prev;
+
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void pushLruFront(struct query_cache* cache, struct cache_entry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_front;
+    if (cache->lru_front) cache->lru_front->lru_prev = entry;
+    cache->lru_front = entry;
+    if (!cache->lru_back) cache->lru_back = entry;
+}
+
+static void removeEntry(struct query_cache* cache, struct cache_entry* entry) {
+
+    struct cache_entry** link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link && *link != entry) link = &(*link)->bucket_next;
+    if (*link) *link = entry->bucket_next;
+
+    unlinkLru(cache, entry);
+    cache->entries--;
+
+    free(entry->key);
+    free(entry->results);
+    free(entry);
+}
+
+void clearQueryCache(struct query_cache* cache) {
+    if (!cache) return;
+    while (cache->lru_front) removeEntry(cache, cache->lru_front);
+}
+
+void freeQueryCache(struct query_cache* cache) {
+    if (!cache) return;
+    clearQueryCache(cache);
+    free(cache->buckets);
+    free(cache);
+}
+
+// loaded years in [from_year, to_year], and whether any changed after "generation"
+static int countYearsInRange(struct years* calendar_head, int from_year, int to_year,
+    unsigned long long generation, int* changed) {
+
+    int count = 0;
+    *changed = 0;
+
+    for (struct years* y = calendar_head; y != NULL && y->year_number <= to_year; y = y->next) {
+        if (y->year_number < from_year) continue;
+        count++;
+        if (y->generation > generation) *changed = 1;
+    }
+    return count;
+}
+
+static int isEntryCurrent(const struct cache_entry* entry, struct years* calendar_head) {
+
+    // fast path: nothing changed anywhere
+    if (entry->generation == calendarGeneration()) return 1;
+
+    // something changed: fine as long as it was outside the years this query covers
+    // (a freed + rebuilt calendar shows up as new years, or as years going missing)
+    int changed;
+    int years = countYearsInRange(calendar_head, entry->from_year, entry->to_year, entry->generation, &changed);
+    return !changed && years == entry->years_in_range;
+}
+
+// growable result array for filling an entry
+struct result_collector {
+    struct task_match* results;
+    int count;
+    int capacity;
+    int failed;
+};
+
+static int collectResult(const struct task_match* match, void* user_data) {
+    struct result_collector* collector = (struct result_collector*)user_data;
+
+    if (collector->count == collector->capacity) {
+        int grown_capacity = collector->capacity ? collector->capacity * 2 : 16;
+        struct task_match* grown = (struct task_match*)realloc(collector->results,
+            grown_capacity * sizeof(struct task_match));
+        if (!grown) {
+            collector->failed = 1;
+            return 0;
+        }
+        collector->results = grown;
+        collector->capacity = grown_capacity;
+    }
+
+    collector->results[collector->count++] = *match;
+    return 1;
+}
+
+// (re)runs the query and stores the fresh results in the entry
+static int fillEntry(struct cache_entry* entry, struct years* calendar_head, struct query* query) {
+
+    struct result_collector collector = { NULL, 0, 0, 0 };
+    unsigned long long generation = calendarGeneration();
+
+    runQuery(calendar_head, query, 0, collectResult, &collector);
+    if (collector.failed) {
+        free(collector.results);
+        return 0;
+    }
+
+    int from_key, to_key;
+    if (queryDateBounds(query, &from_key, &to_key)) {
+        entry->from_year = from_key / 10000;
+        entry->to_year = to_key / 10000;
+    }
+    else {
+        entry->from_year = INT_MIN;
+        entry->to_year = INT_MAX;
+    }
+
+    int changed;
+    free(entry->results);
+    entry->results = collector.results;
+    entry->result_count = collector.count;
+    entry->generation = generation;
+    entry->years_in_range = countYearsInRange(calendar_head, entry->from_year, entry->to_year, generation, &changed);
+    return 1;
+}
+
+int cachedQuery(struct query_cache* cache, struct years* calendar_head, const char* text,
+    const struct task_match** results, char* error, size_t error_size) {
+
+    if (results) *results = NULL;
+    if (!cache) return -1;
+
+    struct query* query = parseQuery(text, error, error_size);
+    if (!query) return -1;
+
+    // normalized key, so equivalent spellings share an entry
+    int key_len = formatQuery(query, NULL, 0);
+    char* key = (key_len >= 0) ? (char*)malloc((size_t)key_len + 1) : NULL;
+    if (!key) {
+        freeQuery(query);
+        if (error && error_size > 0) snprintf(error, error_size, "Out of memory.");
+        return -1;
+    }
+    formatQuery(query, key, (size_t)key_len + 1);
+
+    unsigned long hash = hashText(key);
+    struct cache_entry* entry = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (entry && (entry->hash != hash || strcmp(entry->key, key) != 0)) {
+        entry = entry->bucket_next;
+    }
+
+    if (entry) {
+        free(key);
+
+        if (isEntryCurrent(entry, calendar_head)) {
+            cache->stats.hits++;
+        }
+        else {
+            cache->stats.invalidations++;
+            if (!fillEntry(entry, calendar_head, query)) {
+                removeEntry(cache, entry);
+                freeQuery(query);
+                if (error && error_size > 0) snprintf(error, error_size, "Out of memory.");
+                return -1;
+            }
+        }
+        unlinkLru(cache, entry);
+        pushLruFront(cache, entry);
+    }
+    else {
+        cache->stats.misses++;
+
+        entry = (struct cache_entry*)calloc(1, sizeof(struct cache_entry));
+        if (!entry || !fillEntry(entry, calendar_head, query)) {
+            free(entry);
+            free(key);
+            freeQuery(query);
+            if (error && error_size > 0) snprintf(error, error_size, "Out of memory.");
+            return -1;
+        }
+        entry->key = key;
+        entry->hash = hash;
+
+        // make room by dropping the least recently used entry
+        if (cache->entries >= cache->capacity) {
+            removeEntry(cache, cache->lru_back);
+            cache->stats.evictions++;
+        }
+
+        struct cache_entry** bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+        entry->bucket_next = *bucket;
+        *bucket = entry;
+        pushLruFront(cache, entry);
+        cache->entries++;
+    }
+
+    freeQuery(query);
+
+    if (results) *results = entry->results;
+    return entry->result_count;
+}
+
+void getQueryCacheStats(const struct query_cache* cache, struct query_cache_stats* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) return;
+
+    *stats = cache->stats;
+    stats->entries = cache->entries;
+    stats->capacity = cache->capacity;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <stddef.h>
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // LRU cache of query results (see Query.h for the query syntax).
+    //
+    // Entries are keyed by the canonical form of the query (formatQuery), so
+    // "Prod deploy" and "deploy AND prod" share one entry. Each entry remembers
+    // calendarGeneration() from when it was filled:
+    // - nothing changed anywhere since then -> hit
+    // - something changed -> still a hit if no year the query can touch was changed
+    //   or created since (years carry their own generation stamp), so a query
+    //   bounded to year:2024 survives edits in 2025
+    // - otherwise the entry is refilled
+    //
+    // A cache should only ever be used with one calendar at a time.
+    struct query_cache;
+
+    struct query_cache_stats {
+        unsigned long hits;
+        unsigned long misses;           // not cached yet (or evicted)
+        unsigned long invalidations;    // cached but stale, had to rerun
+        unsigned long evictions;        // dropped to make room (least recently used)
+        int entries;
+        int capacity;
+    };
+
+    struct query_cache* createQueryCache(int capacity);
+    void freeQueryCache(struct query_cache* cache);
+    void clearQueryCache(struct query_cache* cache);
+
+    // runs a query through the cache; *results points at the cached matches (date order)
+    // and stays valid until the next call on this cache or the next calendar change
+    // returns the number of matches, or -1 if the query doesn't parse / memory runs out
+    int cachedQuery(struct query_cache* cache, struct years* calendar_head, const char* text,
+        const struct task_match** results, char* error, size_t error_size);
+
+    void getQueryCacheStats(const struct query_cache* cache, struct query_cache_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
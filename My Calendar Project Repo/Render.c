@@ -0,0 +1,409 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "CalendarInternal.h"
+#include "Platform.h"
+#include "Render.h"
+
+#define RENDER_MIN_CAPACITY 4096
+
+static const char* g_month_names[] = {
+    "", "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December"
+};
+
+// grid rows: 7 cells of 3 characters between '|'s; a week row is copied from
+// the empty one and only its day cells are filled in
+#define GRID_ROW_LENGTH 30
+#define GRID_TITLE_WIDTH 31     // what the titles are centered in
+static const char g_grid_top[] = "_____________________________\n";
+static const char g_grid_days[] = "|Su |Mo |Tu |We |Th |Fr |Sa |\n";
+static const char g_grid_rule[] = "|___|___|___|___|___|___|___|\n";
+static const char g_grid_week[] = "|   |   |   |   |   |   |   |\n";
+static const char g_grid_legend[] = "\n* = day has one or more tasks.\n";
+
+// =====================
+// SINKS
+// =====================
+
+static int writeFile(const char* data, size_t length, void* user_data) {
+    return fwrite(data, 1, length, (FILE*)user_data) == length;
+}
+
+static int writeFd(const char* data, size_t length, void* user_data) {
+
+    int fd = (int)(intptr_t)user_data;
+    while (length > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, length > 0x40000000 ? 0x40000000 : (unsigned int)length);
+#else
+        ssize_t written = write(fd, data, length);
+#endif
+        if (written <= 0) return 0;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+// grows to at least needed bytes (doubling); returns 0 if memory runs out
+static int reserve(char** data, size_t* capacity, size_t needed) {
+
+    if (needed <= *capacity) return 1;
+
+    size_t grown = *capacity ? *capacity : RENDER_MIN_CAPACITY;
+    while (grown < needed) grown *= 2;
+
+    char* bigger = (char*)realloc(*data, grown);
+    if (!bigger) return 0;
+    *data = bigger;
+    *capacity = grown;
+    return 1;
+}
+
+static int writeMemory(const char* data, size_t length, void* user_data) {
+
+    struct render_memory* memory = (struct render_memory*)user_data;
+    if (!reserve(&memory->data, &memory->capacity, memory->length + length + 1)) return 0;
+
+    memcpy(memory->data + memory->length, data, length);
+    memory->length += length;
+    memory->data[memory->length] = '\0';
+    return 1;
+}
+
+struct render_sink fileSink(FILE* out) {
+    struct render_sink sink = { writeFile, out };
+    return sink;
+}
+
+struct render_sink fdSink(int fd) {
+    struct render_sink sink = { writeFd, (void*)(intptr_t)fd };
+    return sink;
+}
+
+struct render_sink memorySink(struct render_memory* memory) {
+    struct render_sink sink = { writeMemory, memory };
+    return sink;
+}
+
+void freeRenderMemory(struct render_memory* memory) {
+    free(memory->data);
+    memset(memory, 0, sizeof(*memory));
+}
+
+// =====================
+// BUFFER
+// =====================
+
+void initRenderBuffer(struct render_buffer* buffer, struct render_sink sink) {
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->sink = sink;
+}
+
+void freeRenderBuffer(struct render_buffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+int flushRender(struct render_buffer* buffer) {
+
+    if (buffer->length > 0 && !buffer->failed) {
+        if (!buffer->sink.write || !buffer->sink.write(buffer->data, buffer->length, buffer->sink.user_data)) buffer->failed = 1;
+    }
+    buffer->length = 0;
+    return !buffer->failed;
+}
+
+// room for length more bytes, or NULL (and the buffer marked failed)
+static char* renderSpace(struct render_buffer* buffer, size_t length) {
+
+    if (buffer->failed) return NULL;
+    if (!reserve(&buffer->data, &buffer->capacity, buffer->length + length)) {
+        buffer->failed = 1;
+        return NULL;
+    }
+
+    char* space = buffer->data + buffer->length;
+    buffer->length += length;
+    return space;
+}
+
+void renderText(struct render_buffer* buffer, const char* text, size_t length) {
+    char* space = renderSpace(buffer, length);
+    if (space) memcpy(space, text, length);
+}
+
+void renderString(struct render_buffer* buffer, const char* text) {
+    renderText(buffer, text, strlen(text));
+}
+
+static void renderSpaces(struct render_buffer* buffer, int count) {
+    char* space = count > 0 ? renderSpace(buffer, (size_t)count) : NULL;
+    if (space) memset(space, ' ', (size_t)count);
+}
+
+static void renderInt(struct render_buffer* buffer, int value) {
+    char digits[16];
+    int length = snprintf(digits, sizeof(digits), "%d", value);
+    renderText(buffer, digits, (size_t)length);
+}
+
+// =====================
+// VIEWS
+// =====================
+
+// digits in a year, ignoring the sign (what the titles are centered by)
+static int yearDigits(int year) {
+
+    int digits = 0;
+    if (year == 0) return 1;
+    while (year != 0) {
+        year /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+// one week of a month into row (GRID_ROW_LENGTH characters, '\n' included);
+// days can be NULL when the year isn't loaded
+static void fillWeekRow(char* row, int week, int first_weekday, int month_days, const struct days* days) {
+
+    memcpy(row, g_grid_week, GRID_ROW_LENGTH);
+    for (int weekday = 0; weekday < 7; weekday++) {
+        int d = week * 7 + weekday - first_weekday + 1;
+        if (d < 1 || d > month_days) continue;
+
+        // "5* " / "5  " or "15*" / "15 "
+        char* cell = row + 1 + weekday * 4;
+        int has_task = days && days[d - 1].tasks_head != NULL;
+        if (d < 10) {
+            cell[0] = (char)('0' + d);
+            cell[1] = has_task ? '*' : ' ';
+        }
+        else {
+            cell[0] = (char)('0' + d / 10);
+            cell[1] = (char)('0' + d % 10);
+            cell[2] = has_task ? '*' : ' ';
+        }
+    }
+}
+
+int renderMonthCalendar(struct render_buffer* buffer, struct years* calendar_head, int year, int month) {
+
+    if (month < 1 || month > 12) {
+        renderString(buffer, "Invalid month.\n");
+        return 0;
+    }
+
+    TRACE_BEGIN(span);
+    struct years* year_node = findYear(calendar_head, year);
+    const struct days* days = year_node ? monthDays(&year_node->months[month - 1]) : NULL;
+
+    const struct month_skeleton* shape = &yearSkeleton(year)->months[month - 1];
+    int nDays = shape->num_days;
+    int firstWeekday = shape->first_weekday;
+
+    // "Month Year" centered over the grid (rounded left when it doesn't fit evenly)
+    int title_len = (int)strlen(g_month_names[month]) + 1 + yearDigits(year);
+    int offset = (GRID_TITLE_WIDTH - title_len) / 2;
+    if (((GRID_TITLE_WIDTH - title_len) % 2) != 0) {
+        offset--;
+    }
+
+    renderString(buffer, "\n");
+    renderSpaces(buffer, offset);
+    renderString(buffer, g_month_names[month]);
+    renderString(buffer, " ");
+    renderInt(buffer, year);
+    renderString(buffer, "\n");
+    renderText(buffer, g_grid_top, GRID_ROW_LENGTH);
+    renderText(buffer, g_grid_days, GRID_ROW_LENGTH);
+    renderText(buffer, g_grid_rule, GRID_ROW_LENGTH);
+
+    // a row per week, each followed by a rule
+    int weeks = (firstWeekday + nDays + 6) / 7;
+    char* grid = renderSpace(buffer, (size_t)weeks * 2 * GRID_ROW_LENGTH);
+    if (!grid) return 1;
+
+    for (int w = 0; w < weeks; w++) {
+        char* row = grid + (size_t)w * 2 * GRID_ROW_LENGTH;
+        fillWeekRow(row, w, firstWeekday, nDays, days);
+        memcpy(row + GRID_ROW_LENGTH, g_grid_rule, GRID_ROW_LENGTH);
+    }
+
+    renderText(buffer, g_grid_legend, sizeof(g_grid_legend) - 1);
+    TRACE_END(span, "render month grid", "render", "month", month);
+    return 1;
+}
+
+void renderYearTitle(struct render_buffer* buffer, int year) {
+
+    // "===Calendar of Year===", one further left than centered
+    int offset = (GRID_TITLE_WIDTH - yearDigits(year) - 18) / 2 - 1;
+
+    renderString(buffer, "\n");
+    renderSpaces(buffer, offset);
+    renderString(buffer, "===Calendar of ");
+    renderInt(buffer, year);
+    renderString(buffer, "===\n");
+}
+
+int renderYearCalendar(struct render_buffer* buffer, struct years* calendar_head, int year) {
+
+    TRACE_BEGIN(span);
+    renderYearTitle(buffer, year);
+
+    // one lookup for all 12 months (the walk is the same every time)
+    struct years* year_node = findYear(calendar_head, year);
+    for (int m = 1; m <= 12; m++) {
+        renderMonthCalendar(buffer, year_node, year, m);
+    }
+
+    TRACE_END(span, "render year calendar", "render", "year", year);
+    return 1;
+}
+
+// where each month of a year starts and how many weeks it spans, straight
+// from the year's shared skeleton
+struct month_layout {
+    int first_weekday;
+    int days;
+    int weeks;
+};
+
+static void yearLayout(int year, struct month_layout layout[12]) {
+
+    const struct year_skeleton* skeleton = yearSkeleton(year);
+    for (int m = 0; m < 12; m++) {
+        layout[m].first_weekday = skeleton->months[m].first_weekday;
+        layout[m].days = skeleton->months[m].num_days;
+        layout[m].weeks = (layout[m].first_weekday + layout[m].days + 6) / 7;
+    }
+}
+
+// one line of a month's block in the column view (no '\n'): its title, the
+// grid's top, the weekday names, then a week row and a rule per week; months
+// with fewer weeks than their neighbours get blank lines
+static void renderBlockLine(struct render_buffer* buffer, int line, int year, int month,
+    const struct month_layout* layout, const struct days* days) {
+
+    const int width = GRID_ROW_LENGTH - 1;
+    char* space = renderSpace(buffer, (size_t)width);
+    if (!space) return;
+
+    if (line == 0) {
+        char title[32];
+        int length = snprintf(title, sizeof(title), "%s %d", g_month_names[month], year);
+        if (length > width) length = width;
+        int offset = (width - length) / 2;
+
+        memset(space, ' ', (size_t)width);
+        memcpy(space + offset, title, (size_t)length);
+    }
+    else if (line == 1) memcpy(space, g_grid_top, (size_t)width);
+    else if (line == 2) memcpy(space, g_grid_days, (size_t)width);
+    else if (line == 3) memcpy(space, g_grid_rule, (size_t)width);
+    else {
+        int week = (line - 4) / 2;
+        if (week >= layout->weeks) memset(space, ' ', (size_t)width);
+        else if ((line - 4) % 2 == 1) memcpy(space, g_grid_rule, (size_t)width);
+        else {
+            char row[GRID_ROW_LENGTH];
+            fillWeekRow(row, week, layout->first_weekday, layout->days, days);
+            memcpy(space, row, (size_t)width);
+        }
+    }
+}
+
+int renderYearColumns(struct render_buffer* buffer, struct years* calendar_head, int year, int columns) {
+
+    if (columns < 1 || columns > 12) {
+        renderString(buffer, "Invalid number of columns.\n");
+        return 0;
+    }
+
+    TRACE_BEGIN(span);
+    struct years* year_node = findYear(calendar_head, year);
+    struct month_layout layout[12];
+    yearLayout(year, layout);
+
+    // the title, centered over all the columns
+    const int gap = 2;
+    int total_width = columns * (GRID_ROW_LENGTH - 1) + (columns - 1) * gap;
+    int offset = (total_width - yearDigits(year) - 18) / 2;
+    renderString(buffer, "\n");
+    renderSpaces(buffer, offset);
+    renderString(buffer, "===Calendar of ");
+    renderInt(buffer, year);
+    renderString(buffer, "===\n");
+
+    // a band of months side by side, written a line at a time across them
+    for (int first = 0; first < 12; first += columns) {
+        int last = first + columns < 12 ? first + columns : 12;
+
+        int weeks = 0;
+        for (int m = first; m < last; m++) {
+            if (layout[m].weeks > weeks) weeks = layout[m].weeks;
+        }
+
+        renderString(buffer, "\n");
+        for (int line = 0; line < 4 + 2 * weeks; line++) {
+            for (int m = first; m < last; m++) {
+                if (m > first) renderSpaces(buffer, gap);
+                const struct days* days = year_node ? monthDays(&year_node->months[m]) : NULL;
+                renderBlockLine(buffer, line, year, m + 1, &layout[m], days);
+            }
+
+            // no trailing blanks (a short last month, a title)
+            while (buffer->length > 0 && !buffer->failed && buffer->data[buffer->length - 1] == ' ') buffer->length--;
+            renderString(buffer, "\n");
+        }
+    }
+
+    renderText(buffer, g_grid_legend, sizeof(g_grid_legend) - 1);
+    TRACE_END(span, "render year columns", "render", "year", year);
+    return 1;
+}
+
+// =====================
+// STDOUT WRAPPERS
+// =====================
+
+//Main Contributors: Farah Laniari
+//Main Editor: Damian Wilson
+void printMonthCalendar(struct years* calendar_head, int year, int month) {
+
+    struct render_buffer buffer;
+    initRenderBuffer(&buffer, fileSink(stdout));
+    renderMonthCalendar(&buffer, calendar_head, year, month);
+    flushRender(&buffer);
+    freeRenderBuffer(&buffer);
+}
+
+void printYearCalendar(struct years* calendar_head, int year) {
+
+    struct render_buffer buffer;
+    initRenderBuffer(&buffer, fileSink(stdout));
+    renderYearCalendar(&buffer, calendar_head, year);
+    flushRender(&buffer);
+    freeRenderBuffer(&buffer);
+}
+
+void printYearColumns(struct years* calendar_head, int year, int columns) {
+
+    struct render_buffer buffer;
+    initRenderBuffer(&buffer, fileSink(stdout));
+    renderYearColumns(&buffer, calendar_head, year, columns);
+    flushRender(&buffer);
+    freeRenderBuffer(&buffer);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Builds the month grid and year calendar views into one growing buffer
+    // and hands the text to a sink in one piece, instead of dozens of tiny
+    // printf calls per month (a whole year used to be thousands of writes).
+    // Grid rows are copied from fixed templates and only the day cells are
+    // filled in.
+    //
+    // A sink is a write function plus its user_data: fileSink (a FILE*),
+    // fdSink (a file descriptor, no stdio buffering in between) and memorySink
+    // (a growing string) are provided; anything else can be plugged in.
+    // printMonthCalendar / printYearCalendar are the stdout wrappers.
+    //
+    // A render_buffer belongs to one thread at a time; keep one around to
+    // reuse its memory from view to view.
+
+    // writes length bytes; returns 0 on failure
+    typedef int (*RenderWriteFn)(const char* data, size_t length, void* user_data);
+
+    struct render_sink {
+        RenderWriteFn write;
+        void* user_data;
+    };
+
+    // what a memorySink collects (free data with freeRenderMemory)
+    struct render_memory {
+        char* data;                 // '\0' terminated, NULL until something is written
+        size_t length;
+        size_t capacity;
+    };
+
+    struct render_sink fileSink(FILE* out);
+    struct render_sink fdSink(int fd);
+    struct render_sink memorySink(struct render_memory* memory);
+    void freeRenderMemory(struct render_memory* memory);
+
+    struct render_buffer {
+        char* data;
+        size_t length;
+        size_t capacity;
+        struct render_sink sink;
+        int failed;                 // out of memory or a failed write since init
+    };
+
+    void initRenderBuffer(struct render_buffer* buffer, struct render_sink sink);
+    void freeRenderBuffer(struct render_buffer* buffer);
+
+    // hands everything rendered so far to the sink (in one write) and empties
+    // the buffer; returns 0 if that or anything before it failed
+    int flushRender(struct render_buffer* buffer);
+
+    // appends to the buffer (nothing is written until flushRender)
+    void renderText(struct render_buffer* buffer, const char* text, size_t length);
+    void renderString(struct render_buffer* buffer, const char* text);
+
+    // The month grid ('*' marks days with tasks) and the year calendar (a
+    // title, then the 12 grids). Years that aren't loaded show no tasks; nothing
+    // is created. Return 0 for an invalid month (after rendering the message).
+    int renderMonthCalendar(struct render_buffer* buffer, struct years* calendar_head, int year, int month);
+    int renderYearCalendar(struct render_buffer* buffer, struct years* calendar_head, int year);
+
+    // The year calendar with its months side by side, columns across (4 gives
+    // three rows of four, 3 four rows of three), written line by line across
+    // each row of months in one pass. Returns 0 unless columns is 1-12.
+    int renderYearColumns(struct render_buffer* buffer, struct years* calendar_head, int year, int columns);
+
+    // just the year calendar's title line, for callers that render its months
+    // themselves (RenderCache.h)
+    void renderYearTitle(struct render_buffer* buffer, int year);
+
+    // the same views to stdout, rendered then written at once
+    void printMonthCalendar(struct years* calendar_head, int year, int month);
+    void printYearCalendar(struct years* calendar_head, int year);
+    void printYearColumns(struct years* calendar_head, int year, int columns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalendarInternal.h"
+#include "RenderCache.h"
+
+// one rendered month grid
+struct grid_entry {
+    int year;
+    int month;
+    unsigned long occupancy;            // bit d-1 set = day d has tasks
+    unsigned long long generation;      // the year's stamp when rendered (0 = not loaded)
+
+    char* text;
+    size_t length;
+
+    struct grid_entry* lru_prev;        // most recently used at the front
+    struct grid_entry* lru_next;
+    struct grid_entry* bucket_next;
+};
+
+struct render_cache {
+    struct grid_entry** buckets;
+    int bucket_count;                   // power of two
+
+    struct grid_entry* lru_front;
+    struct grid_entry* lru_back;
+
+    int capacity;
+    int entries;
+    struct render_cache_stats stats;
+};
+
+static unsigned int hashMonth(int year, int month) {
+    return ((unsigned int)year * 12u + (unsigned int)month) * 2654435761u;
+}
+
+struct render_cache* createRenderCache(int capacity) {
+
+    if (capacity < 1) capacity = 1;
+
+    struct render_cache* cache = (struct render_cache*)calloc(1, sizeof(struct render_cache));
+    if (!cache) return NULL;
+
+    // about two buckets per entry keeps the chains short
+    cache->bucket_count = 1;
+    while (cache->bucket_count < capacity * 2) cache->bucket_count <<= 1;
+
+    cache->buckets = (struct grid_entry**)calloc(cache->bucket_count, sizeof(struct grid_entry*));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+    return cache;
+}
+
+static void unlinkLru(struct render_cache* cache, struct grid_entry* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else cache->lru_front = entry->lru_next;
+
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else cache->lru_back = entry->lru_prev;
+
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void pushLruFront(struct render_cache* cache, struct grid_entry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_front;
+    if (cache->lru_front) cache->lru_front->lru_prev = entry;
+    cache->lru_front = entry;
+    if (!cache->lru_back) cache->lru_back = entry;
+}
+
+static void removeEntry(struct render_cache* cache, struct grid_entry* entry) {
+
+    struct grid_entry** link = &cache->buckets[hashMonth(entry->year, entry->month) & (cache->bucket_count - 1)];
+    while (*link && *link != entry) link = &(*link)->bucket_next;
+    if (*link) *link = entry->bucket_next;
+
+    unlinkLru(cache, entry);
+    cache->entries--;
+
+    free(entry->text);
+    free(entry);
+}
+
+void clearRenderCache(struct render_cache* cache) {
+    if (!cache) return;
+    while (cache->lru_front) removeEntry(cache, cache->lru_front);
+}
+
+void freeRenderCache(struct render_cache* cache) {
+    if (!cache) return;
+    clearRenderCache(cache);
+    free(cache->buckets);
+    free(cache);
+}
+
+// which days of the month have tasks, a bit each (kept up to date by every add / delete)
+static unsigned long monthOccupancy(struct years* year_node, int month) {
+    if (!year_node) return 0;
+    return year_node->months[month - 1].occupied_days;
+}
+
+// renders the month into buffer and keeps a copy in the entry
+static int fillEntry(struct grid_entry* entry, struct render_buffer* buffer, struct years* year_node) {
+
+    size_t start = buffer->length;
+    renderMonthCalendar(buffer, year_node, entry->year, entry->month);
+    if (buffer->failed) return 0;
+
+    size_t length = buffer->length - start;
+    char* text = (char*)malloc(length);
+    if (!text) return 0;
+    memcpy(text, buffer->data + start, length);
+
+    free(entry->text);
+    entry->text = text;
+    entry->length = length;
+    return 1;
+}
+
+int renderCachedMonth(struct render_cache* cache, struct render_buffer* buffer,
+    struct years* calendar_head, int year, int month) {
+
+    if (!cache || month < 1 || month > 12) return renderMonthCalendar(buffer, calendar_head, year, month);
+
+    struct years* year_node = findYear(calendar_head, year);
+    unsigned long long generation = year_node ? year_node->generation : 0;
+
+    unsigned int hash = hashMonth(year, month);
+    struct grid_entry* entry = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (entry && (entry->year != year || entry->month != month)) {
+        entry = entry->bucket_next;
+    }
+
+    if (entry) {
+        // stamps are never reused, so the same one means the same, unchanged year
+        unsigned long occupancy = generation == entry->generation ? entry->occupancy
+            : monthOccupancy(year_node, month);
+
+        if (occupancy == entry->occupancy) {
+            cache->stats.hits++;
+            entry->generation = generation;
+            renderText(buffer, entry->text, entry->length);
+        }
+        else {
+            cache->stats.invalidations++;
+            entry->occupancy = occupancy;
+            entry->generation = generation;
+            if (!fillEntry(entry, buffer, year_node)) {
+                removeEntry(cache, entry);
+                return 1;
+            }
+        }
+        unlinkLru(cache, entry);
+        pushLruFront(cache, entry);
+        return 1;
+    }
+
+    cache->stats.misses++;
+
+    entry = (struct grid_entry*)calloc(1, sizeof(struct grid_entry));
+    if (!entry) return renderMonthCalendar(buffer, year_node, year, month);
+    entry->year = year;
+    entry->month = month;
+    entry->occupancy = monthOccupancy(year_node, month);
+    entry->generation = generation;
+    if (!fillEntry(entry, buffer, year_node)) {
+        free(entry);
+        return 1;
+    }
+
+    // make room by dropping the least recently used entry
+    if (cache->entries >= cache->capacity) {
+        removeEntry(cache, cache->lru_back);
+        cache->stats.evictions++;
+    }
+
+    struct grid_entry** bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+    pushLruFront(cache, entry);
+    cache->entries++;
+    return 1;
+}
+
+int renderCachedYear(struct render_cache* cache, struct render_buffer* buffer,
+    struct years* calendar_head, int year) {
+
+    TRACE_BEGIN(span);
+    renderYearTitle(buffer, year);
+
+    // one lookup for all 12 months
+    struct years* year_node = findYear(calendar_head, year);
+    for (int m = 1; m <= 12; m++) {
+        renderCachedMonth(cache, buffer, year_node, year, m);
+    }
+
+    TRACE_END(span, "render year calendar", "render", "year", year);
+    return 1;
+}
+
+void getRenderCacheStats(const struct render_cache* cache, struct render_cache_stats* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) return;
+
+    *stats = cache->stats;
+    stats->entries = cache->entries;
+    stats->capacity = cache->capacity;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include "Calendar.h"
+#include "Render.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // LRU cache of rendered month grids (Render.h), for views that redraw the
+    // same months over and over.
+    //
+    // A grid only depends on its year, its month and which days have tasks,
+    // so entries are keyed by (year, month) and remember that occupancy (a bit
+    // per day) along with the year's generation stamp from when they were
+    // rendered:
+    // - the year hasn't changed since -> hit, nothing is looked at
+    // - it has, but this month's days with tasks are the same ones -> still a
+    //   hit (an edit, or a change somewhere else in the year)
+    // - the occupancy is different -> only this month is rendered again
+    //
+    // A cache should only ever be used with one calendar at a time, from one
+    // thread at a time.
+    struct render_cache;
+
+    struct render_cache_stats {
+        unsigned long hits;
+        unsigned long misses;           // not cached yet (or evicted)
+        unsigned long invalidations;    // cached but the occupancy changed, rendered again
+        unsigned long evictions;        // dropped to make room (least recently used)
+        int entries;
+        int capacity;
+    };
+
+    // capacity is in months (12 per year view)
+    struct render_cache* createRenderCache(int capacity);
+    void freeRenderCache(struct render_cache* cache);
+    void clearRenderCache(struct render_cache* cache);
+
+    // renderMonthCalendar / renderYearCalendar through the cache (same output,
+    // same return values); a month that can't be cached is still rendered
+    int renderCachedMonth(struct render_cache* cache, struct render_buffer* buffer,
+        struct years* calendar_head, int year, int month);
+    int renderCachedYear(struct render_cache* cache, struct render_buffer* buffer,
+        struct years* calendar_head, int year);
+
+    void getRenderCacheStats(const struct render_cache* cache, struct render_cache_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
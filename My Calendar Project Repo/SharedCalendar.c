@@ -0,0 +1,690 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Platform.h"
+#include "SharedCalendar.h"
+
+#ifndef __linux__
+
+struct shared_calendar* createSharedCalendar(const char* name) {
+    (void)name;
+    return NULL;
+}
+
+void destroySharedCalendar(struct shared_calendar* shared) {
+    (void)shared;
+}
+
+int publishSharedCalendar(struct shared_calendar* shared, struct years* calendar_head) {
+    (void)shared;
+    (void)calendar_head;
+    return 0;
+}
+
+struct shared_calendar_view* openSharedCalendar(const char* name) {
+    (void)name;
+    return NULL;
+}
+
+void closeSharedCalendar(struct shared_calendar_view* view) {
+    (void)view;
+}
+
+long long sharedCalendarVersion(struct shared_calendar_view* view) {
+    (void)view;
+    return -1;
+}
+
+int sharedCountTasks(struct shared_calendar_view* view, int year, int month, int day) {
+    (void)view; (void)year; (void)month; (void)day;
+    return -1;
+}
+
+int sharedMonthSummary(struct shared_calendar_view* view, int year, int month,
+    int* task_count, unsigned int* occupied_days) {
+    (void)view; (void)year; (void)month; (void)task_count; (void)occupied_days;
+    return -1;
+}
+
+int sharedDayTasks(struct shared_calendar_view* view, int year, int month, int day,
+    struct shared_task* tasks, int max) {
+    (void)view; (void)year; (void)month; (void)day; (void)tasks; (void)max;
+    return -1;
+}
+
+int sharedSearchTasks(struct shared_calendar_view* view, const char* keyword,
+    struct shared_task* tasks, int max) {
+    (void)view; (void)keyword; (void)tasks; (void)max;
+    return -1;
+}
+
+#else
+
+#define SHARED_MAGIC 0x544c4143u       // "CALT"
+#define SHARED_LAYOUT 1
+// smallest block; a block that's too small grows to 1.5x what's needed
+#define SHARED_MIN_BLOCK (64 * 1024)
+
+// segment_header.retired: a bigger segment has taken the name, or the writer is gone
+#define SEGMENT_REPLACED 1
+#define SEGMENT_REMOVED 2
+
+// =====================
+// LAYOUT
+// =====================
+// Every offset is from the start of its block. Arrays are 8-byte aligned.
+
+struct segment_header {
+    unsigned int magic;
+    unsigned int layout;
+    unsigned long long block_size;
+    volatile unsigned long long active;     // block readers should use (0 / 1)
+    volatile unsigned long long published;  // how many publishes so far
+    volatile unsigned long long retired;    // SEGMENT_REPLACED / SEGMENT_REMOVED once it's out of use
+    unsigned long long unused[3];           // pads the header to 64 bytes
+};
+
+struct block_header {
+    volatile unsigned long long sequence;   // odd while being written
+    unsigned long long published;           // the publish this block holds
+    unsigned int year_count;
+    unsigned int task_count;
+    unsigned int years_at;                  // flat_year[year_count], sorted
+    unsigned int months_at;                 // flat_month[year_count * 12]
+    unsigned int days_at;                   // flat_day[], each month's days together
+    unsigned int tasks_at;                  // flat_task[task_count], each day's tasks together
+    unsigned int text_at;                   // descriptions, NUL-terminated
+    unsigned int used;
+};
+
+struct flat_year {
+    int year_number;
+    unsigned int task_count;
+};
+
+struct flat_month {
+    unsigned int task_count;
+    unsigned int occupied_days;
+    unsigned int first_day;                 // index into the days
+    unsigned int num_days;
+};
+
+struct flat_day {
+    unsigned int first_task;                // index into the tasks
+    unsigned int task_count;
+};
+
+struct flat_task {
+    int task_id;
+    unsigned int text_at;
+    unsigned int length;                    // without the NUL
+};
+
+static unsigned long long alignUp(unsigned long long offset) {
+    return (offset + 7) & ~7ULL;
+}
+
+static struct segment_header* segmentHeader(const char* base) {
+    return (struct segment_header*)base;
+}
+
+static char* blockStart(const char* base, unsigned long long block_size, unsigned long long index) {
+    return (char*)base + sizeof(struct segment_header) + index * block_size;
+}
+
+// =====================
+// WRITER
+// =====================
+
+struct shared_calendar {
+    char* name;
+    char* next_name;                        // a new segment is built under this, then renamed
+    char* base;
+    size_t size;
+    unsigned long long block_size;
+    unsigned long long published;
+};
+
+// where each array goes in a block for this calendar; returns the bytes needed
+static unsigned long long planBlock(struct years* calendar_head, struct block_header* plan) {
+
+    unsigned long long years = 0, days = 0, tasks = 0, text = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        years++;
+        for (int m = 0; m < 12; m++) {
+            struct months* month = &y->months[m];
+            days += (unsigned long long)month->num_days;
+            if (month->task_count == 0) continue;
+            for (int d = 0; d < month->num_days; d++) {
+                for (struct tasks* t = month->days[d].tasks_head; t != NULL; t = t->next) {
+                    tasks++;
+                    text += strlen(t->task_description) + 1;
+                }
+            }
+        }
+    }
+
+    unsigned long long at = alignUp(sizeof(struct block_header));
+    plan->year_count = (unsigned int)years;
+    plan->task_count = (unsigned int)tasks;
+    plan->years_at = (unsigned int)at;
+    at = alignUp(at + years * sizeof(struct flat_year));
+    plan->months_at = (unsigned int)at;
+    at = alignUp(at + years * 12 * sizeof(struct flat_month));
+    plan->days_at = (unsigned int)at;
+    at = alignUp(at + days * sizeof(struct flat_day));
+    plan->tasks_at = (unsigned int)at;
+    at = alignUp(at + tasks * sizeof(struct flat_task));
+    plan->text_at = (unsigned int)at;
+    at += text;
+    plan->used = (unsigned int)at;
+    return at;
+}
+
+// fills a block laid out by planBlock
+static void writeBlock(char* block, const struct block_header* plan, struct years* calendar_head) {
+
+    struct flat_year* years = (struct flat_year*)(block + plan->years_at);
+    struct flat_month* months = (struct flat_month*)(block + plan->months_at);
+    struct flat_day* days = (struct flat_day*)(block + plan->days_at);
+    struct flat_task* tasks = (struct flat_task*)(block + plan->tasks_at);
+    unsigned int day_at = 0, task_at = 0, text_at = plan->text_at;
+
+    for (struct years* y = calendar_head; y != NULL; y = y->next, years++) {
+        years->year_number = y->year_number;
+        years->task_count = (unsigned int)y->task_count;
+
+        for (int m = 0; m < 12; m++, months++) {
+            struct months* month = &y->months[m];
+            months->task_count = (unsigned int)month->task_count;
+            months->occupied_days = month->occupied_days;
+            months->first_day = day_at;
+            months->num_days = (unsigned int)month->num_days;
+
+            for (int d = 0; d < month->num_days; d++, day_at++) {
+                days[day_at].first_task = task_at;
+                days[day_at].task_count = 0;
+                if (month->task_count == 0) continue;
+
+                for (struct tasks* t = month->days[d].tasks_head; t != NULL; t = t->next, task_at++) {
+                    size_t length = strlen(t->task_description);
+                    memcpy(block + text_at, t->task_description, length + 1);
+                    tasks[task_at].task_id = t->task_id;
+                    tasks[task_at].text_at = text_at;
+                    tasks[task_at].length = (unsigned int)length;
+                    text_at += (unsigned int)length + 1;
+                    days[day_at].task_count++;
+                }
+            }
+        }
+    }
+
+    // the header last, apart from the sequence the caller owns
+    struct block_header* header = (struct block_header*)block;
+    unsigned long long sequence = header->sequence;
+    *header = *plan;
+    header->sequence = sequence;
+}
+
+// where shm_open keeps its objects on Linux: renaming in there is the one way
+// to give a finished segment the shared name in a single step
+#define SHM_DIRECTORY "/dev/shm"
+
+// a fresh segment under the temporary name, so the one readers use keeps its
+// name whatever happens here; both blocks hold an empty calendar
+static char* createSegment(struct shared_calendar* shared, unsigned long long block_size, size_t* size) {
+
+    *size = sizeof(struct segment_header) + 2 * (size_t)block_size;
+
+    // left over from a writer that died half way
+    shm_unlink(shared->next_name);
+    int fd = shm_open(shared->next_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)*size) != 0) {
+        close(fd);
+        shm_unlink(shared->next_name);
+        return NULL;
+    }
+
+    char* base = (char*)mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(shared->next_name);
+        return NULL;
+    }
+
+    // ftruncate zero-fills, so both blocks start out as empty calendars
+    struct segment_header* header = segmentHeader(base);
+    header->layout = SHARED_LAYOUT;
+    header->block_size = block_size;
+    header->published = shared->published;
+    for (int i = 0; i < 2; i++) {
+        struct block_header plan;
+        memset(&plan, 0, sizeof(plan));
+        planBlock(NULL, &plan);
+        plan.published = shared->published;
+        writeBlock(blockStart(base, block_size, i), &plan, NULL);
+    }
+    return base;
+}
+
+// a segment that won't be installed after all; the current one is untouched
+static void dropSegment(struct shared_calendar* shared, char* base, size_t size) {
+    munmap(base, size);
+    shm_unlink(shared->next_name);
+}
+
+// makes a filled-in segment the one readers use: the magic goes in, the
+// segment takes over the name in one rename (anyone opening the name gets the
+// old segment or the new one, complete), then readers of the old one are told
+// to go and find it. Returns 0, with the old segment still in place, if the
+// rename fails.
+static int installSegment(struct shared_calendar* shared, char* base, size_t size, unsigned long long block_size) {
+
+    atomicFence();
+    segmentHeader(base)->magic = SHARED_MAGIC;
+    atomicFence();
+
+    char from[512], to[512];
+    int fits = snprintf(from, sizeof(from), "%s%s", SHM_DIRECTORY, shared->next_name) < (int)sizeof(from)
+        && snprintf(to, sizeof(to), "%s%s", SHM_DIRECTORY, shared->name) < (int)sizeof(to);
+    if (!fits || rename(from, to) != 0) {
+        dropSegment(shared, base, size);
+        return 0;
+    }
+
+    if (shared->base) {
+        atomicStore64(&segmentHeader(shared->base)->retired, SEGMENT_REPLACED);
+        munmap(shared->base, shared->size);
+    }
+
+    shared->base = base;
+    shared->size = size;
+    shared->block_size = block_size;
+    return 1;
+}
+
+struct shared_calendar* createSharedCalendar(const char* name) {
+
+    struct shared_calendar* shared = (struct shared_calendar*)calloc(1, sizeof(struct shared_calendar));
+    if (!shared) return NULL;
+
+    size_t length = strlen(name);
+    shared->name = (char*)malloc(length + 1);
+    shared->next_name = (char*)malloc(length + 6);
+    if (shared->name && shared->next_name) {
+        memcpy(shared->name, name, length + 1);
+        memcpy(shared->next_name, name, length);
+        memcpy(shared->next_name + length, ".next", 6);
+    }
+    size_t size;
+    char* base = shared->name && shared->next_name ? createSegment(shared, SHARED_MIN_BLOCK, &size) : NULL;
+    if (!base || !installSegment(shared, base, size, SHARED_MIN_BLOCK)) {
+        free(shared->name);
+        free(shared->next_name);
+        free(shared);
+        return NULL;
+    }
+    return shared;
+}
+
+void destroySharedCalendar(struct shared_calendar* shared) {
+    if (!shared) return;
+    atomicStore64(&segmentHeader(shared->base)->retired, SEGMENT_REMOVED);
+    munmap(shared->base, shared->size);
+    shm_unlink(shared->name);
+    free(shared->name);
+    free(shared->next_name);
+    free(shared);
+}
+
+int publishSharedCalendar(struct shared_calendar* shared, struct years* calendar_head) {
+
+    struct block_header plan;
+    memset(&plan, 0, sizeof(plan));
+    unsigned long long needed = planBlock(calendar_head, &plan);
+    if (needed > 0xffffffffULL) return 0;
+
+    // A bigger segment is filled completely before it's installed, so readers
+    // only ever move over to this publish (never to an empty calendar, never
+    // to a lower version). Otherwise write the block readers aren't on.
+    char* base = shared->base;
+    size_t size = shared->size;
+    unsigned long long block_size = shared->block_size;
+    unsigned long long target;
+    int grow = needed > shared->block_size;
+    if (grow) {
+        block_size = alignUp(needed + needed / 2);
+        base = createSegment(shared, block_size, &size);
+        if (!base) return 0;
+        target = 0;
+    }
+    else {
+        target = 1 - atomicLoad64(&segmentHeader(base)->active);
+    }
+
+    char* block = blockStart(base, block_size, target);
+    struct block_header* header = (struct block_header*)block;
+    unsigned long long sequence = header->sequence;
+
+    plan.published = shared->published + 1;
+    atomicStore64(&header->sequence, sequence + 1);
+    atomicFence();
+    writeBlock(block, &plan, calendar_head);
+    atomicFence();
+    atomicStore64(&header->sequence, sequence + 2);
+
+    shared->published++;
+    atomicStore64(&segmentHeader(base)->active, target);
+    atomicStore64(&segmentHeader(base)->published, shared->published);
+
+    // the old segment stays published if the new one can't take its place
+    if (grow && !installSegment(shared, base, size, block_size)) {
+        shared->published--;
+        return 0;
+    }
+    return 1;
+}
+
+// =====================
+// READERS
+// =====================
+
+struct shared_calendar_view {
+    char* name;
+    const char* base;
+    size_t size;
+};
+
+// one lookup's hold on a block: everything is read through here, range-checked
+struct block_reader {
+    const char* block;
+    unsigned long long block_size;
+    unsigned long long sequence;
+    struct block_header header;             // copied: it could change under us
+};
+
+static void unmapView(struct shared_calendar_view* view) {
+    if (view->base) munmap((void*)view->base, view->size);
+    view->base = NULL;
+    view->size = 0;
+}
+
+static int mapView(struct shared_calendar_view* view) {
+
+    int fd = shm_open(view->name, O_RDONLY, 0);
+    if (fd < 0) return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(struct segment_header)) {
+        close(fd);
+        return 0;
+    }
+
+    size_t size = (size_t)info.st_size;
+    const char* base = (const char*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+
+    // a segment without its magic is still being filled in
+    const struct segment_header* header = segmentHeader(base);
+    if (header->magic != SHARED_MAGIC || header->layout != SHARED_LAYOUT
+        || header->block_size < sizeof(struct block_header)
+        || sizeof(struct segment_header) + 2 * header->block_size > size) {
+        munmap((void*)base, size);
+        return 0;
+    }
+    // pairs with installSegment: everything written before the magic shows from here on
+    atomicFence();
+
+    view->base = base;
+    view->size = size;
+    return 1;
+}
+
+struct shared_calendar_view* openSharedCalendar(const char* name) {
+
+    struct shared_calendar_view* view = (struct shared_calendar_view*)calloc(1, sizeof(struct shared_calendar_view));
+    if (!view) return NULL;
+
+    size_t length = strlen(name);
+    view->name = (char*)malloc(length + 1);
+    if (view->name) memcpy(view->name, name, length + 1);
+    if (!view->name || !mapView(view)) {
+        free(view->name);
+        free(view);
+        return NULL;
+    }
+    return view;
+}
+
+void closeSharedCalendar(struct shared_calendar_view* view) {
+    if (!view) return;
+    unmapView(view);
+    free(view->name);
+    free(view);
+}
+
+// picks the block to read (after moving to a new segment if this one is retired);
+// 0 if there's no segment to read
+static int beginRead(struct shared_calendar_view* view, struct block_reader* reader) {
+
+    if (view->base) {
+        unsigned long long retired = atomicLoad64(&segmentHeader(view->base)->retired);
+        if (retired == SEGMENT_REMOVED) unmapView(view);
+        else if (retired == SEGMENT_REPLACED) {
+            // the old segment still holds the last publish before the move, so
+            // it's read once more if the new one can't be mapped just now (the
+            // writer may already be filling in the next one)
+            struct shared_calendar_view next = *view;
+            next.base = NULL;
+            if (mapView(&next)) {
+                unmapView(view);
+                *view = next;
+            }
+        }
+    }
+    if (!view->base && !mapView(view)) return 0;
+
+    struct segment_header* header = segmentHeader(view->base);
+    for (int round = 0; ; round++) {
+        unsigned long long active = atomicLoad64(&header->active) & 1;
+        reader->block = blockStart(view->base, header->block_size, active);
+        reader->block_size = header->block_size;
+
+        struct block_header* block = (struct block_header*)reader->block;
+        reader->sequence = atomicLoad64(&block->sequence);
+        if ((reader->sequence & 1) == 0) break;
+        // only when two publishes overlapped this one; the writer is nearly done
+        if (round > 16) threadYield();
+    }
+
+    atomicFence();
+    memcpy(&reader->header, reader->block, sizeof(struct block_header));
+    return 1;
+}
+
+// 1 if nothing was written to the block since beginRead (what was read holds)
+static int endRead(struct block_reader* reader) {
+    atomicFence();
+    return atomicLoad64(&((struct block_header*)reader->block)->sequence) == reader->sequence;
+}
+
+// the bytes [offset, offset + length) of the block, or NULL if they aren't in it
+static const void* blockAt(const struct block_reader* reader, unsigned long long offset, unsigned long long length) {
+    if (offset > reader->block_size || length > reader->block_size - offset) return NULL;
+    return reader->block + offset;
+}
+
+static const struct flat_month* findMonth(const struct block_reader* reader, int year, int month) {
+
+    if (month < 1 || month > 12) return NULL;
+
+    unsigned int count = reader->header.year_count;
+    const struct flat_year* years = (const struct flat_year*)blockAt(reader, reader->header.years_at,
+        (unsigned long long)count * sizeof(struct flat_year));
+    if (!years) return NULL;
+
+    unsigned int low = 0, high = count;
+    while (low < high) {
+        unsigned int mid = low + (high - low) / 2;
+        if (years[mid].year_number < year) low = mid + 1;
+        else high = mid;
+    }
+    if (low == count || years[low].year_number != year) return NULL;
+
+    return (const struct flat_month*)blockAt(reader,
+        reader->header.months_at + ((unsigned long long)low * 12 + (month - 1)) * sizeof(struct flat_month),
+        sizeof(struct flat_month));
+}
+
+static const struct flat_day* findDay(const struct block_reader* reader, int year, int month, int day) {
+
+    const struct flat_month* month_entry = findMonth(reader, year, month);
+    if (!month_entry) return NULL;
+
+    unsigned int num_days = month_entry->num_days, first_day = month_entry->first_day;
+    if (day < 1 || (unsigned int)day > num_days) return NULL;
+
+    return (const struct flat_day*)blockAt(reader,
+        reader->header.days_at + ((unsigned long long)first_day + (day - 1)) * sizeof(struct flat_day),
+        sizeof(struct flat_day));
+}
+
+// a day's run of tasks, or NULL (and *count = 0)
+static const struct flat_task* dayTasks(const struct block_reader* reader, const struct flat_day* day_entry, unsigned int* count) {
+
+    unsigned int first = day_entry->first_task, length = day_entry->task_count;
+    const struct flat_task* tasks = (const struct flat_task*)blockAt(reader,
+        reader->header.tasks_at + (unsigned long long)first * sizeof(struct flat_task),
+        (unsigned long long)length * sizeof(struct flat_task));
+
+    *count = tasks ? length : 0;
+    return tasks;
+}
+
+static void copyTask(const struct block_reader* reader, const struct flat_task* task,
+    int year, int month, int day, struct shared_task* out) {
+
+    unsigned int text_at = task->text_at, length = task->length;
+    if (length > DESC_LEN - 1) length = DESC_LEN - 1;
+
+    const char* text = (const char*)blockAt(reader, text_at, length);
+    if (!text) length = 0;
+    else memcpy(out->description, text, length);
+    out->description[length] = '\0';
+
+    out->year = year;
+    out->month = month;
+    out->day = day;
+    out->task_id = task->task_id;
+}
+
+long long sharedCalendarVersion(struct shared_calendar_view* view) {
+    struct block_reader reader;
+    unsigned long long published;
+    do {
+        if (!beginRead(view, &reader)) return -1;
+        published = reader.header.published;
+    } while (!endRead(&reader));
+    return (long long)published;
+}
+
+int sharedCountTasks(struct shared_calendar_view* view, int year, int month, int day) {
+
+    struct block_reader reader;
+    int count;
+    do {
+        if (!beginRead(view, &reader)) return -1;
+        const struct flat_day* day_entry = findDay(&reader, year, month, day);
+        count = day_entry ? (int)day_entry->task_count : 0;
+    } while (!endRead(&reader));
+    return count;
+}
+
+int sharedMonthSummary(struct shared_calendar_view* view, int year, int month,
+    int* task_count, unsigned int* occupied_days) {
+
+    struct block_reader reader;
+    int found;
+    do {
+        if (!beginRead(view, &reader)) return -1;
+        const struct flat_month* month_entry = findMonth(&reader, year, month);
+        found = month_entry != NULL;
+        if (task_count) *task_count = found ? (int)month_entry->task_count : 0;
+        if (occupied_days) *occupied_days = found ? month_entry->occupied_days : 0;
+    } while (!endRead(&reader));
+    return found;
+}
+
+int sharedDayTasks(struct shared_calendar_view* view, int year, int month, int day,
+    struct shared_task* tasks, int max) {
+
+    struct block_reader reader;
+    unsigned int count;
+    do {
+        if (!beginRead(view, &reader)) return -1;
+        count = 0;
+        const struct flat_day* day_entry = findDay(&reader, year, month, day);
+        if (!day_entry) continue;
+
+        const struct flat_task* run = dayTasks(&reader, day_entry, &count);
+        for (unsigned int i = 0; i < count && (int)i < max; i++) {
+            copyTask(&reader, &run[i], year, month, day, &tasks[i]);
+        }
+    } while (!endRead(&reader));
+    return (int)count;
+}
+
+int sharedSearchTasks(struct shared_calendar_view* view, const char* keyword,
+    struct shared_task* tasks, int max) {
+
+    if (!keyword || keyword[0] == '\0' || max <= 0) return 0;
+
+    struct block_reader reader;
+    int found;
+    do {
+        if (!beginRead(view, &reader)) return -1;
+        found = 0;
+
+        unsigned int year_count = reader.header.year_count;
+        const struct flat_year* years = (const struct flat_year*)blockAt(&reader, reader.header.years_at,
+            (unsigned long long)year_count * sizeof(struct flat_year));
+        if (!years) continue;
+
+        for (unsigned int y = 0; y < year_count && found < max; y++) {
+            if (years[y].task_count == 0) continue;
+            int year = years[y].year_number;
+
+            for (int m = 1; m <= 12 && found < max; m++) {
+                const struct flat_month* month_entry = findMonth(&reader, year, m);
+                if (!month_entry || month_entry->task_count == 0) continue;
+
+                for (int d = 1; d <= 31 && found < max; d++) {
+                    if (!(month_entry->occupied_days & (1u << (d - 1)))) continue;
+                    const struct flat_day* day_entry = findDay(&reader, year, m, d);
+                    if (!day_entry) continue;
+
+                    unsigned int count;
+                    const struct flat_task* run = dayTasks(&reader, day_entry, &count);
+                    for (unsigned int i = 0; i < count && found < max; i++) {
+                        // copied first: the text is only trusted once it's ours
+                        copyTask(&reader, &run[i], year, m, d, &tasks[found]);
+                        if (containsIgnoreCase(tasks[found].description, keyword)) found++;
+                    }
+                }
+            }
+        }
+    } while (!endRead(&reader));
+    return found;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef SHARED_CALENDAR_H
+#define SHARED_CALENDAR_H
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // The calendar published in a POSIX shared memory segment, so read-only
+    // viewers in other processes (a status bar, a dashboard) can look things up
+    // without each one loading and parsing tasks.txt.
+    //
+    // The writer flattens the calendar into one block with no pointers in it,
+    // only offsets from the start of the block: the years in order, 12 months per
+    // year (task count + occupied_days, like struct months), one entry per day
+    // pointing at that day's run of tasks, and the descriptions. A reader maps the
+    // segment read-only and walks those arrays directly.
+    //
+    // The segment holds two such blocks. Each publish writes the one readers aren't
+    // being pointed at, then switches them over, so a reader is only disturbed when
+    // two publishes land during one lookup. Each block has a sequence number
+    // (seqlock): odd while it's being written, bumped again when it's done. A
+    // reader notes it before a lookup, copies out what it needs, and starts over
+    // if the number has changed since; every offset it follows is range-checked,
+    // so a block being rewritten under it can't send it outside the segment.
+    //
+    // When the calendar outgrows the blocks, the writer replaces the segment with a
+    // bigger one: it's built and filled with the new publish under "<name>.next",
+    // renamed over the old one, and only then is the old one marked retired.
+    // Readers notice on their next lookup and map the new one (or read the old
+    // one's last version once more if they can't yet), so a reader never sees an
+    // empty calendar or an older version. If the new segment can't be made, the
+    // publish fails and the old one stays as it was, name and all.
+    //
+    // Linux only (shm_open); elsewhere the create / open functions return NULL.
+    struct shared_calendar;         // the writer's side
+    struct shared_calendar_view;    // a reader's mapping
+
+    // one task copied out of the segment
+    struct shared_task {
+        int year;
+        int month;
+        int day;
+        int task_id;
+        char description[DESC_LEN];
+    };
+
+    // name is a shm name like "/calendar"; any old segment with that name is
+    // replaced. NULL if the segment can't be created.
+    struct shared_calendar* createSharedCalendar(const char* name);
+    // unmaps and removes the segment (open views keep what they have mapped)
+    void destroySharedCalendar(struct shared_calendar* shared);
+    // copies the calendar into the segment; the caller keeps it from changing
+    // meanwhile (calendarPublishShared does that for a context). 1 on success.
+    int publishSharedCalendar(struct shared_calendar* shared, struct years* calendar_head);
+
+    // NULL if there's no such segment (yet)
+    struct shared_calendar_view* openSharedCalendar(const char* name);
+    void closeSharedCalendar(struct shared_calendar_view* view);
+
+    // Lookups; each one sees a single published version. All return -1 when the
+    // segment is gone and no new one could be mapped.
+
+    // how many times the writer has published (changes when the calendar does)
+    long long sharedCalendarVersion(struct shared_calendar_view* view);
+    // tasks on one day (0 if the date isn't in the calendar)
+    int sharedCountTasks(struct shared_calendar_view* view, int year, int month, int day);
+    // task count and occupied_days bits of a month; 0 if the year isn't in the calendar, 1 if it is
+    int sharedMonthSummary(struct shared_calendar_view* view, int year, int month,
+        int* task_count, unsigned int* occupied_days);
+    // copies up to max of the day's tasks (in id order); returns how many the day has
+    int sharedDayTasks(struct shared_calendar_view* view, int year, int month, int day,
+        struct shared_task* tasks, int max);
+    // case-insensitive keyword search in date order, like searchTasksInto;
+    // returns how many were copied (at most max)
+    int sharedSearchTasks(struct shared_calendar_view* view, const char* keyword,
+        struct shared_task* tasks, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
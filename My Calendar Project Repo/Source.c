@@ -2,42 +2,33 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Calendar.h"
+#include "CalendarInternal.h"
+#include "EventRing.h"
+#include "Platform.h"
+#include "Query.h"
+#include "Render.h"
+#include "RenderCache.h"
+
+// bumped on every change to any calendar (adds, updates, deletes, new years, frees)
+// so caches can tell whether what they remember is still current
+// (atomic, since calendar contexts mutate from several threads)
+static volatile unsigned long long g_calendarGeneration = 0;
+
+// stamps a year as changed "now" and returns the new generation
+unsigned long long markYearChanged(struct years* year_node) {
+    year_node->generation = atomicIncrement64(&g_calendarGeneration);
+    return year_node->generation;
+}
 
-#define DESC_LEN 256
-
-// when 1, addTask won't print "Task added..." (we turn this on during file load)
-static int g_silentAdd = 0;
-
-struct years;
-struct months;
-struct days;
-struct tasks;
-
-struct years {
-    int year_number;
-    struct months* months;   // array of 12 months
-    struct years* next;      // linked list of years
-};
-
-struct months {
-    int month_number;
-    const char* month_name;
-    struct days* days;       // array of days in this month
-    int num_days;
-};
-
-struct days {
-    int day_number;
-    const char* day_name;
-    struct tasks* tasks_head; // doubly linked list of tasks for this day
-};
-
-struct tasks {
-    int task_id;
-    char* task_description;
-    struct tasks* next;
-    struct tasks* prev;
-};
+unsigned long long calendarGeneration(void) {
+    return atomicLoad64(&g_calendarGeneration);
+}
 
 // =====================
 // DATE HELPERS
@@ -48,9 +39,18 @@ int dayOfWeek(int year, int month, int day) {
     // offset values for each month (this is a standard trick to compute weekday fast)
     static int month_offsets[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
 
+    // the calendar repeats every 400 years, so only the year's place in its
+    // cycle matters; reducing first keeps every step below in range, even
+    // for INT_MIN / INT_MAX
+    year %= 400;
+
     // Jan/Feb behave like months 13/14 of the previous year in this formula
     if (month < 3) year -= 1;
 
+    // the divisions below truncate toward zero, which is only right for
+    // positive years
+    if (year < 0) year += 400;
+
     int day_of_week = (year + year / 4 - year / 100 + year / 400
         + month_offsets[month - 1] + day) % 7;
 
@@ -91,28 +91,121 @@ int daysInMonth(int year, int month) {
 // YEAR / MONTH / DAY CREATION
 // =====================
 
+// static arrays so we don't recreate strings every call
+static const char* monthNames[] = {
+    "", "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December"
+};
+static const char* dayNames[] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+
+// The 14 year skeletons, [leap * 7 + weekday of Jan 1], built by the first
+// caller of yearSkeleton (0 = not built, 1 = being built, 2 = ready)
+static struct year_skeleton g_skeletons[14];
+static volatile long g_skeletons_state = 0;
+
+static void buildSkeletons(void) {
+    for (int i = 0; i < 14; i++) {
+        struct year_skeleton* skeleton = &g_skeletons[i];
+        skeleton->leap = i / 7;
+        skeleton->first_weekday = i % 7;
+
+        int days_before = 0;
+        for (int m = 0; m < 12; m++) {
+            struct month_skeleton* month = &skeleton->months[m];
+            month->month_name = monthNames[m + 1];
+            month->num_days = daysInMonth(skeleton->leap ? 2000 : 2001, m + 1);
+            month->first_weekday = (skeleton->first_weekday + days_before) % 7;
+            month->days_before = days_before;
+            days_before += month->num_days;
+        }
+    }
+}
+
+const struct year_skeleton* yearSkeleton(int year) {
+
+    long state = atomicLoadLong(&g_skeletons_state);
+    if (state != 2) {
+        if (state == 0 && atomicCompareSwapLong(&g_skeletons_state, 0, 1)) {
+            buildSkeletons();
+            atomicStoreLong(&g_skeletons_state, 2);
+        }
+        // someone else is building them
+        while (atomicLoadLong(&g_skeletons_state) != 2) threadYield();
+    }
+
+    return &g_skeletons[isLeap(year) * 7 + dayOfWeek(year, 1, 1)];
+}
+
+const char* dayName(int year, int month, int day) {
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) return "";
+    return dayNames[(yearSkeleton(year)->months[month - 1].first_weekday + day - 1) % 7];
+}
+
+// every month's days until its first task: all empty, and const so nothing
+// can write to it by mistake (monthDaysForWrite gives the month its own)
+static const struct days g_no_days[31];
+
+static struct days* noDays(void) {
+    return (struct days*)g_no_days;
+}
+
+struct days* monthDaysForWrite(struct years* year_node, struct months* month_node) {
+
+    if (monthHasOwnDays(month_node)) return month_node->days;
+
+    struct days* days = (struct days*)calendarAlloc(MEM_DAY_ARRAYS, year_node->year_number,
+        month_node->num_days * sizeof(struct days), 0);
+    if (!days) return NULL;
+    memset(days, 0, month_node->num_days * sizeof(struct days));
+
+    // readers still on the shared array just see an empty month
+    atomicPublishPointer((void* volatile*)&month_node->days, days);
+    return days;
+}
+
+const struct days* monthDays(const struct months* month_node) {
+    return (const struct days*)atomicReadPointer((void* volatile*)&month_node->days);
+}
+
+int monthHasOwnDays(const struct months* month_node) {
+    return month_node->days != noDays();
+}
+
+void freeMonthDays(struct months* month_node) {
+    if (monthHasOwnDays(month_node)) calendarFree(month_node->days);
+    month_node->days = noDays();
+}
+
+// finds a loaded year without creating it
+// the list is sorted, so we can stop as soon as we pass the year we want
+struct years* findYear(struct years* calendar_head, int year_number) {
+
+    struct years* current_year = calendar_head;
+    while (current_year != NULL && current_year->year_number < year_number) {
+        current_year = current_year->next;
+    }
+
+    if (current_year && current_year->year_number == year_number) return current_year;
+    return NULL;
+}
+
 // finds a year in the list, or creates it if missing
 //Main Contributor: Damian Wilson
 struct years* findOrAddYear(struct years** calendar_head, int year_number) {
 
-    // static arrays so we don't recreate strings every call
-    static const char* monthNames[] = {
-        "", "January", "February", "March", "April", "May", "June",
-        "July", "August", "September", "October", "November", "December"
-    };
-    static const char* dayNames[] = {
-        "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
-    };
-
-    // search existing years first
-    struct years* current_year = *calendar_head;
-    while (current_year != NULL) {
-        if (current_year->year_number == year_number) return current_year;
-        current_year = current_year->next;
+    // search existing years first (sorted, so stop at the first later year;
+    // that's also where a new year has to be linked in)
+    struct years** link = calendar_head;
+    while (*link != NULL && (*link)->year_number < year_number) {
+        link = &(*link)->next;
     }
+    if (*link != NULL && (*link)->year_number == year_number) return *link;
 
     // not found -> create a new year node
-    struct years* new_year = (struct years*)malloc(sizeof(struct years));
+    TRACE_BEGIN(span);
+    struct years* new_year = (struct years*)calendarAlloc(MEM_YEAR_NODES, year_number, sizeof(struct years), 0);
     if (!new_year) {
         printf("Memory allocation failed for year.\n");
         return NULL;
@@ -120,50 +213,34 @@ struct years* findOrAddYear(struct years** calendar_head, int year_number) {
 
     new_year->year_number = year_number;
     new_year->next = NULL;
+    new_year->task_count = 0;
+    markYearChanged(new_year);
 
     // allocate 12 months for this year
-    new_year->months = (struct months*)malloc(12 * sizeof(struct months));
+    new_year->months = (struct months*)calendarAlloc(MEM_MONTH_ARRAYS, year_number, 12 * sizeof(struct months), 0);
     if (!new_year->months) {
         printf("Memory allocation failed for months.\n");
-        free(new_year);
+        calendarFree(new_year);
         return NULL;
     }
 
-    // set up months + allocate days arrays
+    // names and lengths come from the shared skeleton; days are only
+    // allocated for months that get tasks
+    new_year->skeleton = yearSkeleton(year_number);
     for (int m = 0; m < 12; m++) {
-        int month_num = m + 1;
-
-        new_year->months[m].month_number = month_num;
-        new_year->months[m].month_name = monthNames[month_num];
-        new_year->months[m].num_days = daysInMonth(year_number, month_num);
-
-        // allocate the day array for this month (28-31 days)
-        new_year->months[m].days = (struct days*)malloc(new_year->months[m].num_days * sizeof(struct days));
-        if (!new_year->months[m].days) {
-            printf("Memory allocation failed for days in month %d.\n", month_num);
-
-            // cleanup anything we already allocated so we don't leak memory
-            for (int prev_m = 0; prev_m < m; prev_m++) {
-                free(new_year->months[prev_m].days);
-            }
-            free(new_year->months);
-            free(new_year);
-            return NULL;
-        }
-
-        // initialize each day in that month
-        for (int d = 0; d < new_year->months[m].num_days; d++) {
-            int day_num = d + 1;
-            new_year->months[m].days[d].day_number = day_num;
-            new_year->months[m].days[d].day_name = dayNames[dayOfWeek(year_number, month_num, day_num)];
-            new_year->months[m].days[d].tasks_head = NULL; // start with no tasks
-        }
+        new_year->months[m].month_number = m + 1;
+        new_year->months[m].month_name = new_year->skeleton->months[m].month_name;
+        new_year->months[m].num_days = new_year->skeleton->months[m].num_days;
+        new_year->months[m].days = noDays();
+        new_year->months[m].task_count = 0;
+        new_year->months[m].occupied_days = 0;
     }
 
-    // insert new year at the head of the linked list (fast + simple)
-    new_year->next = *calendar_head;
-    *calendar_head = new_year;
+    // link it in where the search stopped so the list stays in year order
+    new_year->next = *link;
+    atomicPublishPointer((void* volatile*)link, new_year);
 
+    TRACE_END(span, "build year skeleton", "calendar", "year", year_number);
     return new_year;
 }
 
@@ -171,53 +248,92 @@ struct years* findOrAddYear(struct years** calendar_head, int year_number) {
 // TASK OPERATIONS
 // =====================
 
-// adds a task to the chosen date (year/month/day)
+// task links are published / read atomically so calendar contexts with lock-free
+// readers (CALENDAR_LOCK_EPOCH) always see either the old or the new list
+static void publishTask(struct tasks** link, struct tasks* task) {
+    atomicPublishPointer((void* volatile*)link, task);
+}
+
+static struct tasks* readTask(struct tasks** link) {
+    return (struct tasks*)atomicReadPointer((void* volatile*)link);
+}
+
+// one allocation for a task node and its description (the text sits right after
+// the node); a description replaced later by updateTask gets its own allocation
+struct tasks* allocTask(int year, const char* desc) {
+
+    size_t desc_len = strlen(desc) + 1;
+    struct tasks* task = (struct tasks*)calendarAlloc(MEM_TASK_NODES, year, sizeof(struct tasks) + desc_len, desc_len);
+    if (!task) return NULL;
+
+    task->task_id = 0;
+    task->task_description = (char*)(task + 1);
+    strcpy_s(task->task_description, desc_len, desc);
+    task->next = NULL;
+    task->prev = NULL;
+    task->loop = NULL;
+    return task;
+}
+
+static int isInlineDescription(const struct tasks* task, const char* description) {
+    return description == (const char*)(task + 1);
+}
+
+void freeTask(struct tasks* task) {
+    if (!isInlineDescription(task, task->task_description)) {
+        calendarFree(task->task_description);
+    }
+    calendarFree(task);
+}
+
+void freeTaskChain(struct tasks* task) {
+    while (task != NULL) {
+        struct tasks* next = task->next;
+        freeTask(task);
+        task = next;
+    }
+}
+
+// adds a task to a day of an already loaded year
+// errors go to "errors", the "Task added" note to "info" (either can be NULL = quiet)
 //Main Contributor: Farah Laniari
 //Main Editors: Damian Wilson and Sierra Jamieson
-void addTask(struct years** calendar_head, int year, int month, int day, const char* desc) {
-
-    // make sure that year exists (create if needed)
-    struct years* year_node = findOrAddYear(calendar_head, year);
+int insertTask(struct years* year_node, int month, int day, const char* desc, FILE* errors, FILE* info) {
 
     // month validity check
     if (!year_node || month < 1 || month > 12) {
-        printf("Invalid month.\n");
-        return;
+        if (errors) fprintf(errors, "Invalid month.\n");
+        return CALENDAR_INVALID_DATE;
     }
 
     // day validity check (depends on month + leap years)
     struct months* month_node = &year_node->months[month - 1];
     if (day < 1 || day > month_node->num_days) {
-        printf("Invalid day for this month.\n");
-        return;
+        if (errors) fprintf(errors, "Invalid day for this month.\n");
+        return CALENDAR_INVALID_DATE;
     }
 
-    struct days* day_node = &month_node->days[day - 1];
+    struct days* days = monthDaysForWrite(year_node, month_node);
 
-    // allocate a task node
-    struct tasks* new_task = (struct tasks*)malloc(sizeof(struct tasks));
+    // allocate a task node (description included)
+    struct tasks* new_task = days ? allocTask(year_node->year_number, desc) : NULL;
     if (!new_task) {
-        printf("Memory allocation failed for task.\n");
-        return;
-    }
-
-    // allocate description string exactly the size we need
-    size_t desc_len = strlen(desc) + 1;
-    new_task->task_description = (char*)malloc(desc_len);
-    if (!new_task->task_description) {
-        printf("Memory allocation failed for task description.\n");
-        free(new_task);
-        return;
+        if (errors) fprintf(errors, "Memory allocation failed for task.\n");
+        return CALENDAR_NO_MEMORY;
     }
+    struct days* day_node = &days[day - 1];
 
-    strcpy_s(new_task->task_description, desc_len, desc);
-    new_task->next = NULL;
-    new_task->prev = NULL;
+    // keep the occupancy info in sync (used by range queries + month grid)
+    markYearChanged(year_node);
+    year_node->task_count++;
+    month_node->task_count++;
+    month_node->occupied_days |= 1u << (day - 1);
 
     // add to end of the day's linked list, and assign sequential id
+    // (the node is filled in before it's linked, readers may be walking the list)
     if (day_node->tasks_head == NULL) {
-        day_node->tasks_head = new_task;
         new_task->task_id = 1;
+        publishTask(&day_node->tasks_head, new_task);
     }
     else {
         struct tasks* current_task = day_node->tasks_head;
@@ -227,26 +343,43 @@ void addTask(struct years** calendar_head, int year, int month, int day, const c
 
         // next ID is last node's id + 1
         new_task->task_id = current_task->task_id + 1;
-        current_task->next = new_task;
         new_task->prev = current_task;
+        publishTask(&current_task->next, new_task);
     }
 
-    // don't spam output during file load
-    if (!g_silentAdd) {
-        printf("Task added for %d-%02d-%02d.\n", year, month, day);
+    if (info) {
+        fprintf(info, "Task added for %d-%02d-%02d.\n", year_node->year_number, month, day);
     }
+    return CALENDAR_OK;
 }
 
-// helper: find day node safely (used by delete + search UI + menu)
-//Main Contributor: Farah Laniari
-//Main Editor: Damian Wilson
-struct days* getDayNode(struct years* calendar_head, int year, int month, int day) {
+// adds a task to the chosen date (year/month/day)
+void addTask(struct years** calendar_head, int year, int month, int day, const char* desc) {
 
-    // find the year first
-    struct years* year_node = calendar_head;
-    while (year_node != NULL && year_node->year_number != year) {
-        year_node = year_node->next;
+    OP_TIMER_START(timer);
+
+    // make sure that year exists (create if needed)
+    struct years* year_node = findOrAddYear(calendar_head, year);
+    if (insertTask(year_node, month, day, desc, stdout, stdout) == CALENDAR_OK) {
+        emitTaskEvent(TASK_EVENT_ADD, year, month, day, lastTaskId(year_node, month, day));
     }
+
+    OP_TIMER_END(timer, OP_ADD_TASK, desc ? strlen(desc) : 0);
+}
+
+int lastTaskId(struct years* year_node, int month, int day) {
+    struct tasks* tail = year_node->months[month - 1].days[day - 1].tasks_head;
+    while (tail != NULL && tail->next != NULL) tail = tail->next;
+    return tail ? tail->task_id : 0;
+}
+
+// finds the year/month/day nodes for a date without creating anything
+// year_out / month_out are optional
+static struct days* lookupDay(struct years* calendar_head, int year, int month, int day,
+    struct years** year_out, struct months** month_out) {
+
+    // find the year first
+    struct years* year_node = findYear(calendar_head, year);
     if (!year_node) return NULL;
 
     // validate month
@@ -256,9 +389,22 @@ struct days* getDayNode(struct years* calendar_head, int year, int month, int da
     struct months* month_node = &year_node->months[month - 1];
     if (day < 1 || day > month_node->num_days) return NULL;
 
+    // a month that never had a task has no day nodes of its own, only the
+    // shared read-only ones, and those mustn't get out to anyone who may write
+    if (!monthHasOwnDays(month_node)) return NULL;
+
+    if (year_out) *year_out = year_node;
+    if (month_out) *month_out = month_node;
     return &month_node->days[day - 1];
 }
 
+// helper: find day node safely (used by delete + search UI + menu)
+//Main Contributor: Farah Laniari
+//Main Editor: Damian Wilson
+struct days* getDayNode(struct years* calendar_head, int year, int month, int day) {
+    return lookupDay(calendar_head, year, month, day, NULL, NULL);
+}
+
 // prints tasks for a day node with IDs so user can pick one
 //Main Contributor: Sierra Jamieson
 //Main Editor: Damian Wilson and Farah Laniari
@@ -298,20 +444,21 @@ void renumberTasks(struct days* day_node) {
     }
 }
 
-// update a task's description by its task_id
-// returns 0 on success, 1 on error (kept simple for menu logic)
+// replaces a task's description on a day of a loaded year
 //Main Contributor: Damian Wilson
 //Main Editor: Sierra Jamieson
-int updateTask(struct years* calendar_head, int year, int month, int day, int task_id, const char* new_desc) {
-
-    struct days* day_node = getDayNode(calendar_head, year, month, day);
+int editTask(struct years* year_node, int month, int day, int task_id, const char* new_desc,
+    FILE* errors, FILE* info, char** replaced) {
 
     // date invalid or year not loaded
-    if (!day_node) {
-        printf("Invalid date / year not found.\n");
-        return 1;
+    if (!year_node || month < 1 || month > 12 || day < 1 || day > year_node->months[month - 1].num_days) {
+        if (errors) fprintf(errors, "Invalid date / year not found.\n");
+        return CALENDAR_INVALID_DATE;
     }
 
+    struct days* day_node = &year_node->months[month - 1].days[day - 1];
+    int year = year_node->year_number;
+
     // find the task by task_id
     struct tasks* updateDay = day_node->tasks_head;
     while (updateDay != NULL && updateDay->task_id != task_id) {
@@ -320,49 +467,90 @@ int updateTask(struct years* calendar_head, int year, int month, int day, int ta
 
     // invalid task id
     if (!updateDay) {
-        printf("Task %d not found on %d-%d-%d.\n", task_id, year, month, day);
-        return 1;
+        if (errors) fprintf(errors, "Task %d not found on %d-%d-%d.\n", task_id, year, month, day);
+        return CALENDAR_NOT_FOUND;
     }
 
-    // free the old description and replace it
-    free(updateDay->task_description);
-
+    // build the new description first, so the task never points at a half-written
+    // string (and keeps the old one if malloc fails)
     size_t desc_len = strlen(new_desc) + 1;
-    updateDay->task_description = (char*)malloc(desc_len);
-    if (!updateDay->task_description) {
-
-        // if malloc fails, we don't want a dangling pointer
-        printf("Memory allocation failed for new task description.\n");
-        updateDay->task_description = (char*)malloc(1);
-        if (updateDay->task_description) {
-            updateDay->task_description[0] = '\0';
-        }
-        return 1;
+    char* description = (char*)calendarAlloc(MEM_DESCRIPTIONS, year_node->year_number, desc_len, 0);
+    if (!description) {
+        if (errors) fprintf(errors, "Memory allocation failed for new task description.\n");
+        return CALENDAR_NO_MEMORY;
     }
+    strcpy_s(description, desc_len, new_desc);
 
-    strcpy_s(updateDay->task_description, desc_len, new_desc);
+    // swap it in, then free the old one (or hand it back to be freed later)
+    char* old_description = updateDay->task_description;
+    atomicPublishPointer((void* volatile*)&updateDay->task_description, description);
+    markYearChanged(year_node);
 
-    printf("Updated task %d on %d-%d-%d.\n", task_id, year, month, day);
-    return 0;
+    // the original text lives inside the node and goes away with it
+    if (isInlineDescription(updateDay, old_description)) old_description = NULL;
+
+    if (replaced) *replaced = old_description;
+    else calendarFree(old_description);
+
+    if (info) fprintf(info, "Updated task %d on %d-%d-%d.\n", task_id, year, month, day);
+    return CALENDAR_OK;
 }
 
-// delete a task by task_id from a specific date
+// update a task's description by its task_id
+// returns 0 on success, 1 on error (kept simple for menu logic)
+int updateTask(struct years* calendar_head, int year, int month, int day, int task_id, const char* new_desc) {
+    OP_TIMER_START(timer);
+
+    struct years* year_node = findYear(calendar_head, year);
+    int status = editTask(year_node, month, day, task_id, new_desc, stdout, stdout, NULL);
+    if (status == CALENDAR_OK) emitTaskEvent(TASK_EVENT_UPDATE, year, month, day, task_id);
+
+    OP_TIMER_END(timer, OP_UPDATE_TASK, new_desc ? strlen(new_desc) : 0);
+    return status == CALENDAR_OK ? 0 : 1;
+}
+
+// copies of the tasks from first on, numbered from id, linked after prev; NULL if
+// memory runs out (nothing is left allocated then)
+static struct tasks* copyRenumbered(int year, struct tasks* first, struct tasks* prev, int id) {
+
+    struct tasks* copies = NULL;
+    struct tasks* last = NULL;
+
+    for (struct tasks* task = first; task != NULL; task = task->next) {
+        struct tasks* copy = allocTask(year, task->task_description);
+        if (!copy) {
+            freeTaskChain(copies);
+            return NULL;
+        }
+        copy->task_id = id++;
+        copy->prev = last ? last : prev;
+        if (last) last->next = copy;
+        else copies = copy;
+        last = copy;
+    }
+    return copies;
+}
+
+// removes a task from a day of a loaded year, then renumbers that day
 //Main Contributor: Farah Laniari
 //Main Editor: Damian Wilson
-int deleteTask(struct years* calendar_head, int year, int month, int day, int task_id) {
-
-    struct days* day_node = getDayNode(calendar_head, year, month, day);
+int removeTask(struct years* year_node, int month, int day, int task_id,
+    FILE* errors, FILE* info, struct tasks** removed) {
 
     // date invalid or year not loaded
-    if (!day_node) {
-        printf("Invalid date / year not found.\n");
-        return 0;
+    if (!year_node || month < 1 || month > 12 || day < 1 || day > year_node->months[month - 1].num_days) {
+        if (errors) fprintf(errors, "Invalid date / year not found.\n");
+        return CALENDAR_INVALID_DATE;
     }
 
+    struct months* month_node = &year_node->months[month - 1];
+    struct days* day_node = &month_node->days[day - 1];
+    int year = year_node->year_number;
+
     // no tasks to delete
     if (!day_node->tasks_head) {
-        printf("No tasks to delete for %d-%d-%d.\n", year, month, day);
-        return 0;
+        if (errors) fprintf(errors, "No tasks to delete for %d-%d-%d.\n", year, month, day);
+        return CALENDAR_NOT_FOUND;
     }
 
     // find the node with the matching id
@@ -373,313 +561,549 @@ int deleteTask(struct years* calendar_head, int year, int month, int day, int ta
 
     // task id not found
     if (!deleteNode) {
-        printf("Task %d not found on %d-%d-%d.\n", task_id, year, month, day);
-        return 0;
+        if (errors) fprintf(errors, "Task %d not found on %d-%d-%d.\n", task_id, year, month, day);
+        return CALENDAR_NOT_FOUND;
+    }
+
+    // what takes its place: the rest of the list, or (when readers may be walking
+    // it) renumbered copies of the rest, so the one store below unlinks the task and
+    // renumbers the day at once; renumbering in place could show a reader two
+    // tasks with the same id
+    struct tasks* rest = deleteNode->next;
+    if (removed && rest) {
+        rest = copyRenumbered(year, deleteNode->next, deleteNode->prev, deleteNode->task_id);
+        if (!rest) {
+            if (errors) fprintf(errors, "Memory allocation failed for task.\n");
+            return CALENDAR_NO_MEMORY;
+        }
     }
 
     // unlink from doubly linked list
+    // (deleteNode->next is left alone so a reader standing on it can still move on)
     if (deleteNode->prev != NULL) {
-        deleteNode->prev->next = deleteNode->next;
+        publishTask(&deleteNode->prev->next, rest);
     }
     else {
         // deleting head
-        day_node->tasks_head = deleteNode->next;
+        publishTask(&day_node->tasks_head, rest);
     }
 
-    if (deleteNode->next != NULL) {
-        deleteNode->next->prev = deleteNode->prev;
+    // free heap memory (or hand it back to be freed later, along with the
+    // old tasks after it that were replaced by copies)
+    if (removed) {
+        *removed = deleteNode;
     }
+    else {
+        if (rest != NULL) rest->prev = deleteNode->prev;
+        freeTask(deleteNode);
 
-    // free heap memory
-    free(deleteNode->task_description);
-    free(deleteNode);
+        // keep IDs clean after deletes (avoids gaps like 1,2,4)
+        renumberTasks(day_node);
+    }
 
-    // keep IDs clean after deletes (avoids gaps like 1,2,4)
-    renumberTasks(day_node);
+    markYearChanged(year_node);
+    year_node->task_count--;
+    month_node->task_count--;
+    if (!day_node->tasks_head) {
+        month_node->occupied_days &= ~(1u << (day - 1));
+    }
 
-    printf("Deleted task %d from %d-%d-%d.\n", task_id, year, month, day);
-    return 1;
+    if (info) fprintf(info, "Deleted task %d from %d-%d-%d.\n", task_id, year, month, day);
+    return CALENDAR_OK;
+}
+
+// delete a task by task_id from a specific date
+// returns 1 if it was deleted, 0 if not
+int deleteTask(struct years* calendar_head, int year, int month, int day, int task_id) {
+    OP_TIMER_START(timer);
+
+    struct years* year_node = findYear(calendar_head, year);
+    int status = removeTask(year_node, month, day, task_id, stdout, stdout, NULL);
+    if (status == CALENDAR_OK) emitTaskEvent(TASK_EVENT_DELETE, year, month, day, task_id);
+
+    OP_TIMER_END(timer, OP_DELETE_TASK, 0);
+    return status == CALENDAR_OK;
 }
 
 // =====================
-// PRINT FUNCTIONS
+// BULK TASK OPS
 // =====================
 
-// prints all tasks for one specific date
-//Main Contributor: Sierra Jamieson
-//Main Editor: Damian Wilson
-void printTasksForDay(struct years* calendar_head, int year, int month, int day) {
+// one batch entry's place once the batch is sorted by date
+// (task_id is only used by deletes; index keeps input order for ties)
+struct batch_order {
+    int year;
+    int month;
+    int day;
+    int task_id;
+    int index;
+};
 
-    // find year
-    struct years* year_node = calendar_head;
-    while (year_node != NULL && year_node->year_number != year) {
-        year_node = year_node->next;
-    }
+static int compareBatchOrder(const void* a, const void* b) {
+    const struct batch_order* x = (const struct batch_order*)a;
+    const struct batch_order* y = (const struct batch_order*)b;
 
-    // validate month
-    if (!year_node || month < 1 || month > 12) {
-        printf("No tasks for %d-%d-%d.\n", year, month, day);
-        return;
-    }
+    if (x->year != y->year) return (x->year > y->year) - (x->year < y->year);
+    if (x->month != y->month) return (x->month > y->month) - (x->month < y->month);
+    if (x->day != y->day) return (x->day > y->day) - (x->day < y->day);
+    if (x->task_id != y->task_id) return (x->task_id > y->task_id) - (x->task_id < y->task_id);
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+static int sameBatchDate(const struct batch_order* a, const struct batch_order* b) {
+    return a->year == b->year && a->month == b->month && a->day == b->day;
+}
+
+static int isValidDate(int year, int month, int day) {
+    return month >= 1 && month <= 12 && day >= 1 && day <= daysInMonth(year, month);
+}
+
+static void setBatchStatus(int* statuses, const struct batch_order* group, int group_size, int status) {
+    if (!statuses) return;
+    for (int i = 0; i < group_size; i++) statuses[group[i].index] = status;
+}
+
+// appends one day's worth of new tasks: the tail is found once, the new run is
+// built off to the side and linked in with a single store
+static int appendDayGroup(struct years* year_node, int month, int day, const struct task_entry* entries,
+    const struct batch_order* group, int group_size, int* statuses) {
 
-    // validate day
     struct months* month_node = &year_node->months[month - 1];
-    if (day < 1 || day > month_node->num_days) {
-        printf("No tasks for %d-%d-%d.\n", year, month, day);
-        return;
+    struct days* days = monthDaysForWrite(year_node, month_node);
+    if (!days) {
+        setBatchStatus(statuses, group, group_size, CALENDAR_NO_MEMORY);
+        return 0;
     }
+    struct days* day_node = &days[day - 1];
 
-    // access day node and its tasks
-    struct days* day_node = &month_node->days[day - 1];
-    struct tasks* task_node = day_node->tasks_head;
+    struct tasks* tail = day_node->tasks_head;
+    while (tail != NULL && tail->next != NULL) tail = tail->next;
+    int next_id = tail ? tail->task_id + 1 : 1;
 
-    if (task_node == NULL) {
-        printf("No tasks for %d-%d-%d.\n", year, month, day);
-        return;
+    struct tasks* first = NULL;
+    struct tasks* last = NULL;
+    int added = 0;
+
+    for (int i = 0; i < group_size; i++) {
+        int index = group[i].index;
+        const char* desc = entries[index].description ? entries[index].description : "";
+
+        struct tasks* task = allocTask(year_node->year_number, desc);
+        if (!task) {
+            if (statuses) statuses[index] = CALENDAR_NO_MEMORY;
+            continue;
+        }
+
+        task->task_id = next_id++;
+        task->prev = last;
+        if (last) last->next = task;
+        else first = task;
+        last = task;
+
+        if (statuses) statuses[index] = CALENDAR_OK;
+        added++;
+    }
+
+    if (!first) return 0;
+
+    if (tail) {
+        first->prev = tail;
+        publishTask(&tail->next, first);
+    }
+    else {
+        publishTask(&day_node->tasks_head, first);
     }
 
-    printf("Tasks for %s, %s %d, %d:\n",
-        day_node->day_name, month_node->month_name, day, year);
+    markYearChanged(year_node);
+    year_node->task_count += added;
+    month_node->task_count += added;
+    month_node->occupied_days |= 1u << (day - 1);
 
-    while (task_node != NULL) {
-        printf(" %d. %s\n", task_node->task_id, task_node->task_description);
-        task_node = task_node->next;
+    for (struct tasks* task = first; task != NULL; task = task->next) {
+        emitTaskEvent(TASK_EVENT_ADD, year_node->year_number, month, day, task->task_id);
     }
+    return added;
 }
 
-// compact month view: prints only days with tasks, and puts tasks on one line
-//Main Contributor: Sierra Jamieson
-//Main Editor: Farah Laniari
-void printTasksForMonthPretty(struct years* calendar_head, int year, int month) {
+int addTasks(struct years** calendar_head, const struct task_entry* entries, int count, int* statuses) {
 
-    if (month < 1 || month > 12) {
-        printf("Invalid month.\n");
-        return;
+    if (!calendar_head || !entries || count <= 0) return 0;
+
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    struct batch_order* order = (struct batch_order*)malloc(count * sizeof(struct batch_order));
+    if (!order) {
+        for (int i = 0; statuses && i < count; i++) statuses[i] = CALENDAR_NO_MEMORY;
+        return 0;
     }
 
-    // find year node
-    struct years* year_node = calendar_head;
-    while (year_node != NULL && year_node->year_number != year) {
-        year_node = year_node->next;
+    for (int i = 0; i < count; i++) {
+        order[i].year = entries[i].year;
+        order[i].month = entries[i].month;
+        order[i].day = entries[i].day;
+        order[i].task_id = 0;
+        order[i].index = i;
     }
+    qsort(order, count, sizeof(struct batch_order), compareBatchOrder);
 
-    // checks if there are tasks in this year
-    if (!year_node) {
-        printf("No data for year %d.\n", year);
-        return;
+    int added = 0;
+    struct years* year_node = NULL;
+
+    for (int start = 0; start < count; ) {
+
+        // one group = every entry for the same date
+        int end = start + 1;
+        while (end < count && sameBatchDate(&order[end], &order[start])) end++;
+
+        int year = order[start].year, month = order[start].month, day = order[start].day;
+
+        // the date is checked once per group, and bad dates don't create years
+        if (!isValidDate(year, month, day)) {
+            setBatchStatus(statuses, &order[start], end - start, CALENDAR_INVALID_DATE);
+        }
+        else {
+            // sorted, so the year only has to be looked up when it changes
+            if (!year_node || year_node->year_number != year) {
+                year_node = findOrAddYear(calendar_head, year);
+            }
+
+            if (!year_node) setBatchStatus(statuses, &order[start], end - start, CALENDAR_NO_MEMORY);
+            else added += appendDayGroup(year_node, month, day, entries, &order[start], end - start, statuses);
+        }
+
+        start = end;
     }
 
+    free(order);
+#ifndef CALENDAR_NO_STATS
+    unsigned long long bytes = 0;
+    for (int i = 0; i < count; i++) bytes += entries[i].description ? strlen(entries[i].description) : 0;
+#endif
+    OP_TIMER_END(timer, OP_ADD_TASKS, bytes);
+    TRACE_END(span, "addTasks", "insert", "tasks", added);
+    return added;
+}
+
+// removes one day's worth of ids in a single walk of the list (the list and the
+// group are both in id order), then renumbers once
+static int removeDayGroup(struct years* year_node, int month, int day,
+    const struct batch_order* group, int group_size, int* statuses) {
+
     struct months* month_node = &year_node->months[month - 1];
+    struct days* day_node = &month_node->days[day - 1];
 
-    printf("\n=== %s %d ===\n", month_node->month_name, year);
-    // flag to track if any tasks were found
-    int found_any = 0;
+    setBatchStatus(statuses, group, group_size, CALENDAR_NOT_FOUND);
 
-    for (int d = 0; d < month_node->num_days; d++) {
+    int removed = 0;
+    int at = 0;
+    struct tasks* task = day_node->tasks_head;
 
-        struct days* day_node = &month_node->days[d];
-        struct tasks* t = day_node->tasks_head;
+    while (task != NULL && at < group_size) {
+        struct tasks* next = task->next;
 
-        if (t != NULL) {
-            found_any = 1;
+        // ids below this task's aren't on the list (they stay NOT_FOUND)
+        while (at < group_size && group[at].task_id < task->task_id) at++;
 
-            printf("%d (%s): ", day_node->day_number, day_node->day_name);
+        if (at < group_size && group[at].task_id == task->task_id) {
+            if (task->prev) publishTask(&task->prev->next, next);
+            else publishTask(&day_node->tasks_head, next);
+            if (next) next->prev = task->prev;
 
-            // print all tasks comma-separated
-            while (t != NULL) {
-                printf("%s", t->task_description);
-                if (t->next != NULL) {
-                    printf(", ");
-                }
-                t = t->next;
-            }
+            freeTask(task);
+            if (statuses) statuses[group[at].index] = CALENDAR_OK;
 
-            printf("\n");
+            // the id it has once the earlier deletes are applied one by one
+            emitTaskEvent(TASK_EVENT_DELETE, year_node->year_number, month, day, group[at].task_id - removed);
+            removed++;
+
+            // the same id twice only deletes once (the repeats stay NOT_FOUND)
+            int deleted_id = group[at].task_id;
+            while (at < group_size && group[at].task_id == deleted_id) at++;
         }
-    }
 
-    if (!found_any) {
-        printf("No tasks stored for %s %d.\n", month_node->month_name, year);
+        task = next;
     }
 
-    printf("\n");
+    if (removed > 0) {
+        markYearChanged(year_node);
+        year_node->task_count -= removed;
+        month_node->task_count -= removed;
+        if (!day_node->tasks_head) month_node->occupied_days &= ~(1u << (day - 1));
+        renumberTasks(day_node);
+    }
+    return removed;
 }
 
-// compact year view: groups by month, prints only days that have tasks
-//Main Contributor: Sierra Jamieson
-//Main Editor: Farah Laniari
-void printTasksForYearPretty(struct years* calendar_head, int year) {
+int deleteTasks(struct years* calendar_head, const struct task_ref* refs, int count, int* statuses) {
+
+    if (!refs || count <= 0) return 0;
+
+    OP_TIMER_START(timer);
 
-    // find year node
-    struct years* year_node = calendar_head;
-    while (year_node != NULL && year_node->year_number != year) {
-        year_node = year_node->next;
+    struct batch_order* order = (struct batch_order*)malloc(count * sizeof(struct batch_order));
+    if (!order) {
+        for (int i = 0; statuses && i < count; i++) statuses[i] = CALENDAR_NO_MEMORY;
+        return 0;
     }
 
-    // checks if there are tasks in this year
-    if (!year_node) {
-        // notify user if no tasks were found 
-        printf("No data for year %d.\n", year);
-        return;
+    for (int i = 0; i < count; i++) {
+        order[i].year = refs[i].year;
+        order[i].month = refs[i].month;
+        order[i].day = refs[i].day;
+        order[i].task_id = refs[i].task_id;
+        order[i].index = i;
     }
+    qsort(order, count, sizeof(struct batch_order), compareBatchOrder);
 
-    printf("\n=== Tasks for %d ===\n", year);
-    // flag to track if any tasks were found
-    int found_any = 0;
+    int removed = 0;
+    struct years* year_node = NULL;
 
-    for (int m = 0; m < 12; m++) {
+    for (int start = 0; start < count; ) {
 
-        struct months* month_node = &year_node->months[m];
-        int month_printed = 0;
+        int end = start + 1;
+        while (end < count && sameBatchDate(&order[end], &order[start])) end++;
 
-        //cycles through the days in a given month
-        for (int d = 0; d < month_node->num_days; d++) {
+        int year = order[start].year, month = order[start].month, day = order[start].day;
 
-            struct days* day_node = &month_node->days[d];
-            struct tasks* task_node = day_node->tasks_head;
+        if (!year_node || year_node->year_number != year) {
+            year_node = findYear(calendar_head, year);
+        }
 
-            if (task_node != NULL) {
-                found_any = 1;
+        // same as deleteTask: a bad date or a year that isn't loaded
+        if (!year_node || !isValidDate(year, month, day)) {
+            setBatchStatus(statuses, &order[start], end - start, CALENDAR_INVALID_DATE);
+        }
+        else {
+            removed += removeDayGroup(year_node, month, day, &order[start], end - start, statuses);
+        }
 
-                // only print the month header once
-                if (!month_printed) {
-                    printf("\n-- %s --\n", month_node->month_name);
-                    month_printed = 1;
-                }
+        start = end;
+    }
 
-                printf("%d (%s): ", day_node->day_number, day_node->day_name);
+    free(order);
+    OP_TIMER_END(timer, OP_DELETE_TASKS, 0);
+    return removed;
+}
 
-                // loop through all tasks for this day
-                while (task_node != NULL) {
-                    printf("%s", task_node->task_description);
-                    // check if there are more tasks
-                    if (task_node->next != NULL) {
-                        printf(", ");
-                    }
-                    // move to next task
-                    task_node = task_node->next;
+// =====================
+// RANGE QUERIES
+// =====================
+
+// index of the lowest set bit (bits must not be 0)
+static int lowestSetBit(unsigned int bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+// bit mask for days first..last of a month (bit d - 1 = day d)
+static unsigned int dayMask(int first_day, int last_day) {
+    if (first_day > last_day) return 0;
+    unsigned int upto_last = (last_day >= 32) ? 0xffffffffu : ((1u << last_day) - 1u);
+    unsigned int below_first = (1u << (first_day - 1)) - 1u;
+    return upto_last & ~below_first;
+}
+
+// walks every task between two dates in date order
+// cost follows the number of non-empty years/months/days, not the length of the span:
+// empty years and months are skipped by their task counts, and inside a month we
+// only visit the days whose occupancy bit is set
+int forEachTaskInRange(struct years* calendar_head,
+    int from_year, int from_month, int from_day,
+    int to_year, int to_month, int to_day,
+    TaskMatchFn on_task, void* user_data) {
+
+    if (!on_task) return 0;
+
+    // clamp so callers can say "month 0" / "day 99" for open ends
+    if (from_month < 1) { from_month = 1; from_day = 1; }
+    if (from_month > 12) { from_month = 12; from_day = 32; }
+    if (to_month > 12) { to_month = 12; to_day = 31; }
+    if (to_month < 1) { to_month = 1; to_day = 0; }
+    if (from_day < 1) from_day = 1;
+
+    if (from_year > to_year) return 0;
+    if (from_year == to_year && (from_month > to_month || (from_month == to_month && from_day > to_day))) return 0;
+
+    int reported = 0;
+    struct task_match match;
+
+    for (struct years* y = calendar_head; y != NULL && y->year_number <= to_year; y = y->next) {
+
+        if (y->year_number < from_year || y->task_count == 0) continue;
+
+        int first_month = (y->year_number == from_year) ? from_month : 1;
+        int last_month = (y->year_number == to_year) ? to_month : 12;
+
+        for (int m = first_month; m <= last_month; m++) {
+
+            struct months* month_node = &y->months[m - 1];
+            if (month_node->task_count == 0) continue;
+
+            int first_day = (y->year_number == from_year && m == from_month) ? from_day : 1;
+            int last_day = (y->year_number == to_year && m == to_month) ? to_day : month_node->num_days;
+            if (last_day > month_node->num_days) last_day = month_node->num_days;
+
+            unsigned int days_left = month_node->occupied_days & dayMask(first_day, last_day);
+
+            while (days_left != 0) {
+                int d = lowestSetBit(days_left);
+                days_left &= days_left - 1;
+
+                // an occupied day is always in the month's own (writable) array
+                struct days* day_node = (struct days*)&monthDays(month_node)[d];
+
+                for (struct tasks* t = readTask(&day_node->tasks_head); t != NULL; t = readTask(&t->next)) {
+
+                    // one stack struct reused for every task, so no allocation per result
+                    match.year = y->year_number;
+                    match.month = m;
+                    match.day = d + 1;
+                    match.day_node = day_node;
+                    match.task = t;
+
+                    reported++;
+                    if (!on_task(&match, user_data)) return reported;
                 }
-                printf("\n");
             }
         }
     }
 
-    if (!found_any) {
-        // notify user if no tasks were found
-        printf("No tasks stored for %d.\n", year);
+    return reported;
+}
+
+// =====================
+// PRINT FUNCTIONS
+// =====================
+
+// prints one task of a compact month/year view
+int printCompactTask(const struct task_match* match, void* user_data) {
+    struct compact_printer* printer = (struct compact_printer*)user_data;
+
+    if (match->month == printer->last_month && match->day == printer->last_day) {
+        // another task on the same day
+        fprintf(printer->output, ", %s", match->task->task_description);
+        return 1;
     }
 
-    printf("\n");
+    // finish the previous day's line
+    if (printer->last_day != 0) {
+        fprintf(printer->output, "\n");
+    }
+
+    // only print the month header once
+    if (printer->print_month_headers && match->month != printer->last_month) {
+        fprintf(printer->output, "\n-- %s --\n", monthNames[match->month]);
+    }
+
+    printer->last_month = match->month;
+    printer->last_day = match->day;
+
+    fprintf(printer->output, "%d (%s): %s", match->day, dayName(match->year, match->month, match->day), match->task->task_description);
+    return 1;
 }
 
-// prints a month in an ASCII grid, and marks days with tasks using '*'
-//Main Contributors: Farah Laniari
-//Main Editor: Damian Wilson
-void printMonthCalendar(struct years* calendar_head, int year, int month) {
+// prints one task line of the single-day view (title before the first one)
+static int printDayTask(const struct task_match* match, void* user_data) {
+    int* printed = (int*)user_data;
 
-    if (month < 1 || month > 12) {
-        printf("Invalid month.\n");
-        return;
+    if (!*printed) {
+        printf("Tasks for %s, %s %d, %d:\n",
+            dayName(match->year, match->month, match->day), monthNames[match->month], match->day, match->year);
     }
+    *printed = 1;
 
-    // use the same year node for title + task checks (creates year if missing)
-    struct years* year_node = findOrAddYear(&calendar_head, year);
-    if (!year_node) {
-        printf("Error accessing year.\n");
+    printf(" %d. %s\n", match->task->task_id, match->task->task_description);
+    return 1;
+}
+
+// prints all tasks for one specific date
+//Main Contributor: Sierra Jamieson
+//Main Editor: Damian Wilson
+void printTasksForDay(struct years* calendar_head, int year, int month, int day) {
+
+    // validate month/day first so the range below is always one real date
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+        printf("No tasks for %d-%d-%d.\n", year, month, day);
         return;
     }
 
-    int nDays = daysInMonth(year, month);
-    int firstWeekday = dayOfWeek(year, month, 1);
+    int printed = 0;
+    forEachTaskInRange(calendar_head, year, month, day, year, month, day, printDayTask, &printed);
 
-    const char* month_title = year_node->months[month - 1].month_name;
+    if (!printed) {
+        printf("No tasks for %d-%d-%d.\n", year, month, day);
+    }
+}
 
-    // this width is just used for centering the title
-    const int calendar_width = 31;
+// compact month view: prints only days with tasks, and puts tasks on one line
+//Main Contributor: Sierra Jamieson
+//Main Editor: Farah Laniari
+void printTasksForMonthPretty(struct years* calendar_head, int year, int month) {
 
-    // calculate the number of digits in the year (for title length)
-    int year_digits = 0;
-    int temp_year = year;
-    if (temp_year == 0) {
-        year_digits = 1;
+    if (month < 1 || month > 12) {
+        printf("Invalid month.\n");
+        return;
     }
-    else {
-        while (temp_year != 0) {
-            temp_year /= 10;
-            year_digits++;
-        }
+
+    // checks if there are tasks in this year
+    if (!findYear(calendar_head, year)) {
+        printf("No data for year %d.\n", year);
+        return;
     }
 
-    // total title length: "Month" + space + "Year"
-    int title_len = (int)strlen(month_title) + 1 + year_digits;
+    TRACE_BEGIN(span);
+    printf("\n=== %s %d ===\n", monthNames[month], year);
 
-    // offset is how many spaces to print before the title to center it
-    int offset = (calendar_width - title_len) / 2;
+    struct compact_printer printer = { stdout, 0, 0, 0 };
+    int found = forEachTaskInRange(calendar_head, year, month, 1, year, month, 31,
+        printCompactTask, &printer);
 
-    // fix: % runs before -, so we need parentheses or centering is off
-    if (((calendar_width - title_len) % 2) != 0) {
-        offset--;
+    if (found) {
+        printf("\n");
+    }
+    else {
+        printf("No tasks stored for %s %d.\n", monthNames[month], year);
     }
 
     printf("\n");
-    // left padding for centering
-    for (int i = 0; i < offset; i++) {
-        printf(" ");
-    }
+    TRACE_END(span, "render month tasks", "render", "tasks", found);
+}
 
-    printf("%s %d\n", month_title, year);
-    printf("_____________________________\n");
-    printf("|Su |Mo |Tu |We |Th |Fr |Sa |\n");
-    printf("|___|___|___|___|___|___|___|\n|");
+// compact year view: groups by month, prints only days that have tasks
+//Main Contributor: Sierra Jamieson
+//Main Editor: Farah Laniari
+void printTasksForYearPretty(struct years* calendar_head, int year) {
 
-    // leading empty cells before day 1
-    for (int i = 0; i < firstWeekday; i++) {
-        printf("   |");
+    // checks if there are tasks in this year
+    if (!findYear(calendar_head, year)) {
+        // notify user if no tasks were found
+        printf("No data for year %d.\n", year);
+        return;
     }
 
-    // print each day cell
-    for (int d = 1; d <= nDays; d++) {
-
-        // mark with * if that day has at least one task
-        int has_task = (year_node->months[month - 1].days[d - 1].tasks_head != NULL);
-
-        // each cell is 3 chars wide (plus the '|')
-        if (has_task && d < 10) {
-            printf("%1d* ", d);
-        }
-        else if (has_task) {
-            printf("%2d*", d);
-        }
-        else if (!has_task && d < 10) {
-            printf("%1d  ", d);
-        }
-        else {
-            printf("%2d ", d);
-        }
+    TRACE_BEGIN(span);
+    printf("\n=== Tasks for %d ===\n", year);
 
-        // end of week (Saturday) -> newline + row line
-        if ((firstWeekday + d - 1) % 7 == 6) {
-            printf("|\n");
-            if (d < nDays) {
-                printf("|___|___|___|___|___|___|___|\n|");
-            }
-        }
-        else {
-            printf("|");
-        }
-    }
+    struct compact_printer printer = { stdout, 0, 0, 1 };
+    int found = forEachTaskInRange(calendar_head, year, 1, 1, year, 12, 31,
+        printCompactTask, &printer);
 
-    // trailing empty cells to finish last row cleanly
-    int lastDayWeekday = (firstWeekday + nDays - 1) % 7;
-    if (lastDayWeekday != 6) {
-        for (int i = lastDayWeekday; i < 6; i++) {
-            printf("   |");
-        }
+    if (found) {
         printf("\n");
     }
+    else {
+        // notify user if no tasks were found
+        printf("No tasks stored for %d.\n", year);
+    }
 
-    printf("|___|___|___|___|___|___|___|\n");
-    printf("\n* = day has one or more tasks.\n");
+    printf("\n");
+    TRACE_END(span, "render year tasks", "render", "tasks", found);
 }
 
 
@@ -733,6 +1157,92 @@ int containsIgnoreCase(const char* text, const char* key) {
     return 0;
 }
 
+// state for searchTasksEach: filters the range walk down to keyword hits
+struct keyword_filter {
+    const char* keyword;
+    int limit;
+    int reported;
+    TaskMatchFn on_match;
+    void* user_data;
+};
+
+static int filterKeyword(const struct task_match* match, void* user_data) {
+    struct keyword_filter* filter = (struct keyword_filter*)user_data;
+
+    if (!containsIgnoreCase(match->task->task_description, filter->keyword)) return 1;
+
+    filter->reported++;
+    if (!filter->on_match(match, filter->user_data)) return 0;
+    return !(filter->limit > 0 && filter->reported >= filter->limit);
+}
+
+// keyword search that reports hits through a callback instead of printing
+// walks the whole calendar in date order (empty months/days are skipped), and stops
+// early when the callback returns 0 or when "limit" hits were reported
+// (limit <= 0 means no limit); returns how many matches were reported
+int searchTasksEach(struct years* calendar_head, const char* keyword, int limit, TaskMatchFn on_match, void* user_data) {
+
+    if (!keyword || keyword[0] == '\0' || !on_match) return 0;
+
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    struct keyword_filter filter = { keyword, limit, 0, on_match, user_data };
+    forEachTaskInRange(calendar_head, INT_MIN, 1, 1, INT_MAX, 12, 31, filterKeyword, &filter);
+
+    OP_TIMER_END(timer, OP_SEARCH, strlen(keyword));
+    TRACE_END(span, "search", "search", "hits", filter.reported);
+    return filter.reported;
+}
+
+// state for searchTasksInto: caller's array + how much of it is used
+struct match_buffer {
+    struct task_match* results;
+    int count;
+};
+
+static int collectMatch(const struct task_match* match, void* user_data) {
+    struct match_buffer* buffer = (struct match_buffer*)user_data;
+    buffer->results[buffer->count++] = *match;
+    return 1;
+}
+
+// same search, but copies hits into a caller-provided array (at most max_results)
+// returns how many entries were filled in
+int searchTasksInto(struct years* calendar_head, const char* keyword, struct task_match* results, int max_results) {
+
+    if (!results || max_results <= 0) return 0;
+
+    struct match_buffer buffer = { results, 0 };
+    searchTasksEach(calendar_head, keyword, max_results, collectMatch, &buffer);
+    return buffer.count;
+}
+
+// state for searchTasks: the keyword is only needed for the header line
+struct search_printer {
+    const char* keyword;
+    int found;
+};
+
+// prints one search hit (header is printed before the first one)
+static int printMatch(const struct task_match* match, void* user_data) {
+    struct search_printer* printer = (struct search_printer*)user_data;
+
+    if (!printer->found) {
+        printf("\nSearch results for \"%s\":\n", printer->keyword);
+    }
+    printer->found = 1;
+
+    // prints tasks with their date and description
+    printf(" - %d-%02d-%02d (Task %d): %s\n",
+        match->year,
+        match->month,
+        match->day,
+        match->task->task_id,
+        match->task->task_description);
+    return 1;
+}
+
 // keyword search across every loaded year/month/day
 // prints matches with the date so the user can actually find them again
 //Main Contributor: Farah Laniari
@@ -743,41 +1253,10 @@ void searchTasks(struct years* calendar_head, const char* keyword) {
         return;
     }
 
-    int found = 0;
-    struct years* y = calendar_head;
-
-    while (y != NULL) {
-
-        for (int m = 0; m < 12; m++) {
-            // loop through each day in current month
-            for (int d = 0; d < y->months[m].num_days; d++) {
-                // gets head of task list
-                struct tasks* t = y->months[m].days[d].tasks_head;
-
-                while (t != NULL) {
-                    if (containsIgnoreCase(t->task_description, keyword)) {
-                        // prints results for any found keywords in all tasks
-                        if (!found) {
-                            printf("\nSearch results for \"%s\":\n", keyword);
-                        }
-                        found = 1;
-                        // prints tasks with their date and description
-                        printf(" - %d-%02d-%02d (Task %d): %s\n",
-                            y->year_number,
-                            y->months[m].month_number,
-                            y->months[m].days[d].day_number,
-                            t->task_id,
-                            t->task_description);
-                    }
-                    t = t->next;
-                }
-            }
-        }
+    struct search_printer printer = { keyword, 0 };
+    searchTasksEach(calendar_head, keyword, 0, printMatch, &printer);
 
-        y = y->next;
-    }
-
-    if (!found) {
+    if (!printer.found) {
         printf("No tasks found containing \"%s\".\n", keyword);
     }
     else {
@@ -797,52 +1276,99 @@ void searchTasks(struct years* calendar_head, const char* keyword) {
 // 1 1 New Year's Day
 //
 // We intentionally do NOT store task_id because addTask() rebuilds them.
+// Years are written in ascending order (the list is kept sorted); files from
+// before that have them in any order and load the same.
 
-//Main Contributor: Damian Wilson and Farah Laniari
-struct years* loadTasks(const char* filename) {
+// splits a "month day description" line like "%d %d %[^\n]", cutting the description to fit desc; returns the fields read
+int parseTaskLine(const char* line, int* month, int* day, char* desc) {
 
-    FILE* fp;
-    fopen_s(&fp, filename, "r");
-    if (!fp) {
-        return NULL;
-    }
+    int consumed = 0;
+    if (sscanf_s(line, "%d %d%n", month, day, &consumed) != 2) return 0;
 
-    // silent mode so addTask doesn't print a line for every task in the file
-    g_silentAdd = 1;
+    const char* at = line + consumed;
+    while (*at == ' ' || *at == '\t' || *at == '\r' || *at == '\n' || *at == '\v' || *at == '\f') at++;
 
-    struct years* calendar_head = NULL;
+    size_t length = 0;
+    while (at[length] != '\0' && at[length] != '\n' && length < DESC_LEN - 1) length++;
+    if (length == 0) return 2;
+
+    memcpy(desc, at, length);
+    desc[length] = '\0';
+    return 3;
+}
+
+//Main Contributor: Damian Wilson and Farah Laniari
+// reads tasks.txt formatted lines from fp into *calendar_head (adds to what's there)
+// returns how many tasks were added
+int readTasksFrom(FILE* fp, struct years** calendar_head, FILE* errors) {
+
+    struct years* year_node = NULL;
     char line[512];
     int current_year = 0;
+    int loaded = 0;
+
+    // a span per [YEAR] section: reading, parsing and inserting go line by line
+    // here, so they can't be told apart (the pooled load can)
+    TRACE_BEGIN(section);
 
     while (fgets(line, sizeof(line), fp)) {
 
         // year marker line: [YEAR] 2025
         if (sscanf_s(line, "[YEAR] %d", &current_year) == 1) {
-            findOrAddYear(&calendar_head, current_year);
+            if (year_node) {
+                TRACE_END(section, "read + parse year", "load", "year", year_node->year_number);
+            }
+            TRACE_RESTART(section);
+            year_node = findOrAddYear(calendar_head, current_year);
         }
-        else if (current_year != 0) {
+        else if (year_node != NULL) {
 
             int month, day;
             char desc[DESC_LEN] = "";
 
             // reads: month day description... (description can include spaces)
-            if (sscanf_s(line, "%d %d %[^\n]", &month, &day, desc, (unsigned)DESC_LEN) >= 2) {
-                addTask(&calendar_head, current_year, month, day, desc);
+            // no "Task added" line per task here, that would spam the whole file
+            if (parseTaskLine(line, &month, &day, desc) >= 2) {
+                if (insertTask(year_node, month, day, desc, errors, NULL) == CALENDAR_OK) {
+                    loaded++;
+                }
             }
         }
     }
 
-    fclose(fp);
+    if (year_node) {
+        TRACE_END(section, "read + parse year", "load", "year", year_node->year_number);
+    }
+    return loaded;
+}
 
-    // back to normal mode
-    g_silentAdd = 0;
+struct years* loadTasks(const char* filename) {
+
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
+    FILE* fp;
+    fopen_s(&fp, filename, "r");
+    if (!fp) {
+        return NULL;
+    }
 
+    struct years* calendar_head = NULL;
+    int loaded = readTasksFrom(fp, &calendar_head, stdout);
+    OP_TIMER_END(timer, OP_LOAD, (unsigned long long)ftell(fp));
+    fclose(fp);
+
+    emitTaskEvent(TASK_EVENT_RELOAD, 0, 0, 0, loaded);
+    TRACE_END(span, "loadTasks", "load", "tasks", loaded);
     return calendar_head;
 }
 
 //Main Contributor: Damian Wilson and Farah Laniari
 int saveTasks(const char* filename, struct years* calendar_head) {
 
+    OP_TIMER_START(timer);
+    TRACE_BEGIN(span);
+
     FILE* fp;
     fopen_s(&fp, filename, "w");
     if (!fp) return 0;
@@ -865,7 +1391,7 @@ int saveTasks(const char* filename, struct years* calendar_head) {
                     // Save: month day description (no task_id needed)
                     fprintf(fp, "%d %d %s\n",
                         current_year->months[m].month_number,
-                        current_year->months[m].days[d].day_number,
+                        d + 1,
                         current_task->task_description);
                     // move to the next task in list
                     current_task = current_task->next;
@@ -876,6 +1402,8 @@ int saveTasks(const char* filename, struct years* calendar_head) {
         current_year = current_year->next;
     }
 
+    OP_TIMER_END(timer, OP_SAVE, (unsigned long long)ftell(fp));
+    TRACE_END(span, "saveTasks", "save", "bytes", ftell(fp));
     fclose(fp);
     return 1;
 }
@@ -888,6 +1416,9 @@ int saveTasks(const char* filename, struct years* calendar_head) {
 //Main Contributor: Damian Wilson
 void freeCalendar(struct years* calendar_head) {
 
+    // anything cached about these nodes is about to dangle
+    atomicIncrement64(&g_calendarGeneration);
+
     struct years* current_year = calendar_head;
     // loop through each year
     while (current_year != NULL) {
@@ -900,22 +1431,21 @@ void freeCalendar(struct years* calendar_head) {
 
                 while (current_task != NULL) {
                     struct tasks* next_task = current_task->next;
-                    // free description
-                    free(current_task->task_description);
-                    free(current_task);
+                    // free the task (and its description)
+                    freeTask(current_task);
                     // move to next task
                     current_task = next_task;
                 }
             }
-            // free the memory for the days array for the current month
-            free(current_year->months[m].days);
+            // free the memory for the days array for the current month (if it has one)
+            freeMonthDays(&current_year->months[m]);
         }
         // free memory of the months array for the current year
-        free(current_year->months);
+        calendarFree(current_year->months);
         // save pointer to next year before freeing current one
         struct years* next_year = current_year->next;
         // free memory for current year
-        free(current_year);
+        calendarFree(current_year);
         // move to the next year in list
         current_year = next_year;
     }
@@ -930,6 +1460,12 @@ void menu(struct years** calendar_head) {
 
     int choice;
 
+    // month grids shown before are redrawn from here while their days with
+    // tasks stay the same (RenderCache.h); 4 years' worth
+    struct render_cache* views = createRenderCache(48);
+    struct render_buffer screen;
+    initRenderBuffer(&screen, fileSink(stdout));
+
     do {
         printf("\n=== Simple Calendar ===\n");
         printf("1. Add task\n");
@@ -941,6 +1477,8 @@ void menu(struct years** calendar_head) {
         printf("7. View all tasks for a year\n");
         printf("8. Show calendar for a month\n");
         printf("9. Show Calendar for a year\n");
+        printf("10. Advanced search (AND / OR / NOT, \"phrases\", year:/month:/date:)\n");
+        printf("11. Show calendar for a year, months side by side\n");
         printf("0. Save and exit\n");
         printf("Choice: ");
 
@@ -1140,7 +1678,8 @@ void menu(struct years** calendar_head) {
                 continue;
             }
 
-            printMonthCalendar(*calendar_head, y, m);
+            renderCachedMonth(views, &screen, *calendar_head, y, m);
+            flushRender(&screen);
         }
 
         else if (choice == 9) { 
@@ -1152,46 +1691,40 @@ void menu(struct years** calendar_head) {
                 int ch; while ((ch = getchar()) != '\n' && ch != EOF);
                 continue;
             }
-            // Calculate the number of digits in the year
-            int calendar_width = 31;
-            int year_digits = 0;
-            int temp_year = y;
-            if (temp_year == 0) {
-                year_digits = 1;
-            }
-            else {
-                while (temp_year != 0) {
-                    temp_year /= 10;
-                    year_digits++;
-                }
-            }
+            // title + all 12 month grids, written out in one go (Render.h); a year
+            // that isn't loaded just shows no tasks (nothing gets created for it)
+            renderCachedYear(views, &screen, *calendar_head, y);
+            flushRender(&screen);
+        }
+        else if (choice == 10) {
 
-            // This will create the year if it's not already loaded.
-            struct years* year_node = findOrAddYear(calendar_head, y);
+            char query_text[DESC_LEN];
 
-            // Check if the year was created successfully (it could fail on memory allocation).
-            if (!year_node) {
-                printf("Error: Could not create or find calendar for year %d.\n", y);
-                continue; // Go back to the menu
+            // clear input buffer so fgets works
+            int ch; while ((ch = getchar()) != '\n' && ch != EOF);
+            // prompts user for the query
+            printf("Enter query (e.g. deploy AND prod NOT staging year:2025): ");
+            if (!fgets(query_text, sizeof(query_text), stdin)) {
+                printf("Error reading query.\n");
+                continue;
             }
+            size_t len = strlen(query_text);
+            if (len > 0 && query_text[len - 1] == '\n') query_text[len - 1] = '\0';
 
-            // Calculate total title length
-            int title_len = year_digits;
-            int offset = (calendar_width - title_len - 18) / 2;
-            printf("\n");
-            if (calendar_width - title_len % 2 != 0) {
-                offset--;
-            }
+            queryTasks(*calendar_head, query_text);
+        }
+        else if (choice == 11) {
 
-            // Print the left padding
-            for (int i = 0; i < offset; i++) {
-                printf(" ");
-            }
-            printf("===Calendar of %d===\n", y);
-            for (int m = 1; m < 13; m++) {
-                printMonthCalendar(*calendar_head, y, m);
+            int y, columns;
+            printf("Enter year and months per row, 3 or 4 (e.g. 2025 4): ");
+            if (scanf_s("%d %d", &y, &columns) != 2) {
+                printf("Invalid input.\n");
+                int ch; while ((ch = getchar()) != '\n' && ch != EOF);
+                continue;
             }
-            
+
+            renderYearColumns(&screen, *calendar_head, y, columns);
+            flushRender(&screen);
         }
         else if (choice == 0) {
             printf("Saving and exiting...\n");
@@ -1201,57 +1734,7 @@ void menu(struct years** calendar_head) {
         }
 
     } while (choice != 0);
-}
-
-// =====================
-// MAIN
-// =====================
-//All Contributed
-int main(void) {
-
-    // Load existing calendar from disk if it exists
-    struct years* calendar = loadTasks("tasks.txt");
-
-    // If no calendar is loaded, ask the user what year to start with
-    if (!calendar) {
-
-        printf("No calendar file found or file is empty.\n");
-
-        int start_year = 0;
-        printf("What year would you like to start with? ");
-
-        // keep asking until we get a valid integer year
-        while (scanf_s("%d", &start_year) != 1 || start_year < 1) {
 
-            printf("Invalid input. Please enter a valid year (e.g., 2025): ");
-
-            // clear input buffer in case of non-numeric input
-            int ch;
-            while ((ch = getchar()) != '\n' && ch != EOF);
-        }
-
-        // create the initial year structure
-        findOrAddYear(&calendar, start_year);
-
-        // save immediately so tasks.txt exists for the next run
-        if (!saveTasks("tasks.txt", calendar)) {
-            printf("Error: Could not save initial calendar file.\n");
-        }
-        else {
-            printf("Calendar for %d created and saved.\n", start_year);
-        }
-    }
-
-    // run menu UI
-    menu(&calendar);
-
-    // save back to disk on exit
-    if (!saveTasks("tasks.txt", calendar)) {
-        printf("Error saving tasks to file.\n");
-    }
-
-    // free everything before exiting
-    freeCalendar(calendar);
-
-    return 0;
+    freeRenderBuffer(&screen);
+    freeRenderCache(views);
 }
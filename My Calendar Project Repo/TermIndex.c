@@ -0,0 +1,770 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalendarInternal.h"
+#include "TermIndex.h"
+#include "WorkPool.h"
+
+// =====================
+// INDEX LAYOUT
+// =====================
+
+// one task that uses a term
+struct term_posting {
+    struct task_match match;
+    long day_number;            // for distance-to-today without redoing date math
+};
+
+// one dictionary word; its postings are postings[first .. first + count), sorted by date
+struct term_entry {
+    const char* term;
+    int first;
+    int count;
+};
+
+// a year the index was built from and its generation at the time
+struct year_stamp {
+    int year;
+    unsigned long long generation;
+};
+
+struct term_index {
+    struct year_stamp* years;   // the years with tasks, in list order
+    int year_count;
+
+    struct term_entry* terms;   // sorted alphabetically
+    int term_count;
+
+    struct term_posting* postings;
+    int posting_count;
+
+    char* pool;                 // every word string lives in here
+};
+
+// days since 1970-01-01 (proleptic Gregorian), so a distance is just a subtraction
+static long dayNumber(int year, int month, int day) {
+    long y = (long)year - (month <= 2);
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long year_of_era = y - era * 400;
+    long day_of_year = (153L * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+static int isWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+static char lowerChar(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// =====================
+// BUILDING
+// =====================
+
+// a (word, task) pair before sorting
+struct raw_posting {
+    const char* word;
+    int sequence;               // keeps tasks of the same day in list order
+    struct term_posting posting;
+};
+
+struct index_builder {
+    char* pool;
+    size_t pool_used;
+
+    struct raw_posting* raw;
+    int raw_count;
+
+    size_t bytes_needed;        // first pass only counts
+    int words_needed;
+};
+
+static int countWords(const struct task_match* match, void* user_data) {
+    struct index_builder* builder = (struct index_builder*)user_data;
+
+    const char* p = match->task->task_description;
+    while (*p) {
+        while (*p && !isWordChar(*p)) p++;
+        if (!*p) break;
+
+        const char* start = p;
+        while (isWordChar(*p)) p++;
+
+        builder->bytes_needed += (size_t)(p - start) + 1;
+        builder->words_needed++;
+    }
+    return 1;
+}
+
+static int collectWords(const struct task_match* match, void* user_data) {
+    struct index_builder* builder = (struct index_builder*)user_data;
+
+    long day = dayNumber(match->year, match->month, match->day);
+    const char* p = match->task->task_description;
+
+    while (*p) {
+        while (*p && !isWordChar(*p)) p++;
+        if (!*p) break;
+
+        // copy the word lowercased into the pool
+        char* word = builder->pool + builder->pool_used;
+        size_t len = 0;
+        while (isWordChar(*p)) word[len++] = lowerChar(*p++);
+        word[len] = '\0';
+        builder->pool_used += len + 1;
+
+        struct raw_posting* raw = &builder->raw[builder->raw_count];
+        raw->word = word;
+        raw->sequence = builder->raw_count;
+        raw->posting.match = *match;
+        raw->posting.day_number = day;
+        builder->raw_count++;
+    }
+    return 1;
+}
+
+static int compareRaw(const void* a, const void* b) {
+    const struct raw_posting* ra = (const struct raw_posting*)a;
+    const struct raw_posting* rb = (const struct raw_posting*)b;
+
+    int by_word = strcmp(ra->word, rb->word);
+    if (by_word != 0) return by_word;
+    if (ra->posting.day_number != rb->posting.day_number) {
+        return ra->posting.day_number < rb->posting.day_number ? -1 : 1;
+    }
+    return ra->sequence - rb->sequence;
+}
+
+// group sorted raw postings into terms; a word used twice in one task only gets one posting
+static void groupPostings(struct term_index* index, const struct raw_posting* sorted, int count) {
+
+    for (int i = 0; i < count; i++) {
+        const struct raw_posting* raw = &sorted[i];
+        struct term_entry* term = index->term_count ? &index->terms[index->term_count - 1] : NULL;
+
+        if (!term || strcmp(term->term, raw->word) != 0) {
+            term = &index->terms[index->term_count++];
+            term->term = raw->word;
+            term->first = index->posting_count;
+            term->count = 0;
+        }
+        else if (index->postings[index->posting_count - 1].match.task == raw->posting.match.task) {
+            continue;
+        }
+
+        index->postings[index->posting_count++] = raw->posting;
+        term->count++;
+    }
+}
+
+// empty years are left out: they hold nothing the index could miss
+static int hasTasks(const struct years* year_node) {
+    return year_node->task_count > 0;
+}
+
+// remembers which years the index covers and how current each was, so only a
+// change to one of them (or a year gaining tasks) makes it stale
+static struct term_index* newIndex(struct years* calendar_head) {
+
+    struct term_index* index = (struct term_index*)calloc(1, sizeof(struct term_index));
+    if (!index) return NULL;
+
+    int count = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) count += hasTasks(y);
+    if (count == 0) return index;
+
+    index->years = (struct year_stamp*)malloc(count * sizeof(struct year_stamp));
+    if (!index->years) {
+        free(index);
+        return NULL;
+    }
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        if (!hasTasks(y)) continue;
+        index->years[index->year_count].year = y->year_number;
+        index->years[index->year_count].generation = y->generation;
+        index->year_count++;
+    }
+    return index;
+}
+
+struct term_index* buildTermIndex(struct years* calendar_head) {
+
+    struct index_builder builder;
+    memset(&builder, 0, sizeof(builder));
+
+    struct term_index* index = newIndex(calendar_head);
+    if (!index) return NULL;
+
+    // pass 1: sizes, so the pool never moves (raw postings point into it)
+    forEachTaskInRange(calendar_head, INT_MIN, 1, 1, INT_MAX, 12, 31, countWords, &builder);
+
+    if (builder.words_needed == 0) return index;
+
+    builder.pool = (char*)malloc(builder.bytes_needed);
+    builder.raw = (struct raw_posting*)malloc(builder.words_needed * sizeof(struct raw_posting));
+    index->terms = (struct term_entry*)malloc(builder.words_needed * sizeof(struct term_entry));
+    index->postings = (struct term_posting*)malloc(builder.words_needed * sizeof(struct term_posting));
+
+    if (!builder.pool || !builder.raw || !index->terms || !index->postings) {
+        free(builder.pool);
+        free(builder.raw);
+        freeTermIndex(index);
+        return NULL;
+    }
+
+    // pass 2: every (word, task) pair, then sort by word, date, list order
+    forEachTaskInRange(calendar_head, INT_MIN, 1, 1, INT_MAX, 12, 31, collectWords, &builder);
+    qsort(builder.raw, builder.raw_count, sizeof(struct raw_posting), compareRaw);
+
+    groupPostings(index, builder.raw, builder.raw_count);
+
+    free(builder.raw);
+    index->pool = builder.pool;
+    return index;
+}
+
+// =====================
+// PARALLEL BUILD
+// =====================
+// same two passes, month by month on a work pool; every month writes its words
+// and postings into its own slice (found with a prefix sum), so the slices come
+// out in date order and sequence numbers match the serial build's
+
+struct parallel_index {
+    const struct month_key* months;
+    struct index_builder* builders;     // one per month
+    struct raw_posting* runs;           // sort runs...
+    struct raw_posting* merged;         // ...and where they get merged to
+    int* run_starts;                    // run r is [run_starts[r], run_starts[r + 1])
+    int run_width;                      // runs merged per output run this round
+};
+
+static void forEachTaskOfMonth(const struct month_key* key, TaskMatchFn on_task, void* user_data) {
+    forEachTaskInRange(key->year_node, key->year, key->month, 1, key->year, key->month, 31, on_task, user_data);
+}
+
+static void countMonths(int begin, int end, void* arg) {
+    struct parallel_index* build = (struct parallel_index*)arg;
+    for (int i = begin; i < end; i++) forEachTaskOfMonth(&build->months[i], countWords, &build->builders[i]);
+}
+
+static void collectMonths(int begin, int end, void* arg) {
+    struct parallel_index* build = (struct parallel_index*)arg;
+    for (int i = begin; i < end; i++) forEachTaskOfMonth(&build->months[i], collectWords, &build->builders[i]);
+}
+
+static void sortRuns(int begin, int end, void* arg) {
+    struct parallel_index* build = (struct parallel_index*)arg;
+    for (int r = begin; r < end; r++) {
+        int first = build->run_starts[r];
+        qsort(build->runs + first, build->run_starts[r + 1] - first, sizeof(struct raw_posting), compareRaw);
+    }
+}
+
+// merges runs pairwise: output run r covers input runs 2r and 2r + 1 (of this round's width)
+static void mergeRuns(int begin, int end, void* arg) {
+    struct parallel_index* build = (struct parallel_index*)arg;
+    const int* starts = build->run_starts;
+    int width = build->run_width;
+
+    for (int r = begin; r < end; r++) {
+        int lo = starts[2 * r * width];
+        int mid = starts[(2 * r + 1) * width];
+        int hi = starts[(2 * r + 2) * width];
+
+        int a = lo, b = mid, out = lo;
+        while (a < mid && b < hi) {
+            build->merged[out++] = compareRaw(&build->runs[b], &build->runs[a]) < 0 ? build->runs[b++] : build->runs[a++];
+        }
+        while (a < mid) build->merged[out++] = build->runs[a++];
+        while (b < hi) build->merged[out++] = build->runs[b++];
+    }
+}
+
+// sorts raw[0 .. count) like qsort(compareRaw) would (every key is distinct, so
+// the order is the same); returns where the sorted postings ended up
+static struct raw_posting* sortParallel(struct parallel_index* build, struct raw_posting* raw,
+    struct raw_posting* spare, int count, struct work_pool* pool) {
+
+    // a power of two runs, so every merge round pairs them all up
+    int runs = 1;
+    while (runs < workPoolThreads(pool) * 2 && count / (runs * 2) >= 1024) runs *= 2;
+
+    int* starts = (int*)malloc((runs + 1) * sizeof(int));
+    if (!starts) {
+        qsort(raw, count, sizeof(struct raw_posting), compareRaw);
+        return raw;
+    }
+    for (int r = 0; r <= runs; r++) starts[r] = (int)((long long)count * r / runs);
+
+    build->run_starts = starts;
+    build->runs = raw;
+    build->merged = spare;
+    parallelFor(pool, runs, 1, sortRuns, build);
+
+    for (int width = 1; width < runs; width *= 2) {
+        build->run_width = width;
+        parallelFor(pool, runs / (2 * width), 1, mergeRuns, build);
+
+        struct raw_posting* swap = build->runs;
+        build->runs = build->merged;
+        build->merged = swap;
+    }
+
+    free(starts);
+    return build->runs;
+}
+
+struct term_index* buildTermIndexParallel(struct years* calendar_head, struct work_pool* pool) {
+
+    if (!pool) return buildTermIndex(calendar_head);
+
+    struct month_key* months;
+    int month_count = listTaskMonths(calendar_head, &months);
+    if (month_count < 0) return NULL;
+
+    struct index_builder* builders = month_count ? (struct index_builder*)calloc(month_count, sizeof(struct index_builder)) : NULL;
+    struct term_index* index = newIndex(calendar_head);
+    if (!index || (month_count && !builders)) {
+        free(builders);
+        freeTermIndex(index);
+        free(months);
+        return NULL;
+    }
+
+    struct parallel_index build;
+    memset(&build, 0, sizeof(build));
+    build.months = months;
+    build.builders = builders;
+
+    // pass 1: sizes per month, then every month's slice of the pool and postings
+    parallelFor(pool, month_count, 1, countMonths, &build);
+
+    size_t bytes_needed = 0;
+    int words_needed = 0;
+    for (int i = 0; i < month_count; i++) {
+        builders[i].pool_used = bytes_needed;
+        builders[i].raw_count = words_needed;
+        bytes_needed += builders[i].bytes_needed;
+        words_needed += builders[i].words_needed;
+    }
+
+    if (words_needed == 0) {
+        free(builders);
+        free(months);
+        return index;
+    }
+
+    char* word_pool = (char*)malloc(bytes_needed);
+    struct raw_posting* raw = (struct raw_posting*)malloc(words_needed * sizeof(struct raw_posting));
+    struct raw_posting* spare = (struct raw_posting*)malloc(words_needed * sizeof(struct raw_posting));
+    index->terms = (struct term_entry*)malloc(words_needed * sizeof(struct term_entry));
+    index->postings = (struct term_posting*)malloc(words_needed * sizeof(struct term_posting));
+
+    if (!word_pool || !raw || !spare || !index->terms || !index->postings) {
+        free(word_pool);
+        free(raw);
+        free(spare);
+        free(builders);
+        free(months);
+        freeTermIndex(index);
+        return NULL;
+    }
+
+    // pass 2: every month fills its own slice
+    for (int i = 0; i < month_count; i++) {
+        builders[i].pool = word_pool;
+        builders[i].raw = raw;
+    }
+    parallelFor(pool, month_count, 1, collectMonths, &build);
+
+    struct raw_posting* sorted = sortParallel(&build, raw, spare, words_needed, pool);
+    groupPostings(index, sorted, words_needed);
+
+    free(raw);
+    free(spare);
+    free(builders);
+    free(months);
+    index->pool = word_pool;
+    return index;
+}
+
+void freeTermIndex(struct term_index* index) {
+    if (!index) return;
+    free(index->terms);
+    free(index->postings);
+    free(index->pool);
+    free(index->years);
+    free(index);
+}
+
+int isTermIndexCurrent(const struct term_index* index, struct years* calendar_head) {
+
+    if (!index) return 0;
+
+    // the same years with tasks, none of them changed since
+    int i = 0;
+    for (struct years* y = calendar_head; y != NULL; y = y->next) {
+        if (!hasTasks(y)) continue;
+        if (i == index->year_count) return 0;
+        if (index->years[i].year != y->year_number || index->years[i].generation != y->generation) return 0;
+        i++;
+    }
+    return i == index->year_count;
+}
+
+int refreshTermIndex(struct term_index** index, struct years* calendar_head) {
+
+    if (isTermIndexCurrent(*index, calendar_head)) return 1;
+
+    struct term_index* fresh = buildTermIndex(calendar_head);
+    if (!fresh) return 0;
+
+    freeTermIndex(*index);
+    *index = fresh;
+    return 1;
+}
+
+// first term >= prefix (binary search over the sorted dictionary)
+static int lowerBoundTerm(const struct term_index* index, const char* prefix) {
+    int lo = 0, hi = index->term_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(index->terms[mid].term, prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int completeTerms(const struct term_index* index, const char* prefix,
+    struct term_completion* terms, int max_terms) {
+
+    if (!index || !prefix || !terms || max_terms <= 0) return 0;
+
+    char key[DESC_LEN];
+    size_t len = 0;
+    while (prefix[len] && len + 1 < sizeof(key)) {
+        key[len] = lowerChar(prefix[len]);
+        len++;
+    }
+    key[len] = '\0';
+
+    int written = 0;
+    for (int i = lowerBoundTerm(index, key); i < index->term_count && written < max_terms; i++) {
+        if (strncmp(index->terms[i].term, key, len) != 0) break;
+
+        terms[written].term = index->terms[i].term;
+        terms[written].task_count = index->terms[i].count;
+        written++;
+    }
+    return written;
+}
+
+// key lowercased into lowered (DESC_LEN); 0 if it isn't a single word the
+// dictionary could hold (spaces / punctuation, empty or too long)
+static int lowerWord(const char* key, char* lowered) {
+    size_t len = 0;
+    for (; key[len]; len++) {
+        if (len + 1 >= DESC_LEN || !isWordChar(key[len])) return 0;
+        lowered[len] = lowerChar(key[len]);
+    }
+    lowered[len] = '\0';
+    return len > 0;
+}
+
+int countTermMatches(const struct term_index* index, const char* key) {
+
+    char lowered[DESC_LEN];
+    if (!index || !key || !lowerWord(key, lowered)) return -1;
+
+    int count = 0;
+    for (int i = 0; i < index->term_count; i++) {
+        if (strstr(index->terms[i].term, lowered)) count += index->terms[i].count;
+    }
+    return count;
+}
+
+// date, then list order (the index is current, so ids are still in list order)
+static int comparePostings(const void* a, const void* b) {
+    const struct term_posting* pa = (const struct term_posting*)a;
+    const struct term_posting* pb = (const struct term_posting*)b;
+    if (pa->day_number != pb->day_number) return pa->day_number < pb->day_number ? -1 : 1;
+    return pa->match.task->task_id - pb->match.task->task_id;
+}
+
+int collectTermMatches(const struct term_index* index, const char* key, struct task_match** matches) {
+
+    *matches = NULL;
+    int total = countTermMatches(index, key);
+    if (total <= 0) return total;
+
+    char lowered[DESC_LEN];
+    lowerWord(key, lowered);
+
+    struct term_posting* postings = (struct term_posting*)malloc(total * sizeof(struct term_posting));
+    struct task_match* out = (struct task_match*)malloc(total * sizeof(struct task_match));
+    if (!postings || !out) {
+        free(postings);
+        free(out);
+        return -1;
+    }
+
+    // one run per matching word, then sorted together; a task with several
+    // matching words ends up next to itself
+    int count = 0;
+    for (int i = 0; i < index->term_count; i++) {
+        const struct term_entry* term = &index->terms[i];
+        if (!strstr(term->term, lowered)) continue;
+        memcpy(postings + count, index->postings + term->first, term->count * sizeof(struct term_posting));
+        count += term->count;
+    }
+    qsort(postings, count, sizeof(struct term_posting), comparePostings);
+
+    int written = 0;
+    for (int i = 0; i < count; i++) {
+        if (written > 0 && out[written - 1].task == postings[i].match.task) continue;
+        out[written++] = postings[i].match;
+    }
+
+    free(postings);
+    *matches = out;
+    return written;
+}
+
+int termIndexSize(const struct term_index* index) {
+    return index ? index->term_count : 0;
+}
+
+// =====================
+// TOP-K SEARCH
+// =====================
+
+struct heap_item {
+    struct ranked_match result;
+    long day_number;
+};
+
+// bounded max-heap: the worst of the current top k sits at the root
+struct topk_heap {
+    struct heap_item* items;
+    int count;
+    int k;
+    long today;
+};
+
+// 1 if a ranks after b
+static int rankedWorse(const struct heap_item* a, const struct heap_item* b, long today) {
+
+    if (a->result.prefix_hit != b->result.prefix_hit) return a->result.prefix_hit < b->result.prefix_hit;
+    if (a->result.distance_days != b->result.distance_days) return a->result.distance_days > b->result.distance_days;
+
+    // same distance: upcoming beats past
+    int a_past = a->day_number < today;
+    int b_past = b->day_number < today;
+    if (a_past != b_past) return a_past;
+
+    if (a->day_number != b->day_number) return a->day_number > b->day_number;
+    return a->result.match.task->task_id > b->result.match.task->task_id;
+}
+
+static void swapItems(struct heap_item* a, struct heap_item* b) {
+    struct heap_item tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void siftUp(struct topk_heap* heap, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!rankedWorse(&heap->items[i], &heap->items[parent], heap->today)) break;
+        swapItems(&heap->items[i], &heap->items[parent]);
+        i = parent;
+    }
+}
+
+static void siftDown(struct topk_heap* heap, int i) {
+    for (;;) {
+        int worst = i;
+        int left = 2 * i + 1, right = 2 * i + 2;
+        if (left < heap->count && rankedWorse(&heap->items[left], &heap->items[worst], heap->today)) worst = left;
+        if (right < heap->count && rankedWorse(&heap->items[right], &heap->items[worst], heap->today)) worst = right;
+        if (worst == i) break;
+        swapItems(&heap->items[i], &heap->items[worst]);
+        i = worst;
+    }
+}
+
+enum offer_result { OFFER_TAKEN, OFFER_DUPLICATE, OFFER_REJECTED };
+
+static enum offer_result offerMatch(struct topk_heap* heap, const struct task_match* match,
+    long day_number, int prefix_hit) {
+
+    // a task can come up more than once (several words with the same prefix)
+    for (int i = 0; i < heap->count; i++) {
+        if (heap->items[i].result.match.task == match->task) return OFFER_DUPLICATE;
+    }
+
+    struct heap_item item;
+    item.result.match = *match;
+    item.result.prefix_hit = prefix_hit;
+    item.result.distance_days = labs(day_number - heap->today);
+    item.day_number = day_number;
+
+    if (heap->count < heap->k) {
+        heap->items[heap->count] = item;
+        siftUp(heap, heap->count++);
+        return OFFER_TAKEN;
+    }
+
+    if (!rankedWorse(&heap->items[0], &item, heap->today)) return OFFER_REJECTED;
+
+    heap->items[0] = item;
+    siftDown(heap, 0);
+    return OFFER_TAKEN;
+}
+
+// offers a term's postings nearest-to-today first; stops at the first one the heap
+// turns down, since everything further out ranks lower still. Postings of one day
+// are offered in list order (lowest id first, the way ties rank), also when
+// walking back into the past.
+static void offerNearestPostings(struct topk_heap* heap, const struct term_index* index,
+    const struct term_entry* term, int prefix_hit) {
+
+    const struct term_posting* postings = &index->postings[term->first];
+
+    // first posting on or after today
+    int lo = 0, hi = term->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (postings[mid].day_number < heap->today) lo = mid + 1;
+        else hi = mid;
+    }
+
+    int before = lo - 1;    // walks back into the past
+    int after = lo;         // walks forward into the future
+
+    while (before >= 0 || after < term->count) {
+        int first, last;
+        if (before < 0 || (after < term->count
+            && postings[after].day_number - heap->today <= heap->today - postings[before].day_number)) {
+            first = last = after++;
+        }
+        else {
+            // the whole past day at once, from its first posting
+            last = before;
+            first = before;
+            while (first > 0 && postings[first - 1].day_number == postings[last].day_number) first--;
+            before = first - 1;
+        }
+
+        for (int pick = first; pick <= last; pick++) {
+            if (offerMatch(heap, &postings[pick].match, postings[pick].day_number, prefix_hit) == OFFER_REJECTED) return;
+        }
+    }
+}
+
+// 0 = some word starts with key, 1 = key only inside a word, -1 = no match
+static int matchTier(const char* text, const char* key) {
+
+    if (!containsIgnoreCase(text, key)) return -1;
+
+    size_t key_len = strlen(key);
+    for (size_t i = 0; text[i] != '\0'; i++) {
+        if (i > 0 && isWordChar(text[i - 1])) continue;
+
+        size_t j = 0;
+        while (j < key_len && text[i + j] != '\0' && lowerChar(text[i + j]) == lowerChar(key[j])) j++;
+        if (j == key_len) return 0;
+    }
+    return 1;
+}
+
+struct topk_scan {
+    struct topk_heap* heap;
+    const char* key;
+};
+
+static int offerScanned(const struct task_match* match, void* user_data) {
+    struct topk_scan* scan = (struct topk_scan*)user_data;
+
+    int tier = matchTier(match->task->task_description, scan->key);
+    if (tier >= 0) {
+        offerMatch(scan->heap, match, dayNumber(match->year, match->month, match->day), tier == 0);
+    }
+    return 1;
+}
+
+static int compareHeapItems(const void* a, const void* b, long today) {
+    const struct heap_item* ia = (const struct heap_item*)a;
+    const struct heap_item* ib = (const struct heap_item*)b;
+    if (rankedWorse(ia, ib, today)) return 1;
+    if (rankedWorse(ib, ia, today)) return -1;
+    return 0;
+}
+
+int topKSearch(struct years* calendar_head, const struct term_index* index, const char* key, int k,
+    int today_year, int today_month, int today_day, struct ranked_match* out) {
+
+    if (!key || key[0] == '\0' || k <= 0 || !out) return 0;
+
+    struct heap_item* items = (struct heap_item*)malloc(k * sizeof(struct heap_item));
+    if (!items) return 0;
+
+    struct topk_heap heap = { items, 0, k, dayNumber(today_year, today_month, today_day) };
+
+    // the dictionary only holds whole words, so keys with spaces/punctuation scan
+    int single_word = 1;
+    for (const char* p = key; *p; p++) {
+        if (!isWordChar(*p)) single_word = 0;
+    }
+
+    if (single_word && isTermIndexCurrent(index, calendar_head) && strlen(key) < DESC_LEN) {
+
+        char lowered[DESC_LEN];
+        size_t len = 0;
+        for (; key[len]; len++) lowered[len] = lowerChar(key[len]);
+        lowered[len] = '\0';
+
+        // prefix hits: the contiguous run of terms starting with the key
+        for (int i = lowerBoundTerm(index, lowered); i < index->term_count; i++) {
+            if (strncmp(index->terms[i].term, lowered, len) != 0) break;
+            offerNearestPostings(&heap, index, &index->terms[i], 1);
+        }
+
+        // substring hits can only matter if prefix hits didn't fill the top k
+        if (heap.count < heap.k) {
+            for (int i = 0; i < index->term_count; i++) {
+                const char* term = index->terms[i].term;
+                if (strncmp(term, lowered, len) != 0 && strstr(term, lowered) != NULL) {
+                    offerNearestPostings(&heap, index, &index->terms[i], 0);
+                }
+            }
+        }
+    }
+    else {
+        struct topk_scan scan = { &heap, key };
+        forEachTaskInRange(calendar_head, INT_MIN, 1, 1, INT_MAX, 12, 31, offerScanned, &scan);
+    }
+
+    // heap order -> best first (k is small, insertion sort is fine)
+    for (int i = 1; i < heap.count; i++) {
+        struct heap_item item = heap.items[i];
+        int j = i - 1;
+        while (j >= 0 && compareHeapItems(&heap.items[j], &item, heap.today) > 0) {
+            heap.items[j + 1] = heap.items[j];
+            j--;
+        }
+        heap.items[j + 1] = item;
+    }
+
+    for (int i = 0; i < heap.count; i++) {
+        out[i] = heap.items[i].result;
+    }
+
+    int count = heap.count;
+    free(items);
+    return count;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#ifndef TERM_INDEX_H
+#define TERM_INDEX_H
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Sorted dictionary of the words used in task descriptions (lowercased, split on
+    // anything that isn't a letter or digit), each with the tasks that use it sorted
+    // by date. Built once, then used for prefix lookups / autocomplete.
+    //
+    // The index is a snapshot: it remembers the generation of every year with
+    // tasks from when it was built, and topKSearch ignores it (falls back to a
+    // scan) once one of those years has changed or another year got tasks.
+    // Changes to other calendars don't matter. refreshTermIndex rebuilds it
+    // only when needed.
+    struct term_index;
+
+    struct term_index* buildTermIndex(struct years* calendar_head);
+    // the same index, built over a work pool (WorkPool.h; NULL = buildTermIndex)
+    struct term_index* buildTermIndexParallel(struct years* calendar_head, struct work_pool* pool);
+    void freeTermIndex(struct term_index* index);
+
+    // rebuilds *index if it's missing or out of date; returns 0 if memory runs out
+    int refreshTermIndex(struct term_index** index, struct years* calendar_head);
+
+    // 1 if the index still matches the calendar it was built from
+    int isTermIndexCurrent(const struct term_index* index, struct years* calendar_head);
+
+    struct term_completion {
+        const char* term;       // owned by the index
+        int task_count;         // how many tasks use it
+    };
+
+    // dictionary words starting with prefix, in alphabetical order (at most max_terms)
+    // returns how many were written
+    int completeTerms(const struct term_index* index, const char* prefix,
+        struct term_completion* terms, int max_terms);
+
+    // For the query planner (Query.h): tasks whose description contains key
+    // (case-insensitively). key must be a single word (letters and digits only),
+    // which a description contains exactly when one of its words does; the index
+    // must be current.
+    //
+    // how many postings the words containing key have (at least as many as there
+    // are such tasks); -1 if key isn't a single word
+    int countTermMatches(const struct term_index* index, const char* key);
+    // the tasks themselves, each once, in date and list order, in a new array
+    // (*matches, free it with free); returns how many, or -1 if key isn't a
+    // single word or memory runs out
+    int collectTermMatches(const struct term_index* index, const char* key, struct task_match** matches);
+    // words in the dictionary (what looking up a key inside words goes through)
+    int termIndexSize(const struct term_index* index);
+
+    // one top-k result, best first
+    struct ranked_match {
+        struct task_match match;
+        int prefix_hit;         // 1 = a word starts with the key, 0 = key is inside a word
+        long distance_days;     // |task date - today|
+    };
+
+    // best k matches for key: word-prefix hits before plain substring hits, then
+    // closest to "today" (upcoming before past on ties). Only a bounded heap of k
+    // entries is kept, nothing else is materialized.
+    // Uses the index when it's current and key is a single word, otherwise scans.
+    // returns how many results were written to out (at most k)
+    int topKSearch(struct years* calendar_head, const struct term_index* index, const char* key, int k,
+        int today_year, int today_month, int today_day, struct ranked_match* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
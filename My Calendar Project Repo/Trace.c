@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Compat.h"
+#include "Platform.h"
+#include "Trace.h"
+
+#define TRACE_DEFAULT_EVENTS (1 << 20)
+#define TRACE_MAX_THREADS 256
+#define TRACE_NAME_LEN 32
+
+struct trace_event {
+    const char* name;           // set last: NULL = not filled in yet
+    const char* category;
+    const char* arg_name;
+    long long arg;
+    long long begin;
+    long long duration;
+    int thread;
+};
+
+static struct trace_event* g_events = NULL;
+static long g_capacity = 0;
+static long g_next = 0;         // next free event (can run past g_capacity)
+static long g_dropped = 0;
+static long g_active = 0;
+static long long g_origin = 0;  // traceStart time, ts 0 in the file
+
+// threads are numbered as they record their first span
+static long g_thread_count = 0;
+static char g_thread_names[TRACE_MAX_THREADS][TRACE_NAME_LEN];
+static PLATFORM_THREAD_LOCAL int t_thread = 0;
+
+static int traceThread(void) {
+    if (t_thread == 0) t_thread = (int)atomicAddLong(&g_thread_count, 1);
+    return t_thread;
+}
+
+// =====================
+// RECORDING
+// =====================
+
+int traceStart(int max_events) {
+#ifdef CALENDAR_NO_STATS
+    return 0;
+#else
+    long capacity = max_events > 0 ? max_events : TRACE_DEFAULT_EVENTS;
+
+    atomicStoreLong(&g_active, 0);
+    if (capacity != g_capacity) {
+        free(g_events);
+        g_events = (struct trace_event*)malloc((size_t)capacity * sizeof(struct trace_event));
+        g_capacity = g_events ? capacity : 0;
+        if (!g_events) return 0;
+    }
+    memset(g_events, 0, (size_t)capacity * sizeof(struct trace_event));
+
+    atomicStoreLong(&g_next, 0);
+    atomicStoreLong(&g_dropped, 0);
+    g_origin = platformNowNanos();
+    atomicStoreLong(&g_active, 1);
+    return 1;
+#endif
+}
+
+void traceStop(void) {
+    atomicStoreLong(&g_active, 0);
+}
+
+int traceActive(void) {
+    return (int)atomicLoadLong(&g_active);
+}
+
+int traceEventCount(void) {
+    long count = atomicLoadLong(&g_next);
+    return (int)(count < g_capacity ? count : g_capacity);
+}
+
+int traceDroppedCount(void) {
+    return (int)atomicLoadLong(&g_dropped);
+}
+
+void traceClear(void) {
+    atomicStoreLong(&g_active, 0);
+    free(g_events);
+    g_events = NULL;
+    g_capacity = 0;
+    atomicStoreLong(&g_next, 0);
+    atomicStoreLong(&g_dropped, 0);
+}
+
+void traceThreadName(const char* name) {
+    int thread = traceThread();
+    if (thread > TRACE_MAX_THREADS) return;
+    snprintf(g_thread_names[thread - 1], TRACE_NAME_LEN, "%s", name);
+}
+
+long long traceBegin(void) {
+    return atomicLoadLong(&g_active) ? platformNowNanos() : 0;
+}
+
+void traceEnd(long long begin, const char* name, const char* category, const char* arg_name, long long arg) {
+
+    if (begin == 0 || !atomicLoadLong(&g_active)) return;
+    long long end = platformNowNanos();
+
+    // once full, stop taking slots (so the counter can't run away)
+    long slot = atomicLoadLong(&g_next) < g_capacity ? atomicAddLong(&g_next, 1) - 1 : g_capacity;
+    if (slot >= g_capacity) {
+        atomicAddLong(&g_dropped, 1);
+        return;
+    }
+
+    struct trace_event* event = &g_events[slot];
+    event->category = category;
+    event->arg_name = arg_name;
+    event->arg = arg;
+    event->begin = begin;
+    event->duration = end - begin;
+    event->thread = traceThread();
+    atomicPublishPointer((void* volatile*)&event->name, (void*)name);
+}
+
+// =====================
+// OUTPUT
+// =====================
+
+static void writeString(FILE* out, const char* text) {
+    fputc('"', out);
+    for (; *text; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+int writeTrace(FILE* out) {
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    // a name row for every thread that recorded something
+    int threads = (int)atomicLoadLong(&g_thread_count);
+    int first = 1;
+    for (int t = 1; t <= threads && t <= TRACE_MAX_THREADS; t++) {
+        char fallback[TRACE_NAME_LEN];
+        snprintf(fallback, sizeof(fallback), "thread %d", t);
+        const char* name = g_thread_names[t - 1][0] ? g_thread_names[t - 1] : fallback;
+
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", t);
+        writeString(out, name);
+        fprintf(out, "}}");
+        first = 0;
+    }
+
+    int count = traceEventCount();
+    for (int i = 0; i < count; i++) {
+        const struct trace_event* event = &g_events[i];
+        const char* name = (const char*)atomicReadPointer((void* volatile*)&event->name);
+        if (!name) continue;
+
+        fprintf(out, "%s{\"name\":", first ? "" : ",\n");
+        writeString(out, name);
+        fprintf(out, ",\"cat\":");
+        writeString(out, event->category ? event->category : "calendar");
+        fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+            (event->begin - g_origin) / 1e3, event->duration / 1e3, event->thread);
+        if (event->arg_name) {
+            fprintf(out, ",\"args\":{");
+            writeString(out, event->arg_name);
+            fprintf(out, ":%lld}", event->arg);
+        }
+        fprintf(out, "}");
+        first = 0;
+    }
+
+    fprintf(out, "\n]}\n");
+    return !ferror(out);
+}
+
+int saveTrace(const char* filename) {
+
+    FILE* fp;
+    fopen_s(&fp, filename, "w");
+    if (!fp) return 0;
+
+    int written = writeTrace(fp);
+    return fclose(fp) == 0 && written;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Timeline spans for the slow phases (file reads, parsing, year skeletons,
+    // inserts, merges, search, save, rendering), written as Chrome trace event
+    // JSON: open it in chrome://tracing or ui.perfetto.dev to see where a load
+    // or a save spent its time. Every thread gets its own row, so the pooled
+    // paths (CalendarParallel.c) show each worker's chunks side by side.
+    //
+    // Off until traceStart; while off a span costs one flag check. Building
+    // with CALENDAR_NO_STATS (like OpStats.h) takes the spans out completely.
+    //
+    // Events go into one buffer sized at traceStart; once it's full further
+    // spans are dropped (and counted). traceStart and traceClear must not run
+    // while other threads may be in a traced call.
+
+    // starts recording, keeping up to max_events spans (0 = a default of 1M);
+    // returns 0 if the buffer can't be allocated or spans were compiled out
+    int traceStart(int max_events);
+    void traceStop(void);
+    int traceActive(void);
+
+    // spans recorded / dropped since traceStart
+    int traceEventCount(void);
+    int traceDroppedCount(void);
+
+    // {"traceEvents": [...]} with times in microseconds from traceStart;
+    // returns 0 on a write error
+    int writeTrace(FILE* out);
+    int saveTrace(const char* filename);
+
+    // frees the buffer (tracing stops)
+    void traceClear(void);
+
+    // the calling thread's name in the trace (copied; "thread n" otherwise)
+    void traceThreadName(const char* name);
+
+    // A span: begin returns 0 when not tracing, and end ignores a 0. name and
+    // category must outlive the trace (string literals); arg_name, if not NULL,
+    // labels one number shown with the span (a year, a task count, bytes).
+    long long traceBegin(void);
+    void traceEnd(long long begin, const char* name, const char* category, const char* arg_name, long long arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,447 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Platform.h"
+#include "Trace.h"
+#include "WorkPool.h"
+
+// slots per worker deque (a power of two); past this the submitter runs the work itself
+#define DEQUE_SIZE 4096
+// empty looks around before an idle worker goes to sleep
+#define IDLE_SPINS 64
+
+// Chase-Lev deque: the owner pushes and pops at bottom, thieves take from top.
+// Indices only grow (and start at 1 so bottom - 1 never wraps); slot i lives at
+// i % DEQUE_SIZE. Padded so the owner's end and the thieves' end don't share a line.
+struct work_deque {
+    volatile unsigned long long top;
+    char padding_top[64 - sizeof(unsigned long long)];
+    volatile unsigned long long bottom;
+    char padding_bottom[64 - sizeof(unsigned long long)];
+    void* volatile slots[DEQUE_SIZE];
+};
+
+struct pool_worker {
+    struct work_pool* pool;
+    struct work_deque deque;
+    unsigned int seed;              // picks where to start stealing
+    volatile unsigned long long executed;
+    volatile unsigned long long stolen;
+};
+
+struct work_pool {
+    struct pool_worker* workers;
+    platform_thread* threads;
+    int thread_count;
+    volatile long stop;
+
+    // work from threads outside the pool (FIFO)
+    platform_mutex shared_lock;
+    struct work_item* shared_head;
+    struct work_item* shared_tail;
+    volatile long shared_count;
+
+    // idle workers sleep here
+    platform_mutex sleep_lock;
+    platform_cond wake;
+    volatile long sleepers;
+
+    volatile unsigned long long inline_runs;
+};
+
+// the worker the current thread is (NULL outside any pool)
+static PLATFORM_THREAD_LOCAL struct pool_worker* t_worker = NULL;
+
+// =====================
+// DEQUES
+// =====================
+
+static void initDeque(struct work_deque* deque) {
+    deque->top = 1;
+    deque->bottom = 1;
+}
+
+// owner only; returns 0 if the deque is full
+static int pushBottom(struct work_deque* deque, struct work_item* item) {
+    unsigned long long bottom = atomicLoad64(&deque->bottom);
+    unsigned long long top = atomicLoad64(&deque->top);
+    if (bottom - top >= DEQUE_SIZE) return 0;
+
+    atomicPublishPointer(&deque->slots[bottom % DEQUE_SIZE], item);
+    atomicStore64(&deque->bottom, bottom + 1);
+    return 1;
+}
+
+// owner only: newest first
+static struct work_item* popBottom(struct work_deque* deque) {
+    unsigned long long bottom = atomicLoad64(&deque->bottom) - 1;
+    atomicStore64(&deque->bottom, bottom);
+    unsigned long long top = atomicLoad64(&deque->top);
+
+    if (top > bottom) {
+        // was empty
+        atomicStore64(&deque->bottom, bottom + 1);
+        return NULL;
+    }
+
+    struct work_item* item = (struct work_item*)atomicReadPointer(&deque->slots[bottom % DEQUE_SIZE]);
+    if (top == bottom) {
+        // the last one: a thief may be after it too, whoever moves top gets it
+        if (!atomicCompareSwap64(&deque->top, top, top + 1)) item = NULL;
+        atomicStore64(&deque->bottom, bottom + 1);
+    }
+    return item;
+}
+
+// any thread: oldest first; NULL if empty or another thread got there first
+static struct work_item* stealTop(struct work_deque* deque) {
+    unsigned long long top = atomicLoad64(&deque->top);
+    unsigned long long bottom = atomicLoad64(&deque->bottom);
+    if (top >= bottom) return NULL;
+
+    // the slot can only be reused after top moves past it, which makes the swap fail
+    struct work_item* item = (struct work_item*)atomicReadPointer(&deque->slots[top % DEQUE_SIZE]);
+    if (!atomicCompareSwap64(&deque->top, top, top + 1)) return NULL;
+    return item;
+}
+
+// =====================
+// FINDING WORK
+// =====================
+
+static struct work_item* takeShared(struct work_pool* pool) {
+    if (atomicLoadLong(&pool->shared_count) == 0) return NULL;
+
+    mutexLock(&pool->shared_lock);
+    struct work_item* item = pool->shared_head;
+    if (item) {
+        pool->shared_head = item->next;
+        if (!pool->shared_head) pool->shared_tail = NULL;
+        atomicAddLong(&pool->shared_count, -1);
+    }
+    mutexUnlock(&pool->shared_lock);
+    return item;
+}
+
+// xorshift
+static unsigned int nextRandom(unsigned int* state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// self = the calling worker (NULL for an outside thread)
+static struct work_item* findWork(struct work_pool* pool, struct pool_worker* self) {
+    struct work_item* item = NULL;
+
+    if (self) item = popBottom(&self->deque);
+    if (!item) item = takeShared(pool);
+    if (item) return item;
+
+    // steal, starting from a random victim so thieves spread out
+    unsigned int local_seed = (unsigned int)(size_t)&item;
+    unsigned int start = nextRandom(self ? &self->seed : &local_seed) % (unsigned int)pool->thread_count;
+    for (int i = 0; i < pool->thread_count; i++) {
+        struct pool_worker* victim = &pool->workers[(start + i) % pool->thread_count];
+        if (victim == self) continue;
+
+        item = stealTop(&victim->deque);
+        if (item) {
+            if (self) atomicIncrement64(&self->stolen);
+            return item;
+        }
+    }
+    return NULL;
+}
+
+static void runItem(struct pool_worker* self, struct work_item* item) {
+    // everything about the item is read before it's marked done (then it may be gone)
+    struct work_group* group = item->group;
+    item->fn(item->arg);
+    if (self) atomicIncrement64(&self->executed);
+    atomicAddLong(&group->pending, -1);
+}
+
+// anything queued anywhere (checked before going to sleep)
+static int hasWork(struct work_pool* pool) {
+    if (atomicLoadLong(&pool->shared_count) > 0) return 1;
+    for (int i = 0; i < pool->thread_count; i++) {
+        struct work_deque* deque = &pool->workers[i].deque;
+        if (atomicLoad64(&deque->top) < atomicLoad64(&deque->bottom)) return 1;
+    }
+    return 0;
+}
+
+static void wakeWorker(struct work_pool* pool) {
+    if (atomicLoadLong(&pool->sleepers) == 0) return;
+    mutexLock(&pool->sleep_lock);
+    condSignal(&pool->wake);
+    mutexUnlock(&pool->sleep_lock);
+}
+
+static void workerLoop(void* arg) {
+    struct pool_worker* self = (struct pool_worker*)arg;
+    struct work_pool* pool = self->pool;
+    t_worker = self;
+
+    char name[32];
+    snprintf(name, sizeof(name), "pool worker %d", (int)(self - pool->workers) + 1);
+    traceThreadName(name);
+
+    int idle = 0;
+    while (!atomicLoadLong(&pool->stop)) {
+        struct work_item* item = findWork(pool, self);
+        if (item) {
+            runItem(self, item);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < IDLE_SPINS) {
+            threadYield();
+            continue;
+        }
+
+        // sleep; the second look happens after announcing it, so a submitter
+        // either sees the sleeper (and signals) or we see its work
+        mutexLock(&pool->sleep_lock);
+        atomicAddLong(&pool->sleepers, 1);
+        if (!hasWork(pool) && !atomicLoadLong(&pool->stop)) condWait(&pool->wake, &pool->sleep_lock);
+        atomicAddLong(&pool->sleepers, -1);
+        mutexUnlock(&pool->sleep_lock);
+        idle = 0;
+    }
+
+    t_worker = NULL;
+}
+
+// =====================
+// POOL
+// =====================
+
+struct work_pool* createWorkPool(int threads) {
+    if (threads <= 0) threads = platformCpuCount();
+
+    struct work_pool* pool = (struct work_pool*)calloc(1, sizeof(struct work_pool));
+    if (!pool) return NULL;
+
+    pool->workers = (struct pool_worker*)calloc(threads, sizeof(struct pool_worker));
+    pool->threads = (platform_thread*)calloc(threads, sizeof(platform_thread));
+    if (!pool->workers || !pool->threads) {
+        free(pool->workers);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+
+    mutexInit(&pool->shared_lock);
+    mutexInit(&pool->sleep_lock);
+    condInit(&pool->wake);
+
+    for (int i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].seed = 2463534242u + 7919u * (unsigned int)i;
+        initDeque(&pool->workers[i].deque);
+    }
+
+    // thread_count has to be final before any worker looks at the others
+    pool->thread_count = threads;
+    int started = 0;
+    while (started < threads && threadStart(&pool->threads[started], workerLoop, &pool->workers[started])) started++;
+
+    if (started < threads) {
+        // workers that did start may be stealing from the rest; stop them all
+        atomicStoreLong(&pool->stop, 1);
+        mutexLock(&pool->sleep_lock);
+        condBroadcast(&pool->wake);
+        mutexUnlock(&pool->sleep_lock);
+        for (int i = 0; i < started; i++) threadJoin(pool->threads[i]);
+
+        condDestroy(&pool->wake);
+        mutexDestroy(&pool->sleep_lock);
+        mutexDestroy(&pool->shared_lock);
+        free(pool->workers);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void freeWorkPool(struct work_pool* pool) {
+    if (!pool) return;
+
+    atomicStoreLong(&pool->stop, 1);
+    mutexLock(&pool->sleep_lock);
+    condBroadcast(&pool->wake);
+    mutexUnlock(&pool->sleep_lock);
+
+    for (int i = 0; i < pool->thread_count; i++) threadJoin(pool->threads[i]);
+
+    condDestroy(&pool->wake);
+    mutexDestroy(&pool->sleep_lock);
+    mutexDestroy(&pool->shared_lock);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+int workPoolThreads(const struct work_pool* pool) {
+    return pool ? pool->thread_count : 1;
+}
+
+void getWorkPoolStats(struct work_pool* pool, struct work_pool_stats* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    stats->threads = workPoolThreads(pool);
+    if (!pool) return;
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        stats->executed += atomicLoad64(&pool->workers[i].executed);
+        stats->stolen += atomicLoad64(&pool->workers[i].stolen);
+    }
+    stats->inline_runs = atomicLoad64(&pool->inline_runs);
+}
+
+// =====================
+// SUBMITTING / WAITING
+// =====================
+
+void initWorkGroup(struct work_group* group) {
+    group->pending = 0;
+}
+
+void submitWork(struct work_pool* pool, struct work_group* group, struct work_item* item, WorkFn fn, void* arg) {
+
+    if (!pool) {
+        fn(arg);
+        return;
+    }
+
+    item->fn = fn;
+    item->arg = arg;
+    item->group = group;
+    item->next = NULL;
+    atomicAddLong(&group->pending, 1);
+
+    struct pool_worker* self = t_worker;
+    if (self && self->pool == pool) {
+        // a worker keeps its own work close; it's stolen from the other end
+        if (!pushBottom(&self->deque, item)) {
+            atomicIncrement64(&pool->inline_runs);
+            runItem(self, item);
+            return;
+        }
+    }
+    else {
+        mutexLock(&pool->shared_lock);
+        if (pool->shared_tail) pool->shared_tail->next = item;
+        else pool->shared_head = item;
+        pool->shared_tail = item;
+        atomicAddLong(&pool->shared_count, 1);
+        mutexUnlock(&pool->shared_lock);
+    }
+
+    wakeWorker(pool);
+}
+
+void waitWorkGroup(struct work_pool* pool, struct work_group* group) {
+    if (!pool) return;
+
+    struct pool_worker* self = t_worker;
+    if (self && self->pool != pool) self = NULL;
+
+    // help rather than block: this may run unrelated work, which is fine, and
+    // it's what keeps nested waits from deadlocking
+    while (atomicLoadLong(&group->pending) > 0) {
+        struct work_item* item = findWork(pool, self);
+        if (item) runItem(self, item);
+        else threadYield();
+    }
+}
+
+// =====================
+// PARALLEL FOR
+// =====================
+
+struct range_job {
+    WorkRangeFn fn;
+    void* arg;
+    int grain;
+    struct work_pool* pool;
+    struct work_group group;
+
+    struct range_task* tasks;   // every piece that gets split off
+    int task_capacity;
+    volatile long tasks_used;
+};
+
+struct range_task {
+    struct work_item item;
+    struct range_job* job;
+    int begin;
+    int end;
+};
+
+static void runRange(void* arg) {
+    struct range_task* task = (struct range_task*)arg;
+    struct range_job* job = task->job;
+    int begin = task->begin, end = task->end;
+
+    // hand off the upper half until what's left is one grain; the halves go on
+    // this worker's deque, so thieves take the biggest pieces
+    while (end - begin > job->grain) {
+        long slot = atomicAddLong(&job->tasks_used, 1) - 1;
+        if (slot >= job->task_capacity) break;
+
+        int middle = begin + (end - begin) / 2;
+        struct range_task* half = &job->tasks[slot];
+        half->job = job;
+        half->begin = middle;
+        half->end = end;
+        submitWork(job->pool, &job->group, &half->item, runRange, half);
+        end = middle;
+    }
+
+    job->fn(begin, end, job->arg);
+}
+
+void parallelFor(struct work_pool* pool, int count, int grain, WorkRangeFn fn, void* arg) {
+    if (count <= 0) return;
+
+    int threads = workPoolThreads(pool);
+    if (grain <= 0) grain = count / (threads * 8) > 0 ? count / (threads * 8) : 1;
+
+    if (!pool || count <= grain) {
+        fn(0, count, arg);
+        return;
+    }
+
+    struct range_job job;
+    job.fn = fn;
+    job.arg = arg;
+    job.grain = grain;
+    job.pool = pool;
+    initWorkGroup(&job.group);
+
+    // halving stops once a piece is at most one grain, so pieces are over half a grain
+    job.task_capacity = 2 * (count / grain) + 2;
+    job.tasks = (struct range_task*)malloc(job.task_capacity * sizeof(struct range_task));
+    job.tasks_used = 1;
+    if (!job.tasks) {
+        fn(0, count, arg);
+        return;
+    }
+
+    struct range_task* root = &job.tasks[0];
+    root->job = &job;
+    root->begin = 0;
+    root->end = count;
+    submitWork(pool, &job.group, &root->item, runRange, root);
+    waitWorkGroup(pool, &job.group);
+
+    free(job.tasks);
+}
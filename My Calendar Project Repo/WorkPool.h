@@ -0,0 +1,71 @@
+#pragma once
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Work-stealing thread pool, shared by everything that scans a whole calendar
+    // (parallel load / save / search, term index builds) so features don't each
+    // start their own threads.
+    //
+    // Every worker has its own deque: it pushes and pops work at one end, and an
+    // idle worker steals from the other end of someone else's. Work submitted from
+    // a thread that isn't a worker goes into a shared queue first. A thread waiting
+    // for a group of work doesn't block, it runs queued work (anyone's) until the
+    // group is done, so work can submit more work and wait for it.
+    //
+    // A NULL pool is allowed everywhere and means "run it right here", which is
+    // how the serial versions of the calendar ops are written.
+    struct work_pool;
+
+    typedef void (*WorkFn)(void* arg);
+
+    // counts the submitted work that hasn't finished yet
+    struct work_group {
+        volatile long pending;
+    };
+
+    // one piece of submitted work; the submitter owns the memory, which has to
+    // stay put until waitWorkGroup returns
+    struct work_item {
+        WorkFn fn;
+        void* arg;
+        struct work_group* group;
+        struct work_item* next;         // used by the shared queue
+    };
+
+    struct work_pool_stats {
+        int threads;
+        unsigned long long executed;    // work items run by the workers
+        unsigned long long stolen;      // ...of which taken from another worker's deque
+        unsigned long long inline_runs; // run by the submitter because a deque was full
+    };
+
+    // threads = worker threads (0 = one per CPU); NULL if none could be started
+    struct work_pool* createWorkPool(int threads);
+    // all submitted work must be finished (waited for) first
+    void freeWorkPool(struct work_pool* pool);
+
+    // how many threads work can run on at once (1 for a NULL pool)
+    int workPoolThreads(const struct work_pool* pool);
+
+    void initWorkGroup(struct work_group* group);
+    void submitWork(struct work_pool* pool, struct work_group* group, struct work_item* item, WorkFn fn, void* arg);
+    // returns once everything submitted to group has run (helping out meanwhile)
+    void waitWorkGroup(struct work_pool* pool, struct work_group* group);
+
+    // runs fn over [0, count) in ranges of about "grain" (<= 0: picked from the
+    // thread count); ranges are split in halves on demand, so idle workers steal
+    // big pieces first. Returns when every range is done.
+    typedef void (*WorkRangeFn)(int begin, int end, void* arg);
+    void parallelFor(struct work_pool* pool, int count, int grain, WorkRangeFn fn, void* arg);
+
+    void getWorkPoolStats(struct work_pool* pool, struct work_pool_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
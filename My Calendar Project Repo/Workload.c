@@ -0,0 +1,364 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Workload.h"
+
+#define WORKLOAD_MAX_YEARS 10000
+// dates an update / delete tries before it settles for an add (an empty calendar)
+#define WORKLOAD_FIND_TRIES 8
+
+static const char* const g_default_words[] = {
+    "meeting", "review", "call", "lunch", "report", "dentist", "budget", "gym",
+    "standup", "release", "invoice", "design", "school", "doctor", "trip", "party",
+    "planning", "dinner", "email", "deadline", "interview", "birthday", "groceries", "laundry",
+    "payroll", "workshop", "demo", "retro", "backup", "deploy", "audit", "training",
+    "pickup", "appointment", "flight", "hotel", "rent", "insurance", "haircut", "vet",
+    "concert", "webinar", "onboarding", "migration", "taxes", "renewal", "inventory", "offsite",
+    "conference", "checkup", "recital", "tournament", "volunteer", "fundraiser", "anniversary", "graduation",
+    "mortgage", "plumber", "electrician", "warranty", "passport", "visa", "marathon", "hackathon"
+};
+
+struct workload_date {
+    int year;
+    int month;
+    int day;
+};
+
+// Zipf over ranks 0..size-1: cdf[i] = sum of 1 / (k + 1)^skew for k <= i (NULL = uniform)
+struct zipf_picker {
+    double* cdf;
+    int size;
+};
+
+struct workload {
+    struct workload_options options;
+    const char* const* words;
+    int word_count;
+
+    // separate streams, so the dates drawn don't depend on the descriptions
+    unsigned long long date_state;
+    unsigned long long text_state;
+
+    struct workload_date* dates;        // every day of the span, in date order
+    int* by_rank;                       // rank -> index into dates
+    int date_count;
+
+    struct zipf_picker date_picker;
+    struct zipf_picker word_picker;
+
+    char description[DESC_LEN];
+};
+
+// =====================
+// RANDOM NUMBERS
+// =====================
+
+// splitmix64, to turn the seed into stream states
+static unsigned long long mixSeed(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x ? x : 1;
+}
+
+// xorshift64*
+static unsigned long long nextRandom(unsigned long long* state) {
+    unsigned long long x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+// [0, 1)
+static double nextUniform(unsigned long long* state) {
+    return (double)(nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int initZipf(struct zipf_picker* picker, int size, double skew) {
+
+    picker->size = size;
+    picker->cdf = NULL;
+    if (skew <= 0) return 1;
+
+    picker->cdf = (double*)malloc(size * sizeof(double));
+    if (!picker->cdf) return 0;
+
+    double total = 0;
+    for (int i = 0; i < size; i++) {
+        total += 1.0 / pow(i + 1, skew);
+        picker->cdf[i] = total;
+    }
+    return 1;
+}
+
+static int pickZipf(const struct zipf_picker* picker, unsigned long long* state) {
+
+    if (!picker->cdf) return (int)(nextRandom(state) % (unsigned long long)picker->size);
+
+    // first rank whose running total is past the draw
+    double target = nextUniform(state) * picker->cdf[picker->size - 1];
+    int low = 0, high = picker->size - 1;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (picker->cdf[middle] > target) high = middle;
+        else low = middle + 1;
+    }
+    return low;
+}
+
+// =====================
+// WORKLOAD
+// =====================
+
+void initWorkloadOptions(struct workload_options* options) {
+    memset(options, 0, sizeof(*options));
+    options->seed = 1;
+    options->first_year = 2000;
+    options->last_year = 2029;
+    options->date_skew = 1.0;
+    options->min_length = 8;
+    options->max_length = 60;
+    options->length_distribution = WORKLOAD_LENGTH_UNIFORM;
+    options->word_skew = 1.0;
+}
+
+struct workload* createWorkload(const struct workload_options* options) {
+
+    if (options->last_year < options->first_year) return NULL;
+    if (options->last_year - options->first_year >= WORKLOAD_MAX_YEARS) return NULL;
+    if (options->min_length < 1 || options->max_length < options->min_length || options->max_length >= DESC_LEN) return NULL;
+    if (options->vocabulary && options->vocabulary_size < 1) return NULL;
+
+    struct workload* workload = (struct workload*)calloc(1, sizeof(struct workload));
+    if (!workload) return NULL;
+
+    workload->options = *options;
+    workload->words = options->vocabulary ? options->vocabulary : g_default_words;
+    workload->word_count = options->vocabulary ? options->vocabulary_size
+        : (int)(sizeof(g_default_words) / sizeof(g_default_words[0]));
+    workload->date_state = mixSeed(options->seed * 3ULL);
+    workload->text_state = mixSeed(options->seed * 3ULL + 1);
+
+    int year_count = options->last_year - options->first_year + 1;
+    workload->dates = (struct workload_date*)malloc(year_count * 366 * sizeof(struct workload_date));
+    workload->by_rank = (int*)malloc(year_count * 366 * sizeof(int));
+    if (!workload->dates || !workload->by_rank) {
+        freeWorkload(workload);
+        return NULL;
+    }
+
+    for (int year = options->first_year; year <= options->last_year; year++) {
+        for (int month = 1; month <= 12; month++) {
+            for (int day = 1; day <= daysInMonth(year, month); day++) {
+                struct workload_date* date = &workload->dates[workload->date_count];
+                date->year = year;
+                date->month = month;
+                date->day = day;
+                workload->by_rank[workload->date_count] = workload->date_count;
+                workload->date_count++;
+            }
+        }
+    }
+
+    // hot days spread over the span instead of all in the first weeks
+    unsigned long long shuffle_state = mixSeed(options->seed * 3ULL + 2);
+    for (int i = workload->date_count - 1; i > 0; i--) {
+        int j = (int)(nextRandom(&shuffle_state) % (unsigned long long)(i + 1));
+        int swap = workload->by_rank[i];
+        workload->by_rank[i] = workload->by_rank[j];
+        workload->by_rank[j] = swap;
+    }
+
+    if (!initZipf(&workload->date_picker, workload->date_count, options->date_skew)
+        || !initZipf(&workload->word_picker, workload->word_count, options->word_skew)) {
+        freeWorkload(workload);
+        return NULL;
+    }
+    return workload;
+}
+
+void freeWorkload(struct workload* workload) {
+    if (!workload) return;
+    free(workload->dates);
+    free(workload->by_rank);
+    free(workload->date_picker.cdf);
+    free(workload->word_picker.cdf);
+    free(workload);
+}
+
+// index into dates
+static int drawDate(struct workload* workload) {
+    return workload->by_rank[pickZipf(&workload->date_picker, &workload->date_state)];
+}
+
+static const char* drawWord(struct workload* workload) {
+    return workload->words[pickZipf(&workload->word_picker, &workload->text_state)];
+}
+
+static int drawLength(struct workload* workload) {
+
+    const struct workload_options* options = &workload->options;
+    int spread = options->max_length - options->min_length;
+
+    if (options->length_distribution == WORKLOAD_LENGTH_LONG_TAIL) {
+        double extra = -log(1.0 - nextUniform(&workload->text_state)) * (spread / 8.0);
+        return extra >= spread ? options->max_length : options->min_length + (int)extra;
+    }
+    return options->min_length + (int)(nextRandom(&workload->text_state) % (unsigned long long)(spread + 1));
+}
+
+// words until the drawn length; the last one is cut to fit
+static const char* drawDescription(struct workload* workload) {
+
+    char* description = workload->description;
+    int target = drawLength(workload);
+    int length = 0;
+
+    while (length < target) {
+        const char* word = drawWord(workload);
+        int word_length = (int)strlen(word);
+        if (word_length == 0) break;
+
+        if (length > 0) {
+            // no room for a space and a letter: make the last word a plural
+            if (target - length < 2) {
+                description[length++] = 's';
+                break;
+            }
+            description[length++] = ' ';
+        }
+        if (word_length > target - length) word_length = target - length;
+        memcpy(description + length, word, word_length);
+        length += word_length;
+    }
+
+    description[length] = '\0';
+    return description;
+}
+
+void nextWorkloadTask(struct workload* workload, struct task_entry* entry) {
+
+    const struct workload_date* date = &workload->dates[drawDate(workload)];
+    entry->year = date->year;
+    entry->month = date->month;
+    entry->day = date->day;
+    entry->description = drawDescription(workload);
+}
+
+// =====================
+// FILES
+// =====================
+
+long writeWorkloadTasks(const struct workload_options* options, long tasks, enum workload_format format, FILE* out) {
+
+    struct workload* workload = createWorkload(options);
+    if (!workload) return -1;
+
+    if (format == WORKLOAD_COMMANDS) {
+        struct task_entry entry;
+        for (long i = 0; i < tasks; i++) {
+            nextWorkloadTask(workload, &entry);
+            fprintf(out, "add %d %d %d %s\n", entry.year, entry.month, entry.day, entry.description);
+        }
+    }
+    else {
+        // the same dates as the commands (the date stream doesn't depend on the
+        // text), counted first so they can come out in date order
+        long* counts = (long*)calloc(workload->date_count, sizeof(long));
+        if (!counts) {
+            freeWorkload(workload);
+            return -1;
+        }
+        for (long i = 0; i < tasks; i++) counts[drawDate(workload)]++;
+
+        int current_year = 0;
+        for (int i = 0; i < workload->date_count; i++) {
+            const struct workload_date* date = &workload->dates[i];
+            for (long n = 0; n < counts[i]; n++) {
+                // only years that have tasks, like the commands would create
+                if (date->year != current_year) {
+                    fprintf(out, "[YEAR] %d\n", date->year);
+                    current_year = date->year;
+                }
+                fprintf(out, "%d %d %s\n", date->month, date->day, drawDescription(workload));
+            }
+        }
+        free(counts);
+    }
+
+    freeWorkload(workload);
+    return ferror(out) ? -1 : tasks;
+}
+
+enum trace_op {
+    TRACE_ADD,
+    TRACE_UPDATE,
+    TRACE_DELETE,
+    TRACE_SEARCH
+};
+
+long writeWorkloadTrace(const struct workload_options* options, long initial_tasks,
+    const struct workload_mix* mix, long operations, FILE* out) {
+
+    int weights[4] = { mix->add_weight, mix->update_weight, mix->delete_weight, mix->search_weight };
+    int total_weight = 0;
+    for (int i = 0; i < 4; i++) {
+        if (weights[i] < 0) return -1;
+        total_weight += weights[i];
+    }
+    if (total_weight == 0) return -1;
+
+    struct workload* workload = createWorkload(options);
+    if (!workload) return -1;
+
+    // tasks per day in the calendar the trace starts from, kept up to date as it goes
+    long* counts = (long*)calloc(workload->date_count, sizeof(long));
+    if (!counts) {
+        freeWorkload(workload);
+        return -1;
+    }
+    for (long i = 0; i < initial_tasks; i++) counts[drawDate(workload)]++;
+
+    for (long i = 0; i < operations; i++) {
+        int draw = (int)(nextRandom(&workload->date_state) % (unsigned long long)total_weight);
+        int op = 0;
+        while (draw >= weights[op]) draw -= weights[op++];
+
+        if (op == TRACE_SEARCH) {
+            fprintf(out, "search %s\n", drawWord(workload));
+            continue;
+        }
+
+        int index = drawDate(workload);
+        if (op != TRACE_ADD) {
+            for (int tries = 1; counts[index] == 0 && tries < WORKLOAD_FIND_TRIES; tries++) index = drawDate(workload);
+            if (counts[index] == 0) op = TRACE_ADD;
+        }
+
+        const struct workload_date* date = &workload->dates[index];
+        int task_id = counts[index] > 0 ? 1 + (int)(nextRandom(&workload->date_state) % (unsigned long long)counts[index]) : 0;
+
+        switch (op) {
+        case TRACE_ADD:
+            fprintf(out, "add %d %d %d %s\n", date->year, date->month, date->day, drawDescription(workload));
+            counts[index]++;
+            break;
+        case TRACE_UPDATE:
+            fprintf(out, "update %d %d %d %d %s\n", date->year, date->month, date->day, task_id, drawDescription(workload));
+            break;
+        case TRACE_DELETE:
+            fprintf(out, "delete %d %d %d %d\n", date->year, date->month, date->day, task_id);
+            counts[index]--;
+            break;
+        }
+    }
+
+    free(counts);
+    freeWorkload(workload);
+    return ferror(out) ? -1 : operations;
+}
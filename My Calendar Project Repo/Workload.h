@@ -0,0 +1,88 @@
+#pragma once
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdio.h>
+
+#include "Calendar.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    // Synthetic calendars and operation traces, for load tests at sizes the
+    // sample tasks.txt can't reach. Everything comes from the seed: the same
+    // options always give the same tasks, in the same order.
+    //
+    // Dates: every day from first_year to last_year gets a rank (in a shuffled
+    // order), and dates are drawn with a Zipf distribution over the rank, with
+    // date_skew as the exponent. 0 makes every day equally likely; around 1 a
+    // handful of hot days get thousands of tasks each and most days get a few.
+    //
+    // Descriptions: words from the vocabulary (a built-in one when none is given),
+    // also Zipf-drawn with word_skew, up to a length drawn between min_length and
+    // max_length. Searches in a trace look for those same words, so common words
+    // hit a lot of tasks and rare ones hardly any.
+    struct workload;
+
+    enum workload_format {
+        WORKLOAD_TASKS_FILE,        // tasks.txt: a [YEAR] section per year, tasks in date order
+        WORKLOAD_COMMANDS           // "add Y M D text" lines (Commands.h), in the order they were drawn
+    };
+
+    enum workload_length {
+        WORKLOAD_LENGTH_UNIFORM,    // every length from min to max equally likely
+        WORKLOAD_LENGTH_LONG_TAIL   // mostly short, now and then up to max (exponential, mean min + (max - min) / 8)
+    };
+
+    struct workload_options {
+        unsigned int seed;
+        int first_year;
+        int last_year;
+        double date_skew;
+        int min_length;                     // description length in characters (max below DESC_LEN)
+        int max_length;
+        enum workload_length length_distribution;
+        const char* const* vocabulary;      // NULL = built-in words (not copied; must outlive the workload)
+        int vocabulary_size;
+        double word_skew;
+    };
+
+    // how often each operation shows up in a trace (relative weights)
+    struct workload_mix {
+        int add_weight;
+        int update_weight;
+        int delete_weight;
+        int search_weight;
+    };
+
+    // defaults: seed 1, 2000-2029, date_skew 1.0, 8-60 characters uniform, built-in words, word_skew 1.0
+    void initWorkloadOptions(struct workload_options* options);
+
+    // NULL if the options make no sense (years backwards or over 10000 of them,
+    // bad lengths, empty vocabulary) or memory runs out
+    struct workload* createWorkload(const struct workload_options* options);
+    void freeWorkload(struct workload* workload);
+
+    // draws the next task; entry->description stays valid until the next call
+    void nextWorkloadTask(struct workload* workload, struct task_entry* entry);
+
+    // writes tasks tasks; returns how many, or -1 on bad options / a write error.
+    // Both formats put the same number of tasks on each day (the tasks file in
+    // date order, so its descriptions are drawn in a different order).
+    long writeWorkloadTasks(const struct workload_options* options, long tasks, enum workload_format format, FILE* out);
+
+    // writes operations command lines (Commands.h) that run against the calendar
+    // writeWorkloadTasks made from the same options and initial_tasks: add,
+    // update Y M D ID, delete Y M D ID and search. Updates and deletes go to the
+    // same skewed dates and always name a task that exists at that point, so
+    // replaying the trace (app --batch, or a command session) gets no errors.
+    // Returns how many lines were written, or -1.
+    long writeWorkloadTrace(const struct workload_options* options, long initial_tasks,
+        const struct workload_mix* mix, long operations, FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif